@@ -18,8 +18,10 @@ find_package(SDL2 REQUIRED)
 CPMAddPackage("gh:g-truc/glm#master") # GLM
 
 find_package(Vulkan REQUIRED)
+find_package(Threads REQUIRED)
 set(DEPENDENCIES
     SDL2::SDL2
     Vulkan::Vulkan
     glm::glm
+    Threads::Threads
 )
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 450
+
+#include "clustered_lighting.glsl"
+
+layout(location = 0) in vec3 inWorldPos;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec3 inAlbedo;
+
+layout(push_constant) uniform PushConstants
+{
+    vec4 cameraPosition;
+} push;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    float viewDepth = -(clusterParams.view * vec4(inWorldPos, 1.0)).z;
+
+    if (clusterDebugHeatmap())
+    {
+        outColor = vec4(clusterHeatmap(gl_FragCoord.xy, viewDepth), 1.0);
+        return;
+    }
+
+    vec3 N = normalize(inNormal);
+    vec3 V = normalize(push.cameraPosition.xyz - inWorldPos);
+    vec3 color = shadeClustered(inWorldPos, N, V, inAlbedo, gl_FragCoord.xy, viewDepth);
+
+    outColor = vec4(color, 1.0);
+}
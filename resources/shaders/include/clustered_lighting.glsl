@@ -0,0 +1,149 @@
+#ifndef CLUSTERED_LIGHTING_GLSL
+#define CLUSTERED_LIGHTING_GLSL
+
+// Shared declarations of the clustered forward lighting data, see ClusteredLighting on the C++ side.
+// Define CLUSTER_CULLING before including to get writable cluster buffers (compute passes only).
+
+#ifndef CLUSTER_SET
+#define CLUSTER_SET 0
+#endif
+
+#ifdef CLUSTER_CULLING
+#define CLUSTER_ACCESS
+#else
+#define CLUSTER_ACCESS readonly
+#endif
+
+#define LIGHT_TYPE_POINT 0
+#define LIGHT_TYPE_SPOT 1
+
+struct Light
+{
+    vec4 positionRange;  // xyz world position, w range
+    vec4 colorIntensity; // rgb color, a intensity
+    vec4 directionType;  // xyz world direction (spot only), w light type
+    vec4 spotCone;       // x cos inner angle, y cos outer angle, z sin outer angle
+};
+
+layout(set = CLUSTER_SET, binding = 0) uniform ClusterParams
+{
+    mat4 view;
+    mat4 inverseProjection;
+    uvec4 gridSize;   // xyz cluster counts, w light count
+    vec4 screenSize;  // xy render size in pixels, zw tile size in pixels
+    vec4 depthSlice;  // x near, y far, z slice scale, w slice bias
+    uvec4 options;    // x max lights per cluster, y debug heatmap
+} clusterParams;
+
+layout(std430, set = CLUSTER_SET, binding = 1) readonly buffer LightBuffer
+{
+    Light lights[];
+};
+
+// view space AABB per cluster, min at 2 * i and max at 2 * i + 1
+layout(std430, set = CLUSTER_SET, binding = 2) CLUSTER_ACCESS buffer ClusterBoundsBuffer
+{
+    vec4 clusterBounds[];
+};
+
+// x offset into lightIndices, y light count
+layout(std430, set = CLUSTER_SET, binding = 3) CLUSTER_ACCESS buffer LightGridBuffer
+{
+    uvec2 lightGrid[];
+};
+
+layout(std430, set = CLUSTER_SET, binding = 4) CLUSTER_ACCESS buffer LightIndexBuffer
+{
+    uint lightIndices[];
+};
+
+layout(std430, set = CLUSTER_SET, binding = 5) CLUSTER_ACCESS buffer LightIndexCounter
+{
+    uint lightIndexCount;
+};
+
+uint clusterSlice(float viewDepth)
+{
+    float slice = log(max(viewDepth, clusterParams.depthSlice.x)) * clusterParams.depthSlice.z - clusterParams.depthSlice.w;
+    return min(uint(max(slice, 0.0)), clusterParams.gridSize.z - 1);
+}
+
+uint clusterIndex(vec2 fragCoord, float viewDepth)
+{
+    uvec2 tile = min(uvec2(fragCoord / clusterParams.screenSize.zw), clusterParams.gridSize.xy - 1);
+    uint slice = clusterSlice(viewDepth);
+    return tile.x + clusterParams.gridSize.x * (tile.y + clusterParams.gridSize.y * slice);
+}
+
+vec3 evaluateLight(Light light, vec3 worldPos, vec3 N, vec3 V, vec3 albedo)
+{
+    vec3 L = light.positionRange.xyz - worldPos;
+    float lightDistance = length(L);
+    float range = light.positionRange.w;
+    if (lightDistance >= range)
+    {
+        return vec3(0.0);
+    }
+    L /= lightDistance;
+
+    // inverse square falloff windowed to reach zero at the light range
+    float window = clamp(1.0 - pow(lightDistance / range, 4.0), 0.0, 1.0);
+    float attenuation = window * window / (lightDistance * lightDistance + 1.0);
+
+    if (uint(light.directionType.w) == LIGHT_TYPE_SPOT)
+    {
+        float cosAngle = dot(-L, light.directionType.xyz);
+        attenuation *= smoothstep(light.spotCone.y, light.spotCone.x, cosAngle);
+    }
+
+    float NdotL = max(dot(N, L), 0.0);
+    vec3 H = normalize(L + V);
+    float specular = pow(max(dot(N, H), 0.0), 32.0) * 0.25;
+
+    return light.colorIntensity.rgb * light.colorIntensity.a * attenuation * NdotL * (albedo + specular);
+}
+
+// Walk only the lights binned into the cluster containing this fragment
+vec3 shadeClustered(vec3 worldPos, vec3 N, vec3 V, vec3 albedo, vec2 fragCoord, float viewDepth)
+{
+    uvec2 cell = lightGrid[clusterIndex(fragCoord, viewDepth)];
+
+    vec3 color = vec3(0.0);
+    for (uint i = 0; i < cell.y; i++)
+    {
+        color += evaluateLight(lights[lightIndices[cell.x + i]], worldPos, N, V, albedo);
+    }
+    return color;
+}
+
+// Reference path looping over every light, used for validation and benchmarking
+vec3 shadeBruteForce(vec3 worldPos, vec3 N, vec3 V, vec3 albedo)
+{
+    vec3 color = vec3(0.0);
+    for (uint i = 0; i < clusterParams.gridSize.w; i++)
+    {
+        color += evaluateLight(lights[i], worldPos, N, V, albedo);
+    }
+    return color;
+}
+
+// Blue (few lights) to green to red (cluster list full), black for empty clusters
+vec3 clusterHeatmap(vec2 fragCoord, float viewDepth)
+{
+    uint count = lightGrid[clusterIndex(fragCoord, viewDepth)].y;
+    if (count == 0)
+    {
+        return vec3(0.0);
+    }
+
+    float t = clamp(float(count) / float(max(clusterParams.options.x, 1u)), 0.0, 1.0);
+    return t < 0.5 ? mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), t * 2.0)
+                   : mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), t * 2.0 - 1.0);
+}
+
+bool clusterDebugHeatmap()
+{
+    return clusterParams.options.y != 0;
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef MIP_GENERATION_GLSL
+#define MIP_GENERATION_GLSL
+
+// Single pass mip chain generation in the style of AMD FidelityFX SPD, see MipGenerator on the C++ side. The
+// including shader defines MIP_FORMAT, the format qualifier of the storage views.
+//
+// Every group reads a 64x64 block of level 0 once, writes the 32x32 block of level 1 and reduces it in shared memory
+// down to level 6. The last group to finish builds the remaining small levels from level 6, so the whole chain is a
+// single dispatch without a barrier per level.
+
+#define MAX_MIP_LEVELS 16
+#define GROUP_SIZE 16
+// levels produced inside a group, 32x32 down to 1x1
+#define GROUP_LEVELS 6
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+// sRGB textures are written through UNORM views, the filter averages linear values
+layout(constant_id = 0) const bool SRGB = false;
+
+// one storage view per level, unused bindings alias the last level
+layout(set = 0, binding = 0, MIP_FORMAT) uniform coherent image2D mips[MAX_MIP_LEVELS];
+layout(std430, set = 0, binding = 1) buffer MipCounters
+{
+    uint finishedGroups[];
+};
+
+layout(push_constant) uniform PushConstants
+{
+    ivec2 extent;    // level 0 in texels
+    int mipCount;
+    uint groupCount;
+    uint counter;    // slot in finishedGroups used by this dispatch
+} push;
+
+shared vec4 groupTexels[GROUP_SIZE][GROUP_SIZE];
+shared bool isLastGroup;
+
+ivec2 mipExtent(int level)
+{
+    return max(push.extent >> level, ivec2(1));
+}
+
+vec3 toLinear(vec3 color)
+{
+    return mix(color / 12.92, pow((color + 0.055) / 1.055, vec3(2.4)), greaterThan(color, vec3(0.04045)));
+}
+
+vec3 toSrgb(vec3 color)
+{
+    return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, greaterThan(color, vec3(0.0031308)));
+}
+
+// image arrays may only be indexed with constants without extra device features
+vec4 loadMip(int level, ivec2 texel)
+{
+    vec4 value = vec4(0.0);
+    switch (level)
+    {
+    case 0: value = imageLoad(mips[0], texel); break;
+    case 1: value = imageLoad(mips[1], texel); break;
+    case 2: value = imageLoad(mips[2], texel); break;
+    case 3: value = imageLoad(mips[3], texel); break;
+    case 4: value = imageLoad(mips[4], texel); break;
+    case 5: value = imageLoad(mips[5], texel); break;
+    case 6: value = imageLoad(mips[6], texel); break;
+    case 7: value = imageLoad(mips[7], texel); break;
+    case 8: value = imageLoad(mips[8], texel); break;
+    case 9: value = imageLoad(mips[9], texel); break;
+    case 10: value = imageLoad(mips[10], texel); break;
+    case 11: value = imageLoad(mips[11], texel); break;
+    case 12: value = imageLoad(mips[12], texel); break;
+    case 13: value = imageLoad(mips[13], texel); break;
+    case 14: value = imageLoad(mips[14], texel); break;
+    case 15: value = imageLoad(mips[15], texel); break;
+    }
+    return SRGB ? vec4(toLinear(value.rgb), value.a) : value;
+}
+
+void storeMip(int level, ivec2 texel, vec4 value)
+{
+    if (any(greaterThanEqual(texel, mipExtent(level))))
+    {
+        return;
+    }
+    value = SRGB ? vec4(toSrgb(value.rgb), value.a) : value;
+    switch (level)
+    {
+    case 1: imageStore(mips[1], texel, value); break;
+    case 2: imageStore(mips[2], texel, value); break;
+    case 3: imageStore(mips[3], texel, value); break;
+    case 4: imageStore(mips[4], texel, value); break;
+    case 5: imageStore(mips[5], texel, value); break;
+    case 6: imageStore(mips[6], texel, value); break;
+    case 7: imageStore(mips[7], texel, value); break;
+    case 8: imageStore(mips[8], texel, value); break;
+    case 9: imageStore(mips[9], texel, value); break;
+    case 10: imageStore(mips[10], texel, value); break;
+    case 11: imageStore(mips[11], texel, value); break;
+    case 12: imageStore(mips[12], texel, value); break;
+    case 13: imageStore(mips[13], texel, value); break;
+    case 14: imageStore(mips[14], texel, value); break;
+    case 15: imageStore(mips[15], texel, value); break;
+    }
+}
+
+// 2x2 box filter over the level above. Extents round down like vkCmdBlitImage chains, so the quad of a valid texel is
+// always valid except in a dimension that is already a single texel, the clamp repeats that texel.
+vec4 downsample(int level, ivec2 target)
+{
+    ivec2 sourceMax = mipExtent(level - 1) - 1;
+    ivec2 source = target * 2;
+    return 0.25 * (loadMip(level - 1, min(source, sourceMax)) +
+                   loadMip(level - 1, min(source + ivec2(1, 0), sourceMax)) +
+                   loadMip(level - 1, min(source + ivec2(0, 1), sourceMax)) +
+                   loadMip(level - 1, min(source + ivec2(1, 1), sourceMax)));
+}
+
+// the same clamp for quads already in registers or shared memory, offset from the quad's first texel at source to
+// its second one, 0 in a dimension where the level above is a single texel
+ivec2 quadStep(int level, ivec2 source)
+{
+    return ivec2(lessThan(source + 1, mipExtent(level - 1)));
+}
+
+void main()
+{
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+    ivec2 group = ivec2(gl_WorkGroupID.xy);
+
+    // level 1 as a 2x2 block per thread, level 2 is the block's average and needs no shared memory yet
+    ivec2 block = group * GROUP_SIZE * 2 + local * 2;
+    vec4 quad[4];
+    for (int i = 0; i < 4; i++)
+    {
+        ivec2 target = block + ivec2(i & 1, i >> 1);
+        quad[i] = downsample(1, target);
+        storeMip(1, target, quad[i]);
+    }
+    ivec2 next = quadStep(2, block);
+    vec4 color = 0.25 * (quad[0] + quad[next.x] + quad[next.y * 2] + quad[next.x + next.y * 2]);
+    if (push.mipCount > 2)
+    {
+        storeMip(2, group * GROUP_SIZE + local, color);
+    }
+    groupTexels[local.y][local.x] = color;
+
+    // every further level halves the active threads, the reduced values stay in shared memory
+    int size = GROUP_SIZE;
+    for (int level = 3; level < min(push.mipCount, GROUP_LEVELS + 1); level++)
+    {
+        barrier();
+        size >>= 1;
+        bool active = all(lessThan(local, ivec2(size)));
+        if (active)
+        {
+            ivec2 source = local * 2;
+            next = quadStep(level, (group * size + local) * 2);
+            color = 0.25 * (groupTexels[source.y][source.x] + groupTexels[source.y][source.x + next.x] +
+                            groupTexels[source.y + next.y][source.x] +
+                            groupTexels[source.y + next.y][source.x + next.x]);
+        }
+        barrier();
+        if (active)
+        {
+            groupTexels[local.y][local.x] = color;
+            storeMip(level, group * size + local, color);
+        }
+    }
+
+    if (push.mipCount <= GROUP_LEVELS + 1)
+    {
+        return;
+    }
+
+    // make this group's levels visible before signaling, the last group continues with the small levels
+    memoryBarrierImage();
+    barrier();
+    if (gl_LocalInvocationIndex == 0)
+    {
+        isLastGroup = atomicAdd(finishedGroups[push.counter], 1) == push.groupCount - 1;
+    }
+    barrier();
+    if (!isLastGroup)
+    {
+        return;
+    }
+    if (gl_LocalInvocationIndex == 0)
+    {
+        // ready for the next dispatch using this slot without a separate clear
+        finishedGroups[push.counter] = 0;
+    }
+
+    for (int level = GROUP_LEVELS + 1; level < push.mipCount; level++)
+    {
+        ivec2 extent = mipExtent(level);
+        for (int i = int(gl_LocalInvocationIndex); i < extent.x * extent.y; i += GROUP_SIZE * GROUP_SIZE)
+        {
+            ivec2 target = ivec2(i % extent.x, i / extent.x);
+            storeMip(level, target, downsample(level, target));
+        }
+        memoryBarrierImage();
+        barrier();
+    }
+}
+
+#endif
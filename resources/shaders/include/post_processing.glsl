@@ -0,0 +1,39 @@
+#ifndef POST_PROCESSING_GLSL
+#define POST_PROCESSING_GLSL
+
+// Descriptor set and push constants shared by all post processing passes, see PostProcessing on the C++ side.
+// The scene and bloom images may be larger than the render extent, only the top left region is valid.
+
+#define MAX_BLOOM_MIPS 8
+
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+// one storage view per bloom level, level 0 is half the render extent
+layout(set = 0, binding = 1, rgba16f) uniform coherent image2D bloomMips[MAX_BLOOM_MIPS];
+layout(std430, set = 0, binding = 2) buffer DownsampleCounter
+{
+    uint finishedGroups;
+};
+// sampled view over the whole bloom chain
+layout(set = 0, binding = 3) uniform sampler2D bloomChain;
+layout(set = 0, binding = 4) uniform sampler3D gradingLut;
+layout(set = 0, binding = 5, rgba8) uniform writeonly image2D outputImage;
+
+layout(push_constant) uniform PushConstants
+{
+    vec4 sceneExtent; // xy render extent in pixels, zw 1 / scene image size
+    vec4 bloom;       // x threshold, y threshold knee, z mip count, w downsample group count
+    vec4 composite;   // x bloom intensity, y exposure, z vignette intensity
+} push;
+
+// valid extent of a bloom level, bloom images are allocated for the maximum render extent
+ivec2 bloomExtent(int level)
+{
+    return max(ivec2(push.sceneExtent.xy) >> (level + 1), ivec2(1));
+}
+
+float luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+#endif
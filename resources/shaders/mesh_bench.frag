@@ -0,0 +1,12 @@
+#version 450
+
+layout(location = 0) in vec3 inNormal;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    const vec3 lightDirection = normalize(vec3(0.4, 0.8, 0.3));
+    float diffuse = max(dot(normalize(inNormal), lightDirection), 0.0);
+    outColor = vec4(vec3(0.1 + 0.9 * diffuse), 1.0);
+}
@@ -0,0 +1,34 @@
+#version 450
+
+// Draws MeshLoader primitives in either vertex layout: float attributes straight from glTF, or the packed layout
+// written by vanadium_bake with octahedral normals and optionally 16 bit positions
+layout(constant_id = 0) const bool PackedVertices = false;
+
+// unorm positions arrive as vec4 with w = 0, float positions get w = 1 from the attribute expansion
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec4 inNormal;
+
+layout(push_constant) uniform PushConstants
+{
+    mat4 viewProjection;
+    // dequantization of the positions, offset 0 and scale 1 for float positions
+    vec4 positionOffset;
+    vec4 positionScale;
+} push;
+
+layout(location = 0) out vec3 outNormal;
+
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(normal.xy, vec2(0.0)));
+    return normalize(normal);
+}
+
+void main()
+{
+    vec3 position = push.positionOffset.xyz + push.positionScale.xyz * inPosition.xyz;
+    outNormal = PackedVertices ? octahedralDecode(inNormal.xy) : normalize(inNormal.xyz);
+    gl_Position = push.viewProjection * vec4(position, 1.0);
+}
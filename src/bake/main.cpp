@@ -0,0 +1,85 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "core/log.h"
+#include "mesh_baker.h"
+
+namespace
+{
+    void PrintUsage()
+    {
+        Log::Info("usage: vanadium_bake [options] <input.glb> <output.vmesh>\n"
+                  "  --quantize-positions  store positions as 16 bit unorm with a per primitive dequantization\n"
+                  "  --no-optimize         keep the triangle order, vertices are still welded and packed\n"
+                  "  --cache-size <n>      post transform cache entries to optimize for (32)");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Bake::BakeProperties properties;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--quantize-positions")
+        {
+            properties.QuantizePositions = true;
+        }
+        else if (argument == "--no-optimize")
+        {
+            properties.Optimize = false;
+        }
+        else if (argument == "--cache-size" && i + 1 < argc)
+        {
+            properties.CacheSize = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (!argument.starts_with("--"))
+        {
+            files.push_back(argument);
+        }
+        else
+        {
+            Log::Error("Invalid or incomplete argument {0}", argument);
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (files.size() != 2)
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    Bake::SourceModel source;
+    if (!Bake::ImportGlb(files[0], source))
+    {
+        return EXIT_FAILURE;
+    }
+
+    Bake::BakedModel baked;
+    Bake::BakeStatistics statistics;
+    Bake::Bake(source, properties, baked, statistics);
+    if (!Bake::WriteBakedFile(files[1], baked))
+    {
+        return EXIT_FAILURE;
+    }
+
+    Log::System("Baked {0} primitives of {1} meshes into {2}",
+                baked.Primitives.size(),
+                baked.MeshNames.size(),
+                files[1]);
+    Log::Info("    vertices {0} -> {1}, {2} triangles",
+              statistics.SourceVertices,
+              statistics.BakedVertices,
+              statistics.Triangles);
+    Log::Info("    ACMR {0:.3f} -> {1:.3f} (FIFO of {2})",
+              statistics.SourceAcmr,
+              statistics.BakedAcmr,
+              properties.CacheSize);
+    Log::Info("    geometry {0:.2f} MiB -> {1:.2f} MiB",
+              static_cast<double>(statistics.SourceBytes) / (1024.0 * 1024.0),
+              static_cast<double>(statistics.BakedBytes) / (1024.0 * 1024.0));
+    return EXIT_SUCCESS;
+}
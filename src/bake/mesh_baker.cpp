@@ -0,0 +1,1147 @@
+#include "mesh_baker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+
+#include "core/gltf.h"
+#include "core/json.h"
+#include "core/log.h"
+#include "core/mapped_file.h"
+
+namespace
+{
+    constexpr uint32_t Unused = ~0u;
+    constexpr uint32_t MaxCacheSize = 64;
+    // the overdraw clusters are cut where the vertex cache order restarts, judged with a small FIFO like Sander et al.
+    constexpr uint32_t OverdrawCacheSize = 16;
+    constexpr uint64_t MaxI32 = std::numeric_limits<int32_t>::max();
+    constexpr uint64_t MaxU32 = std::numeric_limits<uint32_t>::max();
+    constexpr uint64_t MaxU64 = std::numeric_limits<uint64_t>::max();
+
+    struct AccessorData
+    {
+        const uint8_t *data = nullptr;
+        uint32_t stride = 0;
+        uint32_t count = 0;
+        uint32_t componentType = 0;
+        uint32_t components = 0;
+        bool normalized = false;
+    };
+
+    /**
+     * Resolves accessors of a parsed .glb to pointers into its BIN chunk, everything is bounds checked
+     */
+    class AccessorReader
+    {
+    public:
+        AccessorReader(const JsonDocument &json, const Gltf::GlbChunks &chunks)
+            : json(json), chunks(chunks)
+        {
+            const JsonValue &root = json.Root();
+            views = json.Elements(json.Find(root, "bufferViews"));
+            accessors = json.Elements(json.Find(root, "accessors"));
+        }
+
+        bool ReadFloats(double index, uint32_t components, std::vector<float> &values, uint32_t &count) const
+        {
+            AccessorData accessor;
+            if (!Resolve(index, accessor) || accessor.components != components)
+            {
+                return false;
+            }
+
+            const uint32_t componentSize = Gltf::ComponentSize(accessor.componentType);
+            values.resize(static_cast<size_t>(accessor.count) * components);
+            for (uint32_t element = 0; element < accessor.count; element++)
+            {
+                const uint8_t *source = accessor.data + static_cast<size_t>(element) * accessor.stride;
+                for (uint32_t component = 0; component < components; component++)
+                {
+                    values[static_cast<size_t>(element) * components + component] = DecodeComponent(
+                        source + component * componentSize, accessor.componentType, accessor.normalized);
+                }
+            }
+            count = accessor.count;
+            return true;
+        }
+
+        bool ReadIndices(double index, std::vector<uint32_t> &indices) const
+        {
+            AccessorData accessor;
+            if (!Resolve(index, accessor) || accessor.components != 1 ||
+                (accessor.componentType != Gltf::ComponentUnsignedByte &&
+                 accessor.componentType != Gltf::ComponentUnsignedShort &&
+                 accessor.componentType != Gltf::ComponentUnsignedInt))
+            {
+                return false;
+            }
+
+            indices.resize(accessor.count);
+            for (uint32_t i = 0; i < accessor.count; i++)
+            {
+                const uint8_t *source = accessor.data + static_cast<size_t>(i) * accessor.stride;
+                indices[i] = DecodeIndex(source, accessor.componentType);
+            }
+            return true;
+        }
+
+    private:
+        // read as integers, a float only holds indices up to 2^24 exactly
+        static uint32_t DecodeIndex(const uint8_t *source, uint32_t componentType)
+        {
+            switch (componentType)
+            {
+            case Gltf::ComponentUnsignedByte:
+                return source[0];
+            case Gltf::ComponentUnsignedShort:
+            {
+                uint16_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return value;
+            }
+            case Gltf::ComponentUnsignedInt:
+            {
+                uint32_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return value;
+            }
+            default:
+                return 0;
+            }
+        }
+
+        static float DecodeComponent(const uint8_t *source, uint32_t componentType, bool normalized)
+        {
+            switch (componentType)
+            {
+            case Gltf::ComponentFloat:
+            {
+                float value;
+                std::memcpy(&value, source, sizeof(value));
+                return value;
+            }
+            case Gltf::ComponentUnsignedByte:
+                return normalized ? source[0] / 255.0f : source[0];
+            case Gltf::ComponentByte:
+            {
+                const float value = static_cast<int8_t>(source[0]);
+                return normalized ? std::max(value / 127.0f, -1.0f) : value;
+            }
+            case Gltf::ComponentUnsignedShort:
+            {
+                uint16_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return normalized ? value / 65535.0f : value;
+            }
+            case Gltf::ComponentShort:
+            {
+                int16_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+            }
+            case Gltf::ComponentUnsignedInt:
+            {
+                uint32_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return static_cast<float>(value);
+            }
+            default:
+                return 0.0f;
+            }
+        }
+
+        bool Resolve(double index, AccessorData &result) const
+        {
+            uint64_t accessorIndex = 0;
+            if (!Gltf::ToUnsigned(index, MaxU64, accessorIndex) || accessorIndex >= accessors.size())
+            {
+                return false;
+            }
+            const JsonValue &accessor = *accessors[accessorIndex];
+            uint64_t viewIndex = 0;
+            if (json.Find(accessor, "sparse") ||
+                !Gltf::ToUnsigned(json.GetNumber(accessor, "bufferView", -1.0), MaxU64, viewIndex) ||
+                viewIndex >= views.size())
+            {
+                return false;
+            }
+
+            const JsonValue &view = *views[viewIndex];
+            uint64_t viewOffset = 0;
+            uint64_t viewLength = 0;
+            uint64_t viewStride = 0;
+            if (!chunks.Bin || json.GetNumber(view, "buffer", -1.0) != 0.0 ||
+                !Gltf::ToUnsigned(json.GetNumber(view, "byteOffset", 0.0), MaxU64, viewOffset) ||
+                !Gltf::ToUnsigned(json.GetNumber(view, "byteLength", 0.0), MaxU64, viewLength) ||
+                !Gltf::ToUnsigned(json.GetNumber(view, "byteStride", 0.0), MaxU32, viewStride) ||
+                viewOffset > chunks.BinSize || viewLength > chunks.BinSize - viewOffset)
+            {
+                return false;
+            }
+
+            uint64_t offset = 0;
+            uint64_t count = 0;
+            uint64_t componentType = 0;
+            if (!Gltf::ToUnsigned(json.GetNumber(accessor, "byteOffset", 0.0), MaxU64, offset) ||
+                !Gltf::ToUnsigned(json.GetNumber(accessor, "count", 0.0), MaxU32, count) ||
+                !Gltf::ToUnsigned(json.GetNumber(accessor, "componentType", 0.0), MaxU32, componentType))
+            {
+                return false;
+            }
+            result.count = static_cast<uint32_t>(count);
+            result.componentType = static_cast<uint32_t>(componentType);
+            result.components = Gltf::ComponentCount(json.GetString(accessor, "type"));
+            const JsonValue *normalized = json.Find(accessor, "normalized");
+            result.normalized = normalized && normalized->Type == JsonType::Bool && normalized->Bool;
+
+            // stride and count are 32 bit so the span of the elements cannot wrap, the offset is checked on its own
+            const uint64_t elementSize =
+                static_cast<uint64_t>(Gltf::ComponentSize(result.componentType)) * result.components;
+            result.stride = viewStride ? static_cast<uint32_t>(viewStride) : static_cast<uint32_t>(elementSize);
+            if (elementSize == 0 || result.count == 0)
+            {
+                return false;
+            }
+            const uint64_t span = static_cast<uint64_t>(result.stride) * (result.count - 1) + elementSize;
+            if (offset > viewLength || span > viewLength - offset)
+            {
+                return false;
+            }
+            result.data = chunks.Bin + viewOffset + offset;
+            return true;
+        }
+
+        const JsonDocument &json;
+        const Gltf::GlbChunks &chunks;
+        std::vector<const JsonValue *> views;
+        std::vector<const JsonValue *> accessors;
+    };
+
+    bool ImportPrimitive(const JsonDocument &json,
+                         const AccessorReader &reader,
+                         const JsonValue &primitive,
+                         Bake::SourcePrimitive &result)
+    {
+        const JsonValue *attributes = json.Find(primitive, "attributes");
+        const JsonValue *position = attributes ? json.Find(*attributes, "POSITION") : nullptr;
+        if (!position || position->Type != JsonType::Number ||
+            json.GetNumber(primitive, "mode", Gltf::ModeTriangles) != Gltf::ModeTriangles)
+        {
+            return false;
+        }
+
+        std::vector<float> values;
+        uint32_t vertexCount = 0;
+        if (!reader.ReadFloats(position->Number, 3, values, vertexCount))
+        {
+            return false;
+        }
+        result.Positions.resize(vertexCount);
+        std::memcpy(result.Positions.data(), values.data(), values.size() * sizeof(float));
+
+        // optional attributes have to match the position count, otherwise the primitive is rejected
+        const auto readOptional = [&](const char *name, uint32_t components, auto &target)
+        {
+            const JsonValue *index = json.Find(*attributes, name);
+            if (!index)
+            {
+                return true;
+            }
+            uint32_t count = 0;
+            if (index->Type != JsonType::Number || !reader.ReadFloats(index->Number, components, values, count) ||
+                count != vertexCount)
+            {
+                return false;
+            }
+            target.resize(count);
+            std::memcpy(target.data(), values.data(), values.size() * sizeof(float));
+            return true;
+        };
+        if (!readOptional("NORMAL", 3, result.Normals) || !readOptional("TEXCOORD_0", 2, result.TexCoords) ||
+            !readOptional("TANGENT", 4, result.Tangents))
+        {
+            return false;
+        }
+
+        if (const JsonValue *indices = json.Find(primitive, "indices"))
+        {
+            if (indices->Type != JsonType::Number || !reader.ReadIndices(indices->Number, result.Indices))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            result.Indices.resize(vertexCount);
+            std::iota(result.Indices.begin(), result.Indices.end(), 0u);
+        }
+
+        result.Indices.resize(result.Indices.size() - result.Indices.size() % 3);
+        uint64_t material = 0;
+        result.Material = Gltf::ToUnsigned(json.GetNumber(primitive, "material", -1.0), MaxI32, material)
+                              ? static_cast<int32_t>(material)
+                              : -1;
+        return std::all_of(result.Indices.begin(),
+                           result.Indices.end(),
+                           [vertexCount](uint32_t index) { return index < vertexCount; });
+    }
+
+    /**
+     * FIFO post transform cache, entries are timestamps so resetting it is O(1)
+     */
+    class FifoCache
+    {
+    public:
+        FifoCache(uint32_t vertexCount, uint32_t cacheSize)
+            : timestamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize)
+        {
+        }
+
+        uint32_t Access(const uint32_t *triangle)
+        {
+            uint32_t misses = 0;
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                uint32_t &timestamp = timestamps[triangle[corner]];
+                if (time - timestamp > size)
+                {
+                    timestamp = time++;
+                    misses++;
+                }
+            }
+            return misses;
+        }
+
+        void Reset()
+        {
+            time += size + 1;
+        }
+
+    private:
+        std::vector<uint32_t> timestamps;
+        uint32_t time;
+        uint32_t size;
+    };
+
+    // Forsyth's scoring: recently used vertices score high, the last triangle's a bit lower, few remaining triangles
+    // boost a vertex so it gets finished instead of leaving single triangles behind
+    float VertexScore(int32_t cachePosition, uint32_t liveTriangles, uint32_t cacheSize)
+    {
+        if (liveTriangles == 0)
+        {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+            {
+                score = 0.75f;
+            }
+            else
+            {
+                const float scale = 1.0f / static_cast<float>(cacheSize - 3);
+                score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scale, 1.5f);
+            }
+        }
+        return score + 2.0f / std::sqrt(static_cast<float>(liveTriangles));
+    }
+
+    uint32_t HashVertex(const uint8_t *vertex, uint32_t stride)
+    {
+        uint32_t hash = 2166136261u;
+        for (uint32_t i = 0; i < stride; i++)
+        {
+            hash = (hash ^ vertex[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    /**
+     * Merge vertices with identical packed bytes, so attributes that only differ below the quantization step weld
+     *
+     * @param vertices Packed vertices, compacted to the unique ones in order of their first occurrence
+     * @param remap Receives the unique vertex of every input vertex
+     *
+     * @return Number of unique vertices
+     */
+    uint32_t WeldVertices(std::vector<uint8_t> &vertices, uint32_t stride, std::vector<uint32_t> &remap)
+    {
+        const uint32_t count = static_cast<uint32_t>(vertices.size() / stride);
+        size_t capacity = 1;
+        while (capacity < static_cast<size_t>(count) * 2)
+        {
+            capacity <<= 1;
+        }
+        std::vector<uint32_t> table(capacity, Unused);
+
+        remap.resize(count);
+        uint32_t unique = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            // unique never passes i, compacting in place only overwrites vertices that were already looked at
+            const uint8_t *vertex = vertices.data() + static_cast<size_t>(i) * stride;
+            size_t slot = HashVertex(vertex, stride) & (capacity - 1);
+            while (true)
+            {
+                const uint32_t candidate = table[slot];
+                if (candidate == Unused)
+                {
+                    table[slot] = unique;
+                    std::memmove(vertices.data() + static_cast<size_t>(unique) * stride, vertex, stride);
+                    remap[i] = unique++;
+                    break;
+                }
+                if (std::memcmp(vertices.data() + static_cast<size_t>(candidate) * stride, vertex, stride) == 0)
+                {
+                    remap[i] = candidate;
+                    break;
+                }
+                slot = (slot + 1) & (capacity - 1);
+            }
+        }
+        vertices.resize(static_cast<size_t>(unique) * stride);
+        return unique;
+    }
+
+    // round to nearest even like the GPU conversions, out of range values become infinity
+    uint16_t FloatToHalf(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+        const uint32_t magnitude = bits & 0x7FFFFFFF;
+
+        if (magnitude >= 0x7F800000)
+        {
+            return static_cast<uint16_t>(sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00));
+        }
+        // 65520 and above round past the largest half
+        if (magnitude >= 0x477FF000)
+        {
+            return static_cast<uint16_t>(sign | 0x7C00);
+        }
+        // below 2^-14 the result is denormal, in units of 2^-24
+        if (magnitude < 0x38800000)
+        {
+            float absolute;
+            std::memcpy(&absolute, &magnitude, sizeof(absolute));
+            return static_cast<uint16_t>(sign | static_cast<uint16_t>(std::nearbyint(absolute * 16777216.0f)));
+        }
+
+        // rebias the exponent from 127 to 15 and round away the 13 extra mantissa bits
+        uint32_t half = magnitude - 0x38000000;
+        half += 0xFFF + ((half >> 13) & 1);
+        return static_cast<uint16_t>(sign | (half >> 13));
+    }
+
+    glm::vec2 OctahedralEncode(const glm::vec3 &direction)
+    {
+        const float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+        if (length <= 0.0f)
+        {
+            return glm::vec2(0.0f);
+        }
+        glm::vec2 result = glm::vec2(direction) / length;
+        if (direction.z < 0.0f)
+        {
+            const glm::vec2 sign(result.x >= 0.0f ? 1.0f : -1.0f, result.y >= 0.0f ? 1.0f : -1.0f);
+            result = (1.0f - glm::abs(glm::vec2(result.y, result.x))) * sign;
+        }
+        return result;
+    }
+
+    template <typename T>
+    T EncodeSnorm(float value)
+    {
+        constexpr float maximum = static_cast<float>(std::numeric_limits<T>::max());
+        return static_cast<T>(std::lround(std::clamp(value, -1.0f, 1.0f) * maximum));
+    }
+
+    uint16_t EncodeUnorm16(float value)
+    {
+        return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    void PackVertex(const Bake::SourcePrimitive &source,
+                    uint32_t index,
+                    uint32_t flags,
+                    const glm::vec3 &positionOffset,
+                    const glm::vec3 &positionScale,
+                    uint8_t *vertex)
+    {
+        const glm::vec3 &position = source.Positions[index];
+        if (flags & BakedPrimitiveQuantizedPositions)
+        {
+            const glm::vec3 normalized = (position - positionOffset) / positionScale;
+            const uint16_t quantized[4] = {
+                EncodeUnorm16(normalized.x), EncodeUnorm16(normalized.y), EncodeUnorm16(normalized.z), 0};
+            std::memcpy(vertex, quantized, sizeof(quantized));
+        }
+        else
+        {
+            std::memcpy(vertex, &position, sizeof(position));
+        }
+
+        // missing attributes stay zero so they do not keep vertices from welding
+        int16_t normal[2] = {0, 0};
+        if (flags & BakedPrimitiveHasNormals)
+        {
+            const glm::vec2 encoded = OctahedralEncode(source.Normals[index]);
+            normal[0] = EncodeSnorm<int16_t>(encoded.x);
+            normal[1] = EncodeSnorm<int16_t>(encoded.y);
+        }
+        std::memcpy(vertex + BakedNormalOffset(flags), normal, sizeof(normal));
+
+        int8_t tangent[4] = {0, 0, 0, 0};
+        if (flags & BakedPrimitiveHasTangents)
+        {
+            const glm::vec4 &source4 = source.Tangents[index];
+            const glm::vec2 encoded = OctahedralEncode(glm::vec3(source4));
+            tangent[0] = EncodeSnorm<int8_t>(encoded.x);
+            tangent[1] = EncodeSnorm<int8_t>(encoded.y);
+            tangent[2] = source4.w < 0.0f ? -127 : 127;
+        }
+        std::memcpy(vertex + BakedTangentOffset(flags), tangent, sizeof(tangent));
+
+        uint16_t texCoord[2] = {0, 0};
+        if (flags & BakedPrimitiveHasTexCoords)
+        {
+            texCoord[0] = FloatToHalf(source.TexCoords[index].x);
+            texCoord[1] = FloatToHalf(source.TexCoords[index].y);
+        }
+        std::memcpy(vertex + BakedTexCoordOffset(flags), texCoord, sizeof(texCoord));
+    }
+
+    // positions as the GPU will see them, so the overdraw sort works on the quantized geometry
+    glm::vec3 UnpackPosition(const uint8_t *vertex,
+                             uint32_t flags,
+                             const glm::vec3 &positionOffset,
+                             const glm::vec3 &positionScale)
+    {
+        if (flags & BakedPrimitiveQuantizedPositions)
+        {
+            uint16_t quantized[3];
+            std::memcpy(quantized, vertex, sizeof(quantized));
+            return positionOffset + positionScale * glm::vec3(quantized[0], quantized[1], quantized[2]) / 65535.0f;
+        }
+        glm::vec3 position;
+        std::memcpy(&position, vertex, sizeof(position));
+        return position;
+    }
+
+    uint64_t SourceVertexSize(const Bake::SourcePrimitive &source)
+    {
+        return sizeof(glm::vec3) + (source.Normals.empty() ? 0 : sizeof(glm::vec3)) +
+               (source.TexCoords.empty() ? 0 : sizeof(glm::vec2)) +
+               (source.Tangents.empty() ? 0 : sizeof(glm::vec4));
+    }
+
+    void BakePrimitive(const Bake::SourcePrimitive &source,
+                       const Bake::BakeProperties &properties,
+                       Bake::BakedPrimitiveData &result)
+    {
+        const uint32_t sourceCount = static_cast<uint32_t>(source.Positions.size());
+        uint32_t flags = properties.QuantizePositions ? BakedPrimitiveQuantizedPositions : 0;
+        flags |= source.Normals.size() == sourceCount ? BakedPrimitiveHasNormals : 0;
+        flags |= source.Tangents.size() == sourceCount ? BakedPrimitiveHasTangents : 0;
+        flags |= source.TexCoords.size() == sourceCount ? BakedPrimitiveHasTexCoords : 0;
+        const uint32_t stride = BakedVertexStride(flags);
+
+        glm::vec3 positionOffset(0.0f);
+        glm::vec3 positionScale(1.0f);
+        if (flags & BakedPrimitiveQuantizedPositions)
+        {
+            glm::vec3 minimum = source.Positions[0];
+            glm::vec3 maximum = source.Positions[0];
+            for (const glm::vec3 &position : source.Positions)
+            {
+                minimum = glm::min(minimum, position);
+                maximum = glm::max(maximum, position);
+            }
+            positionOffset = minimum;
+            // flat primitives keep a scale of 1 on their flat axis instead of dividing by zero
+            positionScale = glm::max(maximum - minimum, glm::vec3(0.0f));
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                positionScale[axis] = positionScale[axis] > 0.0f ? positionScale[axis] : 1.0f;
+            }
+        }
+
+        std::vector<uint8_t> packed(static_cast<size_t>(sourceCount) * stride);
+        for (uint32_t i = 0; i < sourceCount; i++)
+        {
+            uint8_t *vertex = packed.data() + static_cast<size_t>(i) * stride;
+            PackVertex(source, i, flags, positionOffset, positionScale, vertex);
+        }
+
+        std::vector<uint32_t> remap;
+        const uint32_t uniqueCount = WeldVertices(packed, stride, remap);
+
+        // welding can collapse triangles, those would only cost vertex invocations
+        std::vector<uint32_t> indices;
+        indices.reserve(source.Indices.size());
+        for (size_t i = 0; i + 2 < source.Indices.size(); i += 3)
+        {
+            const uint32_t a = remap[source.Indices[i]];
+            const uint32_t b = remap[source.Indices[i + 1]];
+            const uint32_t c = remap[source.Indices[i + 2]];
+            if (a != b && b != c && a != c)
+            {
+                indices.insert(indices.end(), {a, b, c});
+            }
+        }
+
+        if (properties.Optimize)
+        {
+            std::vector<glm::vec3> positions(uniqueCount);
+            for (uint32_t i = 0; i < uniqueCount; i++)
+            {
+                const uint8_t *vertex = packed.data() + static_cast<size_t>(i) * stride;
+                positions[i] = UnpackPosition(vertex, flags, positionOffset, positionScale);
+            }
+            Bake::OptimizeVertexCache(indices, uniqueCount, properties.CacheSize);
+            Bake::OptimizeOverdraw(indices, positions, properties.OverdrawThreshold);
+        }
+
+        // renumber the vertices in the order the indices first use them, unreferenced vertices are dropped
+        std::vector<uint32_t> fetchOrder(uniqueCount, Unused);
+        uint32_t vertexCount = 0;
+        for (uint32_t &index : indices)
+        {
+            if (fetchOrder[index] == Unused)
+            {
+                fetchOrder[index] = vertexCount++;
+            }
+            index = fetchOrder[index];
+        }
+        result.Vertices.resize(static_cast<size_t>(vertexCount) * stride);
+        for (uint32_t i = 0; i < uniqueCount; i++)
+        {
+            if (fetchOrder[i] != Unused)
+            {
+                std::memcpy(result.Vertices.data() + static_cast<size_t>(fetchOrder[i]) * stride,
+                            packed.data() + static_cast<size_t>(i) * stride,
+                            stride);
+            }
+        }
+
+        // 0xFFFF stays free for primitive restart
+        if (vertexCount <= UINT16_MAX)
+        {
+            flags |= BakedPrimitiveIndex16;
+            std::vector<uint16_t> narrow(indices.begin(), indices.end());
+            result.Indices.resize(narrow.size() * sizeof(uint16_t));
+            std::memcpy(result.Indices.data(), narrow.data(), result.Indices.size());
+        }
+        else
+        {
+            result.Indices.resize(indices.size() * sizeof(uint32_t));
+            std::memcpy(result.Indices.data(), indices.data(), result.Indices.size());
+        }
+
+        BakedPrimitive &header = result.Header;
+        header.Mesh = source.Mesh;
+        header.Material = source.Material;
+        header.Flags = flags;
+        header.VertexCount = vertexCount;
+        header.IndexCount = static_cast<uint32_t>(indices.size());
+        header.VertexStride = stride;
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            header.PositionOffset[axis] = positionOffset[axis];
+            header.PositionScale[axis] = positionScale[axis];
+        }
+    }
+
+    uint64_t AlignData(uint64_t offset)
+    {
+        return (offset + BakedMeshAlignment - 1) & ~static_cast<uint64_t>(BakedMeshAlignment - 1);
+    }
+
+    void WritePadding(std::ostream &stream, uint64_t from, uint64_t to)
+    {
+        static constexpr char zeros[BakedMeshAlignment] = {};
+        stream.write(zeros, static_cast<std::streamsize>(to - from));
+    }
+}
+
+namespace Bake
+{
+    /**
+     * Decode every triangle list of a binary glTF file into float streams
+     *
+     * @param path .glb file, external buffers are not supported
+     * @param model Receives the meshes, primitives that cannot be imported are skipped with a warning
+     *
+     * @return False if the file could not be read at all
+     */
+    bool ImportGlb(const std::string &path, SourceModel &model)
+    {
+        MappedFile file;
+        if (!file.Open(path, MappedFileAccess::Sequential))
+        {
+            return false;
+        }
+
+        Gltf::GlbChunks chunks;
+        std::string error;
+        if (!Gltf::ParseGlb(file.Data(), file.Size(), chunks, error))
+        {
+            Log::Error("{0}: {1}", path, error);
+            return false;
+        }
+        JsonDocument json;
+        if (!json.Parse(chunks.Json))
+        {
+            Log::Error("{0}: {1}", path, json.GetError());
+            return false;
+        }
+
+        const AccessorReader reader(json, chunks);
+        const std::vector<const JsonValue *> meshes = json.Elements(json.Find(json.Root(), "meshes"));
+        uint32_t skipped = 0;
+        for (uint32_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+        {
+            model.MeshNames.emplace_back(json.GetString(*meshes[meshIndex], "name"));
+            for (const JsonValue *primitive : json.Elements(json.Find(*meshes[meshIndex], "primitives")))
+            {
+                SourcePrimitive imported;
+                imported.Mesh = meshIndex;
+                if (ImportPrimitive(json, reader, *primitive, imported))
+                {
+                    model.Primitives.push_back(std::move(imported));
+                }
+                else
+                {
+                    skipped++;
+                }
+            }
+        }
+
+        if (skipped > 0)
+        {
+            Log::Warning("{0}: skipped {1} primitives that are not valid triangle lists with embedded data",
+                         path,
+                         skipped);
+        }
+        return true;
+    }
+
+    /**
+     * Weld, reorder and quantize every primitive of a model
+     *
+     * @param source Imported model, primitives without triangles are dropped
+     * @param baked Receives the packed primitives, ready for WriteBakedFile()
+     * @param statistics Receives the totals before and after baking, ACMR is simulated with a FIFO of CacheSize
+     */
+    void Bake(const SourceModel &source,
+              const BakeProperties &properties,
+              BakedModel &baked,
+              BakeStatistics &statistics)
+    {
+        baked.MeshNames = source.MeshNames;
+        baked.Primitives.clear();
+        statistics = {};
+
+        const uint32_t cacheSize = std::clamp(properties.CacheSize, 4u, MaxCacheSize);
+        uint64_t sourceTriangles = 0;
+        double sourceMisses = 0.0;
+        double bakedMisses = 0.0;
+        for (const SourcePrimitive &primitive : source.Primitives)
+        {
+            if (primitive.Positions.empty() || primitive.Indices.size() < 3)
+            {
+                continue;
+            }
+
+            BakedPrimitiveData &result = baked.Primitives.emplace_back();
+            BakePrimitive(primitive, properties, result);
+
+            const uint32_t triangles = static_cast<uint32_t>(primitive.Indices.size() / 3);
+            sourceTriangles += triangles;
+            sourceMisses +=
+                SimulateAcmr(primitive.Indices, static_cast<uint32_t>(primitive.Positions.size()), cacheSize) *
+                triangles;
+            statistics.SourceVertices += primitive.Positions.size();
+            statistics.SourceBytes +=
+                SourceVertexSize(primitive) * primitive.Positions.size() + primitive.Indices.size() * sizeof(uint32_t);
+
+            std::vector<uint32_t> indices(result.Header.IndexCount);
+            for (uint32_t i = 0; i < result.Header.IndexCount; i++)
+            {
+                uint16_t narrow;
+                if (result.Header.Flags & BakedPrimitiveIndex16)
+                {
+                    std::memcpy(&narrow, result.Indices.data() + i * sizeof(uint16_t), sizeof(narrow));
+                    indices[i] = narrow;
+                }
+                else
+                {
+                    std::memcpy(&indices[i], result.Indices.data() + i * sizeof(uint32_t), sizeof(uint32_t));
+                }
+            }
+            statistics.Triangles += indices.size() / 3;
+            bakedMisses += SimulateAcmr(indices, result.Header.VertexCount, cacheSize) * (indices.size() / 3);
+            statistics.BakedVertices += result.Header.VertexCount;
+            statistics.BakedBytes += result.Vertices.size() + result.Indices.size();
+        }
+
+        statistics.SourceAcmr = sourceTriangles ? sourceMisses / static_cast<double>(sourceTriangles) : 0.0;
+        statistics.BakedAcmr = statistics.Triangles ? bakedMisses / static_cast<double>(statistics.Triangles) : 0.0;
+    }
+
+    /**
+     * Write a baked model as .vmesh, see graphics/baked_mesh.h for the layout
+     *
+     * @param model Baked model, the data offsets of its primitive headers are assigned here
+     *
+     * @return False if the file could not be written
+     */
+    bool WriteBakedFile(const std::string &path, BakedModel &model)
+    {
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        if (!WriteBaked(stream, model))
+        {
+            Log::Error("Could not write {0}", path);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Write a baked model in the .vmesh layout to any stream, e.g. to pack it without a temporary file
+     *
+     * @param model Baked model, the data offsets of its primitive headers are assigned here
+     *
+     * @return False if the stream failed
+     */
+    bool WriteBaked(std::ostream &stream, BakedModel &model)
+    {
+        BakedMeshHeader header;
+        header.MeshCount = static_cast<uint32_t>(model.MeshNames.size());
+        header.PrimitiveCount = static_cast<uint32_t>(model.Primitives.size());
+
+        std::string names;
+        std::vector<BakedMeshRecord> records(header.MeshCount);
+        for (uint32_t i = 0; i < header.MeshCount; i++)
+        {
+            records[i].NameOffset = static_cast<uint32_t>(names.size());
+            records[i].NameLength = static_cast<uint32_t>(model.MeshNames[i].size());
+            names += model.MeshNames[i];
+        }
+
+        header.NamesOffset = sizeof(BakedMeshHeader) + records.size() * sizeof(BakedMeshRecord) +
+                             model.Primitives.size() * sizeof(BakedPrimitive);
+        header.NamesSize = names.size();
+        header.DataOffset = AlignData(header.NamesOffset + header.NamesSize);
+
+        uint64_t dataSize = 0;
+        for (BakedPrimitiveData &primitive : model.Primitives)
+        {
+            primitive.Header.VertexOffset = dataSize;
+            dataSize = AlignData(dataSize + primitive.Vertices.size());
+            primitive.Header.IndexOffset = dataSize;
+            dataSize = AlignData(dataSize + primitive.Indices.size());
+        }
+        header.DataSize = dataSize;
+
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char *>(records.data()),
+                     static_cast<std::streamsize>(records.size() * sizeof(BakedMeshRecord)));
+        for (const BakedPrimitiveData &primitive : model.Primitives)
+        {
+            stream.write(reinterpret_cast<const char *>(&primitive.Header), sizeof(primitive.Header));
+        }
+        stream.write(names.data(), static_cast<std::streamsize>(names.size()));
+        WritePadding(stream, header.NamesOffset + header.NamesSize, header.DataOffset);
+
+        for (const BakedPrimitiveData &primitive : model.Primitives)
+        {
+            stream.write(reinterpret_cast<const char *>(primitive.Vertices.data()),
+                         static_cast<std::streamsize>(primitive.Vertices.size()));
+            const uint64_t vertexEnd = primitive.Header.VertexOffset + primitive.Vertices.size();
+            WritePadding(stream, vertexEnd, AlignData(vertexEnd));
+            stream.write(reinterpret_cast<const char *>(primitive.Indices.data()),
+                         static_cast<std::streamsize>(primitive.Indices.size()));
+            const uint64_t indexEnd = primitive.Header.IndexOffset + primitive.Indices.size();
+            WritePadding(stream, indexEnd, AlignData(indexEnd));
+        }
+
+        return stream.good();
+    }
+
+    /**
+     * @return Average vertex shader invocations per triangle with a FIFO post transform cache of cacheSize entries
+     */
+    double SimulateAcmr(const std::vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+        {
+            return 0.0;
+        }
+
+        FifoCache cache(vertexCount, cacheSize);
+        uint64_t misses = 0;
+        for (size_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            misses += cache.Access(&indices[triangle * 3]);
+        }
+        return static_cast<double>(misses) / static_cast<double>(triangleCount);
+    }
+
+    /**
+     * Reorder triangles for an LRU post transform cache with Forsyth's greedy scoring
+     *
+     * @param indices Triangle list, reordered in place
+     * @param cacheSize Entries of the simulated cache, clamped to [4, 64]
+     */
+    void OptimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        cacheSize = std::clamp(cacheSize, 4u, MaxCacheSize);
+        const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        // triangles of every vertex, the first live[vertex] entries of its range are the ones not emitted yet
+        std::vector<uint32_t> live(vertexCount, 0);
+        for (uint32_t i = 0; i < triangleCount * 3; i++)
+        {
+            live[indices[i]]++;
+        }
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            offsets[vertex + 1] = offsets[vertex] + live[vertex];
+        }
+        std::vector<uint32_t> adjacency(offsets.back());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (uint32_t i = 0; i < triangleCount * 3; i++)
+        {
+            adjacency[fill[indices[i]]++] = i / 3;
+        }
+
+        std::vector<float> vertexScores(vertexCount);
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            vertexScores[vertex] = VertexScore(-1, live[vertex], cacheSize);
+        }
+        std::vector<float> triangleScores(triangleCount);
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            const uint32_t *corners = &indices[triangle * 3];
+            triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> nextCache;
+        uint32_t cursor = 0;
+        uint32_t best = static_cast<uint32_t>(
+            std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+
+        while (best != Unused)
+        {
+            emitted[best] = true;
+            const uint32_t *corners = &indices[best * 3];
+            nextCache.clear();
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                const uint32_t vertex = corners[corner];
+                output.push_back(vertex);
+                if (std::find(nextCache.begin(), nextCache.end(), vertex) != nextCache.end())
+                {
+                    continue;
+                }
+                nextCache.push_back(vertex);
+
+                uint32_t *begin = adjacency.data() + offsets[vertex];
+                uint32_t *end = begin + live[vertex];
+                uint32_t *found = std::find(begin, end, best);
+                if (found != end)
+                {
+                    std::swap(*found, *(end - 1));
+                    live[vertex]--;
+                }
+            }
+            for (const uint32_t vertex : cache)
+            {
+                if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+                {
+                    nextCache.push_back(vertex);
+                }
+            }
+
+            // entries past cacheSize just fell out of the cache
+            for (uint32_t position = 0; position < nextCache.size(); position++)
+            {
+                const uint32_t vertex = nextCache[position];
+                const int32_t cachePosition = position < cacheSize ? static_cast<int32_t>(position) : -1;
+                const float score = VertexScore(cachePosition, live[vertex], cacheSize);
+                const float delta = score - vertexScores[vertex];
+                vertexScores[vertex] = score;
+                for (uint32_t i = 0; i < live[vertex]; i++)
+                {
+                    triangleScores[adjacency[offsets[vertex] + i]] += delta;
+                }
+            }
+            cache.assign(nextCache.begin(), nextCache.begin() + std::min<size_t>(nextCache.size(), cacheSize));
+
+            best = Unused;
+            float bestScore = -1.0f;
+            for (const uint32_t vertex : cache)
+            {
+                for (uint32_t i = 0; i < live[vertex]; i++)
+                {
+                    const uint32_t triangle = adjacency[offsets[vertex] + i];
+                    if (triangleScores[triangle] > bestScore)
+                    {
+                        bestScore = triangleScores[triangle];
+                        best = triangle;
+                    }
+                }
+            }
+
+            if (best == Unused)
+            {
+                // nothing in the cache has triangles left, continue with the next one that was not emitted yet
+                while (cursor < triangleCount && emitted[cursor])
+                {
+                    cursor++;
+                }
+                best = cursor < triangleCount ? cursor : Unused;
+            }
+        }
+
+        indices = std::move(output);
+    }
+
+    /**
+     * Reorder clusters of a vertex cache optimized triangle list so outward facing parts are drawn first, based on
+     * Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+     *
+     * @param indices Triangle list in vertex cache order, reordered in place
+     * @param positions Position of every vertex the indices reference
+     * @param threshold How much the ACMR may grow by cutting the vertex cache order into more clusters
+     */
+    void OptimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions, float threshold)
+    {
+        const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        if (triangleCount < 2)
+        {
+            return;
+        }
+        FifoCache cache(static_cast<uint32_t>(positions.size()), OverdrawCacheSize);
+
+        // hard boundaries where the vertex cache order started over, all three vertices miss the cache
+        std::vector<uint32_t> hardBoundaries;
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            if (cache.Access(&indices[triangle * 3]) == 3 || triangle == 0)
+            {
+                hardBoundaries.push_back(triangle);
+            }
+        }
+        hardBoundaries.push_back(triangleCount);
+
+        // soft boundaries inside them, a new cluster starts as soon as the ACMR since the last cut is good enough
+        std::vector<uint32_t> boundaries;
+        for (size_t hard = 0; hard + 1 < hardBoundaries.size(); hard++)
+        {
+            const uint32_t start = hardBoundaries[hard];
+            const uint32_t end = hardBoundaries[hard + 1];
+
+            cache.Reset();
+            uint32_t clusterMisses = 0;
+            for (uint32_t triangle = start; triangle < end; triangle++)
+            {
+                clusterMisses += cache.Access(&indices[triangle * 3]);
+            }
+            const float limit = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+            cache.Reset();
+            boundaries.push_back(start);
+            uint32_t misses = 0;
+            uint32_t faces = 0;
+            for (uint32_t triangle = start; triangle + 1 < end; triangle++)
+            {
+                misses += cache.Access(&indices[triangle * 3]);
+                faces++;
+                if (static_cast<float>(misses) <= limit * static_cast<float>(faces))
+                {
+                    boundaries.push_back(triangle + 1);
+                    cache.Reset();
+                    misses = 0;
+                    faces = 0;
+                }
+            }
+        }
+        boundaries.push_back(triangleCount);
+
+        struct Cluster
+        {
+            uint32_t begin;
+            uint32_t end;
+            float sortKey;
+        };
+        std::vector<Cluster> clusters;
+        clusters.reserve(boundaries.size() - 1);
+
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        std::vector<glm::vec3> clusterCentroids(boundaries.size() - 1, glm::vec3(0.0f));
+        std::vector<glm::vec3> clusterNormals(boundaries.size() - 1, glm::vec3(0.0f));
+        for (size_t cluster = 0; cluster + 1 < boundaries.size(); cluster++)
+        {
+            float area = 0.0f;
+            for (uint32_t triangle = boundaries[cluster]; triangle < boundaries[cluster + 1]; triangle++)
+            {
+                const glm::vec3 &a = positions[indices[triangle * 3]];
+                const glm::vec3 &b = positions[indices[triangle * 3 + 1]];
+                const glm::vec3 &c = positions[indices[triangle * 3 + 2]];
+                // the cross product's length is twice the area, which weighs both sums alike
+                const glm::vec3 normal = glm::cross(b - a, c - a);
+                const float triangleArea = glm::length(normal);
+                clusterCentroids[cluster] += (a + b + c) * (triangleArea / 3.0f);
+                clusterNormals[cluster] += normal;
+                area += triangleArea;
+            }
+            meshCentroid += clusterCentroids[cluster];
+            meshArea += area;
+            clusterCentroids[cluster] = area > 0.0f ? clusterCentroids[cluster] / area : clusterCentroids[cluster];
+        }
+        meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : meshCentroid;
+
+        for (size_t cluster = 0; cluster + 1 < boundaries.size(); cluster++)
+        {
+            const float normalLength = glm::length(clusterNormals[cluster]);
+            const float key = normalLength > 0.0f ? glm::dot(clusterCentroids[cluster] - meshCentroid,
+                                                             clusterNormals[cluster] / normalLength)
+                                                  : 0.0f;
+            clusters.push_back({boundaries[cluster], boundaries[cluster + 1], key});
+        }
+
+        // clusters facing away from the center are the likely occluders of a convex-ish mesh
+        std::stable_sort(clusters.begin(),
+                         clusters.end(),
+                         [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for (const Cluster &cluster : clusters)
+        {
+            output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+        }
+        indices = std::move(output);
+    }
+}
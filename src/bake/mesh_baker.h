@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "graphics/baked_mesh.h"
+
+/** @brief Offline conversion of imported meshes into the .vmesh format the MeshLoader uploads without processing */
+namespace Bake
+{
+    /** @brief One primitive as it comes out of an importer, every attribute stream has one entry per vertex */
+    struct SourcePrimitive
+    {
+        uint32_t Mesh = 0;
+        int32_t Material = -1;
+        std::vector<glm::vec3> Positions;
+        // optional, empty or the same size as Positions
+        std::vector<glm::vec3> Normals;
+        std::vector<glm::vec2> TexCoords;
+        std::vector<glm::vec4> Tangents;
+        std::vector<uint32_t> Indices;
+    };
+
+    struct SourceModel
+    {
+        std::vector<std::string> MeshNames;
+        std::vector<SourcePrimitive> Primitives;
+    };
+
+    struct BakeProperties
+    {
+        // store positions as 16 bit unorm relative to the primitive's bounds instead of 32 bit floats
+        bool QuantizePositions = false;
+        // reorder triangles for the post transform cache and against overdraw, welding always runs
+        bool Optimize = true;
+        // entries of the LRU cache the triangle order is optimized for
+        uint32_t CacheSize = 32;
+        // how much worse than the vertex cache order the ACMR of the overdraw order may get
+        float OverdrawThreshold = 1.05f;
+    };
+
+    struct BakedPrimitiveData
+    {
+        // offsets are filled in when the file is written
+        BakedPrimitive Header;
+        std::vector<uint8_t> Vertices;
+        std::vector<uint8_t> Indices;
+    };
+
+    struct BakedModel
+    {
+        std::vector<std::string> MeshNames;
+        std::vector<BakedPrimitiveData> Primitives;
+    };
+
+    /** @brief Summed over all primitives, ACMR is the average number of vertex shader invocations per triangle */
+    struct BakeStatistics
+    {
+        uint64_t SourceVertices = 0;
+        uint64_t BakedVertices = 0;
+        uint64_t Triangles = 0;
+        double SourceAcmr = 0.0;
+        double BakedAcmr = 0.0;
+        uint64_t SourceBytes = 0;
+        uint64_t BakedBytes = 0;
+    };
+
+    bool ImportGlb(const std::string &path, SourceModel &model);
+
+    void Bake(const SourceModel &source,
+              const BakeProperties &properties,
+              BakedModel &baked,
+              BakeStatistics &statistics);
+
+    bool WriteBakedFile(const std::string &path, BakedModel &model);
+    bool WriteBaked(std::ostream &stream, BakedModel &model);
+
+    double SimulateAcmr(const std::vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize);
+    void OptimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize);
+    void OptimizeOverdraw(std::vector<uint32_t> &indices,
+                          const std::vector<glm::vec3> &positions,
+                          float threshold);
+}
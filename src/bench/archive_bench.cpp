@@ -0,0 +1,145 @@
+#include "bench.h"
+
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "archive_packer.h"
+#include "core/asset_archive.h"
+#include "core/log.h"
+#include "core/mapped_file.h"
+
+namespace
+{
+    constexpr uint32_t Warmup = 2;
+    constexpr uint32_t Iterations = 10;
+
+    constexpr uint32_t FileCount = 4096;
+    // small assets like materials, shaders and icons, sizes are uniform in this range
+    constexpr uint32_t MinFileSize = 512;
+    constexpr uint32_t MaxFileSize = 64 * 1024;
+
+    bool WriteFiles(const std::filesystem::path &directory, std::vector<std::string> &names, uint64_t &bytes)
+    {
+        std::mt19937 random(7);
+        std::uniform_int_distribution<uint32_t> sizes(MinFileSize, MaxFileSize);
+        std::vector<char> contents(MaxFileSize);
+        for (char &value : contents)
+        {
+            value = static_cast<char>(random());
+        }
+        for (uint32_t i = 0; i < FileCount; i++)
+        {
+            const uint32_t size = sizes(random);
+            // a few directories like a real asset tree, names are relative to the packed directory
+            const std::string name = std::format("group_{0}/asset_{1}.bin", i % 16, i);
+            std::filesystem::create_directories((directory / name).parent_path());
+            std::ofstream stream(directory / name, std::ios::binary | std::ios::trunc);
+            stream.write(contents.data(), size);
+            if (!stream.good())
+            {
+                return false;
+            }
+            names.push_back(name);
+            bytes += size;
+        }
+        return true;
+    }
+
+    void ReportThroughput(const std::string &name, const Bench::Stats &stats, uint64_t bytes)
+    {
+        Bench::Report(name, stats);
+        Log::Info("    {0:.2f} us per asset, {1:.0f} MiB/s (p50)",
+                  stats.p50 * 1e3 / FileCount,
+                  stats.p50 > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / (stats.p50 * 1e-3) : 0.0);
+    }
+}
+
+// Reading thousands of small assets as loose files against one packed archive. Every asset is copied into a staging
+// buffer like the upload queue would. The files stay in the page cache between runs, so this measures the cost of
+// opening, mapping and unmapping them rather than the disk.
+VANADIUM_BENCHMARK(AssetArchiveLoading)
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "vanadium_archive_bench";
+    const std::filesystem::path archivePath = std::filesystem::temp_directory_path() / "vanadium_archive_bench.vpak";
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+
+    std::vector<std::string> names;
+    uint64_t bytes = 0;
+    std::vector<Pack::PackInput> inputs;
+    Pack::PackStatistics statistics;
+    if (!WriteFiles(directory, names, bytes) || !Pack::CollectDirectory(directory.string(), inputs) ||
+        !Pack::WriteArchive(archivePath.string(), inputs, Pack::PackProperties{}, statistics))
+    {
+        Log::Warning("Could not write the assets to {0}, skipping", directory.string());
+        std::filesystem::remove_all(directory, error);
+        return;
+    }
+    Log::Info("{0} assets, {1:.1f} MiB of payload in a {2:.1f} MiB archive",
+              FileCount,
+              static_cast<double>(bytes) / (1024.0 * 1024.0),
+              static_cast<double>(statistics.ArchiveBytes) / (1024.0 * 1024.0));
+
+    std::vector<uint8_t> staging(MaxFileSize);
+    uint64_t copied = 0;
+
+    const auto readLoose = [&]
+    {
+        for (const std::string &name : names)
+        {
+            MappedFile file;
+            file.Open((directory / name).string(), MappedFileAccess::Sequential);
+            std::memcpy(staging.data(), file.Data(), file.Size());
+            copied += file.Size();
+        }
+    };
+    ReportThroughput(std::format("asset_archive/loose_files/{0}", FileCount),
+                     Bench::Measure(Warmup, Iterations, readLoose),
+                     bytes);
+
+    const auto readArchive = [&](bool prefetch)
+    {
+        AssetArchive archive;
+        archive.Open(archivePath.string());
+        if (prefetch)
+        {
+            for (const AssetArchiveEntry &entry : archive.GetEntries())
+            {
+                archive.Prefetch(entry);
+            }
+        }
+        for (const std::string &name : names)
+        {
+            const AssetArchiveEntry *entry = archive.Find(name);
+            const std::span<const uint8_t> data = archive.GetData(*entry);
+            std::memcpy(staging.data(), data.data(), data.size());
+            copied += data.size();
+            if (prefetch)
+            {
+                archive.Release(*entry);
+            }
+        }
+    };
+    ReportThroughput(std::format("asset_archive/archive/{0}", FileCount),
+                     Bench::Measure(Warmup, Iterations, [&] { readArchive(false); }),
+                     bytes);
+    // hints every entry up front and releases each one after its copy like the MeshLoader does, with a warm page cache
+    // this only adds the madvise calls and the faults after a release, the hints pay off when the archive is cold
+    ReportThroughput(std::format("asset_archive/archive_prefetch/{0}", FileCount),
+                     Bench::Measure(Warmup, Iterations, [&] { readArchive(true); }),
+                     bytes);
+
+    const uint64_t expected = bytes * (Warmup + Iterations) * 3;
+    if (copied != expected)
+    {
+        Log::Error("Asset archive benchmark copied {0} bytes instead of {1}", copied, expected);
+    }
+
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::remove(archivePath, error);
+}
@@ -0,0 +1,348 @@
+#include "bench.h"
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "core/async_io.h"
+#include "core/log.h"
+#include "graphics/upload_queue.h"
+#include "headless_context.h"
+
+namespace
+{
+    constexpr uint32_t FileCount = 10'000;
+    // uniform, about 340 MB in total
+    constexpr uint32_t MinFileSize = 4 * 1024;
+    constexpr uint32_t MaxFileSize = 64 * 1024;
+    // every fourth asset is on screen, the rest is streamed ahead
+    constexpr uint32_t VisibleEvery = 4;
+
+    struct Workload
+    {
+        std::filesystem::path Directory;
+        std::vector<std::string> Paths;
+        std::vector<uint32_t> Sizes;
+        uint64_t Bytes = 0;
+    };
+
+    struct BackendCase
+    {
+        const char *Name;
+        IoBackendType Backend;
+        uint32_t ThreadCount;
+    };
+
+    constexpr BackendCase Backends[] = {
+        {"io_uring", IoBackendType::IoUring, 0},
+        {"pread_4_threads", IoBackendType::ThreadPool, 4},
+        {"pread_16_threads", IoBackendType::ThreadPool, 16},
+    };
+
+    struct RunResult
+    {
+        std::vector<double> VisibleLatencies;
+        std::vector<double> PrefetchLatencies;
+        double Milliseconds = 0.0;
+        uint64_t Bytes = 0;
+    };
+
+    bool WriteWorkload(Workload &workload)
+    {
+        workload.Directory = std::filesystem::temp_directory_path() / "vanadium_async_io_bench";
+        std::error_code error;
+        std::filesystem::remove_all(workload.Directory, error);
+
+        std::mt19937 random(11);
+        std::uniform_int_distribution<uint32_t> sizes(MinFileSize, MaxFileSize);
+        std::vector<char> contents(MaxFileSize);
+        for (char &value : contents)
+        {
+            value = static_cast<char>(random());
+        }
+        for (uint32_t i = 0; i < FileCount; i++)
+        {
+            const std::filesystem::path path = workload.Directory / std::format("{0}/{1}.bin", i / 1000, i);
+            std::filesystem::create_directories(path.parent_path(), error);
+            const uint32_t size = sizes(random);
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            stream.write(contents.data(), size);
+            if (!stream.good())
+            {
+                return false;
+            }
+            workload.Paths.push_back(path.string());
+            workload.Sizes.push_back(size);
+            workload.Bytes += size;
+        }
+#if defined(__linux__)
+        // written back once, so dropping the pages before a cold run does not leave dirty pages behind
+        sync();
+#endif
+        return true;
+    }
+
+    // reads hit the disk again afterwards, without needing root to drop the whole page cache
+    bool EvictWorkload(const Workload &workload)
+    {
+#if defined(__linux__)
+        for (const std::string &path : workload.Paths)
+        {
+            const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (file >= 0)
+            {
+                posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+                close(file);
+            }
+        }
+        return true;
+#else
+        (void)workload;
+        return false;
+#endif
+    }
+
+    double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * Stream every file of the workload, keeping up to window reads outstanding
+     *
+     * @param reserve Returns the destination of a file's read, nullptr to hold back until more reads completed
+     * @param complete Called with the index and completion of every finished read
+     */
+    template <typename Reserve, typename Complete>
+    RunResult Stream(AsyncIo &io, const Workload &workload, uint32_t window, Reserve &&reserve, Complete &&complete)
+    {
+        RunResult run;
+        std::vector<std::chrono::steady_clock::time_point> started(FileCount);
+        std::vector<IoFile> files(FileCount, InvalidIoFile);
+        std::vector<IoCompletion> completions;
+
+        const auto start = std::chrono::steady_clock::now();
+        uint32_t next = 0;
+        uint32_t finished = 0;
+        while (finished < FileCount)
+        {
+            while (next < FileCount && io.GetOutstanding() < window)
+            {
+                void *destination = reserve(next);
+                if (!destination)
+                {
+                    break;
+                }
+                files[next] = AsyncIo::OpenFile(workload.Paths[next]);
+                IoRead read;
+                read.File = files[next];
+                read.Destination = destination;
+                read.Size = workload.Sizes[next];
+                read.Priority = next % VisibleEvery == 0 ? IoPriority::Visible : IoPriority::Prefetch;
+                read.UserData = reinterpret_cast<void *>(static_cast<uintptr_t>(next));
+                started[next] = std::chrono::steady_clock::now();
+                io.Read(read);
+                next++;
+            }
+            io.Submit();
+
+            completions.clear();
+            io.Poll(completions, true);
+            for (const IoCompletion &completion : completions)
+            {
+                const uint32_t index = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(completion.UserData));
+                const double latency = ElapsedMilliseconds(started[index]);
+                (index % VisibleEvery == 0 ? run.VisibleLatencies : run.PrefetchLatencies).push_back(latency);
+                if (completion.Status != IoStatus::Complete || completion.BytesRead != workload.Sizes[index])
+                {
+                    Log::Error("Read of {0} failed with status {1} errno {2}",
+                               workload.Paths[index],
+                               static_cast<uint32_t>(completion.Status),
+                               completion.Error);
+                }
+                complete(index, completion);
+                AsyncIo::CloseFile(files[index]);
+                run.Bytes += completion.BytesRead;
+                finished++;
+            }
+        }
+        run.Milliseconds = ElapsedMilliseconds(start);
+        return run;
+    }
+
+    void ReportRun(const std::string &name, RunResult &run)
+    {
+        Log::Info("{0}: {1:.0f} MiB/s, {2:.0f} files/s",
+                  name,
+                  static_cast<double>(run.Bytes) / (1024.0 * 1024.0) / (run.Milliseconds * 1e-3),
+                  FileCount / (run.Milliseconds * 1e-3));
+        Bench::Report(name + "/latency_visible", Bench::Summarize(std::move(run.VisibleLatencies)));
+        Bench::Report(name + "/latency_prefetch", Bench::Summarize(std::move(run.PrefetchLatencies)));
+    }
+
+    bool InitializeBackend(AsyncIo &io, const BackendCase &backend, AsyncIoProperties properties)
+    {
+        properties.Backend = backend.Backend;
+        properties.ThreadCount = backend.ThreadCount;
+        if (!io.Initialize(properties))
+        {
+            Log::Warning("{0} is not available, skipping", backend.Name);
+            return false;
+        }
+        return true;
+    }
+}
+
+// Throughput and per read latency of streaming 10k small files, io_uring against the pread thread pool. Every read
+// goes into a slot of one registered staging buffer and the file is opened and closed around its read. Warm runs are
+// served from the page cache; cold runs drop the files' pages first, so the reads go to the disk.
+VANADIUM_BENCHMARK(AsyncIoRead)
+{
+    Workload workload;
+    if (!WriteWorkload(workload))
+    {
+        Log::Warning("Could not write the workload to {0}, skipping", workload.Directory.string());
+        return;
+    }
+
+    AsyncIoProperties properties;
+    const uint32_t window = properties.QueueDepth * 2;
+    std::vector<uint8_t> staging(static_cast<size_t>(window) * MaxFileSize);
+    std::vector<uint32_t> freeSlots;
+
+    for (const BackendCase &backend : Backends)
+    {
+        for (const bool cold : {false, true})
+        {
+            if (cold && !EvictWorkload(workload))
+            {
+                continue;
+            }
+
+            AsyncIo io;
+            if (!InitializeBackend(io, backend, properties))
+            {
+                break;
+            }
+            io.RegisterBuffer(staging.data(), staging.size());
+
+            freeSlots.clear();
+            for (uint32_t slot = 0; slot < window; slot++)
+            {
+                freeSlots.push_back(slot);
+            }
+            std::vector<uint32_t> slots(FileCount);
+            RunResult run = Stream(
+                io,
+                workload,
+                window,
+                [&](uint32_t index) -> void *
+                {
+                    slots[index] = freeSlots.back();
+                    freeSlots.pop_back();
+                    return staging.data() + static_cast<size_t>(slots[index]) * MaxFileSize;
+                },
+                [&](uint32_t index, const IoCompletion &) { freeSlots.push_back(slots[index]); });
+            ReportRun(std::format("async_io/{0}/{1}", backend.Name, cold ? "cold" : "warm"), run);
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::remove_all(workload.Directory, error);
+}
+
+// The same workload streamed to the GPU: reads land directly in the upload queue's persistently mapped staging ring,
+// registered with the backend, and every finished read records its copy into a device local buffer. The time
+// includes waiting for the last copy.
+VANADIUM_BENCHMARK(AsyncIoUpload)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+    VulkanDevice *device = context.device;
+
+    Workload workload;
+    if (!WriteWorkload(workload))
+    {
+        Log::Warning("Could not write the workload to {0}, skipping", workload.Directory.string());
+        return;
+    }
+
+    // the copies of different files overlap in the destination, only the transfer matters here
+    constexpr VkDeviceSize DestinationBytes = 64ull * 1024 * 1024;
+    Buffer destination;
+    if (device->createBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                             &destination,
+                             DestinationBytes) != VK_SUCCESS)
+    {
+        Log::Error("Could not create the destination buffer");
+        return;
+    }
+
+    AsyncIoProperties properties;
+    for (const BackendCase &backend : Backends)
+    {
+        for (const bool cold : {false, true})
+        {
+            if (cold && !EvictWorkload(workload))
+            {
+                continue;
+            }
+
+            UploadQueue uploads;
+            UploadQueueProperties uploadProperties;
+            uploadProperties.StagingBytes = 16ull * 1024 * 1024;
+            uploadProperties.BatchBytes = 2ull * 1024 * 1024;
+            const uint32_t family = device->queueFamilyIndices.transfer;
+            if (uploads.Initialize(device, context.transferQueue, family, uploadProperties) != VK_SUCCESS)
+            {
+                Log::Error("Could not create the upload queue");
+                break;
+            }
+
+            AsyncIo io;
+            if (!InitializeBackend(io, backend, properties))
+            {
+                uploads.Destroy();
+                break;
+            }
+            const std::span<uint8_t> ring = uploads.GetStagingMemory();
+            io.RegisterBuffer(ring.data(), ring.size());
+
+            std::vector<uint64_t> positions(FileCount);
+            RunResult run = Stream(
+                io,
+                workload,
+                properties.QueueDepth * 2,
+                [&](uint32_t index) -> void * { return uploads.Reserve(workload.Sizes[index], positions[index]); },
+                [&](uint32_t index, const IoCompletion &completion)
+                {
+                    const VkDeviceSize offset = (static_cast<VkDeviceSize>(index) * MaxFileSize) % DestinationBytes;
+                    uploads.CopyReserved(positions[index], completion.BytesRead, destination.buffer, offset);
+                });
+            const auto start = std::chrono::steady_clock::now();
+            uploads.Wait(uploads.Submit());
+            run.Milliseconds += ElapsedMilliseconds(start);
+
+            ReportRun(std::format("async_io_upload/{0}/{1}", backend.Name, cold ? "cold" : "warm"), run);
+            io.Destroy();
+            uploads.Destroy();
+        }
+    }
+
+    destination.destroy();
+    std::error_code error;
+    std::filesystem::remove_all(workload.Directory, error);
+}
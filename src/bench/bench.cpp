@@ -0,0 +1,105 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+
+#include "core/log.h"
+
+namespace Bench
+{
+    struct Entry
+    {
+        const char *name;
+        BenchmarkFunction function;
+    };
+
+    // constructed on first use, registrations run during static initialization in unspecified order
+    std::vector<Entry> &Registry()
+    {
+        static std::vector<Entry> entries;
+        return entries;
+    }
+
+    Registration::Registration(const char *name, BenchmarkFunction function)
+    {
+        Registry().push_back({name, function});
+    }
+
+    Stats Summarize(std::vector<double> samples)
+    {
+        Stats stats{};
+        if (samples.empty())
+        {
+            return stats;
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        // nearest rank percentile
+        const auto percentile = [&samples](double p)
+        {
+            const size_t rank = static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+            return samples[std::min(rank, samples.size() - 1)];
+        };
+
+        double sum = 0.0;
+        for (const double sample : samples)
+        {
+            sum += sample;
+        }
+
+        stats.samples = static_cast<uint32_t>(samples.size());
+        stats.mean = sum / static_cast<double>(samples.size());
+        stats.min = samples.front();
+        stats.p50 = percentile(0.50);
+        stats.p95 = percentile(0.95);
+        stats.p99 = percentile(0.99);
+        stats.max = samples.back();
+        return stats;
+    }
+
+    void Report(const std::string &name, const Stats &stats)
+    {
+        Log::Info("{0:<48} n={1:<5} mean={2:>9.3f}ms p50={3:>9.3f}ms p95={4:>9.3f}ms p99={5:>9.3f}ms max={6:>9.3f}ms",
+                  name,
+                  stats.samples,
+                  stats.mean,
+                  stats.p50,
+                  stats.p95,
+                  stats.p99,
+                  stats.max);
+    }
+
+    int RunAll(const std::vector<std::string> &filters)
+    {
+        std::vector<Entry> entries = Registry();
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+                  { return std::string(a.name) < std::string(b.name); });
+
+        uint32_t ran = 0;
+        for (const Entry &entry : entries)
+        {
+            const std::string name = entry.name;
+            const bool selected = filters.empty() ||
+                                  std::ranges::any_of(filters, [&name](const std::string &filter)
+                                                      { return name.find(filter) != std::string::npos; });
+            if (!selected)
+            {
+                continue;
+            }
+
+            Log::System("[{0}]", name);
+            entry.function();
+            ran++;
+        }
+
+        if (ran == 0)
+        {
+            Log::Error("No benchmark matched the given filters.");
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Bench
+{
+    /** @brief Summary of a series of timing samples, all values in milliseconds */
+    struct Stats
+    {
+        uint32_t samples = 0;
+        double mean = 0.0;
+        double min = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    using BenchmarkFunction = void (*)();
+
+    /** @brief Adds a benchmark to the global list at static initialization time, see VANADIUM_BENCHMARK */
+    struct Registration
+    {
+        Registration(const char *name, BenchmarkFunction function);
+    };
+
+    Stats Summarize(std::vector<double> samples);
+    void Report(const std::string &name, const Stats &stats);
+
+    /**
+     * Time a callable, samples are only recorded after the warmup runs
+     *
+     * @param warmup Number of untimed runs
+     * @param iterations Number of timed runs
+     * @param function Callable to measure
+     */
+    template <typename Function>
+    Stats Measure(uint32_t warmup, uint32_t iterations, Function &&function)
+    {
+        for (uint32_t i = 0; i < warmup; i++)
+        {
+            function();
+        }
+
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+            samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+
+        return Summarize(std::move(samples));
+    }
+
+    /**
+     * Run every registered benchmark whose name contains one of the filters
+     *
+     * @return Process exit code
+     */
+    int RunAll(const std::vector<std::string> &filters);
+}
+
+#define VANADIUM_BENCHMARK(name)                                        \
+    static void name();                                                 \
+    static Bench::Registration name##Registration(#name, &name);        \
+    static void name()
@@ -0,0 +1,352 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <format>
+#include <vector>
+
+#include "core/log.h"
+#include "graphics/vulkan/vk_debugger.h"
+#include "graphics/vulkan/vk_host_memory.h"
+#include "graphics/vulkan/vk_initializers.h"
+#include "headless_context.h"
+
+namespace
+{
+    constexpr uint32_t Warmup = 3;
+    constexpr uint32_t Iterations = 30;
+    // objects created per sample for the per object benchmarks
+    constexpr uint32_t BatchSize = 256;
+
+    std::string SizeName(VkDeviceSize size)
+    {
+        if (size >= 1024 * 1024)
+        {
+            return std::format("{0}MiB", size / (1024 * 1024));
+        }
+        if (size >= 1024)
+        {
+            return std::format("{0}KiB", size / 1024);
+        }
+        return std::format("{0}B", size);
+    }
+
+    void ReportPerObject(const std::string &name, const Bench::Stats &stats, uint32_t objects)
+    {
+        Bench::Report(name, stats);
+        Log::Info("    {0:.2f} us per object (p50), {1:.2f} us (p99)",
+                  stats.p50 * 1e3 / objects,
+                  stats.p99 * 1e3 / objects);
+    }
+
+    void ReportThroughput(const std::string &name, const Bench::Stats &stats, uint32_t operations, VkDeviceSize size)
+    {
+        Bench::Report(name, stats);
+        const double bytes = static_cast<double>(size) * operations;
+        Log::Info("    {0:.2f} us per operation, {1:.2f} GiB/s (p50)",
+                  stats.p50 * 1e3 / operations,
+                  stats.p50 > 0.0 ? bytes / (stats.p50 * 1e-3) / (1024.0 * 1024.0 * 1024.0) : 0.0);
+    }
+}
+
+// VulkanDevice::createBuffer with its own allocation per buffer against placing every buffer into one
+// preallocated block, the second is what a suballocator reduces buffer creation to
+VANADIUM_BENCHMARK(BufferCreation)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+    VulkanDevice *device = context.device;
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    for (const VkDeviceSize size : {VkDeviceSize{256}, VkDeviceSize{64 * 1024}, VkDeviceSize{1024 * 1024}})
+    {
+        std::vector<Buffer> buffers(BatchSize);
+        const Bench::Stats dedicated = Bench::Measure(Warmup, Iterations, [&]
+                                                      {
+            for (Buffer &buffer : buffers)
+            {
+                Debug::CheckVulkan(device->createBuffer(usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &buffer, size));
+            }
+            for (Buffer &buffer : buffers)
+            {
+                buffer.destroy();
+            } });
+        ReportPerObject(std::format("buffer/{0}/create_dedicated", SizeName(size)), dedicated, BatchSize);
+
+        // one block for the whole batch, buffers are bound at aligned offsets like a linear suballocator would
+        VkBufferCreateInfo bufferInfo = vkinit::bufferCreateInfo(usage, size);
+        VkBuffer probe;
+        Debug::CheckVulkan(vkCreateBuffer(device->logicalDevice,
+                                          &bufferInfo,
+                                          vkhost::allocationCallbacks(VK_OBJECT_TYPE_BUFFER),
+                                          &probe));
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device->logicalDevice, probe, &requirements);
+        vkDestroyBuffer(device->logicalDevice, probe, vkhost::allocationCallbacks(VK_OBJECT_TYPE_BUFFER));
+
+        const VkDeviceSize stride = (requirements.size + requirements.alignment - 1) & ~(requirements.alignment - 1);
+        VkMemoryAllocateInfo allocateInfo = vkinit::memoryAllocateInfo();
+        allocateInfo.allocationSize = stride * BatchSize;
+        allocateInfo.memoryTypeIndex = device->getMemoryType(requirements.memoryTypeBits,
+                                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkDeviceMemory block;
+        Debug::CheckVulkan(vkAllocateMemory(device->logicalDevice,
+                                            &allocateInfo,
+                                            vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY),
+                                            &block));
+
+        std::vector<VkBuffer> handles(BatchSize);
+        const Bench::Stats suballocated = Bench::Measure(Warmup, Iterations, [&]
+                                                         {
+            for (uint32_t i = 0; i < BatchSize; i++)
+            {
+                Debug::CheckVulkan(vkCreateBuffer(device->logicalDevice,
+                                                  &bufferInfo,
+                                                  vkhost::allocationCallbacks(VK_OBJECT_TYPE_BUFFER),
+                                                  &handles[i]));
+                // a suballocator has to query the requirements of every buffer before placing it
+                VkMemoryRequirements bufferRequirements;
+                vkGetBufferMemoryRequirements(device->logicalDevice, handles[i], &bufferRequirements);
+                Debug::CheckVulkan(vkBindBufferMemory(device->logicalDevice, handles[i], block, stride * i));
+            }
+            for (const VkBuffer handle : handles)
+            {
+                vkDestroyBuffer(device->logicalDevice, handle, vkhost::allocationCallbacks(VK_OBJECT_TYPE_BUFFER));
+            } });
+        ReportPerObject(std::format("buffer/{0}/create_in_block", SizeName(size)), suballocated, BatchSize);
+
+        vkFreeMemory(device->logicalDevice, block, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY));
+    }
+}
+
+// Latency of the blocking submit helpers, every call records, submits and waits on a fresh fence
+VANADIUM_BENCHMARK(SubmitRoundTrip)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+    VulkanDevice *device = context.device;
+
+    const Bench::Stats empty = Bench::Measure(Warmup, Iterations * 4, [&]
+                                              {
+        const VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+        device->flushCommandBuffer(commandBuffer, context.queue); });
+    Bench::Report("submit/flush_empty", empty);
+
+    for (const VkDeviceSize size : {VkDeviceSize{64}, VkDeviceSize{1024 * 1024}, VkDeviceSize{64 * 1024 * 1024}})
+    {
+        Buffer source;
+        Buffer destination;
+        Debug::CheckVulkan(device->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                &source,
+                                                size));
+        Debug::CheckVulkan(device->createBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                &destination,
+                                                size));
+
+        const Bench::Stats copy = Bench::Measure(Warmup, Iterations, [&]
+                                                 { device->copyBuffer(&source, &destination, context.queue); });
+        ReportThroughput(std::format("submit/copy_buffer/{0}", SizeName(size)), copy, 1, size);
+
+        source.destroy();
+        destination.destroy();
+    }
+}
+
+// Host writes into mapped memory: map + copyTo + flush + unmap per upload, and the same with a persistent mapping
+VANADIUM_BENCHMARK(UploadThroughput)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+    VulkanDevice *device = context.device;
+
+    constexpr VkDeviceSize MaxSize = 64 * 1024 * 1024;
+    // enough uploads per sample that small sizes are not dominated by the clock
+    constexpr VkDeviceSize BytesPerSample = 64 * 1024 * 1024;
+    std::vector<uint8_t> source(MaxSize, 0x5a);
+
+    Buffer buffer;
+    Debug::CheckVulkan(device->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                            &buffer,
+                                            MaxSize));
+
+    for (VkDeviceSize size = 64; size <= MaxSize; size *= 16)
+    {
+        const uint32_t uploads = static_cast<uint32_t>(std::clamp<VkDeviceSize>(BytesPerSample / size, 1, 4096));
+
+        const Bench::Stats mapped = Bench::Measure(Warmup, Iterations, [&]
+                                                   {
+            for (uint32_t i = 0; i < uploads; i++)
+            {
+                Debug::CheckVulkan(buffer.map());
+                buffer.copyTo(source.data(), size);
+                Debug::CheckVulkan(buffer.flush());
+                buffer.unmap();
+            } });
+        ReportThroughput(std::format("upload/{0}/map_copy_flush", SizeName(size)), mapped, uploads, size);
+
+        Debug::CheckVulkan(buffer.map());
+        const Bench::Stats persistent = Bench::Measure(Warmup, Iterations, [&]
+                                                       {
+            for (uint32_t i = 0; i < uploads; i++)
+            {
+                buffer.copyTo(source.data(), size);
+                Debug::CheckVulkan(buffer.flush());
+            } });
+        buffer.unmap();
+        ReportThroughput(std::format("upload/{0}/persistent_copy_flush", SizeName(size)), persistent, uploads, size);
+    }
+
+    buffer.destroy();
+}
+
+// createCommandBuffer one at a time against one batched vkAllocateCommandBuffers, and resetting the pool instead
+// of freeing
+VANADIUM_BENCHMARK(CommandBufferAllocation)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+    VulkanDevice *device = context.device;
+    std::vector<VkCommandBuffer> commandBuffers(BatchSize);
+
+    const Bench::Stats single = Bench::Measure(Warmup, Iterations, [&]
+                                               {
+        for (VkCommandBuffer &commandBuffer : commandBuffers)
+        {
+            commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, false);
+        }
+        vkFreeCommandBuffers(device->logicalDevice, device->commandPool, BatchSize, commandBuffers.data()); });
+    ReportPerObject("commands/create_command_buffer", single, BatchSize);
+
+    const Bench::Stats begin = Bench::Measure(Warmup, Iterations, [&]
+                                              {
+        for (VkCommandBuffer &commandBuffer : commandBuffers)
+        {
+            commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+            Debug::CheckVulkan(vkEndCommandBuffer(commandBuffer));
+        }
+        vkFreeCommandBuffers(device->logicalDevice, device->commandPool, BatchSize, commandBuffers.data()); });
+    ReportPerObject("commands/create_begin_end", begin, BatchSize);
+
+    const VkCommandPool transientPool = device->createCommandPool(device->queueFamilyIndices.graphics,
+                                                                  VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    const VkCommandBufferAllocateInfo allocateInfo = vkinit::commandBufferAllocateInfo(transientPool,
+                                                                                       VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                                                       BatchSize);
+    const Bench::Stats batched = Bench::Measure(Warmup, Iterations, [&]
+                                                {
+        Debug::CheckVulkan(vkAllocateCommandBuffers(device->logicalDevice, &allocateInfo, commandBuffers.data()));
+        Debug::CheckVulkan(vkResetCommandPool(device->logicalDevice, transientPool, 0));
+        vkFreeCommandBuffers(device->logicalDevice, transientPool, BatchSize, commandBuffers.data()); });
+    ReportPerObject("commands/batched_transient_pool", batched, BatchSize);
+
+    // reuse after a pool reset is the steady state of a per frame pool
+    Debug::CheckVulkan(vkAllocateCommandBuffers(device->logicalDevice, &allocateInfo, commandBuffers.data()));
+    const VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
+    const Bench::Stats reused = Bench::Measure(Warmup, Iterations, [&]
+                                               {
+        for (const VkCommandBuffer commandBuffer : commandBuffers)
+        {
+            Debug::CheckVulkan(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+            Debug::CheckVulkan(vkEndCommandBuffer(commandBuffer));
+        }
+        Debug::CheckVulkan(vkResetCommandPool(device->logicalDevice, transientPool, 0)); });
+    ReportPerObject("commands/reuse_after_pool_reset", reused, BatchSize);
+
+    vkDestroyCommandPool(device->logicalDevice,
+                         transientPool,
+                         vkhost::allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL));
+}
+
+// Descriptor sets with a storage and a uniform buffer: one allocation call per set, one call for the whole batch,
+// and writing them
+VANADIUM_BENCHMARK(DescriptorAllocation)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+    const VkDevice device = context.device->logicalDevice;
+
+    const VkDescriptorSetLayoutBinding bindings[] = {
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo = vkinit::descriptorSetLayoutCreateInfo(bindings, 2);
+    VkDescriptorSetLayout layout;
+    Debug::CheckVulkan(vkCreateDescriptorSetLayout(device,
+                                                   &layoutInfo,
+                                                   vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
+                                                   &layout));
+
+    VkDescriptorPoolSize poolSizes[] = {
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, BatchSize),
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, BatchSize),
+    };
+    VkDescriptorPoolCreateInfo poolInfo = vkinit::descriptorPoolCreateInfo(2, poolSizes, BatchSize);
+    VkDescriptorPool pool;
+    Debug::CheckVulkan(vkCreateDescriptorPool(device,
+                                              &poolInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL),
+                                              &pool));
+
+    std::vector<VkDescriptorSet> sets(BatchSize);
+    const VkDescriptorSetAllocateInfo singleInfo = vkinit::descriptorSetAllocateInfo(pool, &layout, 1);
+    const Bench::Stats single = Bench::Measure(Warmup, Iterations, [&]
+                                               {
+        for (VkDescriptorSet &set : sets)
+        {
+            Debug::CheckVulkan(vkAllocateDescriptorSets(device, &singleInfo, &set));
+        }
+        Debug::CheckVulkan(vkResetDescriptorPool(device, pool, 0)); });
+    ReportPerObject("descriptors/allocate_single", single, BatchSize);
+
+    const std::vector<VkDescriptorSetLayout> layouts(BatchSize, layout);
+    const VkDescriptorSetAllocateInfo batchInfo = vkinit::descriptorSetAllocateInfo(pool, layouts.data(), BatchSize);
+    const Bench::Stats batched = Bench::Measure(Warmup, Iterations, [&]
+                                                {
+        Debug::CheckVulkan(vkAllocateDescriptorSets(device, &batchInfo, sets.data()));
+        Debug::CheckVulkan(vkResetDescriptorPool(device, pool, 0)); });
+    ReportPerObject("descriptors/allocate_batched", batched, BatchSize);
+
+    Buffer buffer;
+    Debug::CheckVulkan(context.device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                    &buffer,
+                                                    256));
+    Debug::CheckVulkan(vkAllocateDescriptorSets(device, &batchInfo, sets.data()));
+    std::vector<VkWriteDescriptorSet> writes;
+    writes.reserve(BatchSize * 2);
+    for (const VkDescriptorSet set : sets)
+    {
+        writes.push_back(vkinit::writeDescriptorSet(set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &buffer.descriptor));
+        writes.push_back(vkinit::writeDescriptorSet(set, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, &buffer.descriptor));
+    }
+    const Bench::Stats update = Bench::Measure(Warmup, Iterations, [&]
+                                               { vkUpdateDescriptorSets(device,
+                                                                        static_cast<uint32_t>(writes.size()),
+                                                                        writes.data(),
+                                                                        0,
+                                                                        nullptr); });
+    ReportPerObject("descriptors/update", update, BatchSize);
+
+    buffer.destroy();
+    vkDestroyDescriptorPool(device, pool, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+    vkDestroyDescriptorSetLayout(device, layout, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+}
@@ -0,0 +1,196 @@
+#include "headless_context.h"
+
+#include <cstdlib>
+
+#include "core/log.h"
+#include "graphics/vulkan/vk_debugger.h"
+#include "graphics/vulkan/vk_device_selection.h"
+#include "graphics/vulkan/vk_host_memory.h"
+#include "graphics/vulkan/vk_initializers.h"
+
+bool HeadlessContext::Initialize()
+{
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "Vanadium Bench";
+    appInfo.pEngineName = "Vanadium";
+    appInfo.apiVersion = VK_API_VERSION_1_3;
+
+    VkInstanceCreateInfo instanceCreateInfo{};
+    instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceCreateInfo.pApplicationInfo = &appInfo;
+
+    if (vkCreateInstance(&instanceCreateInfo,
+                         vkhost::allocationCallbacks(VK_OBJECT_TYPE_INSTANCE),
+                         &instance) != VK_SUCCESS)
+    {
+        Log::Error("Could not create Vulkan instance!");
+        return false;
+    }
+
+    DeviceSelectionProperties selection = {};
+    if (const char *requested = std::getenv("VANADIUM_BENCH_DEVICE"))
+    {
+        selection.Override = requested;
+    }
+    const VkPhysicalDevice physicalDevice = vktools::selectPhysicalDevice(instance, selection);
+    if (physicalDevice == VK_NULL_HANDLE)
+    {
+        Log::Error("No Physical Device with the required Vulkan features found!");
+        return false;
+    }
+
+    device = new VulkanDevice(physicalDevice);
+    Log::System("Bench Device: {0}", device->properties.deviceName);
+
+    VkPhysicalDeviceFeatures enabledFeatures{};
+    enabledFeatures.pipelineStatisticsQuery = device->features.pipelineStatisticsQuery;
+    enabledFeatures.occlusionQueryPrecise = device->features.occlusionQueryPrecise;
+    features13.dynamicRendering = VK_TRUE;
+    features13.synchronization2 = VK_TRUE;
+    features12.timelineSemaphore = VK_TRUE;
+    features13.pNext = &features12;
+    if (device->createLogicalDevice(enabledFeatures,
+                                    {},
+                                    &features13,
+                                    false,
+                                    VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT) != VK_SUCCESS)
+    {
+        Log::Error("Could not create logical device!");
+        return false;
+    }
+
+    vkGetDeviceQueue(device->logicalDevice, device->queueFamilyIndices.graphics, 0, &queue);
+    vkGetDeviceQueue(device->logicalDevice, device->queueFamilyIndices.compute, 0, &computeQueue);
+    vkGetDeviceQueue(device->logicalDevice, device->queueFamilyIndices.transfer, 0, &transferQueue);
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2;
+    Debug::CheckVulkan(vkCreateQueryPool(device->logicalDevice,
+                                         &queryPoolInfo,
+                                         vkhost::allocationCallbacks(VK_OBJECT_TYPE_QUERY_POOL),
+                                         &timestampPool));
+
+    return true;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (device)
+    {
+        vkDeviceWaitIdle(device->logicalDevice);
+        if (timestampPool)
+        {
+            vkDestroyQueryPool(device->logicalDevice,
+                               timestampPool,
+                               vkhost::allocationCallbacks(VK_OBJECT_TYPE_QUERY_POOL));
+        }
+        delete device;
+    }
+    if (instance)
+    {
+        vkDestroyInstance(instance, vkhost::allocationCallbacks(VK_OBJECT_TYPE_INSTANCE));
+    }
+}
+
+Bench::Stats HeadlessContext::MeasureGpu(uint32_t warmup,
+                                         uint32_t iterations,
+                                         const std::function<void(VkCommandBuffer)> &record)
+{
+    const uint32_t validBits = device->queueFamilyProperties[device->queueFamilyIndices.graphics].timestampValidBits;
+    if (validBits == 0)
+    {
+        Log::Warning("Graphics queue does not support timestamps, skipping GPU timing.");
+        Submit(record);
+        return {};
+    }
+
+    const VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, false);
+    const VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
+
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (uint32_t i = 0; i < warmup + iterations; i++)
+    {
+        Debug::CheckVulkan(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+        vkCmdResetQueryPool(commandBuffer, timestampPool, 0, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, 0);
+        record(commandBuffer);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, 1);
+        Flush(commandBuffer);
+
+        uint64_t timestamps[2];
+        Debug::CheckVulkan(vkGetQueryPoolResults(device->logicalDevice,
+                                                 timestampPool,
+                                                 0,
+                                                 2,
+                                                 sizeof(timestamps),
+                                                 timestamps,
+                                                 sizeof(uint64_t),
+                                                 VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+        if (i >= warmup)
+        {
+            const uint64_t mask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+            const uint64_t ticks = (timestamps[1] - timestamps[0]) & mask;
+            samples.push_back(static_cast<double>(ticks) * device->properties.limits.timestampPeriod / 1e6);
+        }
+    }
+
+    vkFreeCommandBuffers(device->logicalDevice, device->commandPool, 1, &commandBuffer);
+    return Bench::Summarize(std::move(samples));
+}
+
+void HeadlessContext::Submit(const std::function<void(VkCommandBuffer)> &record)
+{
+    const VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    record(commandBuffer);
+    Flush(commandBuffer);
+    vkFreeCommandBuffers(device->logicalDevice, device->commandPool, 1, &commandBuffer);
+}
+
+void HeadlessContext::WaitOnNextSubmit(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stages)
+{
+    waitSemaphores.push_back(semaphore);
+    waitValues.push_back(value);
+    waitStages.push_back(stages);
+}
+
+void HeadlessContext::SubmitToQueue(VkCommandBuffer commandBuffer, VkFence fence)
+{
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+
+    VkSubmitInfo submitInfo = vkinit::submitInfo();
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    Debug::CheckVulkan(vkQueueSubmit(queue, 1, &submitInfo, fence));
+
+    waitSemaphores.clear();
+    waitValues.clear();
+    waitStages.clear();
+}
+
+// like VulkanDevice::flushCommandBuffer, with the registered waits
+void HeadlessContext::Flush(VkCommandBuffer commandBuffer)
+{
+    Debug::CheckVulkan(vkEndCommandBuffer(commandBuffer));
+
+    const VkFenceCreateInfo fenceInfo = vkinit::fenceCreateInfo(0);
+    VkFence fence;
+    Debug::CheckVulkan(vkCreateFence(device->logicalDevice,
+                                     &fenceInfo,
+                                     vkhost::allocationCallbacks(VK_OBJECT_TYPE_FENCE),
+                                     &fence));
+    SubmitToQueue(commandBuffer, fence);
+    Debug::CheckVulkan(vkWaitForFences(device->logicalDevice, 1, &fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+    vkDestroyFence(device->logicalDevice, fence, vkhost::allocationCallbacks(VK_OBJECT_TYPE_FENCE));
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "bench.h"
+#include "graphics/vulkan/vk_device.h"
+
+/**
+ * @brief Minimal Vulkan instance and device without a surface, for GPU benchmarks (runs on lavapipe)
+ * @note Set VANADIUM_BENCH_DEVICE to a substring of the device name or its UUID to pick a specific adapter
+ */
+class HeadlessContext
+{
+public:
+    bool Initialize();
+    ~HeadlessContext();
+
+    /**
+     * Record work into a fresh primary command buffer, submit it and time it with timestamp queries
+     *
+     * @param record Callback recording the work to measure
+     *
+     * @return GPU time statistics, empty if the queue does not support timestamps
+     */
+    Bench::Stats MeasureGpu(uint32_t warmup,
+                            uint32_t iterations,
+                            const std::function<void(VkCommandBuffer)> &record);
+
+    /** @brief Record and submit a command buffer once and wait for completion */
+    void Submit(const std::function<void(VkCommandBuffer)> &record);
+
+    /**
+     * Make the next submission to queue wait for a timeline semaphore, e.g. for work a record callback submitted to
+     * another queue
+     */
+    void WaitOnNextSubmit(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stages);
+
+    /** @brief Submit an ended command buffer to queue with the waits registered since the last submission */
+    void SubmitToQueue(VkCommandBuffer commandBuffer, VkFence fence);
+
+    VkInstance instance{VK_NULL_HANDLE};
+    VulkanDevice *device = nullptr;
+    VkQueue queue{VK_NULL_HANDLE};
+    VkQueue computeQueue{VK_NULL_HANDLE};
+    VkQueue transferQueue{VK_NULL_HANDLE};
+    std::string shaderDirectory = "shaders";
+
+private:
+    void Flush(VkCommandBuffer commandBuffer);
+
+    VkPhysicalDeviceVulkan12Features features12{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    VkPhysicalDeviceVulkan13Features features13{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
+    VkQueryPool timestampPool{VK_NULL_HANDLE};
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    std::vector<VkPipelineStageFlags> waitStages;
+};
@@ -0,0 +1,120 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <format>
+#include <thread>
+#include <vector>
+
+#include "core/job_system.h"
+#include "core/log.h"
+
+namespace
+{
+    constexpr uint32_t Warmup = 3;
+    constexpr uint32_t Iterations = 20;
+
+    constexpr uint32_t ParallelForCount = 1 << 22;
+    constexpr uint32_t ParallelForGrain = 4096;
+    // 2^14 leaves of roughly 10 us each
+    constexpr uint32_t ForkJoinDepth = 14;
+    constexpr uint32_t LeafIterations = 2000;
+
+    std::atomic<uint64_t> sink{0};
+
+    uint64_t Spin(uint32_t seed, uint32_t iterations)
+    {
+        float value = static_cast<float>(seed);
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            value = std::sqrt(value * 1.0001f + 1.0f);
+        }
+        return static_cast<uint64_t>(value);
+    }
+
+    void SpinRange(uint32_t begin, uint32_t end)
+    {
+        uint64_t sum = 0;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            sum += Spin(i, 8);
+        }
+        sink.fetch_add(sum, std::memory_order_relaxed);
+    }
+
+    struct ForkJoinContext
+    {
+        JobSystem *Jobs;
+    };
+
+    // binary tree of jobs, each node spawns both children and waits for them, leaves do the actual work
+    void ForkJoinJob(const void *context, uint32_t depth, uint32_t seed)
+    {
+        const ForkJoinContext &forkJoin = *static_cast<const ForkJoinContext *>(context);
+        if (depth == 0)
+        {
+            sink.fetch_add(Spin(seed, LeafIterations), std::memory_order_relaxed);
+            return;
+        }
+
+        JobCounter children;
+        forkJoin.Jobs->Run(&ForkJoinJob, context, depth - 1, seed * 2, children);
+        forkJoin.Jobs->Run(&ForkJoinJob, context, depth - 1, seed * 2 + 1, children);
+        forkJoin.Jobs->Wait(children);
+    }
+
+    std::vector<uint32_t> ThreadCounts()
+    {
+        const uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<uint32_t> counts;
+        for (uint32_t count = 1; count < hardware; count *= 2)
+        {
+            counts.push_back(count);
+        }
+        counts.push_back(hardware);
+        return counts;
+    }
+
+    void ReportScaling(const std::string &name, const Bench::Stats &stats, double serialP50, uint32_t threads)
+    {
+        Bench::Report(name, stats);
+        const double speedup = serialP50 / stats.p50;
+        Log::Info("    {0:.2f}x speedup over 1 thread, {1:.0f}% parallel efficiency",
+                  speedup,
+                  speedup / threads * 100.0);
+    }
+}
+
+// Synthetic fork-join workloads on 1 to N threads: a flat ParallelFor and a recursive job tree whose inner nodes
+// wait for their children, which exercises stealing and helping while waiting
+VANADIUM_BENCHMARK(JobSystemScaling)
+{
+    double parallelForSerial = 0.0;
+    double forkJoinSerial = 0.0;
+
+    for (const uint32_t threads : ThreadCounts())
+    {
+        JobSystemProperties properties = {};
+        properties.ThreadCount = threads;
+        JobSystem jobs(properties);
+
+        const Bench::Stats parallelFor = Bench::Measure(
+            Warmup, Iterations, [&] { jobs.ParallelFor(ParallelForCount, ParallelForGrain, &SpinRange); });
+
+        const ForkJoinContext context{&jobs};
+        const Bench::Stats forkJoin = Bench::Measure(Warmup, Iterations, [&]
+                                                     {
+            JobCounter root;
+            jobs.Run(&ForkJoinJob, &context, ForkJoinDepth, 1, root);
+            jobs.Wait(root); });
+
+        if (threads == 1)
+        {
+            parallelForSerial = parallelFor.p50;
+            forkJoinSerial = forkJoin.p50;
+        }
+        ReportScaling(std::format("jobs/parallel_for/{0}_threads", threads), parallelFor, parallelForSerial, threads);
+        ReportScaling(std::format("jobs/fork_join/{0}_threads", threads), forkJoin, forkJoinSerial, threads);
+    }
+}
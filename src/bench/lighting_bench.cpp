@@ -0,0 +1,54 @@
+#include "bench.h"
+
+#include "core/log.h"
+#include "headless_context.h"
+#include "shading_workload.h"
+
+namespace
+{
+    constexpr uint32_t Width = 1920;
+    constexpr uint32_t Height = 1080;
+    constexpr uint32_t Warmup = 5;
+    constexpr uint32_t Iterations = 50;
+}
+
+VANADIUM_BENCHMARK(ClusteredLightCulling)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+
+    ShadingWorkload workload;
+    if (!workload.Initialize(context, Width, Height))
+    {
+        return;
+    }
+
+    for (const uint32_t lightCount : {256u, 1024u, 4096u})
+    {
+        workload.SetLights(lightCount);
+
+        const Bench::Stats cull = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                     { workload.RecordCull(commandBuffer); });
+        const Bench::Stats clustered = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                          { workload.RecordClustered(commandBuffer); });
+        const Bench::Stats bruteForce = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                           { workload.RecordBruteForce(commandBuffer); });
+
+        Bench::Report(std::format("lighting/{0}/cull_only", lightCount), cull);
+        // the graphics queue timestamps only cover the shading when the cull overlaps it on the compute queue
+        Bench::Report(std::format("lighting/{0}/{1}",
+                                  lightCount,
+                                  workload.IsCullAsync() ? "clustered_shade_async_cull" : "clustered_cull_and_shade"),
+                      clustered);
+        Bench::Report(std::format("lighting/{0}/brute_force_shade", lightCount), bruteForce);
+        if (clustered.p50 > 0.0)
+        {
+            Log::Info("    speedup over brute force: {0:.2f}x", bruteForce.p50 / clustered.p50);
+        }
+    }
+
+    workload.Destroy();
+}
@@ -0,0 +1,88 @@
+#include "bench.h"
+
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "core/log.h"
+
+namespace
+{
+    // below the logger queue capacity, so a batch never drops messages
+    constexpr uint32_t MessagesPerBatch = 4'000;
+    constexpr uint32_t Warmup = 3;
+    constexpr uint32_t Iterations = 50;
+
+    // only the calling thread's cost is timed, the queue is drained between batches
+    template <typename Function>
+    Bench::Stats MeasureBatches(Function &&logBatch)
+    {
+        std::vector<double> samples;
+        samples.reserve(Iterations);
+        for (uint32_t i = 0; i < Warmup + Iterations; i++)
+        {
+            Log::Flush();
+            const auto start = std::chrono::steady_clock::now();
+            logBatch();
+            const auto end = std::chrono::steady_clock::now();
+            if (i >= Warmup)
+            {
+                samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            }
+        }
+        return Bench::Summarize(std::move(samples));
+    }
+
+    void ReportPerMessage(const std::string &name, const Bench::Stats &stats)
+    {
+        Bench::Report(name, stats);
+        Log::Info("    {0:.1f} ns per message (p50), {1:.1f} ns (p99)",
+                  stats.p50 * 1e6 / MessagesPerBatch,
+                  stats.p99 * 1e6 / MessagesPerBatch);
+    }
+}
+
+// Cost of a log call on the calling thread: filtered out at runtime, formatted by the caller, and deferred to the
+// logger thread. Messages go to log_bench.log only so the console does not slow down the logger thread.
+VANADIUM_BENCHMARK(LogCallCost)
+{
+    LogProperties properties{};
+    properties.Threshold = LogLevel::Info;
+    properties.Console = false;
+    properties.FilePath = "log_bench.log";
+    properties.MaxRotatedFiles = 0;
+    Log::Initialize(properties);
+
+    const std::string deviceName = "Bench Device";
+    const Bench::Stats filtered = MeasureBatches(
+        [&]
+        {
+            for (uint32_t i = 0; i < MessagesPerBatch; i++)
+            {
+                Log::Trace("frame {0} device {1} took {2:.3f} ms", i, deviceName, 1.5);
+            }
+        });
+    const Bench::Stats eager = MeasureBatches(
+        [&]
+        {
+            for (uint32_t i = 0; i < MessagesPerBatch; i++)
+            {
+                Log::Info(std::format("frame {0} device {1} took {2:.3f} ms", i, deviceName, 1.5));
+            }
+        });
+    const Bench::Stats deferred = MeasureBatches(
+        [&]
+        {
+            for (uint32_t i = 0; i < MessagesPerBatch; i++)
+            {
+                Log::Info("frame {0} device {1} took {2:.3f} ms", i, deviceName, 1.5);
+            }
+        });
+
+    // reported after the console is back
+    Log::Initialize(LogProperties{});
+    ReportPerMessage("log/filtered_trace", filtered);
+    ReportPerMessage("log/eager_format", eager);
+    ReportPerMessage("log/deferred_format", deferred);
+}
@@ -0,0 +1,8 @@
+#include "bench.h"
+
+int main(int argc, char *argv[])
+{
+    // every argument is a substring filter on the benchmark name
+    std::vector<std::string> filters(argv + 1, argv + argc);
+    return Bench::RunAll(filters);
+}
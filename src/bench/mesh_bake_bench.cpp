@@ -0,0 +1,528 @@
+#include "bench.h"
+
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <string>
+#include <vector>
+
+#include "core/job_system.h"
+#include "core/log.h"
+#include "graphics/gpu_statistics.h"
+#include "graphics/mesh_loader.h"
+#include "graphics/upload_queue.h"
+#include "graphics/vulkan/vk_debugger.h"
+#include "graphics/vulkan/vk_host_memory.h"
+#include "graphics/vulkan/vk_initializers.h"
+#include "graphics/vulkan/vk_tools.h"
+#include "headless_context.h"
+#include "mesh_baker.h"
+
+namespace
+{
+    constexpr uint32_t Width = 1920;
+    constexpr uint32_t Height = 1080;
+    constexpr uint32_t Warmup = 5;
+    constexpr uint32_t Iterations = 50;
+
+    // 262144 triangles, as a triangle soup about 24 MiB of float attributes
+    constexpr uint32_t Segments = 512;
+    constexpr uint32_t Rings = 256;
+
+    constexpr VkFormat ColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    // guaranteed to be usable as depth attachment
+    constexpr VkFormat DepthFormat = VK_FORMAT_D16_UNORM;
+
+    struct PushConstants
+    {
+        glm::mat4 viewProjection;
+        glm::vec4 positionOffset;
+        glm::vec4 positionScale;
+    };
+
+    struct MeshVariant
+    {
+        const char *Name;
+        bool Baked;
+        bool QuantizePositions;
+    };
+
+    constexpr MeshVariant Variants[] = {
+        {"raw", false, false},
+        {"baked", true, false},
+        {"baked_quantized", true, true},
+    };
+
+    glm::vec3 BumpySphere(uint32_t ring, uint32_t segment)
+    {
+        const float theta = glm::pi<float>() * static_cast<float>(ring) / Rings;
+        const float phi = glm::two_pi<float>() * static_cast<float>(segment) / Segments;
+        // the bumps give the mesh concave parts that can overdraw each other
+        const float radius = 1.0f + 0.2f * std::sin(6.0f * theta) * std::sin(6.0f * phi);
+        return radius * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+    }
+
+    // a bumpy sphere the way importers often hand it over: every triangle has its own three vertices and the
+    // triangles come in no particular order
+    Bake::SourceModel BuildRawMesh()
+    {
+        const uint32_t columns = Segments + 1;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        for (uint32_t ring = 0; ring <= Rings; ring++)
+        {
+            for (uint32_t segment = 0; segment <= Segments; segment++)
+            {
+                positions.push_back(BumpySphere(ring, segment));
+                texCoords.emplace_back(static_cast<float>(segment) / Segments, static_cast<float>(ring) / Rings);
+            }
+        }
+
+        std::vector<uint32_t> triangles;
+        for (uint32_t ring = 0; ring < Rings; ring++)
+        {
+            for (uint32_t segment = 0; segment < Segments; segment++)
+            {
+                const uint32_t corner = ring * columns + segment;
+                triangles.insert(triangles.end(),
+                                 {corner, corner + 1, corner + columns, corner + 1, corner + columns + 1,
+                                  corner + columns});
+            }
+        }
+
+        std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            const glm::vec3 normal = glm::cross(positions[triangles[i + 1]] - positions[triangles[i]],
+                                                positions[triangles[i + 2]] - positions[triangles[i]]);
+            for (size_t corner = 0; corner < 3; corner++)
+            {
+                normals[triangles[i + corner]] += normal;
+            }
+        }
+
+        // a fixed permutation of the triangles: the count is a power of two, so stepping by an odd constant modulo
+        // the count visits every triangle exactly once
+        const uint32_t triangleCount = static_cast<uint32_t>(triangles.size() / 3);
+        Bake::SourceModel model;
+        model.MeshNames.push_back("bumpy_sphere");
+        Bake::SourcePrimitive &primitive = model.Primitives.emplace_back();
+        for (uint32_t i = 0; i < triangleCount; i++)
+        {
+            const uint32_t triangle = static_cast<uint32_t>((i * 2654435761ull) % triangleCount);
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                const uint32_t vertex = triangles[triangle * 3 + corner];
+                primitive.Indices.push_back(static_cast<uint32_t>(primitive.Positions.size()));
+                primitive.Positions.push_back(positions[vertex]);
+                const float length = glm::length(normals[vertex]);
+                primitive.Normals.push_back(length > 0.0f ? normals[vertex] / length : glm::vec3(0.0f, 1.0f, 0.0f));
+                primitive.TexCoords.push_back(texCoords[vertex]);
+            }
+        }
+        return model;
+    }
+
+    void WriteU32(std::ofstream &stream, uint32_t value)
+    {
+        stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    void WriteVector(std::ofstream &stream, const std::vector<T> &values)
+    {
+        stream.write(reinterpret_cast<const char *>(values.data()),
+                     static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+
+    // the unbaked mesh goes through the same loader as the baked one, as float streams with 32 bit indices
+    bool WriteRawGlb(const std::filesystem::path &path, const Bake::SourcePrimitive &primitive)
+    {
+        const uint64_t positionBytes = primitive.Positions.size() * sizeof(glm::vec3);
+        const uint64_t normalBytes = primitive.Normals.size() * sizeof(glm::vec3);
+        const uint64_t texCoordBytes = primitive.TexCoords.size() * sizeof(glm::vec2);
+        const uint64_t indexBytes = primitive.Indices.size() * sizeof(uint32_t);
+        const uint64_t binBytes = positionBytes + normalBytes + texCoordBytes + indexBytes;
+
+        std::string json = std::format(
+            "{{\"asset\":{{\"version\":\"2.0\"}},\"buffers\":[{{\"byteLength\":{0}}}],\"bufferViews\":["
+            "{{\"buffer\":0,\"byteOffset\":0,\"byteLength\":{1}}},"
+            "{{\"buffer\":0,\"byteOffset\":{1},\"byteLength\":{2}}},"
+            "{{\"buffer\":0,\"byteOffset\":{3},\"byteLength\":{4}}},"
+            "{{\"buffer\":0,\"byteOffset\":{5},\"byteLength\":{6}}}],\"accessors\":["
+            "{{\"bufferView\":0,\"componentType\":5126,\"count\":{7},\"type\":\"VEC3\","
+            "\"min\":[-1.2,-1.2,-1.2],\"max\":[1.2,1.2,1.2]}},"
+            "{{\"bufferView\":1,\"componentType\":5126,\"count\":{7},\"type\":\"VEC3\"}},"
+            "{{\"bufferView\":2,\"componentType\":5126,\"count\":{7},\"type\":\"VEC2\"}},"
+            "{{\"bufferView\":3,\"componentType\":5125,\"count\":{8},\"type\":\"SCALAR\"}}],"
+            "\"meshes\":[{{\"name\":\"bumpy_sphere\",\"primitives\":[{{\"attributes\":{{\"POSITION\":0,"
+            "\"NORMAL\":1,\"TEXCOORD_0\":2}},\"indices\":3}}]}}]}}",
+            binBytes,
+            positionBytes,
+            normalBytes,
+            positionBytes + normalBytes,
+            texCoordBytes,
+            positionBytes + normalBytes + texCoordBytes,
+            indexBytes,
+            primitive.Positions.size(),
+            primitive.Indices.size());
+        json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        WriteU32(stream, 0x46546C67);
+        WriteU32(stream, 2);
+        WriteU32(stream, static_cast<uint32_t>(12 + 8 + json.size() + 8 + binBytes));
+        WriteU32(stream, static_cast<uint32_t>(json.size()));
+        WriteU32(stream, 0x4E4F534A);
+        stream.write(json.data(), static_cast<std::streamsize>(json.size()));
+        WriteU32(stream, static_cast<uint32_t>(binBytes));
+        WriteU32(stream, 0x004E4942);
+        WriteVector(stream, primitive.Positions);
+        WriteVector(stream, primitive.Normals);
+        WriteVector(stream, primitive.TexCoords);
+        WriteVector(stream, primitive.Indices);
+        return stream.good();
+    }
+
+    // position and normal in separate bindings, which covers both the glTF streams and the interleaved baked layout
+    VkPipeline CreateMeshPipeline(VkDevice device,
+                                  VkPipelineLayout layout,
+                                  const std::string &shaderDirectory,
+                                  const MeshPrimitive &primitive,
+                                  bool packed)
+    {
+        const VkShaderModule vertexShader = vktools::loadShader(shaderDirectory + "/mesh_bench.vert.spv", device);
+        const VkShaderModule fragmentShader = vktools::loadShader(shaderDirectory + "/mesh_bench.frag.spv", device);
+        if (!vertexShader || !fragmentShader)
+        {
+            return VK_NULL_HANDLE;
+        }
+
+        const VkSpecializationMapEntry entry = vkinit::specializationMapEntry(0, 0, sizeof(VkBool32));
+        const VkBool32 packedFlag = packed ? VK_TRUE : VK_FALSE;
+        const VkSpecializationInfo specialization =
+            vkinit::specializationInfo(1, &entry, sizeof(VkBool32), &packedFlag);
+        const VkPipelineShaderStageCreateInfo stages[] = {
+            vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertexShader, &specialization),
+            vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader)};
+
+        const std::vector<VkVertexInputBindingDescription> bindings = {
+            vkinit::vertexInputBindingDescription(0, primitive.Position.Stride, VK_VERTEX_INPUT_RATE_VERTEX),
+            vkinit::vertexInputBindingDescription(1, primitive.Normal.Stride, VK_VERTEX_INPUT_RATE_VERTEX)};
+        const std::vector<VkVertexInputAttributeDescription> attributes = {
+            vkinit::vertexInputAttributeDescription(0, 0, primitive.Position.Format, 0),
+            vkinit::vertexInputAttributeDescription(1, 1, primitive.Normal.Format, 0)};
+        const VkPipelineVertexInputStateCreateInfo vertexInput =
+            vkinit::pipelineVertexInputStateCreateInfo(bindings, attributes);
+        const VkPipelineInputAssemblyStateCreateInfo inputAssembly =
+            vkinit::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+        const VkPipelineRasterizationStateCreateInfo rasterization = vkinit::pipelineRasterizationStateCreateInfo(
+            VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        const VkPipelineColorBlendAttachmentState blendAttachment =
+            vkinit::pipelineColorBlendAttachmentState(0xF, VK_FALSE);
+        const VkPipelineColorBlendStateCreateInfo colorBlend =
+            vkinit::pipelineColorBlendStateCreateInfo(1, &blendAttachment);
+        const VkPipelineDepthStencilStateCreateInfo depthStencil =
+            vkinit::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS);
+        const VkPipelineViewportStateCreateInfo viewport = vkinit::pipelineViewportStateCreateInfo(1, 1);
+        const VkPipelineMultisampleStateCreateInfo multisample =
+            vkinit::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT);
+        const std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        const VkPipelineDynamicStateCreateInfo dynamicState = vkinit::pipelineDynamicStateCreateInfo(dynamicStates);
+
+        VkPipelineRenderingCreateInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachmentFormats = &ColorFormat;
+        renderingInfo.depthAttachmentFormat = DepthFormat;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo = vkinit::pipelineCreateInfo();
+        pipelineInfo.pNext = &renderingInfo;
+        pipelineInfo.layout = layout;
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = stages;
+        pipelineInfo.pVertexInputState = &vertexInput;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pRasterizationState = &rasterization;
+        pipelineInfo.pColorBlendState = &colorBlend;
+        pipelineInfo.pDepthStencilState = &depthStencil;
+        pipelineInfo.pViewportState = &viewport;
+        pipelineInfo.pMultisampleState = &multisample;
+        pipelineInfo.pDynamicState = &dynamicState;
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        Debug::CheckVulkan(vkCreateGraphicsPipelines(device,
+                                                     VK_NULL_HANDLE,
+                                                     1,
+                                                     &pipelineInfo,
+                                                     vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE),
+                                                     &pipeline));
+        vkDestroyShaderModule(device, vertexShader, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+        vkDestroyShaderModule(device, fragmentShader, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+        return pipeline;
+    }
+
+    void RecordDraw(VkCommandBuffer commandBuffer,
+                    const MeshModel &model,
+                    VkPipeline pipeline,
+                    VkPipelineLayout layout,
+                    const glm::mat4 &viewProjection,
+                    const Image &color,
+                    const Image &depth)
+    {
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          color.image,
+                                          0,
+                                          VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_UNDEFINED,
+                                          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                          VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                          VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                          color.subresourceRange());
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          depth.image,
+                                          0,
+                                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_UNDEFINED,
+                                          VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                          VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                              VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                                          VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                              VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                                          depth.subresourceRange());
+
+        VkRenderingAttachmentInfo colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        colorAttachment.imageView = color.view;
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        VkRenderingAttachmentInfo depthAttachment{};
+        depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        depthAttachment.imageView = depth.view;
+        depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.clearValue.depthStencil = {1.0f, 0};
+
+        VkRenderingInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        renderingInfo.renderArea = vkinit::rect2D(Width, Height, 0, 0);
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+        renderingInfo.pDepthAttachment = &depthAttachment;
+        vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+        const VkViewport viewport = vkinit::viewport(static_cast<float>(Width), static_cast<float>(Height), 0.0f, 1.0f);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &renderingInfo.renderArea);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+        for (const Mesh &mesh : model.Meshes)
+        {
+            for (const MeshPrimitive &primitive : mesh.Primitives)
+            {
+                const PushConstants push{viewProjection,
+                                         glm::vec4(primitive.PositionOffset, 0.0f),
+                                         glm::vec4(primitive.PositionScale, 0.0f)};
+                vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push);
+
+                const VkBuffer buffers[] = {model.Geometry.buffer, model.Geometry.buffer};
+                const VkDeviceSize offsets[] = {primitive.Position.Offset, primitive.Normal.Offset};
+                vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+                vkCmdBindIndexBuffer(commandBuffer, model.Geometry.buffer, primitive.IndexOffset, primitive.IndexType);
+                vkCmdDrawIndexed(commandBuffer, primitive.IndexCount, 1, 0, 0, 0);
+            }
+        }
+        vkCmdEndRendering(commandBuffer);
+    }
+}
+
+// Vertex shader invocations and GPU time of the same mesh before and after vanadium_bake's processing. The raw mesh
+// is an unwelded triangle soup in random order with float attributes, the baked ones are welded, reordered for the
+// post transform cache and overdraw and packed. Both are loaded through the MeshLoader, drawn at 1080p with depth
+// testing and back face culling.
+VANADIUM_BENCHMARK(MeshBaking)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+    VulkanDevice *device = context.device;
+    const VkDevice logicalDevice = device->logicalDevice;
+
+    const Bake::SourceModel source = BuildRawMesh();
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::vector<std::string> paths;
+    for (const MeshVariant &variant : Variants)
+    {
+        const std::filesystem::path path =
+            directory / std::format("vanadium_mesh_bake_bench_{0}.{1}", variant.Name, variant.Baked ? "vmesh" : "glb");
+        paths.push_back(path.string());
+        if (!variant.Baked)
+        {
+            if (!WriteRawGlb(path, source.Primitives[0]))
+            {
+                Log::Warning("Could not write {0}, skipping", path.string());
+                return;
+            }
+            continue;
+        }
+
+        Bake::BakeProperties properties;
+        properties.QuantizePositions = variant.QuantizePositions;
+        Bake::BakedModel baked;
+        Bake::BakeStatistics statistics;
+        const Bench::Stats bakeTime =
+            Bench::Measure(0, 1, [&] { Bake::Bake(source, properties, baked, statistics); });
+        if (!Bake::WriteBakedFile(paths.back(), baked))
+        {
+            return;
+        }
+
+        Bench::Report(std::format("mesh_bake/{0}/bake_cpu", variant.Name), bakeTime);
+        Log::Info("    vertices {0} -> {1}, ACMR {2:.3f} -> {3:.3f}, geometry {4:.2f} MiB -> {5:.2f} MiB",
+                  statistics.SourceVertices,
+                  statistics.BakedVertices,
+                  statistics.SourceAcmr,
+                  statistics.BakedAcmr,
+                  static_cast<double>(statistics.SourceBytes) / (1024.0 * 1024.0),
+                  static_cast<double>(statistics.BakedBytes) / (1024.0 * 1024.0));
+    }
+
+    JobSystem jobs;
+    UploadQueue uploads;
+    if (uploads.Initialize(device, context.transferQueue, device->queueFamilyIndices.transfer) != VK_SUCCESS)
+    {
+        Log::Error("Could not create the upload queue");
+        return;
+    }
+    MeshLoader loader(device, jobs, uploads, device->queueFamilyIndices.graphics);
+    std::vector<MeshModel> models;
+    const bool loaded = loader.Load(paths, models);
+    for (const std::string &path : paths)
+    {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+    if (!loaded)
+    {
+        for (MeshModel &model : models)
+        {
+            model.Destroy();
+        }
+        uploads.Destroy();
+        return;
+    }
+    for (const MeshModel &model : models)
+    {
+        uploads.Wait(model.UploadValue);
+    }
+
+    Image color;
+    Image depth;
+    Debug::CheckVulkan(device->createImage(ColorFormat,
+                                           {Width, Height},
+                                           VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           &color));
+    Debug::CheckVulkan(device->createImage(DepthFormat,
+                                           {Width, Height},
+                                           VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           &depth));
+
+    GpuStatistics statistics;
+    Debug::CheckVulkan(statistics.Initialize(device, GpuStatisticsProperties{}, 1));
+    if (!statistics.IsPipelineStatisticsSupported())
+    {
+        Log::Warning("pipelineStatisticsQuery is not supported, vertex invocations are not reported");
+    }
+
+    const VkPushConstantRange pushRange =
+        vkinit::pushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, sizeof(PushConstants), 0);
+    VkPipelineLayoutCreateInfo layoutInfo = vkinit::pipelineLayoutCreateInfo(0u);
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    Debug::CheckVulkan(vkCreatePipelineLayout(logicalDevice,
+                                              &layoutInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT),
+                                              &pipelineLayout));
+
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.8f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f),
+                                                 static_cast<float>(Width) / static_cast<float>(Height),
+                                                 0.1f,
+                                                 10.0f);
+    projection[1][1] *= -1.0f;
+    const glm::mat4 viewProjection = projection * view;
+
+    for (uint32_t i = 0; i < models.size(); i++)
+    {
+        const MeshVariant &variant = Variants[i];
+        const MeshModel &model = models[i];
+        const VkPipeline pipeline = CreateMeshPipeline(logicalDevice,
+                                                       pipelineLayout,
+                                                       context.shaderDirectory,
+                                                       model.Meshes[0].Primitives[0],
+                                                       variant.Baked);
+        if (!pipeline)
+        {
+            continue;
+        }
+
+        // the statistics of a frame are resolved when its slot begins again, the queue is idle after Submit
+        context.Submit([&](VkCommandBuffer commandBuffer)
+                       {
+            statistics.BeginFrame(commandBuffer, 0);
+            statistics.BeginPass(commandBuffer, variant.Name);
+            RecordDraw(commandBuffer, model, pipeline, pipelineLayout, viewProjection, color, depth);
+            statistics.EndPass(commandBuffer); });
+        context.Submit([&](VkCommandBuffer commandBuffer) { statistics.BeginFrame(commandBuffer, 0); });
+
+        const Bench::Stats stats = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                      {
+            RecordDraw(commandBuffer, model, pipeline, pipelineLayout, viewProjection, color, depth); });
+        Bench::Report(std::format("mesh_bake/{0}/draw_gpu", variant.Name), stats);
+
+        uint64_t triangles = 0;
+        for (const Mesh &mesh : model.Meshes)
+        {
+            for (const MeshPrimitive &primitive : mesh.Primitives)
+            {
+                triangles += primitive.IndexCount / 3;
+            }
+        }
+        if (const PassStatistics *pass = statistics.FindPass(variant.Name))
+        {
+            Log::Info("    {0} vertex invocations for {1} triangles ({2:.3f} per triangle), {3} fragment invocations",
+                      pass->VertexInvocations,
+                      triangles,
+                      triangles ? static_cast<double>(pass->VertexInvocations) / static_cast<double>(triangles) : 0.0,
+                      pass->FragmentInvocations);
+        }
+        Log::Info("    {0:.2f} MiB of geometry", static_cast<double>(model.Geometry.size) / (1024.0 * 1024.0));
+
+        vkDestroyPipeline(logicalDevice, pipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    }
+
+    vkDeviceWaitIdle(logicalDevice);
+    vkDestroyPipelineLayout(logicalDevice,
+                            pipelineLayout,
+                            vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+    statistics.Destroy();
+    color.destroy();
+    depth.destroy();
+    for (MeshModel &model : models)
+    {
+        model.Destroy();
+    }
+    uploads.Destroy();
+}
@@ -0,0 +1,255 @@
+#include "bench.h"
+
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "core/job_system.h"
+#include "core/log.h"
+#include "graphics/mesh_loader.h"
+#include "graphics/upload_queue.h"
+#include "headless_context.h"
+
+namespace
+{
+    constexpr uint32_t Warmup = 1;
+    constexpr uint32_t Iterations = 5;
+
+    // 256 x 256 vertices with position, normal and uv plus 32 bit indices, about 3.5 MiB per mesh
+    constexpr uint32_t GridSize = 256;
+    constexpr uint32_t VertexCount = GridSize * GridSize;
+    constexpr uint32_t IndexCount = (GridSize - 1) * (GridSize - 1) * 6;
+
+    struct SceneCase
+    {
+        const char *Name;
+        uint64_t Bytes;
+        uint32_t Files;
+    };
+
+    constexpr SceneCase Scenes[] = {
+        {"100MB", 100ull * 1000 * 1000, 1},
+        {"100MB", 100ull * 1000 * 1000, 8},
+        {"1GB", 1000ull * 1000 * 1000, 1},
+        {"1GB", 1000ull * 1000 * 1000, 8},
+    };
+
+    struct GridData
+    {
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> texCoords;
+        std::vector<uint32_t> indices;
+    };
+
+    GridData BuildGrid()
+    {
+        GridData grid;
+        grid.positions.reserve(VertexCount * 3);
+        grid.normals.reserve(VertexCount * 3);
+        grid.texCoords.reserve(VertexCount * 2);
+        for (uint32_t z = 0; z < GridSize; z++)
+        {
+            for (uint32_t x = 0; x < GridSize; x++)
+            {
+                const float u = static_cast<float>(x) / (GridSize - 1);
+                const float v = static_cast<float>(z) / (GridSize - 1);
+                grid.positions.insert(grid.positions.end(), {u, 0.0f, v});
+                grid.normals.insert(grid.normals.end(), {0.0f, 1.0f, 0.0f});
+                grid.texCoords.insert(grid.texCoords.end(), {u, v});
+            }
+        }
+
+        grid.indices.reserve(IndexCount);
+        for (uint32_t z = 0; z + 1 < GridSize; z++)
+        {
+            for (uint32_t x = 0; x + 1 < GridSize; x++)
+            {
+                const uint32_t corner = z * GridSize + x;
+                grid.indices.insert(grid.indices.end(),
+                                    {corner, corner + GridSize, corner + 1, corner + 1, corner + GridSize,
+                                     corner + GridSize + 1});
+            }
+        }
+        return grid;
+    }
+
+    uint64_t GridBytes(const GridData &grid)
+    {
+        return (grid.positions.size() + grid.normals.size() + grid.texCoords.size()) * sizeof(float) +
+               grid.indices.size() * sizeof(uint32_t);
+    }
+
+    void WriteU32(std::ofstream &stream, uint32_t value)
+    {
+        stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    // every mesh has its own four buffer views, the grid data itself is repeated
+    bool WriteSyntheticGlb(const std::filesystem::path &path, const GridData &grid, uint32_t meshCount)
+    {
+        const uint64_t positionBytes = grid.positions.size() * sizeof(float);
+        const uint64_t normalBytes = grid.normals.size() * sizeof(float);
+        const uint64_t texCoordBytes = grid.texCoords.size() * sizeof(float);
+        const uint64_t indexBytes = grid.indices.size() * sizeof(uint32_t);
+        const uint64_t meshBytes = GridBytes(grid);
+        const uint64_t binBytes = meshBytes * meshCount;
+
+        std::string views;
+        std::string accessors;
+        std::string meshes;
+        for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+        {
+            const uint64_t base = meshBytes * mesh;
+            const uint32_t view = mesh * 4;
+            const char *separator = mesh == 0 ? "" : ",";
+            views += std::format("{0}{{\"buffer\":0,\"byteOffset\":{1},\"byteLength\":{2}}},"
+                                 "{{\"buffer\":0,\"byteOffset\":{3},\"byteLength\":{4}}},"
+                                 "{{\"buffer\":0,\"byteOffset\":{5},\"byteLength\":{6}}},"
+                                 "{{\"buffer\":0,\"byteOffset\":{7},\"byteLength\":{8}}}",
+                                 separator,
+                                 base,
+                                 positionBytes,
+                                 base + positionBytes,
+                                 normalBytes,
+                                 base + positionBytes + normalBytes,
+                                 texCoordBytes,
+                                 base + positionBytes + normalBytes + texCoordBytes,
+                                 indexBytes);
+            accessors += std::format("{0}{{\"bufferView\":{1},\"componentType\":5126,\"count\":{5},\"type\":\"VEC3\","
+                                     "\"min\":[0,0,0],\"max\":[1,0,1]}},"
+                                     "{{\"bufferView\":{2},\"componentType\":5126,\"count\":{5},\"type\":\"VEC3\"}},"
+                                     "{{\"bufferView\":{3},\"componentType\":5126,\"count\":{5},\"type\":\"VEC2\"}},"
+                                     "{{\"bufferView\":{4},\"componentType\":5125,\"count\":{6},\"type\":\"SCALAR\"}}",
+                                     separator,
+                                     view,
+                                     view + 1,
+                                     view + 2,
+                                     view + 3,
+                                     VertexCount,
+                                     IndexCount);
+            meshes += std::format("{0}{{\"name\":\"grid{1}\",\"primitives\":[{{\"attributes\":{{\"POSITION\":{2},"
+                                  "\"NORMAL\":{3},\"TEXCOORD_0\":{4}}},\"indices\":{5}}}]}}",
+                                  separator,
+                                  mesh,
+                                  view,
+                                  view + 1,
+                                  view + 2,
+                                  view + 3);
+        }
+
+        std::string json = std::format("{{\"asset\":{{\"version\":\"2.0\"}},\"buffers\":[{{\"byteLength\":{0}}}],"
+                                       "\"bufferViews\":[{1}],\"accessors\":[{2}],\"meshes\":[{3}]}}",
+                                       binBytes,
+                                       views,
+                                       accessors,
+                                       meshes);
+        // the JSON chunk is padded with spaces to keep the BIN chunk 4 byte aligned
+        json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+        const uint64_t totalBytes = 12 + 8 + json.size() + 8 + binBytes;
+        if (totalBytes > UINT32_MAX)
+        {
+            return false;
+        }
+
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        WriteU32(stream, 0x46546C67);
+        WriteU32(stream, 2);
+        WriteU32(stream, static_cast<uint32_t>(totalBytes));
+        WriteU32(stream, static_cast<uint32_t>(json.size()));
+        WriteU32(stream, 0x4E4F534A);
+        stream.write(json.data(), static_cast<std::streamsize>(json.size()));
+        WriteU32(stream, static_cast<uint32_t>(binBytes));
+        WriteU32(stream, 0x004E4942);
+        for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+        {
+            stream.write(reinterpret_cast<const char *>(grid.positions.data()),
+                         static_cast<std::streamsize>(positionBytes));
+            stream.write(reinterpret_cast<const char *>(grid.normals.data()), static_cast<std::streamsize>(normalBytes));
+            stream.write(reinterpret_cast<const char *>(grid.texCoords.data()),
+                         static_cast<std::streamsize>(texCoordBytes));
+            stream.write(reinterpret_cast<const char *>(grid.indices.data()), static_cast<std::streamsize>(indexBytes));
+        }
+        return stream.good();
+    }
+}
+
+// Load time of synthetic binary glTF scenes from disk until their geometry is resident on the GPU: mapping, parsing
+// the JSON chunk on the job system and streaming every buffer view through the staging ring on the transfer queue.
+// The files are generated right before they are measured, so they are usually served from the page cache; the
+// numbers are the loader's throughput, not the disk's.
+VANADIUM_BENCHMARK(MeshLoading)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+    VulkanDevice *device = context.device;
+
+    JobSystem jobs;
+    UploadQueue uploads;
+    if (uploads.Initialize(device, context.transferQueue, device->queueFamilyIndices.transfer) != VK_SUCCESS)
+    {
+        Log::Error("Could not create the upload queue");
+        return;
+    }
+    MeshLoader loader(device, jobs, uploads, device->queueFamilyIndices.graphics);
+
+    const GridData grid = BuildGrid();
+    const uint64_t meshBytes = GridBytes(grid);
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+
+    for (const SceneCase &scene : Scenes)
+    {
+        const uint32_t meshesPerFile =
+            std::max<uint32_t>(1, static_cast<uint32_t>(scene.Bytes / meshBytes / scene.Files));
+
+        std::vector<std::string> paths;
+        bool written = true;
+        for (uint32_t file = 0; file < scene.Files && written; file++)
+        {
+            const std::filesystem::path path = directory / std::format("vanadium_mesh_bench_{0}.glb", file);
+            paths.push_back(path.string());
+            written = WriteSyntheticGlb(path, grid, meshesPerFile);
+        }
+
+        if (written)
+        {
+            uint64_t loadedBytes = 0;
+            const Bench::Stats stats = Bench::Measure(Warmup, Iterations, [&]
+                                                      {
+                std::vector<MeshModel> models;
+                loader.Load(paths, models);
+                loadedBytes = 0;
+                for (MeshModel &model : models)
+                {
+                    uploads.Wait(model.UploadValue);
+                    loadedBytes += model.Geometry.size;
+                    model.Destroy();
+                } });
+
+            Bench::Report(std::format("mesh_load/{0}/{1}_files", scene.Name, scene.Files), stats);
+            Log::Info("    {0:.1f} MiB of geometry, {1:.0f} MiB/s (p50)",
+                      static_cast<double>(loadedBytes) / (1024.0 * 1024.0),
+                      stats.p50 > 0.0 ? static_cast<double>(loadedBytes) / (1024.0 * 1024.0) / (stats.p50 * 1e-3)
+                                      : 0.0);
+        }
+        else
+        {
+            Log::Warning("Could not write the {0} scene to {1}, skipping", scene.Name, directory.string());
+        }
+
+        for (const std::string &path : paths)
+        {
+            std::error_code error;
+            std::filesystem::remove(path, error);
+        }
+    }
+
+    uploads.Destroy();
+}
@@ -0,0 +1,184 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <random>
+#include <vector>
+
+#include "core/log.h"
+#include "graphics/mip_generator.h"
+#include "graphics/texture.h"
+#include "graphics/upload_queue.h"
+#include "graphics/vulkan/vk_debugger.h"
+#include "graphics/vulkan/vk_tools.h"
+#include "headless_context.h"
+
+namespace
+{
+    constexpr uint32_t Warmup = 3;
+    constexpr uint32_t Iterations = 20;
+    constexpr uint32_t Sizes[] = {1024, 4096, 8192};
+
+    // noise instead of a flat color so bandwidth compression does not flatter either path
+    std::vector<uint32_t> NoiseTexels(uint32_t size)
+    {
+        std::vector<uint32_t> texels(static_cast<size_t>(size) * size);
+        std::minstd_rand random(size);
+        for (uint32_t &texel : texels)
+        {
+            texel = static_cast<uint32_t>(random()) | 0xFF000000u;
+        }
+        return texels;
+    }
+
+    // the chain MipGenerator replaces: one linear blit per level and a barrier before the next level reads it
+    void RecordBlitChain(VkCommandBuffer commandBuffer, const Image &image, VkImageLayout &layout)
+    {
+        VkImageSubresourceRange range = image.subresourceRange();
+        range.levelCount = 1;
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          image.image,
+                                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                                          VK_ACCESS_TRANSFER_READ_BIT,
+                                          layout,
+                                          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                          VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          range);
+        range.baseMipLevel = 1;
+        range.levelCount = image.mipLevels - 1;
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          image.image,
+                                          0,
+                                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_UNDEFINED,
+                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          range);
+
+        range.levelCount = 1;
+        for (uint32_t level = 1; level < image.mipLevels; level++)
+        {
+            VkImageBlit blit{};
+            blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+            blit.srcOffsets[1] = {std::max(static_cast<int32_t>(image.extent.width >> (level - 1)), 1),
+                                  std::max(static_cast<int32_t>(image.extent.height >> (level - 1)), 1),
+                                  1};
+            blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+            blit.dstOffsets[1] = {std::max(static_cast<int32_t>(image.extent.width >> level), 1),
+                                  std::max(static_cast<int32_t>(image.extent.height >> level), 1),
+                                  1};
+            vkCmdBlitImage(commandBuffer,
+                           image.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           image.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1,
+                           &blit,
+                           VK_FILTER_LINEAR);
+
+            range.baseMipLevel = level;
+            vktools::insertImageMemoryBarrier(commandBuffer,
+                                              image.image,
+                                              VK_ACCESS_TRANSFER_WRITE_BIT,
+                                              VK_ACCESS_TRANSFER_READ_BIT,
+                                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                              VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                              range);
+        }
+
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          image.image,
+                                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                                          VK_ACCESS_SHADER_READ_BIT,
+                                          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                          image.subresourceRange());
+        layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+}
+
+// Full mip chain of 1k, 4k and 8k textures: a serial vkCmdBlitImage chain with a barrier per level against the
+// single dispatch of the MipGenerator, for UNORM and for sRGB textures that filter in linear space
+VANADIUM_BENCHMARK(MipGeneration)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+    VulkanDevice *device = context.device;
+
+    MipGenerator generator;
+    if (generator.Initialize(device, context.shaderDirectory, 4) != VK_SUCCESS)
+    {
+        generator.Destroy();
+        return;
+    }
+    // base levels are uploaded on the graphics queue, so neither path needs concurrent sharing
+    UploadQueue uploads;
+    Debug::CheckVulkan(uploads.Initialize(device, context.queue, device->queueFamilyIndices.graphics));
+
+    for (const uint32_t size : Sizes)
+    {
+        const std::vector<uint32_t> texels = NoiseTexels(size);
+        const VkExtent2D extent{size, size};
+        const uint32_t mipLevels = std::bit_width(size);
+        const VkDeviceSize rowBytes = static_cast<VkDeviceSize>(size) * sizeof(uint32_t);
+
+        Image blitImage;
+        Debug::CheckVulkan(device->createImage(VK_FORMAT_R8G8B8A8_UNORM,
+                                               extent,
+                                               VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                                   VK_IMAGE_USAGE_SAMPLED_BIT,
+                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                               &blitImage,
+                                               mipLevels));
+        Texture unormTexture;
+        Texture srgbTexture;
+        TextureProperties properties;
+        properties.Format = VK_FORMAT_R8G8B8A8_UNORM;
+        Debug::CheckVulkan(unormTexture.Initialize(device, extent, properties));
+        properties.Format = VK_FORMAT_R8G8B8A8_SRGB;
+        Debug::CheckVulkan(srgbTexture.Initialize(device, extent, properties));
+
+        uploads.CopyToImage(texels.data(), rowBytes, blitImage);
+        unormTexture.Upload(uploads, texels.data());
+        srgbTexture.Upload(uploads, texels.data());
+        uploads.Wait(uploads.Submit());
+
+        VkImageLayout blitLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        const Bench::Stats blit = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                     { RecordBlitChain(commandBuffer, blitImage, blitLayout); });
+        Bench::Report(std::format("mips/blit_chain/{0}", size), blit);
+
+        const Bench::Stats compute = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                        { generator.Record(commandBuffer, unormTexture); });
+        Bench::Report(std::format("mips/single_pass/{0}", size), compute);
+
+        const Bench::Stats srgb = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                     { generator.Record(commandBuffer, srgbTexture); });
+        Bench::Report(std::format("mips/single_pass_srgb/{0}", size), srgb);
+
+        if (compute.p50 > 0.0)
+        {
+            Log::Info("    {0} levels, single pass {1:.2f}x faster than the blit chain (p50)",
+                      mipLevels,
+                      blit.p50 / compute.p50);
+        }
+
+        vkDeviceWaitIdle(device->logicalDevice);
+        blitImage.destroy();
+        unormTexture.Destroy();
+        srgbTexture.Destroy();
+    }
+
+    uploads.Destroy();
+    generator.Destroy();
+}
@@ -0,0 +1,164 @@
+#include "bench.h"
+
+#include "core/log.h"
+#include "graphics/gpu_profiler.h"
+#include "graphics/post_processing.h"
+#include "graphics/vulkan/vk_debugger.h"
+#include "graphics/vulkan/vk_initializers.h"
+#include "graphics/vulkan/vk_tools.h"
+#include "headless_context.h"
+#include "shading_workload.h"
+
+namespace
+{
+    constexpr uint32_t Width = 1920;
+    constexpr uint32_t Height = 1080;
+    constexpr uint32_t Warmup = 5;
+    constexpr uint32_t Iterations = 50;
+
+    struct EffectSet
+    {
+        const char *name;
+        bool bloom;
+        bool tonemap;
+        bool colorGrading;
+        bool vignette;
+    };
+}
+
+// Full post stack and the stack with one effect removed at a time, the difference is the cost of that effect
+// inside the fused composite
+VANADIUM_BENCHMARK(PostProcessingStack)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+
+    // a lit scene instead of a cleared image so bandwidth compression does not flatter the passes
+    ShadingWorkload workload;
+    if (!workload.Initialize(context, Width, Height))
+    {
+        return;
+    }
+    workload.SetLights(1024);
+
+    const VkExtent2D extent{Width, Height};
+    Image scene;
+    Image output;
+    Debug::CheckVulkan(context.device->createImage(VK_FORMAT_R32G32B32A32_SFLOAT,
+                                                   extent,
+                                                   VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                   &scene));
+    Debug::CheckVulkan(context.device->createImage(VK_FORMAT_R8G8B8A8_UNORM,
+                                                   extent,
+                                                   VK_IMAGE_USAGE_STORAGE_BIT,
+                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                   &output));
+
+    context.Submit([&](VkCommandBuffer commandBuffer)
+                   {
+        workload.RecordClustered(commandBuffer);
+
+        VkBufferMemoryBarrier barrier = vkinit::bufferMemoryBarrier();
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.buffer = workload.output.buffer;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             1,
+                             &barrier,
+                             0,
+                             nullptr);
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          scene.image,
+                                          0,
+                                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_UNDEFINED,
+                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          scene.subresourceRange());
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {Width, Height, 1};
+        vkCmdCopyBufferToImage(commandBuffer,
+                               workload.output.buffer,
+                               scene.image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1,
+                               &region);
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          scene.image,
+                                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                                          VK_ACCESS_SHADER_READ_BIT,
+                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                          scene.subresourceRange());
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          output.image,
+                                          0,
+                                          VK_ACCESS_SHADER_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_UNDEFINED,
+                                          VK_IMAGE_LAYOUT_GENERAL,
+                                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                          output.subresourceRange()); });
+
+    PostProcessingProperties postProperties{};
+    postProperties.MaxWidth = Width;
+    postProperties.MaxHeight = Height;
+    // one frame in flight, MeasureGpu waits for every submission so each frame resolves the previous one
+    GpuProfiler profiler;
+    profiler.Initialize(context.device, {}, 1, context.device->queueFamilyIndices.graphics);
+    PostProcessing post;
+    if (post.Initialize(context.device, postProperties, &profiler, context.queue, context.shaderDirectory) !=
+        VK_SUCCESS)
+    {
+        profiler.Destroy();
+        return;
+    }
+    post.SetImages(scene, output);
+
+    const EffectSet effectSets[] = {
+        {"all", true, true, true, true},
+        {"no_bloom", false, true, true, true},
+        {"no_tonemap", true, false, true, true},
+        {"no_grading", true, true, false, true},
+        {"no_vignette", true, true, true, false},
+        {"none", false, false, false, false},
+    };
+
+    for (const EffectSet &effects : effectSets)
+    {
+        post.SetEffects(effects.bloom, effects.tonemap, effects.colorGrading, effects.vignette);
+        const Bench::Stats stats = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                      {
+            profiler.BeginFrame(commandBuffer, 0);
+            post.Record(commandBuffer, extent);
+            profiler.EndFrame(commandBuffer); });
+        Bench::Report(std::format("post/{0}", effects.name), stats);
+
+        // second to last measured frame, the last one is only resolved by the next BeginFrame()
+        Log::Info("    bloom pass {0:.3f} ms, composite pass {1:.3f} ms",
+                  profiler.GetLastMs("Frame/Post/Bloom"),
+                  profiler.GetLastMs("Frame/Post/Composite"));
+    }
+
+    vkDeviceWaitIdle(context.device->logicalDevice);
+    post.Destroy();
+    profiler.Destroy();
+    scene.destroy();
+    output.destroy();
+    workload.Destroy();
+}
@@ -0,0 +1,55 @@
+#include "bench.h"
+
+#include <format>
+
+#include "core/log.h"
+#include "core/profiler.h"
+
+namespace
+{
+    // below the ring capacity, so nothing is dropped between two collects
+    constexpr uint32_t ZonesPerBatch = 10'000;
+    constexpr uint32_t Warmup = 3;
+    constexpr uint32_t Iterations = 50;
+
+    // keeps the timestamp loop from being optimized away
+    volatile uint64_t timestampSink = 0;
+
+    void ReportPerIteration(const std::string &name, const Bench::Stats &stats)
+    {
+        Bench::Report(name, stats);
+        Log::Info("    {0:.1f} ns per iteration (p50), {1:.1f} ns (p99)",
+                  stats.p50 * 1e6 / ZonesPerBatch,
+                  stats.p99 * 1e6 / ZonesPerBatch);
+    }
+}
+
+// Cost of one zone on the recording thread, uses Profiler::Zone directly so it runs without VANADIUM_PROFILING.
+// The budget is 50 ns per zone including both timestamps.
+VANADIUM_BENCHMARK(ProfilerZoneCost)
+{
+    const Bench::Stats timestamps = Bench::Measure(Warmup, Iterations, []
+                                                   {
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < ZonesPerBatch; i++)
+        {
+            sum += Profiler::Now();
+        }
+        timestampSink = sum; });
+    ReportPerIteration("profiler/timestamp", timestamps);
+
+    const auto recordBatch = []
+    {
+        for (uint32_t i = 0; i < ZonesPerBatch; i++)
+        {
+            const Profiler::Zone zone("bench zone");
+        }
+        Profiler::Collect();
+    };
+    ReportPerIteration("profiler/zone", Bench::Measure(Warmup, Iterations, recordBatch));
+
+    Profiler::BeginCapture();
+    ReportPerIteration("profiler/zone_capturing", Bench::Measure(Warmup, Iterations, recordBatch));
+
+    Profiler::EndCapture("profiler_bench_trace.json");
+}
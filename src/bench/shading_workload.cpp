@@ -0,0 +1,289 @@
+#include "shading_workload.h"
+
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "graphics/vulkan/vk_debugger.h"
+#include "graphics/vulkan/vk_host_memory.h"
+#include "graphics/vulkan/vk_initializers.h"
+#include "graphics/vulkan/vk_tools.h"
+#include "headless_context.h"
+
+namespace
+{
+    constexpr float ZNear = 0.1f;
+    constexpr float ZFar = 250.0f;
+    const glm::vec3 CameraPosition(0.0f, 12.0f, -40.0f);
+
+    std::vector<Light> RandomLights(uint32_t count)
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> horizontal(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> height(0.5f, 6.0f);
+        std::uniform_real_distribution<float> range(4.0f, 12.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<Light> lights(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Light &light = lights[i];
+            light.Position = glm::vec3(horizontal(rng), height(rng), horizontal(rng));
+            light.Range = range(rng);
+            light.Color = glm::vec3(unit(rng), unit(rng), unit(rng));
+            light.Intensity = 20.0f;
+            // every fourth light is a spot pointing down
+            if (i % 4 == 0)
+            {
+                light.Type = LightType::Spot;
+                light.Direction = glm::vec3(unit(rng) - 0.5f, -1.0f, unit(rng) - 0.5f);
+            }
+        }
+        return lights;
+    }
+}
+
+/**
+ * Create the lighting, output buffer and shading pipelines
+ *
+ * @param maxWidth Largest width passed to SetResolution, sizes the output buffer
+ * @param maxHeight Largest height passed to SetResolution
+ */
+bool ShadingWorkload::Initialize(HeadlessContext &headlessContext, uint32_t maxWidth, uint32_t maxHeight)
+{
+    context = &headlessContext;
+    device = context->device->logicalDevice;
+    VulkanDevice *vulkanDevice = context->device;
+
+    ClusterProperties clusterProperties{};
+    if (lighting.Initialize(vulkanDevice, clusterProperties, context->shaderDirectory) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    // shading pass writing into a plain storage buffer, set 0 is the cluster set shared with forward shaders
+    Debug::CheckVulkan(vulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                    &output,
+                                                    sizeof(glm::vec4) * maxWidth * maxHeight));
+
+    const VkDescriptorSetLayoutBinding outputBinding = vkinit::descriptorSetLayoutBinding(
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0);
+    VkDescriptorSetLayoutCreateInfo outputLayoutInfo = vkinit::descriptorSetLayoutCreateInfo(&outputBinding, 1);
+    Debug::CheckVulkan(vkCreateDescriptorSetLayout(device,
+                                                   &outputLayoutInfo,
+                                                   vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
+                                                   &outputLayout));
+
+    VkDescriptorPoolSize poolSize = vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1);
+    VkDescriptorPoolCreateInfo poolInfo = vkinit::descriptorPoolCreateInfo(1, &poolSize, 1);
+    Debug::CheckVulkan(vkCreateDescriptorPool(device,
+                                              &poolInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL),
+                                              &descriptorPool));
+
+    VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocateInfo(descriptorPool, &outputLayout, 1);
+    Debug::CheckVulkan(vkAllocateDescriptorSets(device, &allocInfo, &outputSet));
+    VkWriteDescriptorSet write = vkinit::writeDescriptorSet(outputSet,
+                                                            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                            0,
+                                                            &output.descriptor);
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+    const VkDescriptorSetLayout setLayouts[] = {lighting.GetDescriptorSetLayout(), outputLayout};
+    VkPushConstantRange pushRange = vkinit::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                              sizeof(PushConstants),
+                                                              0);
+    VkPipelineLayoutCreateInfo layoutInfo = vkinit::pipelineLayoutCreateInfo(setLayouts, 2);
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    Debug::CheckVulkan(vkCreatePipelineLayout(device,
+                                              &layoutInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT),
+                                              &pipelineLayout));
+
+    const VkShaderModule shader = vktools::loadShader(context->shaderDirectory + "/light_shading_bench.comp.spv",
+                                                      device);
+    if (!shader)
+    {
+        return false;
+    }
+    const VkSpecializationMapEntry entry = vkinit::specializationMapEntry(0, 0, sizeof(VkBool32));
+    const VkBool32 clusteredFlag = VK_FALSE;
+    const VkBool32 bruteForceFlag = VK_TRUE;
+    const VkSpecializationInfo clusteredSpec = vkinit::specializationInfo(1, &entry, sizeof(VkBool32), &clusteredFlag);
+    const VkSpecializationInfo bruteForceSpec = vkinit::specializationInfo(1, &entry, sizeof(VkBool32), &bruteForceFlag);
+    clusteredPipeline = vktools::createComputePipeline(device, pipelineLayout, shader, &clusteredSpec);
+    bruteForcePipeline = vktools::createComputePipeline(device, pipelineLayout, shader, &bruteForceSpec);
+    vkDestroyShaderModule(device, shader, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+
+    const uint32_t computeFamily = vulkanDevice->queueFamilyIndices.compute;
+    if (computeFamily != vulkanDevice->queueFamilyIndices.graphics)
+    {
+        cullCommandPool = vulkanDevice->createCommandPool(computeFamily);
+
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        VkSemaphoreCreateInfo semaphoreInfo = vkinit::semaphoreCreateInfo();
+        semaphoreInfo.pNext = &typeInfo;
+        Debug::CheckVulkan(vkCreateSemaphore(device,
+                                             &semaphoreInfo,
+                                             vkhost::allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE),
+                                             &cullTimeline));
+    }
+
+    SetResolution(maxWidth, maxHeight);
+    return true;
+}
+
+void ShadingWorkload::Destroy()
+{
+    if (!device)
+    {
+        return;
+    }
+
+    vkDeviceWaitIdle(device);
+    if (cullCommandPool)
+    {
+        // frees the cull command buffers
+        vkDestroyCommandPool(device, cullCommandPool, vkhost::allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL));
+        vkDestroySemaphore(device, cullTimeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE));
+        cullCommandPool = VK_NULL_HANDLE;
+        cullTimeline = VK_NULL_HANDLE;
+        cullBatches.clear();
+    }
+    vkDestroyPipeline(device, clusteredPipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipeline(device, bruteForcePipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipelineLayout(device, pipelineLayout, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+    vkDestroyDescriptorPool(device, descriptorPool, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+    vkDestroyDescriptorSetLayout(device,
+                                 outputLayout,
+                                 vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+    output.destroy();
+    lighting.Destroy();
+
+    device = VK_NULL_HANDLE;
+}
+
+void ShadingWorkload::SetLights(uint32_t count)
+{
+    SetLights(RandomLights(count));
+}
+
+void ShadingWorkload::SetLights(const std::vector<Light> &newLights)
+{
+    lights = newLights;
+    lighting.SetLights(lights);
+}
+
+/**
+ * Change the shaded resolution, the output buffer is tightly packed at width x height
+ */
+void ShadingWorkload::SetResolution(uint32_t newWidth, uint32_t newHeight)
+{
+    width = newWidth;
+    height = newHeight;
+
+    const glm::mat4 view = glm::lookAt(CameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f),
+                                            static_cast<float>(width) / static_cast<float>(height),
+                                            ZNear,
+                                            ZFar);
+    projection[1][1] *= -1.0f;
+    lighting.SetCamera(view, projection, ZNear, ZFar, width, height);
+
+    push.inverseViewProjection = glm::inverse(projection * view);
+    push.cameraPosition = glm::vec4(CameraPosition, 1.0f);
+}
+
+/**
+ * Cull on the compute queue if it has its own family, in commandBuffer otherwise, and shade in commandBuffer
+ *
+ * @param commandBuffer Graphics command buffer submitted through HeadlessContext, which waits for the cull
+ */
+void ShadingWorkload::RecordClustered(VkCommandBuffer commandBuffer)
+{
+    lighting.BeginFrame();
+    const uint32_t graphicsFamily = context->device->queueFamilyIndices.graphics;
+    if (cullCommandPool)
+    {
+        SubmitCull();
+        lighting.AcquireForGraphics(commandBuffer, context->device->queueFamilyIndices.compute);
+    }
+    else
+    {
+        lighting.Cull(commandBuffer, graphicsFamily);
+        lighting.AcquireForGraphics(commandBuffer, graphicsFamily);
+    }
+    Shade(commandBuffer, clusteredPipeline);
+}
+
+void ShadingWorkload::RecordCull(VkCommandBuffer commandBuffer)
+{
+    lighting.BeginFrame();
+    lighting.Cull(commandBuffer, context->device->queueFamilyIndices.graphics);
+}
+
+void ShadingWorkload::RecordBruteForce(VkCommandBuffer commandBuffer)
+{
+    lighting.BeginFrame();
+    Shade(commandBuffer, bruteForcePipeline);
+}
+
+// records the cull of the current frame into a compute command buffer, submits it and makes the next graphics
+// submission wait for it
+void ShadingWorkload::SubmitCull()
+{
+    uint64_t completed = 0;
+    Debug::CheckVulkan(vkGetSemaphoreCounterValue(device, cullTimeline, &completed));
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (!cullBatches.empty() && cullBatches.front().value <= completed)
+    {
+        commandBuffer = cullBatches.front().commandBuffer;
+        cullBatches.pop_front();
+        Debug::CheckVulkan(vkResetCommandBuffer(commandBuffer, 0));
+    }
+    else
+    {
+        commandBuffer = context->device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, cullCommandPool, false);
+    }
+
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    Debug::CheckVulkan(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    lighting.Cull(commandBuffer, context->device->queueFamilyIndices.compute);
+    Debug::CheckVulkan(vkEndCommandBuffer(commandBuffer));
+
+    const uint64_t signalValue = ++cullValue;
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo = vkinit::submitInfo();
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &cullTimeline;
+    Debug::CheckVulkan(vkQueueSubmit(context->computeQueue, 1, &submitInfo, VK_NULL_HANDLE));
+    cullBatches.push_back({commandBuffer, signalValue});
+
+    // the acquire barrier waits in the stages reading the light lists
+    context->WaitOnNextSubmit(cullTimeline,
+                              signalValue,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+void ShadingWorkload::Shade(VkCommandBuffer commandBuffer, VkPipeline pipeline)
+{
+    const VkDescriptorSet sets[] = {lighting.GetDescriptorSet(), outputSet};
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 2, sets, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdDispatch(commandBuffer, vktools::divideRoundUp(width, 8), vktools::divideRoundUp(height, 8), 1);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "graphics/clustered_lighting.h"
+#include "graphics/vulkan/vk_buffer.h"
+
+class HeadlessContext;
+
+/**
+ * @brief Synthetic per pixel lighting workload for GPU benchmarks
+ *
+ * Shades a ground plane lit by random point and spot lights (light_shading_bench.comp) into a storage buffer of
+ * tightly packed vec4 pixels, either through the cluster lists or by looping over every light.
+ *
+ * With a separate compute family the cull is submitted to HeadlessContext::computeQueue while the shading is
+ * recorded, and the context's next graphics submission waits for it. Every Record call starts a new frame of the
+ * ClusteredLighting, at most ClusterProperties::FramesInFlight of them may be in flight.
+ */
+class ShadingWorkload
+{
+public:
+    bool Initialize(HeadlessContext &headlessContext, uint32_t maxWidth, uint32_t maxHeight);
+    void Destroy();
+
+    /** @brief Random point and spot lights, the same ones for the same count */
+    void SetLights(uint32_t count);
+    void SetLights(const std::vector<Light> &newLights);
+    [[nodiscard]] const std::vector<Light> &GetLights() const
+    {
+        return lights;
+    }
+    void SetResolution(uint32_t width, uint32_t height);
+
+    /** @brief Cull the lights and shade the plane through the clusters, the submission has to go through the context */
+    void RecordClustered(VkCommandBuffer commandBuffer);
+    /** @brief Cull the lights in commandBuffer, without the ownership transfer to another family */
+    void RecordCull(VkCommandBuffer commandBuffer);
+    /** @brief Shade the plane looping over every light, no culling */
+    void RecordBruteForce(VkCommandBuffer commandBuffer);
+
+    /** @brief True if RecordClustered() culls on the compute queue, outside of the measured graphics submission */
+    [[nodiscard]] bool IsCullAsync() const
+    {
+        return cullCommandPool != VK_NULL_HANDLE;
+    }
+
+    ClusteredLighting lighting;
+    Buffer output;
+
+private:
+    struct PushConstants
+    {
+        glm::mat4 inverseViewProjection;
+        glm::vec4 cameraPosition;
+    };
+
+    struct CullBatch
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        uint64_t value = 0;
+    };
+
+    void SubmitCull();
+    void Shade(VkCommandBuffer commandBuffer, VkPipeline pipeline);
+
+    HeadlessContext *context = nullptr;
+    VkDevice device{VK_NULL_HANDLE};
+    uint32_t width = 0;
+    uint32_t height = 0;
+    PushConstants push{};
+    std::vector<Light> lights;
+
+    VkDescriptorSetLayout outputLayout{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSet outputSet{VK_NULL_HANDLE};
+    VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline clusteredPipeline{VK_NULL_HANDLE};
+    VkPipeline bruteForcePipeline{VK_NULL_HANDLE};
+
+    // async cull, only used with a separate compute family
+    VkCommandPool cullCommandPool{VK_NULL_HANDLE};
+    VkSemaphore cullTimeline{VK_NULL_HANDLE};
+    uint64_t cullValue = 0;
+    std::deque<CullBatch> cullBatches;
+};
@@ -0,0 +1,146 @@
+#include "bench.h"
+
+#include <cmath>
+#include <format>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "core/log.h"
+#include "graphics/shadow_atlas.h"
+
+namespace
+{
+    constexpr uint32_t Frames = 600;
+    constexpr uint32_t StaticCasters = 5000;
+    constexpr uint32_t DynamicCasters = 200;
+    constexpr uint32_t SpotLights = 48;
+    constexpr uint32_t PointLights = 16;
+    // one static caster is moved (e.g. a door opening) every this many frames
+    constexpr uint32_t StaticMoveInterval = 30;
+
+    struct FrameTotals
+    {
+        uint64_t draws = 0;
+        uint64_t staticViews = 0;
+        uint64_t views = 0;
+        std::vector<double> planTimes;
+    };
+
+    // A city block: randomly placed static casters, dynamic casters walking in circles, a camera flying along the
+    // street and two lights swinging. Identical for both runs so only caching differs.
+    FrameTotals Simulate(bool caching)
+    {
+        ShadowAtlasProperties properties{};
+        properties.Caching = caching;
+        ShadowAtlas shadows(properties);
+
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> size(0.5f, 3.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<ShadowCasterHandle> staticHandles;
+        std::vector<glm::vec3> staticCenters;
+        for (uint32_t i = 0; i < StaticCasters; i++)
+        {
+            const glm::vec3 center(position(rng), size(rng), position(rng));
+            staticCenters.push_back(center);
+            staticHandles.push_back(shadows.AddCaster(center, size(rng), true));
+        }
+
+        std::vector<ShadowCasterHandle> dynamicHandles;
+        std::vector<glm::vec3> dynamicOrigins;
+        for (uint32_t i = 0; i < DynamicCasters; i++)
+        {
+            const glm::vec3 origin(position(rng), 1.0f, position(rng));
+            dynamicOrigins.push_back(origin);
+            dynamicHandles.push_back(shadows.AddCaster(origin, 1.0f, false));
+        }
+
+        ShadowLight sun;
+        sun.Type = ShadowLightType::Directional;
+        sun.Direction = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+        shadows.AddLight(sun);
+
+        std::vector<ShadowLightHandle> swinging;
+        for (uint32_t i = 0; i < SpotLights + PointLights; i++)
+        {
+            ShadowLight light;
+            light.Type = i < SpotLights ? ShadowLightType::Spot : ShadowLightType::Point;
+            light.Position = glm::vec3(position(rng), 6.0f + 4.0f * unit(rng), position(rng));
+            light.Direction = glm::vec3(unit(rng) - 0.5f, -1.0f, unit(rng) - 0.5f);
+            light.Range = 10.0f + 15.0f * unit(rng);
+            const ShadowLightHandle handle = shadows.AddLight(light);
+            if (i < 2)
+            {
+                swinging.push_back(handle);
+            }
+        }
+        std::vector<ShadowLight> swingingLights;
+        for (uint32_t i = 0; i < swinging.size(); i++)
+        {
+            ShadowLight light;
+            light.Position = glm::vec3(-20.0f + 40.0f * static_cast<float>(i), 8.0f, 0.0f);
+            light.Range = 20.0f;
+            swingingLights.push_back(light);
+        }
+
+        FrameTotals totals;
+        totals.planTimes.reserve(Frames);
+        for (uint32_t frame = 0; frame < Frames; frame++)
+        {
+            const float time = static_cast<float>(frame) / 60.0f;
+
+            for (uint32_t i = 0; i < DynamicCasters; i++)
+            {
+                const float angle = time + static_cast<float>(i);
+                shadows.MoveCaster(dynamicHandles[i],
+                                   dynamicOrigins[i] + glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * 3.0f,
+                                   1.0f);
+            }
+            if (frame % StaticMoveInterval == 0)
+            {
+                const uint32_t index = frame % StaticCasters;
+                staticCenters[index].y += 0.5f;
+                shadows.MoveCaster(staticHandles[index], staticCenters[index], 2.0f);
+            }
+            for (uint32_t i = 0; i < swinging.size(); i++)
+            {
+                ShadowLight light = swingingLights[i];
+                light.Direction = glm::vec3(std::sin(time * 2.0f), -1.0f, 0.0f);
+                shadows.UpdateLight(swinging[i], light);
+            }
+
+            ShadowCamera camera;
+            camera.Position = glm::vec3(-80.0f + time * 5.0f, 2.0f, 0.0f);
+            camera.View = glm::lookAt(camera.Position, camera.Position + glm::vec3(1.0f, 0.0f, 0.0f),
+                                      glm::vec3(0.0f, 1.0f, 0.0f));
+
+            const auto start = std::chrono::steady_clock::now();
+            shadows.Plan(camera);
+            const auto end = std::chrono::steady_clock::now();
+            totals.planTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+            const ShadowStats &stats = shadows.GetStats();
+            totals.draws += stats.Draws();
+            totals.staticViews += stats.StaticViewsRendered;
+            totals.views += stats.Views;
+        }
+        return totals;
+    }
+}
+
+// Shadow caster draws per frame with the static cache on and off, the draw counts are what Record() would issue
+VANADIUM_BENCHMARK(ShadowAtlasCaching)
+{
+    for (const bool caching : {false, true})
+    {
+        FrameTotals totals = Simulate(caching);
+        const char *mode = caching ? "caching_on" : "caching_off";
+        Bench::Report(std::format("shadows/{0}/plan", mode), Bench::Summarize(std::move(totals.planTimes)));
+        Log::Info("    {0:.1f} draws/frame, {1:.1f} of {2:.1f} views re-rendered static casters per frame",
+                  static_cast<double>(totals.draws) / Frames,
+                  static_cast<double>(totals.staticViews) / Frames,
+                  static_cast<double>(totals.views) / Frames);
+    }
+}
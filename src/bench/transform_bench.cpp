@@ -0,0 +1,87 @@
+#include "bench.h"
+
+#include <format>
+#include <random>
+
+#include "core/log.h"
+#include "core/job_system.h"
+#include "scene/transform_hierarchy.h"
+
+namespace
+{
+    constexpr uint32_t NodeCount = 1'000'000;
+    constexpr uint32_t RootCount = 64;
+    constexpr uint32_t Branching = 8;
+    constexpr uint32_t Warmup = 3;
+    constexpr uint32_t Iterations = 30;
+
+    // 64 roots with 8 children per node, roughly 7 levels deep
+    std::vector<TransformHandle> BuildHierarchy(TransformHierarchy &hierarchy)
+    {
+        std::vector<TransformHandle> nodes;
+        nodes.reserve(NodeCount);
+        hierarchy.Reserve(NodeCount);
+
+        for (uint32_t i = 0; i < NodeCount; i++)
+        {
+            const TransformHandle parent = i < RootCount
+                                               ? InvalidTransform
+                                               : nodes[(i - RootCount) / Branching];
+            const TransformHandle node = hierarchy.Create(parent);
+            hierarchy.SetPosition(node, glm::vec3(static_cast<float>(i % 17), 1.0f, 0.0f));
+            nodes.push_back(node);
+        }
+
+        hierarchy.Update();
+        return nodes;
+    }
+
+    void RunDirtyRatio(double ratio, JobSystem *jobs)
+    {
+        TransformHierarchy hierarchy;
+        const std::vector<TransformHandle> nodes = BuildHierarchy(hierarchy);
+
+        std::mt19937 rng(1337);
+        std::uniform_int_distribution<uint32_t> pick(0, NodeCount - 1);
+        const uint32_t dirtyCount = static_cast<uint32_t>(NodeCount * ratio);
+
+        std::vector<TransformHandle> dirty;
+        dirty.reserve(dirtyCount);
+        for (uint32_t i = 0; i < dirtyCount; i++)
+        {
+            dirty.push_back(ratio >= 1.0 ? nodes[i] : nodes[pick(rng)]);
+        }
+
+        uint32_t updated = 0;
+        float angle = 0.0f;
+        const Bench::Stats stats = Bench::Measure(Warmup, Iterations, [&]
+                                                  {
+            angle += 0.01f;
+            const glm::quat rotation = glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f));
+            for (const TransformHandle node : dirty)
+            {
+                hierarchy.SetRotation(node, rotation);
+            }
+            updated = hierarchy.Update(jobs); });
+
+        const std::string name = std::format("transform_update/{0}%/{1}",
+                                             static_cast<uint32_t>(ratio * 100.0),
+                                             jobs ? std::format("{0}_threads", jobs->GetThreadCount()) : "serial");
+        Bench::Report(name, stats);
+        Log::Info("    {0} nodes, {1} levels, {2} locally dirty, {3} world matrices recomputed",
+                  hierarchy.Size(),
+                  hierarchy.GetDepthCount(),
+                  dirtyCount,
+                  updated);
+    }
+}
+
+VANADIUM_BENCHMARK(TransformHierarchyUpdate)
+{
+    JobSystem jobs;
+
+    RunDirtyRatio(0.01, nullptr);
+    RunDirtyRatio(0.01, &jobs);
+    RunDirtyRatio(1.0, nullptr);
+    RunDirtyRatio(1.0, &jobs);
+}
@@ -0,0 +1,163 @@
+#include "bench.h"
+
+#include "core/log.h"
+#include "graphics/upscaler.h"
+#include "graphics/vulkan/vk_debugger.h"
+#include "graphics/vulkan/vk_initializers.h"
+#include "graphics/vulkan/vk_tools.h"
+#include "headless_context.h"
+#include "shading_workload.h"
+
+namespace
+{
+    constexpr uint32_t Width = 1920;
+    constexpr uint32_t Height = 1080;
+    constexpr uint32_t LightCount = 1024;
+    constexpr uint32_t Warmup = 5;
+    constexpr uint32_t Iterations = 50;
+
+    // make the shaded buffer visible to the copy into the scene image
+    void ShadeToTransferBarrier(VkCommandBuffer commandBuffer, const Buffer &buffer)
+    {
+        VkBufferMemoryBarrier barrier = vkinit::bufferMemoryBarrier();
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.buffer = buffer.buffer;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             1,
+                             &barrier,
+                             0,
+                             nullptr);
+    }
+
+    void CopyToImage(VkCommandBuffer commandBuffer, const Buffer &buffer, const Image &image, VkExtent2D extent)
+    {
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          image.image,
+                                          0,
+                                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_UNDEFINED,
+                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          image.subresourceRange());
+
+        VkBufferImageCopy region{};
+        region.bufferRowLength = extent.width;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {extent.width, extent.height, 1};
+        vkCmdCopyBufferToImage(commandBuffer,
+                               buffer.buffer,
+                               image.image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1,
+                               &region);
+    }
+}
+
+// Native resolution shading against 67% internal resolution plus the EASU/RCAS style upscale, both paths copy the
+// shaded pixels into a scene image so the only difference is the resolution and the upscale dispatch
+VANADIUM_BENCHMARK(SpatialUpscaling)
+{
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return;
+    }
+
+    ShadingWorkload workload;
+    if (!workload.Initialize(context, Width, Height))
+    {
+        return;
+    }
+    workload.SetLights(LightCount);
+
+    UpscalerProperties upscalerProperties{};
+    Upscaler upscaler;
+    if (upscaler.Initialize(context.device, upscalerProperties, context.shaderDirectory) != VK_SUCCESS)
+    {
+        return;
+    }
+
+    const VkExtent2D outputExtent{Width, Height};
+    const VkExtent2D renderExtent = upscaler.GetRenderExtent(outputExtent);
+
+    // the scene image is oversized like a dynamic resolution target, the upscaler only reads renderExtent of it
+    Image scene;
+    Image output;
+    Debug::CheckVulkan(context.device->createImage(VK_FORMAT_R32G32B32A32_SFLOAT,
+                                                   outputExtent,
+                                                   VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                   &scene));
+    Debug::CheckVulkan(context.device->createImage(VK_FORMAT_R8G8B8A8_UNORM,
+                                                   outputExtent,
+                                                   VK_IMAGE_USAGE_STORAGE_BIT,
+                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                   &output));
+    upscaler.SetImages(scene, output);
+
+    const auto upscale = [&](VkCommandBuffer commandBuffer)
+    {
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          scene.image,
+                                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                                          VK_ACCESS_SHADER_READ_BIT,
+                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                          scene.subresourceRange());
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          output.image,
+                                          0,
+                                          VK_ACCESS_SHADER_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_UNDEFINED,
+                                          VK_IMAGE_LAYOUT_GENERAL,
+                                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                          output.subresourceRange());
+        upscaler.Dispatch(commandBuffer, renderExtent, outputExtent);
+    };
+
+    workload.SetResolution(Width, Height);
+    const Bench::Stats native = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                   {
+        workload.RecordClustered(commandBuffer);
+        ShadeToTransferBarrier(commandBuffer, workload.output);
+        CopyToImage(commandBuffer, workload.output, scene, outputExtent); });
+
+    workload.SetResolution(renderExtent.width, renderExtent.height);
+    const Bench::Stats scaled = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                   {
+        workload.RecordClustered(commandBuffer);
+        ShadeToTransferBarrier(commandBuffer, workload.output);
+        CopyToImage(commandBuffer, workload.output, scene, renderExtent);
+        upscale(commandBuffer); });
+
+    const Bench::Stats upscaleOnly = context.MeasureGpu(Warmup, Iterations, [&](VkCommandBuffer commandBuffer)
+                                                        {
+        CopyToImage(commandBuffer, workload.output, scene, renderExtent);
+        upscale(commandBuffer); });
+
+    Bench::Report(std::format("upscale/native_{0}x{1}", Width, Height), native);
+    Bench::Report(std::format("upscale/internal_{0}x{1}_plus_upscale", renderExtent.width, renderExtent.height), scaled);
+    Bench::Report("upscale/copy_and_upscale_only", upscaleOnly);
+    if (scaled.p50 > 0.0)
+    {
+        Log::Info("    speedup over native: {0:.2f}x", native.p50 / scaled.p50);
+    }
+
+    vkDeviceWaitIdle(context.device->logicalDevice);
+    scene.destroy();
+    output.destroy();
+    upscaler.Destroy();
+    workload.Destroy();
+}
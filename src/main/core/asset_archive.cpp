@@ -0,0 +1,153 @@
+#include "asset_archive.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "log.h"
+#include "profiler.h"
+
+namespace
+{
+    bool InRange(uint64_t offset, uint64_t size, uint64_t fileSize)
+    {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+}
+
+/**
+ * Map an archive and validate its index, a previously opened archive is closed first
+ *
+ * @param path Archive written by vanadium_pack
+ *
+ * @return False if the file could not be mapped or is not a valid archive, the error is logged
+ */
+bool AssetArchive::Open(const std::string &path)
+{
+    VANADIUM_ZONE("Open asset archive");
+    Close();
+
+    // payloads are looked up by name and read in any order
+    if (!file.Open(path, MappedFileAccess::Random))
+    {
+        return false;
+    }
+
+    AssetArchiveHeader header;
+    if (file.Size() < sizeof(header))
+    {
+        Log::Error("{0} is not an asset archive", path);
+        Close();
+        return false;
+    }
+    std::memcpy(&header, file.Data(), sizeof(header));
+    if (header.Magic != AssetArchiveMagic || header.Version != AssetArchiveVersion)
+    {
+        Log::Error("{0} is not an asset archive of version {1}", path, AssetArchiveVersion);
+        Close();
+        return false;
+    }
+
+    const uint64_t indexSize = static_cast<uint64_t>(header.EntryCount) * sizeof(AssetArchiveEntry);
+    if (!InRange(sizeof(header), indexSize, file.Size()) ||
+        !InRange(header.NamesOffset, header.NamesSize, file.Size()) || header.Alignment == 0 ||
+        (header.Alignment & (header.Alignment - 1)) != 0)
+    {
+        Log::Error("{0} has an invalid index", path);
+        Close();
+        return false;
+    }
+
+    // copied out so the index stays resident and aligned no matter what the OS does with the mapping
+    entries.resize(header.EntryCount);
+    std::memcpy(entries.data(), file.Data() + sizeof(header), indexSize);
+    names = std::string_view(reinterpret_cast<const char *>(file.Data() + header.NamesOffset), header.NamesSize);
+    alignment = header.Alignment;
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const AssetArchiveEntry &entry = entries[i];
+        const bool sorted = i == 0 || entries[i - 1].Hash <= entry.Hash;
+        if (!InRange(entry.Offset, entry.Size, file.Size()) ||
+            !InRange(entry.NameOffset, entry.NameLength, header.NamesSize) || entry.Offset % alignment != 0 || !sorted)
+        {
+            Log::Error("{0} has an invalid entry at index {1}", path, i);
+            Close();
+            return false;
+        }
+    }
+
+    Log::Info("Opened asset archive {0} with {1} entries", path, entries.size());
+    return true;
+}
+
+void AssetArchive::Close()
+{
+    file.Close();
+    entries.clear();
+    names = {};
+    alignment = 0;
+}
+
+/**
+ * @return The entry stored under name, nullptr if the archive does not contain it
+ */
+const AssetArchiveEntry *AssetArchive::Find(std::string_view name) const
+{
+    const uint64_t hash = HashName(name);
+    auto it = std::lower_bound(entries.begin(),
+                               entries.end(),
+                               hash,
+                               [](const AssetArchiveEntry &entry, uint64_t value) { return entry.Hash < value; });
+    // the packer rejects colliding names, comparing the name guards against lookups of names that are not packed
+    for (; it != entries.end() && it->Hash == hash; ++it)
+    {
+        if (GetName(*it) == name)
+        {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @return Payload of an entry, points into the mapping and stays valid until the archive is closed
+ */
+std::span<const uint8_t> AssetArchive::GetData(const AssetArchiveEntry &entry) const
+{
+    return {file.Data() + entry.Offset, static_cast<size_t>(entry.Size)};
+}
+
+std::string_view AssetArchive::GetName(const AssetArchiveEntry &entry) const
+{
+    return names.substr(entry.NameOffset, entry.NameLength);
+}
+
+/**
+ * Start paging in the payload of an entry in the background, call it ahead of GetData() when streaming
+ */
+void AssetArchive::Prefetch(const AssetArchiveEntry &entry) const
+{
+    file.Prefetch(entry.Offset, entry.Size);
+}
+
+/**
+ * Let the OS reclaim the pages of an entry once its payload has been uploaded, GetData() stays valid
+ */
+void AssetArchive::Release(const AssetArchiveEntry &entry) const
+{
+    file.Evict(entry.Offset, entry.Size);
+}
+
+/**
+ * @return 64 bit FNV-1a of the name, names are stored with forward slashes relative to the packed directory
+ */
+uint64_t AssetArchive::HashName(std::string_view name)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const char character : name)
+    {
+        hash ^= static_cast<uint8_t>(character);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
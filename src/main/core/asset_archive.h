@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.h"
+
+/*
+ * Asset archives (.vpak) are written by vanadium_pack and replace thousands of small files with one mapping:
+ *
+ *   AssetArchiveHeader
+ *   AssetArchiveEntry[EntryCount], sorted by Hash
+ *   entry names, not terminated
+ *   payloads, each starting at a multiple of Alignment
+ *
+ * Alignment is at least a page, which is a multiple of every nonCoherentAtomSize, so a payload can be copied into
+ * staging memory or flushed without touching its neighbours. Payloads flagged AssetGpuReady are stored in the
+ * layout the runtime uploads, e.g. meshes are .vmesh files.
+ */
+
+constexpr uint32_t AssetArchiveMagic = 0x4B415056; // "VPAK"
+constexpr uint32_t AssetArchiveVersion = 1;
+constexpr uint32_t AssetArchiveDefaultAlignment = 4096;
+
+enum class AssetType : uint32_t
+{
+    Raw,
+    // baked .vmesh
+    Mesh,
+    // SPIR-V module
+    Shader,
+};
+
+enum AssetFlags : uint32_t
+{
+    AssetGpuReady = 1 << 0,
+};
+
+struct AssetArchiveHeader
+{
+    uint32_t Magic = AssetArchiveMagic;
+    uint32_t Version = AssetArchiveVersion;
+    uint32_t EntryCount = 0;
+    uint32_t Alignment = AssetArchiveDefaultAlignment;
+    uint64_t NamesOffset = 0;
+    uint64_t NamesSize = 0;
+};
+
+struct AssetArchiveEntry
+{
+    // AssetArchive::HashName() of the name
+    uint64_t Hash = 0;
+    // absolute offset of the payload in the archive
+    uint64_t Offset = 0;
+    uint64_t Size = 0;
+    AssetType Type = AssetType::Raw;
+    uint32_t Flags = 0;
+    // relative to NamesOffset
+    uint32_t NameOffset = 0;
+    uint32_t NameLength = 0;
+};
+
+static_assert(sizeof(AssetArchiveHeader) == 32);
+static_assert(sizeof(AssetArchiveEntry) == 40);
+
+/**
+ * @brief Read only view of a .vpak archive, the whole archive is mapped once and payloads are returned in place
+ * @note Lookups hash the name and binary search the index, no file system calls are made after Open()
+ */
+class AssetArchive
+{
+public:
+    bool Open(const std::string &path);
+    void Close();
+
+    [[nodiscard]] const AssetArchiveEntry *Find(std::string_view name) const;
+    [[nodiscard]] std::span<const uint8_t> GetData(const AssetArchiveEntry &entry) const;
+    [[nodiscard]] std::string_view GetName(const AssetArchiveEntry &entry) const;
+
+    void Prefetch(const AssetArchiveEntry &entry) const;
+    void Release(const AssetArchiveEntry &entry) const;
+
+    [[nodiscard]] bool IsOpen() const
+    {
+        return file.IsOpen();
+    }
+
+    [[nodiscard]] const std::vector<AssetArchiveEntry> &GetEntries() const
+    {
+        return entries;
+    }
+
+    [[nodiscard]] uint32_t GetAlignment() const
+    {
+        return alignment;
+    }
+
+    static uint64_t HashName(std::string_view name);
+
+private:
+    MappedFile file;
+    std::vector<AssetArchiveEntry> entries;
+    std::string_view names;
+    uint32_t alignment = 0;
+};
@@ -0,0 +1,379 @@
+#include "async_io.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "io_backend.h"
+#include "log.h"
+#include "profiler.h"
+
+namespace
+{
+    const char *BackendName(IoBackendType type)
+    {
+        return type == IoBackendType::IoUring ? "io_uring" : "thread pool";
+    }
+
+    size_t PriorityIndex(IoPriority priority)
+    {
+        return static_cast<size_t>(priority);
+    }
+}
+
+AsyncIo::AsyncIo() = default;
+
+AsyncIo::~AsyncIo()
+{
+    Destroy();
+}
+
+/**
+ * Create the backend, a previously initialized backend is destroyed first
+ *
+ * @param properties (Optional) Backend choice and queue depths
+ *
+ * @return False if io_uring was requested explicitly and is not available
+ */
+bool AsyncIo::Initialize(const AsyncIoProperties &properties)
+{
+    Destroy();
+    settings = properties;
+    settings.QueueDepth = std::max(settings.QueueDepth, 1u);
+    settings.PrefetchDepth = std::clamp(settings.PrefetchDepth, 1u, settings.QueueDepth);
+    settings.ThreadCount = std::max(settings.ThreadCount, 1u);
+
+    if (settings.Backend != IoBackendType::ThreadPool)
+    {
+        backend = CreateUringBackend(settings);
+        backendType = IoBackendType::IoUring;
+        if (!backend && settings.Backend == IoBackendType::IoUring)
+        {
+            Log::Error("io_uring is not available");
+            return false;
+        }
+    }
+    if (!backend)
+    {
+        backend = CreateThreadPoolBackend(settings);
+        backendType = IoBackendType::ThreadPool;
+    }
+
+    Log::System("Async IO Init ({0}, queue depth {1})", BackendName(backendType), settings.QueueDepth);
+    return true;
+}
+
+/**
+ * Cancel every outstanding read and wait for the ones in flight, their destinations are not written afterwards
+ */
+void AsyncIo::Destroy()
+{
+    if (!backend)
+    {
+        return;
+    }
+
+    for (const auto &[handle, request] : requests)
+    {
+        if (request.state == RequestState::InFlight)
+        {
+            backend->Cancel(handle);
+        }
+    }
+    while (inFlight > 0)
+    {
+        results.clear();
+        backend->Reap(results, true);
+        if (results.empty())
+        {
+            // the backend failed, nothing more will complete
+            break;
+        }
+        inFlight -= std::min<uint32_t>(inFlight, static_cast<uint32_t>(results.size()));
+    }
+
+    backend.reset();
+    requests.clear();
+    queued[0].clear();
+    queued[1].clear();
+    cancelled.clear();
+    inFlight = 0;
+    prefetchInFlight = 0;
+    registeredMemory = nullptr;
+    registeredSize = 0;
+}
+
+/**
+ * Register memory reads are expected to land in, only one buffer is registered at a time
+ *
+ * @param memory Start of the buffer, e.g. UploadQueue::GetStagingMemory(), has to stay valid until Destroy()
+ * @param size Size of the buffer in bytes
+ *
+ * @return False if the backend could not register it, reads into it then work like any other read
+ */
+bool AsyncIo::RegisterBuffer(void *memory, size_t size)
+{
+    if (!requests.empty())
+    {
+        Log::Error("Buffers can only be registered while no reads are outstanding");
+        return false;
+    }
+
+    registeredMemory = nullptr;
+    registeredSize = 0;
+    if (!backend->RegisterBuffer(memory, size))
+    {
+        return false;
+    }
+    registeredMemory = static_cast<uint8_t *>(memory);
+    registeredSize = size;
+    return true;
+}
+
+/**
+ * Queue a read, it is handed to the backend by the next Submit() or Poll()
+ *
+ * @param read File range and destination, the destination has to stay valid until the read's completion
+ *
+ * @return Handle identifying the read in Cancel(), Promote() and its completion
+ */
+IoHandle AsyncIo::Read(const IoRead &read)
+{
+    const IoHandle handle = nextHandle++;
+    requests.emplace(handle, Request{read});
+    queued[PriorityIndex(read.Priority)].push_back(handle);
+    return handle;
+}
+
+/**
+ * Hand queued reads to the backend as one batch, as many as the queue depths allow
+ */
+void AsyncIo::Submit()
+{
+    VANADIUM_ZONE("AsyncIo::Submit");
+    batch.clear();
+    for (const IoPriority priority : {IoPriority::Visible, IoPriority::Prefetch})
+    {
+        std::deque<IoHandle> &queue = queued[PriorityIndex(priority)];
+        while (!queue.empty() && inFlight < settings.QueueDepth &&
+               (priority == IoPriority::Visible || prefetchInFlight < settings.PrefetchDepth))
+        {
+            const IoHandle handle = queue.front();
+            queue.pop_front();
+            const auto it = requests.find(handle);
+            // cancelled, or promoted and queued as visible as well
+            if (it == requests.end() || it->second.state != RequestState::Queued ||
+                it->second.read.Priority != priority)
+            {
+                continue;
+            }
+
+            it->second.state = RequestState::InFlight;
+            inFlight++;
+            prefetchInFlight += priority == IoPriority::Prefetch ? 1 : 0;
+            batch.push_back(MakeBackendRead(handle, it->second));
+        }
+    }
+
+    if (!batch.empty())
+    {
+        backend->Submit(batch);
+    }
+}
+
+/**
+ * Cancel a read, queued reads are dropped right away, reads in flight may still complete
+ *
+ * @return False if the read already completed
+ */
+bool AsyncIo::Cancel(IoHandle handle)
+{
+    const auto it = requests.find(handle);
+    if (it == requests.end())
+    {
+        return false;
+    }
+
+    if (it->second.state == RequestState::Queued)
+    {
+        Finish(handle, IoStatus::Cancelled, ECANCELED, cancelled);
+    }
+    else
+    {
+        it->second.cancelRequested = true;
+        backend->Cancel(handle);
+    }
+    return true;
+}
+
+/**
+ * Raise a queued prefetch read to visible, e.g. because the asset came on screen before it was streamed in
+ */
+void AsyncIo::Promote(IoHandle handle)
+{
+    const auto it = requests.find(handle);
+    if (it == requests.end() || it->second.state != RequestState::Queued ||
+        it->second.read.Priority == IoPriority::Visible)
+    {
+        return;
+    }
+    // the old queue entry is skipped because the priority does not match anymore
+    it->second.read.Priority = IoPriority::Visible;
+    queued[PriorityIndex(IoPriority::Visible)].push_back(handle);
+}
+
+/**
+ * Collect finished reads and submit queued ones into the freed queue slots
+ *
+ * @param completions Finished reads are appended, in the order the backend finished them
+ * @param wait Block until at least one read finished, returns right away if nothing is outstanding
+ *
+ * @return Number of completions appended
+ */
+uint32_t AsyncIo::Poll(std::vector<IoCompletion> &completions, bool wait)
+{
+    VANADIUM_ZONE("AsyncIo::Poll");
+    const size_t first = completions.size();
+    completions.insert(completions.end(), cancelled.begin(), cancelled.end());
+    cancelled.clear();
+    Submit();
+
+    do
+    {
+        results.clear();
+        backend->Reap(results, wait && completions.size() == first && inFlight > 0);
+
+        batch.clear();
+        for (const IoBackendResult &result : results)
+        {
+            const auto it = requests.find(result.Handle);
+            if (it == requests.end())
+            {
+                continue;
+            }
+
+            Request &request = it->second;
+            if (result.Result == -ECANCELED)
+            {
+                Finish(result.Handle, IoStatus::Cancelled, ECANCELED, completions);
+                continue;
+            }
+            if (result.Result < 0)
+            {
+                Finish(result.Handle, IoStatus::Failed, static_cast<int>(-result.Result), completions);
+                continue;
+            }
+
+            request.bytesRead += static_cast<uint32_t>(result.Result);
+            if (result.Result > 0 && request.bytesRead < request.read.Size)
+            {
+                if (request.cancelRequested)
+                {
+                    Finish(result.Handle, IoStatus::Cancelled, ECANCELED, completions);
+                }
+                else
+                {
+                    // short read before the end of the file, the remainder keeps the request's queue slot
+                    batch.push_back(MakeBackendRead(result.Handle, request));
+                }
+                continue;
+            }
+            Finish(result.Handle, IoStatus::Complete, 0, completions);
+        }
+        if (!batch.empty())
+        {
+            backend->Submit(batch);
+        }
+    } while (wait && completions.size() == first && inFlight > 0);
+
+    Submit();
+    return static_cast<uint32_t>(completions.size() - first);
+}
+
+/**
+ * Open a file for reading with Read()
+ *
+ * @return InvalidIoFile if the file could not be opened, the error is logged
+ */
+IoFile AsyncIo::OpenFile(const std::string &path)
+{
+#if defined(_WIN32)
+    const HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        Log::Error("Could not open {0}", path);
+        return InvalidIoFile;
+    }
+    return reinterpret_cast<IoFile>(file);
+#else
+    const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+    {
+        Log::Error("Could not open {0}", path);
+        return InvalidIoFile;
+    }
+    return file;
+#endif
+}
+
+/**
+ * Close a file opened with OpenFile(), no read of it may be outstanding
+ */
+void AsyncIo::CloseFile(IoFile file)
+{
+    if (file == InvalidIoFile)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    CloseHandle(reinterpret_cast<HANDLE>(file));
+#else
+    ::close(static_cast<int>(file));
+#endif
+}
+
+IoBackendRead AsyncIo::MakeBackendRead(IoHandle handle, const Request &request) const
+{
+    IoBackendRead read;
+    read.Handle = handle;
+    read.File = request.read.File;
+    read.Offset = request.read.Offset + request.bytesRead;
+    read.Destination = static_cast<uint8_t *>(request.read.Destination) + request.bytesRead;
+    read.Size = request.read.Size - request.bytesRead;
+    read.Priority = request.read.Priority;
+
+    const uint8_t *destination = static_cast<const uint8_t *>(read.Destination);
+    read.Registered = registeredMemory && destination >= registeredMemory &&
+                      destination + read.Size <= registeredMemory + registeredSize;
+    return read;
+}
+
+// reports a request and forgets it, frees its queue slot if it was in flight
+void AsyncIo::Finish(IoHandle handle, IoStatus status, int error, std::vector<IoCompletion> &completions)
+{
+    const auto it = requests.find(handle);
+    const Request &request = it->second;
+
+    IoCompletion completion;
+    completion.Handle = handle;
+    completion.Status = status;
+    completion.BytesRead = request.bytesRead;
+    completion.Error = status == IoStatus::Complete ? 0 : error;
+    completion.UserData = request.read.UserData;
+    completions.push_back(completion);
+
+    if (request.state == RequestState::InFlight)
+    {
+        inFlight--;
+        prefetchInFlight -= request.read.Priority == IoPriority::Prefetch ? 1 : 0;
+    }
+    requests.erase(it);
+}
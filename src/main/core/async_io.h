@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class IIoBackend;
+struct IoBackendRead;
+struct IoBackendResult;
+
+// native file descriptor, or HANDLE on Windows
+using IoFile = intptr_t;
+constexpr IoFile InvalidIoFile = -1;
+
+using IoHandle = uint64_t;
+constexpr IoHandle InvalidIoHandle = 0;
+
+enum class IoPriority : uint8_t
+{
+    // needed for what is on screen now, always submitted first
+    Visible,
+    // streamed ahead of time, only gets the queue depth visible reads leave free up to PrefetchDepth
+    Prefetch,
+};
+
+enum class IoStatus : uint8_t
+{
+    Complete,
+    Failed,
+    Cancelled,
+};
+
+enum class IoBackendType : uint8_t
+{
+    // io_uring where the kernel supports it, the thread pool otherwise
+    Auto,
+    IoUring,
+    ThreadPool,
+};
+
+struct AsyncIoProperties
+{
+    IoBackendType Backend = IoBackendType::Auto;
+    // reads in flight at once, also the size of the io_uring submission queue
+    uint32_t QueueDepth = 128;
+    // prefetch reads in flight at once, keeps the rest of the queue free for visible reads
+    uint32_t PrefetchDepth = 32;
+    // threads of the pread fallback, each one blocks in one read at a time
+    uint32_t ThreadCount = 4;
+};
+
+struct IoRead
+{
+    IoFile File = InvalidIoFile;
+    uint64_t Offset = 0;
+    void *Destination = nullptr;
+    uint32_t Size = 0;
+    IoPriority Priority = IoPriority::Visible;
+    // handed back in the completion
+    void *UserData = nullptr;
+};
+
+struct IoCompletion
+{
+    IoHandle Handle = InvalidIoHandle;
+    IoStatus Status = IoStatus::Complete;
+    // less than the requested size only when the read reached the end of the file
+    uint32_t BytesRead = 0;
+    // errno of a failed read
+    int Error = 0;
+    void *UserData = nullptr;
+};
+
+/**
+ * @brief Asynchronous file reads for asset streaming, on io_uring or on a thread pool doing pread
+ *
+ * Read() only queues a request, Submit() hands the queued requests to the backend as one batch: io_uring takes the
+ * whole batch with a single system call. Visible reads are always submitted before prefetch reads and prefetch reads
+ * never take more than PrefetchDepth of the queue, the io_uring backend also passes the priority on to the block
+ * layer. Poll() returns finished reads and refills the queue, short reads before the end of the file are resubmitted
+ * for the remainder.
+ *
+ * Destinations inside the buffer given to RegisterBuffer(), e.g. the upload queue's persistently mapped staging
+ * ring, are read with fixed buffer reads that skip pinning the pages on every request.
+ *
+ * Cancel() drops queued reads right away and asks the backend to abort reads in flight, which may still complete.
+ * The object is not thread safe, one streaming thread owns it.
+ */
+class AsyncIo
+{
+public:
+    AsyncIo();
+    ~AsyncIo();
+
+    AsyncIo(const AsyncIo &) = delete;
+    AsyncIo &operator=(const AsyncIo &) = delete;
+
+    bool Initialize(const AsyncIoProperties &properties = {});
+    void Destroy();
+
+    bool RegisterBuffer(void *memory, size_t size);
+
+    IoHandle Read(const IoRead &read);
+    void Submit();
+    bool Cancel(IoHandle handle);
+    void Promote(IoHandle handle);
+    uint32_t Poll(std::vector<IoCompletion> &completions, bool wait);
+
+    [[nodiscard]] IoBackendType GetBackendType() const
+    {
+        return backendType;
+    }
+
+    // reads that were queued or submitted and did not complete yet
+    [[nodiscard]] size_t GetOutstanding() const
+    {
+        return requests.size();
+    }
+
+    static IoFile OpenFile(const std::string &path);
+    static void CloseFile(IoFile file);
+
+private:
+    enum class RequestState : uint8_t
+    {
+        Queued,
+        InFlight,
+    };
+
+    struct Request
+    {
+        IoRead read;
+        RequestState state = RequestState::Queued;
+        uint32_t bytesRead = 0;
+        // a cancelled read in flight is not resubmitted after a short read
+        bool cancelRequested = false;
+    };
+
+    IoBackendRead MakeBackendRead(IoHandle handle, const Request &request) const;
+    void Finish(IoHandle handle, IoStatus status, int error, std::vector<IoCompletion> &completions);
+
+    AsyncIoProperties settings;
+    std::unique_ptr<IIoBackend> backend;
+    IoBackendType backendType = IoBackendType::Auto;
+
+    std::unordered_map<IoHandle, Request> requests;
+    // per priority, may hold handles that were cancelled or promoted in the meantime, those are skipped
+    std::deque<IoHandle> queued[2];
+    uint32_t inFlight = 0;
+    uint32_t prefetchInFlight = 0;
+    IoHandle nextHandle = 1;
+
+    // reads cancelled before submission, returned by the next Poll()
+    std::vector<IoCompletion> cancelled;
+    std::vector<IoBackendRead> batch;
+    std::vector<IoBackendResult> results;
+
+    uint8_t *registeredMemory = nullptr;
+    size_t registeredSize = 0;
+};
@@ -0,0 +1,164 @@
+#include "frame_loop.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "log.h"
+#include "profiler.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    Clock::duration Interval(double hz)
+    {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+    }
+}
+
+FrameLoop::FrameLoop(const FrameLoopProperties &properties)
+    : settings(properties)
+{
+}
+
+/**
+ * Start the simulation and render threads and pump window events on the calling thread until the window closes
+ *
+ * @param window Window whose events are forwarded, has to be pumped on the thread that created it
+ * @param renderer Renderer updated on the render thread
+ */
+void FrameLoop::Run(IWindow &window, IRenderer &renderer)
+{
+    running.store(true, std::memory_order_release);
+    published.store(false, std::memory_order_relaxed);
+    // read here, the window only updates its size on the event thread
+    std::thread simulationThread(&FrameLoop::SimulationLoop, this, window.GetWidth(), window.GetHeight());
+    std::thread renderThread(&FrameLoop::RenderLoop, this, std::ref(renderer));
+
+    while (window.PumpEvents(settings.EventTimeoutMs, input))
+    {
+    }
+
+    running.store(false, std::memory_order_release);
+    simulationThread.join();
+    // wakes a render thread still waiting for the first snapshot
+    published.store(true, std::memory_order_release);
+    published.notify_all();
+    renderThread.join();
+}
+
+void FrameLoop::SimulationLoop(uint32_t viewportWidth, uint32_t viewportHeight)
+{
+    VANADIUM_PROFILE_THREAD("Simulation");
+    const Clock::duration step = Interval(settings.SimulationHz);
+    const double stepSeconds = 1.0 / settings.SimulationHz;
+
+    FrameSnapshot state;
+    state.ViewportWidth = viewportWidth;
+    state.ViewportHeight = viewportHeight;
+    std::vector<InputEvent> events;
+    uint64_t droppedTicks = 0;
+
+    Clock::time_point next = Clock::now();
+    while (running.load(std::memory_order_acquire))
+    {
+        std::this_thread::sleep_until(next);
+
+        uint32_t ticks = 0;
+        for (; ticks < settings.MaxCatchUpTicks && Clock::now() >= next; ticks++)
+        {
+            VANADIUM_ZONE("Simulation tick");
+            events.clear();
+            InputEvent event;
+            while (input.TryPop(event))
+            {
+                events.push_back(event);
+                if (event.Type == InputEventType::Resize)
+                {
+                    state.ViewportWidth = static_cast<uint32_t>(event.X);
+                    state.ViewportHeight = static_cast<uint32_t>(event.Y);
+                }
+            }
+
+            state.Tick++;
+            state.SimulationTime += stepSeconds;
+            state.InputEvents = static_cast<uint32_t>(events.size());
+            if (!events.empty())
+            {
+                state.LastInputTimestampNs = events.back().TimestampNs;
+            }
+            if (simulate)
+            {
+                simulate(stepSeconds, events, state);
+            }
+            next += step;
+        }
+
+        // too far behind to catch up, continue from now instead of simulating the backlog
+        const Clock::time_point now = Clock::now();
+        if (now >= next + step)
+        {
+            droppedTicks += (now - next) / step;
+            next = now + step;
+        }
+
+        if (ticks > 0)
+        {
+            snapshots.Publish(state);
+            if (!published.exchange(true, std::memory_order_release))
+            {
+                published.notify_all();
+            }
+        }
+    }
+
+    if (droppedTicks > 0)
+    {
+        Log::Warning("Simulation fell behind and dropped {0} ticks", droppedTicks);
+    }
+}
+
+void FrameLoop::RenderLoop(IRenderer &renderer)
+{
+    VANADIUM_PROFILE_THREAD("Render");
+    const bool paced = settings.RenderHz > 0.0;
+    const Clock::duration interval = paced ? Interval(settings.RenderHz) : Clock::duration::zero();
+    bool firstFrame = true;
+
+    Clock::time_point next = Clock::now();
+    while (running.load(std::memory_order_acquire))
+    {
+        if (paced)
+        {
+            std::this_thread::sleep_until(next);
+            // a late frame moves the cadence instead of rendering a burst to catch up
+            next = std::max(next + interval, Clock::now());
+        }
+
+        snapshots.Acquire();
+        const FrameSnapshot &frame = snapshots.Latest();
+        if (frame.Tick == 0)
+        {
+            // nothing simulated yet, sleep until the first snapshot is published or the loop stops
+            published.wait(false, std::memory_order_acquire);
+            continue;
+        }
+
+        VANADIUM_PROFILE_FRAME();
+        {
+            VANADIUM_ZONE("Frame");
+            renderer.OnUpdate(frame);
+        }
+
+        if (firstFrame)
+        {
+            firstFrame = false;
+            if (settings.LaunchTime != Clock::time_point{})
+            {
+                const std::chrono::duration<double, std::milli> elapsed = Clock::now() - settings.LaunchTime;
+                Log::System("Time to first frame: {0:.1f} ms", elapsed.count());
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "core/snapshot_mailbox.h"
+#include "graphics/renderer.h"
+#include "platform/window.h"
+
+struct FrameLoopProperties
+{
+    double SimulationHz = 60.0;
+    // render thread cadence, 0 renders back to back and leaves the pacing to presentation (FIFO swapchain)
+    double RenderHz = 60.0;
+    // longest the main thread blocks waiting for OS events
+    uint32_t EventTimeoutMs = 100;
+    // ticks simulated back to back after a hitch, beyond that the simulation drops the lost time
+    uint32_t MaxCatchUpTicks = 5;
+    // time to first frame is logged relative to this when set
+    std::chrono::steady_clock::time_point LaunchTime{};
+};
+
+/**
+ * @brief Runs OS events, simulation and rendering on separate threads
+ *
+ * The calling thread (main, SDL wants its events there) blocks in the window until events arrive and forwards them
+ * through a lock-free SPSC queue. The simulation thread ticks at a fixed timestep, drains the input and publishes a
+ * FrameSnapshot per step. The render thread runs on its own cadence with whatever snapshot is the latest, so a slow
+ * simulation step delays new content but never the frame itself. Every thread sleeps while it has nothing to do.
+ */
+class FrameLoop
+{
+public:
+    using SimulateFunction =
+        std::function<void(double stepSeconds, std::span<const InputEvent> input, FrameSnapshot &state)>;
+
+    explicit FrameLoop(const FrameLoopProperties &properties);
+
+    /** @brief Called on the simulation thread once per tick, after the loop bookkeeping */
+    void SetSimulation(SimulateFunction function)
+    {
+        simulate = std::move(function);
+    }
+
+    void Run(IWindow &window, IRenderer &renderer);
+
+private:
+    void SimulationLoop(uint32_t viewportWidth, uint32_t viewportHeight);
+    void RenderLoop(IRenderer &renderer);
+
+    FrameLoopProperties settings;
+    SimulateFunction simulate;
+    std::atomic<bool> running{false};
+    // set with the first snapshot, the render thread waits on it instead of polling the mailbox
+    std::atomic<bool> published{false};
+    InputQueue input;
+    SnapshotMailbox<FrameSnapshot> snapshots;
+};
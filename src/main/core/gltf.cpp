@@ -0,0 +1,123 @@
+#include "gltf.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t GlbMagic = 0x46546C67;
+    constexpr uint32_t GlbVersion = 2;
+    constexpr uint32_t GlbChunkJson = 0x4E4F534A;
+    constexpr uint32_t GlbChunkBin = 0x004E4942;
+    constexpr size_t GlbHeaderSize = 12;
+    constexpr size_t GlbChunkHeaderSize = 8;
+
+    // the data is usually a read only mapping and glTF does not guarantee alignment of the chunk headers
+    uint32_t ReadU32(const uint8_t *data)
+    {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+}
+
+namespace Gltf
+{
+    /**
+     * Locate the JSON and BIN chunks of a binary glTF 2.0 file
+     *
+     * @param data Whole file, has to outlive chunks
+     * @param chunks Receives the chunks
+     * @param error Receives the reason if the file is malformed
+     *
+     * @return False if the file is not a valid .glb
+     */
+    bool ParseGlb(const uint8_t *data, size_t size, GlbChunks &chunks, std::string &error)
+    {
+        if (size < GlbHeaderSize + GlbChunkHeaderSize || ReadU32(data) != GlbMagic ||
+            ReadU32(data + 4) != GlbVersion || ReadU32(data + 8) > size)
+        {
+            error = "not a binary glTF 2.0 file";
+            return false;
+        }
+        const size_t length = ReadU32(data + 8);
+
+        const size_t jsonLength = ReadU32(data + GlbHeaderSize);
+        const size_t jsonStart = GlbHeaderSize + GlbChunkHeaderSize;
+        if (ReadU32(data + GlbHeaderSize + 4) != GlbChunkJson || jsonStart + jsonLength > length)
+        {
+            error = "does not start with a JSON chunk";
+            return false;
+        }
+        chunks.Json = std::string_view(reinterpret_cast<const char *>(data + jsonStart), jsonLength);
+        chunks.Bin = nullptr;
+        chunks.BinSize = 0;
+
+        // chunks are padded to 4 bytes, the BIN chunk is optional
+        const size_t binHeader = jsonStart + ((jsonLength + 3) & ~size_t(3));
+        if (binHeader + GlbChunkHeaderSize <= length && ReadU32(data + binHeader + 4) == GlbChunkBin)
+        {
+            const size_t binLength = ReadU32(data + binHeader);
+            if (binHeader + GlbChunkHeaderSize + binLength > length)
+            {
+                error = "truncated BIN chunk";
+                return false;
+            }
+            chunks.Bin = data + binHeader + GlbChunkHeaderSize;
+            chunks.BinSize = binLength;
+        }
+        return true;
+    }
+
+    uint32_t ComponentSize(uint32_t componentType)
+    {
+        switch (componentType)
+        {
+        case ComponentByte:
+        case ComponentUnsignedByte:
+            return 1;
+        case ComponentShort:
+        case ComponentUnsignedShort:
+            return 2;
+        case ComponentUnsignedInt:
+        case ComponentFloat:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * @return Number of components of an accessor type, 0 for matrices and unknown types
+     */
+    uint32_t ComponentCount(std::string_view type)
+    {
+        if (type == "SCALAR")
+        {
+            return 1;
+        }
+        if (type.size() == 4 && type.starts_with("VEC") && type[3] >= '2' && type[3] <= '4')
+        {
+            return static_cast<uint32_t>(type[3] - '0');
+        }
+        return 0;
+    }
+
+    /**
+     * Convert a JSON number holding a count, offset or size to an integer
+     *
+     * @param max Largest value the target type holds
+     *
+     * @return False if the number is not finite, negative, fractional or larger than max
+     */
+    bool ToUnsigned(double number, uint64_t max, uint64_t &value)
+    {
+        // 2^64 is exact as a double while UINT64_MAX is not, anything below it converts without overflow
+        if (!std::isfinite(number) || number < 0.0 || number >= 18446744073709551616.0 || std::trunc(number) != number)
+        {
+            return false;
+        }
+        value = static_cast<uint64_t>(number);
+        return value <= max;
+    }
+}
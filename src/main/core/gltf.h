@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/** @brief Constants and container parsing shared by everything that reads binary glTF */
+namespace Gltf
+{
+    constexpr uint32_t ComponentByte = 5120;
+    constexpr uint32_t ComponentUnsignedByte = 5121;
+    constexpr uint32_t ComponentShort = 5122;
+    constexpr uint32_t ComponentUnsignedShort = 5123;
+    constexpr uint32_t ComponentUnsignedInt = 5125;
+    constexpr uint32_t ComponentFloat = 5126;
+    constexpr uint32_t ModeTriangles = 4;
+
+    /** @brief Chunks of a .glb file, both point into the memory that was parsed */
+    struct GlbChunks
+    {
+        std::string_view Json;
+        // null if the file has no BIN chunk
+        const uint8_t *Bin = nullptr;
+        uint64_t BinSize = 0;
+    };
+
+    bool ParseGlb(const uint8_t *data, size_t size, GlbChunks &chunks, std::string &error);
+
+    uint32_t ComponentSize(uint32_t componentType);
+    uint32_t ComponentCount(std::string_view type);
+    bool ToUnsigned(double number, uint64_t max, uint64_t &value);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "async_io.h"
+
+/** @brief One read as AsyncIo hands it to a backend, resubmitted remainders keep the handle of their request */
+struct IoBackendRead
+{
+    IoHandle Handle = InvalidIoHandle;
+    IoFile File = InvalidIoFile;
+    uint64_t Offset = 0;
+    void *Destination = nullptr;
+    uint32_t Size = 0;
+    IoPriority Priority = IoPriority::Visible;
+    // the destination lies inside the registered buffer
+    bool Registered = false;
+};
+
+struct IoBackendResult
+{
+    IoHandle Handle = InvalidIoHandle;
+    // bytes read, or the negated errno
+    int64_t Result = 0;
+};
+
+/** @brief Executes reads for AsyncIo, which does the queueing, prioritization and bookkeeping */
+class IIoBackend
+{
+public:
+    virtual ~IIoBackend() = default;
+
+    virtual bool RegisterBuffer(void *memory, size_t size) = 0;
+    virtual void Submit(std::span<const IoBackendRead> reads) = 0;
+    // best effort, the read reports -ECANCELED if it was aborted and its normal result otherwise
+    virtual void Cancel(IoHandle handle) = 0;
+    // appends finished reads, with wait it blocks until at least one read finished
+    virtual void Reap(std::vector<IoBackendResult> &results, bool wait) = 0;
+};
+
+// nullptr if io_uring is not available, e.g. on other platforms or when the kernel or a sandbox refuses it
+std::unique_ptr<IIoBackend> CreateUringBackend(const AsyncIoProperties &properties);
+std::unique_ptr<IIoBackend> CreateThreadPoolBackend(const AsyncIoProperties &properties);
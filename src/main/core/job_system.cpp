@@ -0,0 +1,456 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <format>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "profiler.h"
+
+namespace
+{
+    // failed attempts to find work before a worker goes to sleep
+    constexpr uint32_t IdleSpins = 256;
+    // failed attempts to find work before a waiting thread gives its time slice away between attempts
+    constexpr uint32_t WaitSpins = 64;
+
+    // identifies the worker the current thread belongs to, if any
+    thread_local const JobSystem *threadSystem = nullptr;
+    thread_local uint32_t threadWorker = 0;
+    thread_local uint32_t stealSeed = 0x9e3779b9;
+
+    void CpuRelax()
+    {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    uint32_t NextRandom()
+    {
+        // xorshift32, only used to spread thieves over the victims
+        stealSeed ^= stealSeed << 13;
+        stealSeed ^= stealSeed >> 17;
+        stealSeed ^= stealSeed << 5;
+        return stealSeed;
+    }
+
+    void PinCurrentThread(uint32_t core)
+    {
+#if defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)core;
+#endif
+    }
+
+    struct ParallelForContext
+    {
+        JobSystem *System;
+        const JobSystem::RangeTask *Task;
+        uint32_t Grain;
+        JobCounter *Counter;
+    };
+
+    // splits off the upper half until the range fits the grain, so idle workers steal large pieces first
+    void ParallelForJob(const void *context, uint32_t begin, uint32_t end)
+    {
+        const ParallelForContext &parallelFor = *static_cast<const ParallelForContext *>(context);
+        while (end - begin > parallelFor.Grain)
+        {
+            const uint32_t middle = begin + (end - begin) / 2;
+            parallelFor.System->Run(&ParallelForJob, context, middle, end, *parallelFor.Counter);
+            end = middle;
+        }
+        VANADIUM_ZONE("ParallelFor chunk");
+        (*parallelFor.Task)(begin, end);
+    }
+}
+
+void JobSystem::WorkDeque::Store(int64_t index, const Job &job)
+{
+    Slot &slot = slots[index & (Capacity - 1)];
+    slot.Function.store(job.Function, std::memory_order_relaxed);
+    slot.Context.store(job.Context, std::memory_order_relaxed);
+    slot.Begin.store(job.Begin, std::memory_order_relaxed);
+    slot.End.store(job.End, std::memory_order_relaxed);
+    slot.Counter.store(job.Counter, std::memory_order_relaxed);
+    slot.Dependency.store(job.Dependency, std::memory_order_relaxed);
+}
+
+Job JobSystem::WorkDeque::Load(int64_t index) const
+{
+    const Slot &slot = slots[index & (Capacity - 1)];
+    Job job;
+    job.Function = slot.Function.load(std::memory_order_relaxed);
+    job.Context = slot.Context.load(std::memory_order_relaxed);
+    job.Begin = slot.Begin.load(std::memory_order_relaxed);
+    job.End = slot.End.load(std::memory_order_relaxed);
+    job.Counter = slot.Counter.load(std::memory_order_relaxed);
+    job.Dependency = slot.Dependency.load(std::memory_order_relaxed);
+    return job;
+}
+
+// owner only, returns false if the deque is full
+bool JobSystem::WorkDeque::Push(const Job &job)
+{
+    const int64_t b = bottom.load(std::memory_order_relaxed);
+    const int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= Capacity)
+    {
+        return false;
+    }
+    Store(b, job);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+// owner only, takes the most recently pushed job
+bool JobSystem::WorkDeque::Pop(Job &job)
+{
+    const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_seq_cst);
+    if (t > b)
+    {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    job = Load(b);
+    if (t == b)
+    {
+        // last job, race the thieves for it
+        const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+// any thread, takes the oldest job
+bool JobSystem::WorkDeque::Steal(Job &job)
+{
+    int64_t t = top.load(std::memory_order_seq_cst);
+    const int64_t b = bottom.load(std::memory_order_seq_cst);
+    if (t >= b)
+    {
+        return false;
+    }
+
+    job = Load(t);
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+/**
+ * Spawn the worker threads
+ *
+ * @param properties (Optional) Thread count and whether workers are pinned to cores
+ */
+JobSystem::JobSystem(const JobSystemProperties &properties)
+{
+    uint32_t threadCount = properties.ThreadCount;
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // every deque has to exist before the first worker starts stealing
+    workers.reserve(threadCount - 1);
+    for (uint32_t i = 1; i < threadCount; i++)
+    {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (uint32_t i = 0; i < workers.size(); i++)
+    {
+        workers[i]->thread = std::thread(&JobSystem::WorkerLoop, this, i, properties.PinWorkers);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    stopping.store(true, std::memory_order_seq_cst);
+    wakeGeneration.fetch_add(1, std::memory_order_seq_cst);
+    wakeGeneration.notify_all();
+
+    for (const std::unique_ptr<Worker> &worker : workers)
+    {
+        worker->thread.join();
+    }
+}
+
+/**
+ * Schedule a job, counter is incremented now and decremented once the job finished
+ *
+ * @param function Job body, called with context and [begin, end)
+ * @param context Passed to function, has to stay valid until the counter is done
+ * @param counter Counter to wait on
+ */
+void JobSystem::Run(JobFunction function, const void *context, uint32_t begin, uint32_t end, JobCounter &counter)
+{
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    Schedule(Job{function, context, begin, end, &counter, nullptr});
+}
+
+/**
+ * Schedule a job that only starts once dependency is done
+ *
+ * @param dependency Counter of the jobs that have to finish first, has to stay valid until the job started
+ */
+void JobSystem::RunAfter(const JobCounter &dependency,
+                         JobFunction function,
+                         const void *context,
+                         uint32_t begin,
+                         uint32_t end,
+                         JobCounter &counter)
+{
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    const Job job{function, context, begin, end, &counter, &dependency};
+    if (!Park(job))
+    {
+        Schedule(job);
+    }
+}
+
+/**
+ * Run other jobs until every job counted by counter has finished, yielding once there is nothing left to help with
+ * so a waiter blocked on a long job does not keep a core busy spinning
+ */
+void JobSystem::Wait(const JobCounter &counter)
+{
+    VANADIUM_ZONE("JobSystem::Wait");
+    uint32_t idle = 0;
+    while (!counter.IsDone())
+    {
+        if (TryRunOne())
+        {
+            idle = 0;
+        }
+        else if (++idle < WaitSpins)
+        {
+            CpuRelax();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * Run task over [0, count) split into ranges of at most grainSize, returns once every range has finished
+ *
+ * @param count Number of elements to process
+ * @param grainSize Largest range handed to a job
+ * @param task Callback receiving a [begin, end) range
+ */
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const RangeTask &task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grainSize = std::max(1u, grainSize);
+
+    // not worth involving anyone else for a single range
+    if (workers.empty() || count <= grainSize)
+    {
+        task(0, count);
+        return;
+    }
+
+    JobCounter counter;
+    const ParallelForContext context{this, &task, grainSize, &counter};
+    Run(&ParallelForJob, &context, 0, count, counter);
+    Wait(counter);
+}
+
+void JobSystem::WorkerLoop(uint32_t workerIndex, bool pin)
+{
+    VANADIUM_PROFILE_THREAD(std::format("Worker {0}", workerIndex + 1));
+    threadSystem = this;
+    threadWorker = workerIndex;
+    stealSeed += workerIndex * 0x85ebca6b;
+    if (pin)
+    {
+        PinCurrentThread(workerIndex + 1);
+    }
+
+    uint32_t idle = 0;
+    while (!stopping.load(std::memory_order_relaxed))
+    {
+        if (TryRunOne())
+        {
+            idle = 0;
+            continue;
+        }
+        if (++idle < IdleSpins)
+        {
+            CpuRelax();
+            continue;
+        }
+
+        // announce the sleep before the last look for work, Schedule() checks sleepingWorkers after publishing
+        sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        const uint32_t generation = wakeGeneration.load(std::memory_order_seq_cst);
+        if (!HasWork() && !stopping.load(std::memory_order_seq_cst))
+        {
+            wakeGeneration.wait(generation, std::memory_order_seq_cst);
+        }
+        sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+void JobSystem::Schedule(const Job &job)
+{
+    if (threadSystem == this)
+    {
+        if (!workers[threadWorker]->deque.Push(job))
+        {
+            // deque full, running it right away still makes progress
+            if (!job.Dependency || job.Dependency->IsDone())
+            {
+                Execute(job);
+                return;
+            }
+            Inject(job);
+        }
+    }
+    else
+    {
+        Inject(job);
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+    {
+        wakeGeneration.fetch_add(1, std::memory_order_seq_cst);
+        wakeGeneration.notify_one();
+    }
+}
+
+void JobSystem::Inject(const Job &job)
+{
+    std::lock_guard lock(injectedMutex);
+    injected.push_back(job);
+    injectedCount.fetch_add(1, std::memory_order_seq_cst);
+}
+
+// returns false if the dependency is already done and the job can be scheduled right away
+bool JobSystem::Park(const Job &job)
+{
+    std::lock_guard lock(parkedMutex);
+    // announced before looking at the dependency, pairs with the order in Execute() so one of the two sees the other
+    parkedCount.fetch_add(1, std::memory_order_seq_cst);
+    if (job.Dependency->pending.load(std::memory_order_seq_cst) == 0)
+    {
+        parkedCount.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    parked.push_back(job);
+    return true;
+}
+
+// schedules every job parked on dependency, which only has to be compared against, it may be gone already
+void JobSystem::Unpark(const JobCounter *dependency)
+{
+    std::vector<Job> ready;
+    {
+        std::lock_guard lock(parkedMutex);
+        const auto first = std::stable_partition(parked.begin(),
+                                                 parked.end(),
+                                                 [dependency](const Job &job) { return job.Dependency != dependency; });
+        ready.assign(first, parked.end());
+        parked.erase(first, parked.end());
+        parkedCount.fetch_sub(static_cast<uint32_t>(ready.size()), std::memory_order_relaxed);
+    }
+    for (const Job &job : ready)
+    {
+        Schedule(job);
+    }
+}
+
+bool JobSystem::TryRunOne()
+{
+    Job job;
+    bool found = threadSystem == this && workers[threadWorker]->deque.Pop(job);
+
+    if (!found && injectedCount.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard lock(injectedMutex);
+        if (!injected.empty())
+        {
+            job = injected.front();
+            injected.pop_front();
+            injectedCount.fetch_sub(1, std::memory_order_relaxed);
+            found = true;
+        }
+    }
+
+    const uint32_t workerCount = static_cast<uint32_t>(workers.size());
+    const uint32_t start = workerCount > 0 ? NextRandom() % workerCount : 0;
+    for (uint32_t i = 0; !found && i < workerCount; i++)
+    {
+        const uint32_t victim = (start + i) % workerCount;
+        if (threadSystem != this || victim != threadWorker)
+        {
+            found = workers[victim]->deque.Steal(job);
+        }
+    }
+
+    if (!found)
+    {
+        return false;
+    }
+
+    // only reached by a job whose dependency counter was reused after it got unparked
+    if (job.Dependency && Park(job))
+    {
+        return false;
+    }
+
+    Execute(job);
+    return true;
+}
+
+bool JobSystem::HasWork() const
+{
+    if (injectedCount.load(std::memory_order_seq_cst) > 0)
+    {
+        return true;
+    }
+    return std::ranges::any_of(workers, [](const std::unique_ptr<Worker> &worker) { return !worker->deque.IsEmpty(); });
+}
+
+void JobSystem::Execute(const Job &job)
+{
+    job.Function(job.Context, job.Begin, job.End);
+    // nothing may touch the counter after this, a waiter can return and destroy it right away
+    const JobCounter *counter = job.Counter;
+    if (job.Counter->pending.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+        parkedCount.load(std::memory_order_seq_cst) > 0)
+    {
+        Unpark(counter);
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+// jobs are a plain function over a range so they fit into the lock-free deques by value
+using JobFunction = void (*)(const void *context, uint32_t begin, uint32_t end);
+
+struct Job
+{
+    JobFunction Function = nullptr;
+    // has to stay valid until the job ran, usually lives on the stack of whoever waits for Counter
+    const void *Context = nullptr;
+    uint32_t Begin = 0;
+    uint32_t End = 0;
+    JobCounter *Counter = nullptr;
+    // the job is held back until this counter is done
+    const JobCounter *Dependency = nullptr;
+};
+
+/** @brief Number of scheduled jobs that have not finished yet, can be reused once it is done */
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter &) = delete;
+    JobCounter &operator=(const JobCounter &) = delete;
+
+    [[nodiscard]] bool IsDone() const
+    {
+        return pending.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class JobSystem;
+    std::atomic<uint32_t> pending{0};
+};
+
+struct JobSystemProperties
+{
+    // total number of threads including the one waiting for jobs, 0 uses hardware concurrency
+    uint32_t ThreadCount = 0;
+    // pin worker i to core i, the creating thread keeps its affinity as core 0's user
+    bool PinWorkers = false;
+};
+
+/**
+ * @brief Work-stealing job scheduler shared by every subsystem that needs parallelism
+ *
+ * Each worker owns a Chase-Lev deque: it pushes and pops its own jobs at the bottom without contention and idle
+ * workers steal from the top of the others. Threads that are not workers submit through a small mutex protected
+ * queue. Waiting never blocks a thread while there is work: Wait() runs other jobs until the counter is done, which
+ * is also what the thread calling ParallelFor() does. Workers sleep once nothing was found for a while.
+ *
+ * A job scheduled with a dependency is parked until the dependency counter is done, the job that finishes the
+ * dependency schedules it, so idle workers never see work they cannot run. Waiting from inside a job
+ * should be limited to counters of jobs it scheduled itself, the helping thread may otherwise end up running a job
+ * that waits for the job below it on the same stack.
+ */
+class JobSystem
+{
+public:
+    using RangeTask = std::function<void(uint32_t begin, uint32_t end)>;
+
+    explicit JobSystem(const JobSystemProperties &properties = {});
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    void Run(JobFunction function, const void *context, uint32_t begin, uint32_t end, JobCounter &counter);
+    void RunAfter(const JobCounter &dependency,
+                  JobFunction function,
+                  const void *context,
+                  uint32_t begin,
+                  uint32_t end,
+                  JobCounter &counter);
+    void Wait(const JobCounter &counter);
+
+    void ParallelFor(uint32_t count, uint32_t grainSize, const RangeTask &task);
+
+    [[nodiscard]] uint32_t GetThreadCount() const
+    {
+        return static_cast<uint32_t>(workers.size()) + 1;
+    }
+
+private:
+    // fixed capacity Chase-Lev deque, slots are atomics so a thief racing the owner reads a torn job only when its
+    // claim on the slot fails anyway
+    class WorkDeque
+    {
+    public:
+        static constexpr int64_t Capacity = 4096;
+
+        bool Push(const Job &job);
+        bool Pop(Job &job);
+        bool Steal(Job &job);
+
+        [[nodiscard]] bool IsEmpty() const
+        {
+            // sequentially consistent so a worker going to sleep cannot miss a push, see JobSystem::WorkerLoop
+            return bottom.load(std::memory_order_seq_cst) <= top.load(std::memory_order_seq_cst);
+        }
+
+    private:
+        struct Slot
+        {
+            std::atomic<JobFunction> Function{nullptr};
+            std::atomic<const void *> Context{nullptr};
+            std::atomic<uint32_t> Begin{0};
+            std::atomic<uint32_t> End{0};
+            std::atomic<JobCounter *> Counter{nullptr};
+            std::atomic<const JobCounter *> Dependency{nullptr};
+        };
+
+        void Store(int64_t index, const Job &job);
+        Job Load(int64_t index) const;
+
+        std::vector<Slot> slots = std::vector<Slot>(Capacity);
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+    };
+
+    struct Worker
+    {
+        WorkDeque deque;
+        std::thread thread;
+    };
+
+    void WorkerLoop(uint32_t workerIndex, bool pin);
+    void Schedule(const Job &job);
+    void Inject(const Job &job);
+    bool Park(const Job &job);
+    void Unpark(const JobCounter *dependency);
+    bool TryRunOne();
+    bool HasWork() const;
+    void Execute(const Job &job);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> stopping{false};
+
+    // submissions from threads that are not workers
+    std::mutex injectedMutex;
+    std::deque<Job> injected;
+    std::atomic<uint32_t> injectedCount{0};
+
+    // jobs whose dependency is not done yet, matched to it by address because the dependency may be destroyed as
+    // soon as it is done
+    std::mutex parkedMutex;
+    std::vector<Job> parked;
+    std::atomic<uint32_t> parkedCount{0};
+
+    // workers sleep on wakeGeneration once they found nothing to do for a while
+    alignas(64) std::atomic<uint32_t> sleepingWorkers{0};
+    std::atomic<uint32_t> wakeGeneration{0};
+};
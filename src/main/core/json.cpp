@@ -0,0 +1,262 @@
+#include "json.h"
+
+#include <charconv>
+#include <format>
+
+namespace
+{
+    // nesting deeper than this is rejected instead of risking the stack
+    constexpr uint32_t MaxDepth = 256;
+}
+
+/**
+ * Parse a complete JSON text, a previously parsed document is discarded
+ *
+ * @param text JSON text, has to outlive the document
+ *
+ * @return False on a syntax error, see GetError()
+ */
+bool JsonDocument::Parse(std::string_view text)
+{
+    values.clear();
+    error.clear();
+    source = text;
+    position = 0;
+
+    // rough guess of one value per 16 bytes avoids most reallocations for asset files
+    values.reserve(text.size() / 16 + 1);
+    if (ParseValue(0) == JsonValue::None)
+    {
+        values.clear();
+        values.emplace_back();
+        return false;
+    }
+
+    SkipWhitespace();
+    if (position != source.size())
+    {
+        return Fail("Trailing characters after the root value");
+    }
+    return true;
+}
+
+/**
+ * Look up a member of an object
+ *
+ * @return Null if object is not an object or has no such member
+ */
+const JsonValue *JsonDocument::Find(const JsonValue &object, std::string_view key) const
+{
+    if (object.Type != JsonType::Object)
+    {
+        return nullptr;
+    }
+    for (uint32_t child = object.FirstChild; child != JsonValue::None; child = values[child].NextSibling)
+    {
+        if (values[child].Key == key)
+        {
+            return &values[child];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Collect the elements of an array for indexed access
+ *
+ * @return Empty if array is null or not an array
+ */
+std::vector<const JsonValue *> JsonDocument::Elements(const JsonValue *array) const
+{
+    std::vector<const JsonValue *> elements;
+    if (!array || array->Type != JsonType::Array)
+    {
+        return elements;
+    }
+    elements.reserve(array->ChildCount);
+    for (uint32_t child = array->FirstChild; child != JsonValue::None; child = values[child].NextSibling)
+    {
+        elements.push_back(&values[child]);
+    }
+    return elements;
+}
+
+double JsonDocument::GetNumber(const JsonValue &object, std::string_view key, double fallback) const
+{
+    const JsonValue *value = Find(object, key);
+    return value && value->Type == JsonType::Number ? value->Number : fallback;
+}
+
+std::string_view JsonDocument::GetString(const JsonValue &object, std::string_view key) const
+{
+    const JsonValue *value = Find(object, key);
+    return value && value->Type == JsonType::String ? value->Text : std::string_view();
+}
+
+// returns the index of the parsed value or None on error
+uint32_t JsonDocument::ParseValue(uint32_t depth)
+{
+    if (depth > MaxDepth)
+    {
+        Fail("Nesting too deep");
+        return JsonValue::None;
+    }
+
+    SkipWhitespace();
+    if (position >= source.size())
+    {
+        Fail("Unexpected end of input");
+        return JsonValue::None;
+    }
+
+    const uint32_t index = static_cast<uint32_t>(values.size());
+    values.emplace_back();
+    const char c = source[position];
+
+    if (c == '{' || c == '[')
+    {
+        const bool isObject = c == '{';
+        const char close = isObject ? '}' : ']';
+        values[index].Type = isObject ? JsonType::Object : JsonType::Array;
+        position++;
+
+        SkipWhitespace();
+        if (position < source.size() && source[position] == close)
+        {
+            position++;
+            return index;
+        }
+
+        uint32_t previous = JsonValue::None;
+        while (true)
+        {
+            std::string_view key;
+            if (isObject)
+            {
+                SkipWhitespace();
+                if (!ParseString(key))
+                {
+                    return JsonValue::None;
+                }
+                SkipWhitespace();
+                if (position >= source.size() || source[position] != ':')
+                {
+                    Fail("Expected ':' after member name");
+                    return JsonValue::None;
+                }
+                position++;
+            }
+
+            const uint32_t child = ParseValue(depth + 1);
+            if (child == JsonValue::None)
+            {
+                return JsonValue::None;
+            }
+            // values may have moved, only indices are kept across the recursive call
+            values[child].Key = key;
+            if (previous == JsonValue::None)
+            {
+                values[index].FirstChild = child;
+            }
+            else
+            {
+                values[previous].NextSibling = child;
+            }
+            previous = child;
+            values[index].ChildCount++;
+
+            SkipWhitespace();
+            if (position < source.size() && source[position] == ',')
+            {
+                position++;
+                continue;
+            }
+            if (position < source.size() && source[position] == close)
+            {
+                position++;
+                return index;
+            }
+            Fail(isObject ? "Expected ',' or '}'" : "Expected ',' or ']'");
+            return JsonValue::None;
+        }
+    }
+
+    if (c == '"')
+    {
+        std::string_view text;
+        if (!ParseString(text))
+        {
+            return JsonValue::None;
+        }
+        values[index].Type = JsonType::String;
+        values[index].Text = text;
+        return index;
+    }
+
+    if (source.substr(position, 4) == "true" || source.substr(position, 5) == "false")
+    {
+        values[index].Type = JsonType::Bool;
+        values[index].Bool = c == 't';
+        position += c == 't' ? 4 : 5;
+        return index;
+    }
+
+    if (source.substr(position, 4) == "null")
+    {
+        position += 4;
+        return index;
+    }
+
+    double number = 0.0;
+    const char *begin = source.data() + position;
+    const std::from_chars_result result = std::from_chars(begin, source.data() + source.size(), number);
+    if (result.ec != std::errc() || result.ptr == begin)
+    {
+        Fail("Unexpected character");
+        return JsonValue::None;
+    }
+    values[index].Type = JsonType::Number;
+    values[index].Number = number;
+    position += static_cast<size_t>(result.ptr - begin);
+    return index;
+}
+
+bool JsonDocument::ParseString(std::string_view &out)
+{
+    if (position >= source.size() || source[position] != '"')
+    {
+        return Fail("Expected a string");
+    }
+    const size_t begin = ++position;
+    while (position < source.size() && source[position] != '"')
+    {
+        // skip the escaped character so an escaped quote does not end the string
+        position += source[position] == '\\' ? 2 : 1;
+    }
+    if (position >= source.size())
+    {
+        return Fail("Unterminated string");
+    }
+    out = source.substr(begin, position - begin);
+    position++;
+    return true;
+}
+
+void JsonDocument::SkipWhitespace()
+{
+    while (position < source.size() &&
+           (source[position] == ' ' || source[position] == '\n' || source[position] == '\r' ||
+            source[position] == '\t'))
+    {
+        position++;
+    }
+}
+
+bool JsonDocument::Fail(const char *message)
+{
+    if (error.empty())
+    {
+        error = std::format("{0} at byte {1}", message, position);
+    }
+    return false;
+}
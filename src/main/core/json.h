@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class JsonType : uint8_t
+{
+    Null,
+    Bool,
+    Number,
+    String,
+    Array,
+    Object,
+};
+
+struct JsonValue
+{
+    static constexpr uint32_t None = ~0u;
+
+    JsonType Type = JsonType::Null;
+    bool Bool = false;
+    double Number = 0.0;
+    // string contents with escape sequences left as they are, points into the parsed text
+    std::string_view Text;
+    // member name when the value is part of an object
+    std::string_view Key;
+    uint32_t FirstChild = None;
+    uint32_t NextSibling = None;
+    uint32_t ChildCount = 0;
+};
+
+/**
+ * @brief Read only JSON DOM whose strings point into the parsed text instead of being copied
+ * @note The text has to outlive the document. Escapes are not decoded, which is fine for keys and the ASCII names
+ *       asset formats use but not for arbitrary text.
+ */
+class JsonDocument
+{
+public:
+    bool Parse(std::string_view text);
+
+    [[nodiscard]] const JsonValue &Root() const
+    {
+        return values.front();
+    }
+
+    [[nodiscard]] const std::string &GetError() const
+    {
+        return error;
+    }
+
+    [[nodiscard]] const JsonValue *Find(const JsonValue &object, std::string_view key) const;
+    [[nodiscard]] std::vector<const JsonValue *> Elements(const JsonValue *array) const;
+
+    [[nodiscard]] double GetNumber(const JsonValue &object, std::string_view key, double fallback) const;
+    [[nodiscard]] std::string_view GetString(const JsonValue &object, std::string_view key) const;
+
+private:
+    uint32_t ParseValue(uint32_t depth);
+    bool ParseString(std::string_view &out);
+    void SkipWhitespace();
+    bool Fail(const char *message);
+
+    std::vector<JsonValue> values;
+    std::string_view source;
+    size_t position = 0;
+    std::string error;
+};
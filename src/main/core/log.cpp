@@ -1,42 +1,520 @@
 #include "log.h"
 
-#include <iostream>
-using std::cout;
-using std::endl;
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // has to be a power of two
+    constexpr size_t QueueCapacity = 8192;
+    // messages written per console and file call
+    constexpr size_t BatchSize = 256;
+    // yields a crash handler waits for the writer thread before writing regardless
+    constexpr uint32_t CrashLockAttempts = 100'000;
+
+    using SystemClock = std::chrono::system_clock;
+
+    struct LogMessage
+    {
+        // Vyukov bounded queue sequence, equals the position when free and position + 1 when published
+        std::atomic<size_t> sequence{0};
+        LogLevel level = LogLevel::Info;
+        SystemClock::time_point time;
+        // deferred messages carry a record, the others their text
+        LogRecord record;
+        std::string text;
+    };
+
+    const char *ConsoleColor(LogLevel level)
+    {
+        switch (level)
+        {
+        case LogLevel::System:
+            return "\033[94m";
+        case LogLevel::Warning:
+            return "\033[33m";
+        case LogLevel::Error:
+            return "\033[31m";
+        default:
+            return "\033[0m";
+        }
+    }
+
+    const char *LevelName(LogLevel level)
+    {
+        switch (level)
+        {
+        case LogLevel::System:
+            return "system";
+        case LogLevel::Warning:
+            return "warning";
+        case LogLevel::Error:
+            return "error";
+        case LogLevel::Trace:
+            return "trace";
+        default:
+            return "info";
+        }
+    }
+
+    class AsyncLogger
+    {
+    public:
+        AsyncLogger()
+            : messages(QueueCapacity)
+        {
+            for (size_t i = 0; i < QueueCapacity; i++)
+            {
+                messages[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            writer = std::thread(&AsyncLogger::WriterLoop, this);
+        }
+
+        void Configure(const LogProperties &newProperties)
+        {
+            Flush();
+            LockSinks();
+            if (file)
+            {
+                std::fclose(file);
+                file = nullptr;
+            }
+            properties = newProperties;
+            OpenFile();
+            UnlockSinks();
+        }
+
+        void Push(LogLevel level, const std::string &text)
+        {
+            if (!running.load(std::memory_order_acquire))
+            {
+                WriteNow(level, text);
+                return;
+            }
+            Enqueue(level,
+                    [&](LogMessage &message)
+                    {
+                        message.record.Format = nullptr;
+                        // reuses the capacity the slot's previous message left behind
+                        message.text.assign(text);
+                    });
+        }
+
+        void Push(LogLevel level, const LogRecord &record)
+        {
+            if (!running.load(std::memory_order_acquire))
+            {
+                std::string text;
+                record.Format(text, record.FormatString, record.Arguments);
+                WriteNow(level, text);
+                return;
+            }
+            Enqueue(level,
+                    [&](LogMessage &message)
+                    {
+                        message.record.Format = record.Format;
+                        message.record.FormatString = record.FormatString;
+                        message.record.ArgumentBytes = record.ArgumentBytes;
+                        std::memcpy(message.record.Arguments, record.Arguments, record.ArgumentBytes);
+                    });
+        }
+
+        void Flush()
+        {
+            if (!running.load(std::memory_order_acquire) || std::this_thread::get_id() == writer.get_id())
+            {
+                return;
+            }
+
+            const size_t target = enqueuePosition.load(std::memory_order_acquire);
+            size_t current = written.load(std::memory_order_acquire);
+            while (current < target)
+            {
+                written.wait(current, std::memory_order_acquire);
+                current = written.load(std::memory_order_acquire);
+            }
+        }
+
+        void Shutdown()
+        {
+            if (!running.exchange(false, std::memory_order_acq_rel))
+            {
+                return;
+            }
+            pushed.fetch_add(1, std::memory_order_release);
+            pushed.notify_one();
+            writer.join();
+
+            LockSinks();
+            while (Drain() > 0)
+            {
+            }
+            UnlockSinks();
+        }
+
+        // not async signal safe, a crashing process gets a best effort attempt to keep its last messages
+        void CrashFlush()
+        {
+            // the writer may itself be the crashing thread or never release the sinks, so only wait a bounded time
+            if (std::this_thread::get_id() != writer.get_id())
+            {
+                for (uint32_t attempt = 0;
+                     attempt < CrashLockAttempts && sinksBusy.test_and_set(std::memory_order_acquire);
+                     attempt++)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            while (Drain() > 0)
+            {
+            }
+        }
+
+    private:
+        // nothing drains the queue after Shutdown()
+        void WriteNow(LogLevel level, const std::string &text)
+        {
+            LockSinks();
+            Append(level, SystemClock::now(), text);
+            WriteBatch();
+            UnlockSinks();
+        }
+
+        template <typename Fill>
+        void Enqueue(LogLevel level, const Fill &fill)
+        {
+            if (!TryPush(level, fill))
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            // seq_cst pairs with WriterLoop(), either the writer sees the new count or the producer sees it asleep
+            pushed.fetch_add(1, std::memory_order_seq_cst);
+            if (writerWaiting.load(std::memory_order_seq_cst))
+            {
+                pushed.notify_one();
+            }
+        }
+
+        template <typename Fill>
+        bool TryPush(LogLevel level, const Fill &fill)
+        {
+            size_t position = enqueuePosition.load(std::memory_order_relaxed);
+            LogMessage *message = nullptr;
+            while (true)
+            {
+                message = &messages[position & (QueueCapacity - 1)];
+                const size_t sequence = message->sequence.load(std::memory_order_acquire);
+                const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                if (difference == 0)
+                {
+                    if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    // the writer has not consumed this slot yet, the queue is full
+                    return false;
+                }
+                else
+                {
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+
+            message->level = level;
+            message->time = SystemClock::now();
+            fill(*message);
+            message->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // writes up to BatchSize queued messages, the caller owns the sinks
+        size_t Drain()
+        {
+            size_t count = 0;
+            while (count < BatchSize)
+            {
+                LogMessage &message = messages[dequeuePosition & (QueueCapacity - 1)];
+                if (message.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+                {
+                    break;
+                }
+                if (message.record.Format)
+                {
+                    formatted.clear();
+                    message.record.Format(formatted, message.record.FormatString, message.record.Arguments);
+                    Append(message.level, message.time, formatted);
+                }
+                else
+                {
+                    Append(message.level, message.time, message.text);
+                    message.text.clear();
+                }
+                message.sequence.store(dequeuePosition + QueueCapacity, std::memory_order_release);
+                dequeuePosition++;
+                count++;
+            }
+
+            const uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0)
+            {
+                Append(LogLevel::Warning,
+                       SystemClock::now(),
+                       std::format("{0} log messages dropped, the queue was full", lost));
+            }
+            WriteBatch();
+
+            written.store(dequeuePosition, std::memory_order_release);
+            written.notify_all();
+            return count;
+        }
+
+        void Append(LogLevel level, SystemClock::time_point time, const std::string &text)
+        {
+            if (properties.Console)
+            {
+                consoleBatch += ConsoleColor(level);
+                consoleBatch += text;
+                consoleBatch += "\033[0m\n";
+            }
+            if (file)
+            {
+                fileBatch += std::format("{0:%F %T} {1:<7} ",
+                                         std::chrono::floor<std::chrono::milliseconds>(time),
+                                         LevelName(level));
+                fileBatch += text;
+                fileBatch += '\n';
+            }
+        }
+
+        void WriteBatch()
+        {
+            if (!consoleBatch.empty())
+            {
+                std::fwrite(consoleBatch.data(), 1, consoleBatch.size(), stdout);
+                std::fflush(stdout);
+                consoleBatch.clear();
+            }
+
+            if (!file || fileBatch.empty())
+            {
+                fileBatch.clear();
+                return;
+            }
+            if (fileBytes > 0 && fileBytes + fileBatch.size() > properties.MaxFileBytes)
+            {
+                std::fclose(file);
+                file = nullptr;
+                OpenFile();
+                if (!file)
+                {
+                    fileBatch.clear();
+                    return;
+                }
+            }
+            std::fwrite(fileBatch.data(), 1, fileBatch.size(), file);
+            std::fflush(file);
+            fileBytes += fileBatch.size();
+            fileBatch.clear();
+        }
+
+        // moves the current file to FilePath.1 and the older ones one index up, then starts an empty file
+        void OpenFile()
+        {
+            fileBytes = 0;
+            if (properties.FilePath.empty())
+            {
+                return;
+            }
+
+            // missing files are expected, rename and remove errors are ignored
+            std::error_code error;
+            const std::string &path = properties.FilePath;
+            if (properties.MaxRotatedFiles > 0)
+            {
+                std::filesystem::remove(std::format("{0}.{1}", path, properties.MaxRotatedFiles), error);
+                for (uint32_t i = properties.MaxRotatedFiles; i > 1; i--)
+                {
+                    std::filesystem::rename(std::format("{0}.{1}", path, i - 1),
+                                            std::format("{0}.{1}", path, i),
+                                            error);
+                }
+                std::filesystem::rename(path, path + ".1", error);
+            }
+
+            file = std::fopen(path.c_str(), "w");
+            if (!file)
+            {
+                Append(LogLevel::Warning, SystemClock::now(), std::format("Could not open log file {0}", path));
+            }
+        }
+
+        void WriterLoop()
+        {
+            while (running.load(std::memory_order_acquire))
+            {
+                // read before draining so a message pushed in between ends the wait immediately
+                const uint32_t seen = pushed.load(std::memory_order_acquire);
+                LockSinks();
+                const size_t count = Drain();
+                UnlockSinks();
+                if (count < BatchSize)
+                {
+                    writerWaiting.store(true, std::memory_order_seq_cst);
+                    pushed.wait(seen, std::memory_order_seq_cst);
+                    writerWaiting.store(false, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void LockSinks()
+        {
+            while (sinksBusy.test_and_set(std::memory_order_acquire))
+            {
+                sinksBusy.wait(true, std::memory_order_relaxed);
+            }
+        }
+
+        void UnlockSinks()
+        {
+            sinksBusy.clear(std::memory_order_release);
+            sinksBusy.notify_one();
+        }
+
+        std::vector<LogMessage> messages;
+        alignas(64) std::atomic<size_t> enqueuePosition{0};
+        // the remaining state is only touched by whoever owns the sinks
+        alignas(64) size_t dequeuePosition = 0;
+        std::atomic<size_t> written{0};
+        std::atomic<uint32_t> pushed{0};
+        std::atomic<bool> writerWaiting{false};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> running{true};
+        std::atomic_flag sinksBusy;
+        std::thread writer;
+
+        LogProperties properties;
+        std::FILE *file = nullptr;
+        uint64_t fileBytes = 0;
+        std::string formatted;
+        std::string consoleBatch;
+        std::string fileBatch;
+    };
+
+    // never destroyed so static destructors can still log, Shutdown() at exit switches to synchronous writes
+    AsyncLogger &Logger()
+    {
+        static AsyncLogger *logger = []
+        {
+            AsyncLogger *instance = new AsyncLogger();
+            std::atexit([] { Logger().Shutdown(); });
+            return instance;
+        }();
+        return *logger;
+    }
+
+    std::terminate_handler previousTerminateHandler = nullptr;
+
+    void CrashSignalHandler(int signal)
+    {
+        Logger().CrashFlush();
+        std::signal(signal, SIG_DFL);
+        std::raise(signal);
+    }
+
+    void TerminateHandler()
+    {
+        Logger().CrashFlush();
+        if (previousTerminateHandler)
+        {
+            previousTerminateHandler();
+        }
+        std::abort();
+    }
+}
+
+/**
+ * Apply the properties and install the crash handlers that flush the queue, messages logged before are kept
+ *
+ * @param properties Sinks and severity threshold, the log file is rotated on every call
+ */
+void Log::Initialize(const LogProperties &properties)
+{
+    Logger().Configure(properties);
+    threshold.store(properties.Threshold, std::memory_order_relaxed);
+
+    static bool crashHandlersInstalled = false;
+    if (!crashHandlersInstalled)
+    {
+        crashHandlersInstalled = true;
+        for (const int signal : {SIGSEGV, SIGABRT, SIGFPE, SIGILL})
+        {
+            std::signal(signal, CrashSignalHandler);
+        }
+        previousTerminateHandler = std::set_terminate(TerminateHandler);
+    }
+}
+
+void Log::SetThreshold(LogLevel level)
+{
+    threshold.store(level, std::memory_order_relaxed);
+}
+
+void Log::Flush()
+{
+    Logger().Flush();
+}
+
+void Log::Shutdown()
+{
+    Logger().Shutdown();
+}
 
 void Log::Info(const std::string &text)
 {
-    ResetColor();
-    cout << text << endl;
+    Write(LogLevel::Info, text);
 }
 
 void Log::Warning(const std::string &text)
 {
-    SetColor(33);
-    cout << text << endl;
-    ResetColor();
+    Write(LogLevel::Warning, text);
 }
 
 void Log::Error(const std::string &text)
 {
-    SetColor(31);
-    cout << text << endl;
-    ResetColor();
+    Write(LogLevel::Error, text);
 }
 
 void Log::System(const std::string &text)
 {
-    SetColor(94);
-    cout << text << endl;
-    ResetColor();
+    Write(LogLevel::System, text);
+}
+
+void Log::Write(LogLevel level, const std::string &text)
+{
+    if (IsEnabled(level))
+    {
+        Logger().Push(level, text);
+    }
 }
 
-void Log::SetColor(int textColor)
+void Log::Push(LogLevel level, const LogRecord &record)
 {
-    cout << "\033[" << textColor << "m";
+    Logger().Push(level, record);
 }
 
-void Log::ResetColor()
+void Log::Push(LogLevel level, const std::string &text)
 {
-    cout << "\033[0m";
-}
\ No newline at end of file
+    Logger().Push(level, text);
+}
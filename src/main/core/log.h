@@ -1,14 +1,136 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <format>
 #include <string>
+#include <string_view>
 
+#include "log_record.h"
+
+enum class LogLevel : uint8_t
+{
+    Trace,
+    Info,
+    System,
+    Warning,
+    Error,
+};
+
+// messages below this level are removed at compile time, set through the VANADIUM_LOG_LEVEL CMake cache variable
+#ifndef VANADIUM_LOG_LEVEL
+#ifdef NDEBUG
+#define VANADIUM_LOG_LEVEL 1
+#else
+#define VANADIUM_LOG_LEVEL 0
+#endif
+#endif
+
+struct LogProperties
+{
+    // messages below the threshold are discarded on the calling thread
+    LogLevel Threshold = LogLevel::Info;
+    bool Console = true;
+    // empty disables the file sink
+    std::string FilePath;
+    uint64_t MaxFileBytes = 16 * 1024 * 1024;
+    // full files are kept as FilePath.1 (newest) up to FilePath.N
+    uint32_t MaxRotatedFiles = 3;
+};
+
+/**
+ * @brief Asynchronous logger, callers only enqueue and never wait for console or file I/O
+ *
+ * Messages go into a bounded lock-free multi producer queue that a background thread drains in batches, writing each
+ * batch to the console and the log file with one call per sink. A full queue drops messages and reports how many
+ * instead of blocking the producer. Crash signals and std::terminate flush whatever is still queued.
+ *
+ * The templated overloads take a std::format string and its arguments. The severity is checked before anything else,
+ * levels below VANADIUM_LOG_LEVEL compile to nothing, and the arguments are copied into a LogRecord so formatting
+ * happens on the logger thread. Arguments are still evaluated at the call site, keep them free of side effects.
+ * The std::string overloads log their text as is.
+ *
+ * Logging works before Initialize() with console output only.
+ */
 class Log
 {
 public:
+    static constexpr LogLevel CompiledLevel = static_cast<LogLevel>(VANADIUM_LOG_LEVEL);
+
+    static void Initialize(const LogProperties &properties);
+    static void SetThreshold(LogLevel level);
+    /** @brief Block until everything logged so far is written */
+    static void Flush();
+    /** @brief Flush and stop the background thread, later messages are written synchronously */
+    static void Shutdown();
+
+    [[nodiscard]] static bool IsEnabled(LogLevel level)
+    {
+        return level >= CompiledLevel && level >= threshold.load(std::memory_order_relaxed);
+    }
+
     static void Info(const std::string &text);
     static void Warning(const std::string &text);
     static void Error(const std::string &text);
     static void System(const std::string &text);
-    static void SetColor(int textColor);
-    static void ResetColor();
-};
\ No newline at end of file
+    static void Write(LogLevel level, const std::string &text);
+
+    template <typename... Args>
+    static void Trace(std::format_string<Args...> format, Args &&...args)
+    {
+        WriteDeferred<LogLevel::Trace>(format.get(), args...);
+    }
+
+    template <typename... Args>
+    static void Info(std::format_string<Args...> format, Args &&...args)
+    {
+        WriteDeferred<LogLevel::Info>(format.get(), args...);
+    }
+
+    template <typename... Args>
+    static void Warning(std::format_string<Args...> format, Args &&...args)
+    {
+        WriteDeferred<LogLevel::Warning>(format.get(), args...);
+    }
+
+    template <typename... Args>
+    static void Error(std::format_string<Args...> format, Args &&...args)
+    {
+        WriteDeferred<LogLevel::Error>(format.get(), args...);
+    }
+
+    template <typename... Args>
+    static void System(std::format_string<Args...> format, Args &&...args)
+    {
+        WriteDeferred<LogLevel::System>(format.get(), args...);
+    }
+
+private:
+    // the format string was checked against the arguments by the std::format_string of the public overloads
+    template <LogLevel Level, typename... Args>
+    static void WriteDeferred(std::string_view format, const Args &...args)
+    {
+        if constexpr (Level >= CompiledLevel)
+        {
+            if (!IsEnabled(Level))
+            {
+                return;
+            }
+            if constexpr (logrecord::Deferrable<Args...>)
+            {
+                LogRecord record;
+                if (logrecord::Encode(record, format, args...))
+                {
+                    Push(Level, record);
+                    return;
+                }
+            }
+            Push(Level, std::vformat(format, std::make_format_args(args...)));
+        }
+    }
+
+    static void Push(LogLevel level, const LogRecord &record);
+    static void Push(LogLevel level, const std::string &text);
+
+    static inline std::atomic<LogLevel> threshold{LogLevel::Info};
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// argument bytes a deferred message can carry, messages with more are formatted by the caller
+constexpr size_t LogRecordArgumentBytes = 192;
+
+/**
+ * @brief A log message whose arguments are captured as bytes and formatted later by the logger thread
+ *
+ * The format string is only referenced, std::format_string guarantees it is a constant with static storage.
+ */
+struct LogRecord
+{
+    using Formatter = void (*)(std::string &out, std::string_view format, const std::byte *arguments);
+
+    Formatter Format = nullptr;
+    std::string_view FormatString;
+    uint32_t ArgumentBytes = 0;
+    alignas(std::max_align_t) std::byte Arguments[LogRecordArgumentBytes];
+};
+
+/*
+ * Encoding of the captured arguments, each one aligned to its type:
+ *   strings (std::string, std::string_view, char pointers and arrays)   uint32_t length followed by the characters
+ *   trivially copyable values                                            the value's bytes
+ * Any other argument type makes the whole message fall back to formatting on the calling thread.
+ */
+namespace logrecord
+{
+    template <typename T>
+    using Stored = std::decay_t<std::remove_cvref_t<T>>;
+
+    template <typename T>
+    constexpr bool IsString = std::is_same_v<Stored<T>, std::string> || std::is_same_v<Stored<T>, std::string_view> ||
+                              std::is_same_v<Stored<T>, const char *> || std::is_same_v<Stored<T>, char *>;
+
+    template <typename T>
+    constexpr bool IsValue = !IsString<T> && std::is_trivially_copyable_v<Stored<T>> &&
+                             std::is_default_constructible_v<Stored<T>>;
+
+    template <typename... Args>
+    constexpr bool Deferrable = ((IsString<Args> || IsValue<Args>) && ...);
+
+    // what the logger thread passes to std::vformat_to in place of the original argument
+    template <typename T>
+    using Decoded = std::conditional_t<IsString<T>, std::string_view, Stored<T>>;
+
+    inline size_t Align(size_t offset, size_t alignment)
+    {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+
+    template <typename T>
+    bool EncodeArgument(std::byte *buffer, size_t &offset, const T &argument)
+    {
+        if constexpr (IsString<T>)
+        {
+            const std::string_view text(argument);
+            offset = Align(offset, alignof(uint32_t));
+            if (offset + sizeof(uint32_t) + text.size() > LogRecordArgumentBytes)
+            {
+                return false;
+            }
+            const uint32_t length = static_cast<uint32_t>(text.size());
+            std::memcpy(buffer + offset, &length, sizeof(length));
+            std::memcpy(buffer + offset + sizeof(length), text.data(), text.size());
+            offset += sizeof(length) + text.size();
+        }
+        else
+        {
+            offset = Align(offset, alignof(Stored<T>));
+            if (offset + sizeof(Stored<T>) > LogRecordArgumentBytes)
+            {
+                return false;
+            }
+            std::memcpy(buffer + offset, &argument, sizeof(Stored<T>));
+            offset += sizeof(Stored<T>);
+        }
+        return true;
+    }
+
+    template <typename T>
+    Decoded<T> DecodeArgument(const std::byte *buffer, size_t &offset)
+    {
+        if constexpr (IsString<T>)
+        {
+            offset = Align(offset, alignof(uint32_t));
+            uint32_t length;
+            std::memcpy(&length, buffer + offset, sizeof(length));
+            const std::string_view text(reinterpret_cast<const char *>(buffer + offset + sizeof(length)), length);
+            offset += sizeof(length) + length;
+            return text;
+        }
+        else
+        {
+            offset = Align(offset, alignof(Stored<T>));
+            Stored<T> value;
+            std::memcpy(&value, buffer + offset, sizeof(Stored<T>));
+            offset += sizeof(Stored<T>);
+            return value;
+        }
+    }
+
+    template <typename... Args>
+    void FormatRecord(std::string &out, std::string_view format, const std::byte *arguments)
+    {
+        size_t offset = 0;
+        // braced initialization decodes the arguments left to right
+        const std::tuple<Decoded<Args>...> values{DecodeArgument<Args>(arguments, offset)...};
+        std::apply([&](const auto &...value)
+                   { std::vformat_to(std::back_inserter(out), format, std::make_format_args(value...)); },
+                   values);
+    }
+
+    /**
+     * Capture the arguments of a message
+     *
+     * @return False if they do not fit into LogRecordArgumentBytes
+     */
+    template <typename... Args>
+    bool Encode(LogRecord &record, std::string_view format, const Args &...arguments)
+    {
+        size_t offset = 0;
+        if (!(EncodeArgument(record.Arguments, offset, arguments) && ...))
+        {
+            return false;
+        }
+        record.Format = &FormatRecord<Stored<Args>...>;
+        record.FormatString = format;
+        record.ArgumentBytes = static_cast<uint32_t>(offset);
+        return true;
+    }
+}
@@ -0,0 +1,231 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "log.h"
+
+namespace
+{
+    size_t PageSize()
+    {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    // page aligned start and length covering [offset, offset + length) clamped to the mapping, length 0 if empty
+    std::pair<size_t, size_t> PageRange(size_t offset, size_t length, size_t size)
+    {
+        static const size_t pageSize = PageSize();
+        if (offset >= size || length == 0)
+        {
+            return {0, 0};
+        }
+        const size_t end = offset + std::min(length, size - offset);
+        const size_t begin = offset & ~(pageSize - 1);
+        return {begin, end - begin};
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+        open = std::exchange(other.open, false);
+#if defined(_WIN32)
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+/**
+ * Map a file read only, a previously opened file is closed first
+ *
+ * @param path File to map
+ * @param access (Optional) Expected access pattern, passed on to the OS as a paging hint
+ *
+ * @return False if the file could not be opened or mapped, the error is logged
+ */
+bool MappedFile::Open(const std::string &path, MappedFileAccess access)
+{
+    Close();
+
+#if defined(_WIN32)
+    const DWORD flags = access == MappedFileAccess::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN
+                        : access == MappedFileAccess::Random   ? FILE_FLAG_RANDOM_ACCESS
+                                                               : FILE_ATTRIBUTE_NORMAL;
+    const HANDLE file =
+        CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        Log::Error("Could not open {0}", path);
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        Log::Error("Could not query the size of {0}", path);
+        return false;
+    }
+    fileHandle = file;
+    size = static_cast<size_t>(fileSize.QuadPart);
+    open = true;
+    if (size == 0)
+    {
+        return true;
+    }
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle)
+    {
+        data = static_cast<const uint8_t *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        Log::Error("Could not open {0}", path);
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        ::close(file);
+        Log::Error("Could not query the size of {0}", path);
+        return false;
+    }
+    size = static_cast<size_t>(status.st_size);
+    open = true;
+    if (size == 0)
+    {
+        ::close(file);
+        return true;
+    }
+
+    // the mapping keeps its own reference to the file
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (mapping != MAP_FAILED)
+    {
+        data = static_cast<const uint8_t *>(mapping);
+        const int advice = access == MappedFileAccess::Sequential ? MADV_SEQUENTIAL
+                           : access == MappedFileAccess::Random   ? MADV_RANDOM
+                                                                  : MADV_NORMAL;
+        madvise(mapping, size, advice);
+    }
+#endif
+
+    if (!data)
+    {
+        Log::Error("Could not map {0}", path);
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+    if (data)
+    {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle)
+    {
+        CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+    }
+    if (fileHandle)
+    {
+        CloseHandle(fileHandle);
+        fileHandle = nullptr;
+    }
+#else
+    if (data)
+    {
+        munmap(const_cast<uint8_t *>(data), size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    open = false;
+}
+
+/**
+ * Hint that a range is about to be read so the OS starts paging it in asynchronously, the call does not block
+ *
+ * @param offset Byte offset into the mapping, rounded down to a page boundary
+ * @param length Bytes to prefetch, clamped to the end of the file
+ */
+void MappedFile::Prefetch(size_t offset, size_t length) const
+{
+    const auto [begin, pageLength] = PageRange(offset, length, size);
+    if (!data || pageLength == 0)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<uint8_t *>(data + begin);
+    range.NumberOfBytes = pageLength;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    madvise(const_cast<uint8_t *>(data + begin), pageLength, MADV_WILLNEED);
+#endif
+}
+
+/**
+ * Hint that a range is not needed anymore so its pages can be reclaimed first, reading it again pages it back in
+ *
+ * @param offset Byte offset into the mapping, rounded down to a page boundary
+ * @param length Bytes to release, clamped to the end of the file
+ */
+void MappedFile::Evict(size_t offset, size_t length) const
+{
+    const auto [begin, pageLength] = PageRange(offset, length, size);
+    if (!data || pageLength == 0)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    // removes the pages from the working set, they stay in the standby list until the memory is needed elsewhere
+    VirtualUnlock(const_cast<uint8_t *>(data + begin), pageLength);
+#else
+    // the mapping is private and read only, dropping its pages never loses data
+    madvise(const_cast<uint8_t *>(data + begin), pageLength, MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class MappedFileAccess
+{
+    Normal,
+    // read front to back once, lets the OS read ahead aggressively and drop pages behind
+    Sequential,
+    Random,
+};
+
+/**
+ * @brief Read only memory mapping of a whole file
+ * @note Empty files open successfully with a null Data()
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    bool Open(const std::string &path, MappedFileAccess access = MappedFileAccess::Normal);
+    void Close();
+
+    void Prefetch(size_t offset, size_t length) const;
+    void Evict(size_t offset, size_t length) const;
+
+    [[nodiscard]] bool IsOpen() const
+    {
+        return open;
+    }
+
+    [[nodiscard]] const uint8_t *Data() const
+    {
+        return data;
+    }
+
+    [[nodiscard]] size_t Size() const
+    {
+        return size;
+    }
+
+private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    bool open = false;
+#if defined(_WIN32)
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
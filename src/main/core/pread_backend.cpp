@@ -0,0 +1,167 @@
+#include "io_backend.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "profiler.h"
+
+namespace
+{
+    // bytes read or the negated errno, a single read that may return short like pread itself
+    int64_t ReadAt(const IoBackendRead &read)
+    {
+#if defined(_WIN32)
+        // the offset in the OVERLAPPED positions the read on a synchronous handle as well
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(read.Offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(read.Offset >> 32);
+        DWORD bytesRead = 0;
+        if (!ReadFile(reinterpret_cast<HANDLE>(read.File), read.Destination, read.Size, &bytesRead, &overlapped))
+        {
+            return GetLastError() == ERROR_HANDLE_EOF ? 0 : -EIO;
+        }
+        return bytesRead;
+#else
+        while (true)
+        {
+            const ssize_t result =
+                pread(static_cast<int>(read.File), read.Destination, read.Size, static_cast<off_t>(read.Offset));
+            if (result >= 0)
+            {
+                return result;
+            }
+            if (errno != EINTR)
+            {
+                return -errno;
+            }
+        }
+#endif
+    }
+
+    /** @brief Fallback backend, every thread blocks in one read at a time and takes visible reads first */
+    class ThreadPoolBackend final : public IIoBackend
+    {
+    public:
+        explicit ThreadPoolBackend(uint32_t threadCount)
+        {
+            for (uint32_t i = 0; i < threadCount; i++)
+            {
+                threads.emplace_back(&ThreadPoolBackend::WorkerLoop, this, i);
+            }
+        }
+
+        ~ThreadPoolBackend() override
+        {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            workCondition.notify_all();
+            for (std::thread &thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        // pread takes any destination, there is nothing to register
+        bool RegisterBuffer(void *, size_t) override
+        {
+            return true;
+        }
+
+        void Submit(std::span<const IoBackendRead> reads) override
+        {
+            {
+                std::lock_guard lock(mutex);
+                for (const IoBackendRead &read : reads)
+                {
+                    queues[static_cast<size_t>(read.Priority)].push_back(read);
+                }
+            }
+            workCondition.notify_all();
+        }
+
+        // only reads no thread picked up yet can be cancelled
+        void Cancel(IoHandle handle) override
+        {
+            std::lock_guard lock(mutex);
+            for (std::deque<IoBackendRead> &queue : queues)
+            {
+                const auto it = std::find_if(
+                    queue.begin(), queue.end(), [&](const IoBackendRead &read) { return read.Handle == handle; });
+                if (it != queue.end())
+                {
+                    queue.erase(it);
+                    finished.push_back({handle, -ECANCELED});
+                    resultCondition.notify_one();
+                    return;
+                }
+            }
+        }
+
+        void Reap(std::vector<IoBackendResult> &results, bool wait) override
+        {
+            std::unique_lock lock(mutex);
+            if (wait)
+            {
+                resultCondition.wait(lock, [&] { return !finished.empty(); });
+            }
+            results.insert(results.end(), finished.begin(), finished.end());
+            finished.clear();
+        }
+
+    private:
+        void WorkerLoop(uint32_t index)
+        {
+            VANADIUM_PROFILE_THREAD(std::format("IO {0}", index + 1));
+            while (true)
+            {
+                IoBackendRead read;
+                {
+                    std::unique_lock lock(mutex);
+                    workCondition.wait(lock, [&] { return stopping || !queues[0].empty() || !queues[1].empty(); });
+                    if (stopping)
+                    {
+                        return;
+                    }
+                    std::deque<IoBackendRead> &queue = !queues[0].empty() ? queues[0] : queues[1];
+                    read = queue.front();
+                    queue.pop_front();
+                }
+
+                const int64_t result = ReadAt(read);
+                {
+                    std::lock_guard lock(mutex);
+                    finished.push_back({read.Handle, result});
+                }
+                resultCondition.notify_one();
+            }
+        }
+
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable workCondition;
+        std::condition_variable resultCondition;
+        // indexed by IoPriority
+        std::deque<IoBackendRead> queues[2];
+        std::vector<IoBackendResult> finished;
+        bool stopping = false;
+    };
+}
+
+std::unique_ptr<IIoBackend> CreateThreadPoolBackend(const AsyncIoProperties &properties)
+{
+    return std::make_unique<ThreadPoolBackend>(properties.ThreadCount);
+}
@@ -0,0 +1,253 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "log.h"
+
+namespace
+{
+    // zones a thread can record between two Collect() calls before it starts dropping
+    constexpr uint64_t RingCapacity = 1 << 15;
+    // bounds the memory of a forgotten capture, roughly 100 MB
+    constexpr size_t MaxCapturedZones = 1 << 22;
+
+    struct ZoneEvent
+    {
+        const char *name;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    // written by its owning thread only, drained by the collector
+    struct ThreadRing
+    {
+        std::vector<ZoneEvent> events = std::vector<ZoneEvent>(RingCapacity);
+        alignas(64) std::atomic<uint64_t> head{0};
+        // producer side copy of tail, only refreshed when the ring looks full
+        uint64_t cachedTail = 0;
+        std::atomic<uint64_t> dropped{0};
+        alignas(64) std::atomic<uint64_t> tail{0};
+
+        // guarded by registryMutex
+        uint32_t threadId = 0;
+        std::string threadName;
+    };
+
+    struct CapturedZone
+    {
+        const char *name;
+        uint32_t threadId;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    thread_local ThreadRing *threadRing = nullptr;
+
+    std::atomic<bool> capturing{false};
+    // only touched by the collecting thread
+    std::vector<CapturedZone> captured;
+    uint64_t captureStartTick = 0;
+    std::chrono::steady_clock::time_point captureStartTime;
+    uint64_t droppedTotal = 0;
+    bool captureOverflowed = false;
+
+    ThreadRing &GetThreadRing()
+    {
+        if (!threadRing)
+        {
+            auto ring = std::make_unique<ThreadRing>();
+            std::lock_guard lock(registryMutex);
+            ring->threadId = static_cast<uint32_t>(rings.size()) + 1;
+            ring->threadName = std::format("Thread {0}", ring->threadId);
+            threadRing = ring.get();
+            rings.push_back(std::move(ring));
+        }
+        return *threadRing;
+    }
+
+    std::string EscapeJson(const char *text)
+    {
+        std::string escaped;
+        for (; *text; text++)
+        {
+            if (*text == '"' || *text == '\\')
+            {
+                escaped.push_back('\\');
+            }
+            escaped.push_back(static_cast<unsigned char>(*text) < 0x20 ? ' ' : *text);
+        }
+        return escaped;
+    }
+}
+
+namespace Profiler
+{
+    /**
+     * Append a zone to the ring of the calling thread, never blocks
+     */
+    void RecordZone(const char *name, uint64_t begin, uint64_t end)
+    {
+        ThreadRing &ring = GetThreadRing();
+        const uint64_t head = ring.head.load(std::memory_order_relaxed);
+        if (head - ring.cachedTail >= RingCapacity)
+        {
+            ring.cachedTail = ring.tail.load(std::memory_order_acquire);
+            if (head - ring.cachedTail >= RingCapacity)
+            {
+                ring.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        ring.events[head & (RingCapacity - 1)] = {name, begin, end};
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * Name the calling thread in exported traces
+     */
+    void SetThreadName(const std::string &name)
+    {
+        ThreadRing &ring = GetThreadRing();
+        std::lock_guard lock(registryMutex);
+        ring.threadName = name;
+    }
+
+    /**
+     * Drain the rings of all threads, has to be called regularly (once per frame) from a single thread
+     */
+    void Collect()
+    {
+        const bool keep = capturing.load(std::memory_order_relaxed);
+        uint64_t dropped = 0;
+
+        std::lock_guard lock(registryMutex);
+        for (const std::unique_ptr<ThreadRing> &ring : rings)
+        {
+            const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            if (keep)
+            {
+                for (uint64_t i = tail; i < head; i++)
+                {
+                    if (captured.size() >= MaxCapturedZones)
+                    {
+                        captureOverflowed = true;
+                        break;
+                    }
+                    const ZoneEvent &event = ring->events[i & (RingCapacity - 1)];
+                    captured.push_back({event.name, ring->threadId, event.begin, event.end});
+                }
+            }
+            ring->tail.store(head, std::memory_order_release);
+            dropped += ring->dropped.load(std::memory_order_relaxed);
+        }
+
+        if (keep && dropped > droppedTotal)
+        {
+            Log::Warning("Profiler dropped {0} zones, collect more often or record fewer zones",
+                         dropped - droppedTotal);
+        }
+        droppedTotal = dropped;
+    }
+
+    /**
+     * Start keeping collected zones, everything recorded before is discarded
+     */
+    void BeginCapture()
+    {
+        Collect();
+        captured.clear();
+        captureOverflowed = false;
+        captureStartTick = Now();
+        captureStartTime = std::chrono::steady_clock::now();
+        capturing.store(true, std::memory_order_relaxed);
+    }
+
+    /**
+     * Stop the capture and write it as Chrome trace event JSON
+     *
+     * @param path Output file, open it in chrome://tracing or ui.perfetto.dev
+     *
+     * @return False if there was no capture running or the file could not be written
+     */
+    bool EndCapture(const std::string &path)
+    {
+        if (!capturing.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        Collect();
+        capturing.store(false, std::memory_order_relaxed);
+
+        // ticks are calibrated against steady_clock over the whole capture
+        const uint64_t endTick = Now();
+        const double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                                                                           captureStartTime)
+                                     .count();
+        const double usPerTick = endTick > captureStartTick
+                                     ? elapsedUs / static_cast<double>(endTick - captureStartTick)
+                                     : 0.0;
+
+        std::ofstream file(path);
+        if (!file)
+        {
+            Log::Error("Failed to write profiler capture to {0}", path);
+            captured.clear();
+            return false;
+        }
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        {
+            std::lock_guard lock(registryMutex);
+            for (const std::unique_ptr<ThreadRing> &ring : rings)
+            {
+                file << std::format("{0}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{1},"
+                                    "\"args\":{{\"name\":\"{2}\"}}}}",
+                                    first ? "" : ",\n",
+                                    ring->threadId,
+                                    EscapeJson(ring->threadName.c_str()));
+                first = false;
+            }
+        }
+        for (const CapturedZone &zone : captured)
+        {
+            // zones that started before the capture are clamped to its start
+            const uint64_t begin = std::max(zone.begin, captureStartTick);
+            const uint64_t end = std::max(zone.end, begin);
+            file << std::format("{0}{{\"name\":\"{1}\",\"ph\":\"X\",\"pid\":1,\"tid\":{2},\"ts\":{3:.3f},"
+                                "\"dur\":{4:.3f}}}",
+                                first ? "" : ",\n",
+                                EscapeJson(zone.name),
+                                zone.threadId,
+                                static_cast<double>(begin - captureStartTick) * usPerTick,
+                                static_cast<double>(end - begin) * usPerTick);
+            first = false;
+        }
+        file << "\n]}\n";
+
+        if (captureOverflowed)
+        {
+            Log::Warning("Profiler capture was cut off after {0} zones", MaxCapturedZones);
+        }
+        Log::System("Wrote {0} profiler zones to {1}", captured.size(), path);
+        captured.clear();
+        captured.shrink_to_fit();
+        return static_cast<bool>(file);
+    }
+
+    bool IsCapturing()
+    {
+        return capturing.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/**
+ * @brief CPU zone profiler with per thread lock-free buffers and Chrome trace export
+ *
+ * A zone records its begin and end tick into a single producer / single consumer ring owned by the calling thread,
+ * nothing is shared between producers. Collect() drains every ring once per frame; while a capture is running the
+ * drained zones are kept and EndCapture() writes them as Chrome trace event JSON (chrome://tracing, Perfetto UI).
+ * Zones that do not fit into a full ring are dropped and counted instead of blocking the producer.
+ *
+ * The VANADIUM_ZONE macros only exist with the VANADIUM_PROFILING CMake option, otherwise they compile to nothing.
+ * Zone names have to be string literals or otherwise outlive the capture, only the pointer is stored.
+ */
+namespace Profiler
+{
+    // rdtsc where available (invariant TSC assumed), steady_clock ticks otherwise; converted at export
+    inline uint64_t Now()
+    {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    void RecordZone(const char *name, uint64_t begin, uint64_t end);
+    void SetThreadName(const std::string &name);
+
+    void Collect();
+    void BeginCapture();
+    bool EndCapture(const std::string &path);
+    [[nodiscard]] bool IsCapturing();
+
+    /** @brief Records the time between construction and destruction as one zone */
+    class Zone
+    {
+    public:
+        explicit Zone(const char *name)
+            : name(name),
+              begin(Now())
+        {
+        }
+
+        ~Zone()
+        {
+            RecordZone(name, begin, Now());
+        }
+
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        const char *name;
+        uint64_t begin;
+    };
+}
+
+#ifdef VANADIUM_PROFILING
+#define VANADIUM_PROFILER_CONCAT_INNER(a, b) a##b
+#define VANADIUM_PROFILER_CONCAT(a, b) VANADIUM_PROFILER_CONCAT_INNER(a, b)
+#define VANADIUM_ZONE(name) const Profiler::Zone VANADIUM_PROFILER_CONCAT(profilerZone, __LINE__)(name)
+#define VANADIUM_ZONE_FUNCTION() VANADIUM_ZONE(__func__)
+#define VANADIUM_PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#define VANADIUM_PROFILE_FRAME() Profiler::Collect()
+#else
+#define VANADIUM_ZONE(name) ((void)0)
+#define VANADIUM_ZONE_FUNCTION() ((void)0)
+#define VANADIUM_PROFILE_THREAD(name) ((void)0)
+#define VANADIUM_PROFILE_FRAME() ((void)0)
+#endif
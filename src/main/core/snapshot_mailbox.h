@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Hands the latest value from one producer thread to one consumer thread without either side waiting
+ *
+ * One slot is being written, one is being read and the third holds the latest published value; Publish() and
+ * Acquire() swap their slot with the shared one. The producer can publish any number of times while the consumer
+ * holds on to a value, intermediate values are simply replaced.
+ */
+template <typename T>
+class SnapshotMailbox
+{
+public:
+    /** @brief Producer only, makes value the latest one */
+    void Publish(const T &value)
+    {
+        slots[writeIndex] = value;
+        const uint32_t previous = shared.exchange(writeIndex | FreshBit, std::memory_order_acq_rel);
+        writeIndex = previous & IndexMask;
+    }
+
+    /** @brief Consumer only, moves the latest value into Latest(), returns false if nothing was published since */
+    bool Acquire()
+    {
+        if ((shared.load(std::memory_order_relaxed) & FreshBit) == 0)
+        {
+            return false;
+        }
+        const uint32_t previous = shared.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & IndexMask;
+        return true;
+    }
+
+    /** @brief Consumer only, value taken by the last successful Acquire(), default constructed before that */
+    [[nodiscard]] const T &Latest() const
+    {
+        return slots[readIndex];
+    }
+
+private:
+    static constexpr uint32_t IndexMask = 3;
+    // set while the shared slot holds a value the consumer has not taken yet
+    static constexpr uint32_t FreshBit = 4;
+
+    std::array<T, 3> slots{};
+    alignas(64) std::atomic<uint32_t> shared{1};
+    alignas(64) uint32_t writeIndex = 0;
+    alignas(64) uint32_t readIndex = 2;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer thread and one consumer thread
+ *
+ * Each side only writes its own index and keeps a cached copy of the other one, so the shared cache lines are only
+ * touched when the queue looks full or empty. A full queue rejects the push instead of blocking the producer.
+ */
+template <typename T, uint32_t Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+public:
+    /** @brief Producer only, returns false if the queue is full */
+    bool TryPush(const T &value)
+    {
+        const uint64_t position = head.load(std::memory_order_relaxed);
+        if (position - cachedTail >= Capacity)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position - cachedTail >= Capacity)
+            {
+                return false;
+            }
+        }
+        slots[position & (Capacity - 1)] = value;
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Consumer only, returns false if the queue is empty */
+    bool TryPop(T &value)
+    {
+        const uint64_t position = tail.load(std::memory_order_relaxed);
+        if (position == cachedHead)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position == cachedHead)
+            {
+                return false;
+            }
+        }
+        value = slots[position & (Capacity - 1)];
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> slots{};
+    alignas(64) std::atomic<uint64_t> head{0};
+    // producer side copy of tail
+    uint64_t cachedTail = 0;
+    alignas(64) std::atomic<uint64_t> tail{0};
+    // consumer side copy of head
+    uint64_t cachedHead = 0;
+};
@@ -0,0 +1,199 @@
+#include "startup_graph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <thread>
+
+#include "log.h"
+#include "profiler.h"
+
+namespace
+{
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+/**
+ * Add a phase to the graph
+ *
+ * @param name Name used for the timing breakdown and profiler zone, has to outlive the graph
+ * @param phase Callback returning whether the phase succeeded
+ * @param dependencies (Optional) Phases that have to succeed before this one starts
+ * @param thread (Optional) Thread the phase is allowed to run on
+ *
+ * @return Id other phases use to depend on this one
+ */
+StartupGraph::PhaseId StartupGraph::Add(const char *name,
+                                        Phase phase,
+                                        std::initializer_list<PhaseId> dependencies,
+                                        StartupThread thread)
+{
+    const PhaseId id = static_cast<PhaseId>(nodes.size());
+
+    Node node;
+    node.Function = std::move(phase);
+    node.Thread = thread;
+    node.DependencyCount = static_cast<uint32_t>(dependencies.size());
+    for (const PhaseId dependency : dependencies)
+    {
+        // only earlier phases can be named, which keeps the graph acyclic
+        assert(dependency < id);
+        nodes[dependency].Dependents.push_back(id);
+    }
+    nodes.push_back(std::move(node));
+
+    StartupPhaseTiming timing;
+    timing.Name = name;
+    timings.push_back(timing);
+    return id;
+}
+
+/**
+ * Run every phase once dependencies allow, returns when all phases have finished or were skipped
+ *
+ * @param threadCount (Optional) Total number of threads including the caller, 0 starts one worker per phase that can
+ * run on a worker. Phases mostly wait on the driver, the OS or the disk, so this is not capped by the core count.
+ *
+ * @return False if any phase failed or was skipped
+ */
+bool StartupGraph::Run(uint32_t threadCount)
+{
+    runStart = std::chrono::steady_clock::now();
+    finishedCount = 0;
+    readyAny.clear();
+    readyCaller.clear();
+
+    uint32_t anyPhases = 0;
+    for (PhaseId id = 0; id < nodes.size(); id++)
+    {
+        Node &node = nodes[id];
+        node.Remaining = node.DependencyCount;
+        node.DependencyFailed = false;
+        timings[id] = StartupPhaseTiming{timings[id].Name};
+        if (node.Thread == StartupThread::Any)
+        {
+            anyPhases++;
+        }
+        if (node.Remaining == 0)
+        {
+            (node.Thread == StartupThread::Caller ? readyCaller : readyAny).push_back(id);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    const uint32_t workerCount = threadCount == 0 ? anyPhases : std::min(threadCount - 1, anyPhases);
+    workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(
+            [this, i]
+            {
+                VANADIUM_PROFILE_THREAD(std::format("Startup {0}", i + 1));
+                RunPhases(false);
+            });
+    }
+
+    RunPhases(true);
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    totalMs = MillisecondsSince(runStart);
+    return std::ranges::all_of(timings, [](const StartupPhaseTiming &timing) { return timing.Succeeded; });
+}
+
+void StartupGraph::RunPhases(bool caller)
+{
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        wakeCondition.wait(lock,
+                           [&]
+                           {
+                               return finishedCount == nodes.size() || !readyAny.empty() ||
+                                      (caller && !readyCaller.empty());
+                           });
+        if (finishedCount == nodes.size())
+        {
+            return;
+        }
+
+        // the caller serves its own queue first, nobody else can
+        std::deque<PhaseId> &queue = caller && !readyCaller.empty() ? readyCaller : readyAny;
+        const PhaseId id = queue.front();
+        queue.pop_front();
+        lock.unlock();
+
+        StartupPhaseTiming &timing = timings[id];
+        timing.StartMs = MillisecondsSince(runStart);
+        bool succeeded;
+        {
+            VANADIUM_ZONE(timing.Name);
+            succeeded = nodes[id].Function();
+        }
+        timing.DurationMs = MillisecondsSince(runStart) - timing.StartMs;
+
+        lock.lock();
+        Finish(id, succeeded);
+        wakeCondition.notify_all();
+    }
+}
+
+void StartupGraph::Finish(PhaseId id, bool succeeded)
+{
+    timings[id].Succeeded = succeeded;
+    finishedCount++;
+
+    for (const PhaseId dependentId : nodes[id].Dependents)
+    {
+        Node &dependent = nodes[dependentId];
+        dependent.DependencyFailed |= !succeeded;
+        if (--dependent.Remaining > 0)
+        {
+            continue;
+        }
+        if (dependent.DependencyFailed)
+        {
+            timings[dependentId].Skipped = true;
+            Finish(dependentId, false);
+        }
+        else
+        {
+            (dependent.Thread == StartupThread::Caller ? readyCaller : readyAny).push_back(dependentId);
+        }
+    }
+}
+
+/**
+ * Log when each phase of the last Run() started and how long it took. The sum of the phase durations is what running
+ * them one after another would roughly have cost.
+ */
+void StartupGraph::LogTimings() const
+{
+    double phaseSumMs = 0.0;
+    for (const StartupPhaseTiming &timing : timings)
+    {
+        phaseSumMs += timing.DurationMs;
+    }
+    Log::System("Startup took {0:.1f} ms, {1:.1f} ms of phases", totalMs, phaseSumMs);
+
+    for (const StartupPhaseTiming &timing : timings)
+    {
+        if (timing.Skipped)
+        {
+            Log::Warning("    {0:<24} skipped, a dependency failed", timing.Name);
+        }
+        else if (!timing.Succeeded)
+        {
+            Log::Warning("    {0:<24} failed after {1:.2f} ms", timing.Name, timing.DurationMs);
+        }
+        else
+        {
+            Log::System("    {0:<24} {1:8.2f} ms at {2:8.2f} ms", timing.Name, timing.DurationMs, timing.StartMs);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <vector>
+
+enum class StartupThread
+{
+    // any worker, or the calling thread while it has nothing else to do
+    Any,
+    // only the thread calling Run(), for APIs with thread affinity such as window creation
+    Caller,
+};
+
+struct StartupPhaseTiming
+{
+    const char *Name = nullptr;
+    // milliseconds since Run() started
+    double StartMs = 0.0;
+    double DurationMs = 0.0;
+    // false if the phase failed or was skipped because a dependency failed
+    bool Succeeded = false;
+    bool Skipped = false;
+};
+
+/**
+ * @brief Runs one-shot initialization phases as a dependency graph on short lived worker threads
+ *
+ * A phase starts once every phase it depends on has succeeded; phases that depend on a failed phase are skipped.
+ * Dependencies can only name phases added before, so the graph is acyclic by construction. Run() records when each
+ * phase started and how long it took, LogTimings() prints the breakdown.
+ *
+ * Phase names have to be string literals or otherwise outlive the graph, they are also used as profiler zone names.
+ */
+class StartupGraph
+{
+public:
+    using PhaseId = uint32_t;
+    using Phase = std::function<bool()>;
+
+    PhaseId Add(const char *name,
+                Phase phase,
+                std::initializer_list<PhaseId> dependencies = {},
+                StartupThread thread = StartupThread::Any);
+
+    bool Run(uint32_t threadCount = 0);
+    void LogTimings() const;
+
+    [[nodiscard]] const std::vector<StartupPhaseTiming> &GetTimings() const
+    {
+        return timings;
+    }
+
+    [[nodiscard]] double GetTotalMs() const
+    {
+        return totalMs;
+    }
+
+private:
+    struct Node
+    {
+        Phase Function;
+        StartupThread Thread = StartupThread::Any;
+        std::vector<PhaseId> Dependents;
+        uint32_t DependencyCount = 0;
+        // dependencies not finished yet, reset by Run()
+        uint32_t Remaining = 0;
+        bool DependencyFailed = false;
+    };
+
+    void RunPhases(bool caller);
+    // called with the mutex held
+    void Finish(PhaseId id, bool succeeded);
+
+    std::vector<Node> nodes;
+    std::vector<StartupPhaseTiming> timings;
+    double totalMs = 0.0;
+
+    // state of the current Run()
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::deque<PhaseId> readyAny;
+    std::deque<PhaseId> readyCaller;
+    uint32_t finishedCount = 0;
+    std::chrono::steady_clock::time_point runStart;
+};
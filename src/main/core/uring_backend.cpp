@@ -0,0 +1,304 @@
+#include "io_backend.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+#include "log.h"
+
+namespace
+{
+    // user data of cancel requests, their own completions are dropped
+    constexpr uint64_t CancelTag = 1ull << 63;
+
+    // IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, level), level 0 is served first by schedulers that honor it
+    constexpr uint16_t VisibleIoPriority = (2 << 13) | 0;
+    constexpr uint16_t PrefetchIoPriority = (2 << 13) | 7;
+
+    // raw system calls, so the engine does not depend on liburing
+    int Setup(uint32_t entries, io_uring_params &params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    }
+
+    int Enter(int ring, uint32_t submit, uint32_t minComplete, uint32_t flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ring, submit, minComplete, flags, nullptr, 0));
+    }
+
+    int Register(int ring, uint32_t opcode, const void *argument, uint32_t count)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, ring, opcode, argument, count));
+    }
+
+    /**
+     * @brief io_uring backend, submission and completion rings are shared with the kernel through mmap
+     *
+     * Only the owning thread touches the rings: the submission tail is published with a release store before
+     * io_uring_enter and the completion tail written by the kernel is read with an acquire load.
+     */
+    class UringBackend final : public IIoBackend
+    {
+    public:
+        ~UringBackend() override
+        {
+            if (sqes)
+            {
+                munmap(sqes, sqesSize);
+            }
+            if (cqRing && cqRing != sqRing)
+            {
+                munmap(cqRing, cqRingSize);
+            }
+            if (sqRing)
+            {
+                munmap(sqRing, sqRingSize);
+            }
+            if (ring >= 0)
+            {
+                // also drops the registered buffer
+                close(ring);
+            }
+        }
+
+        bool Initialize(uint32_t entries)
+        {
+            io_uring_params params{};
+            ring = Setup(entries, params);
+            if (ring < 0)
+            {
+                Log::Info("io_uring is not available: {0}", std::strerror(errno));
+                return false;
+            }
+
+            // IORING_OP_READ and the probe itself need Linux 5.6
+            std::vector<uint8_t> probeStorage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+            io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(probeStorage.data());
+            if (Register(ring, IORING_REGISTER_PROBE, probe, 256) < 0 || probe->last_op < IORING_OP_READ ||
+                !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED))
+            {
+                Log::Info("io_uring does not support IORING_OP_READ");
+                return false;
+            }
+
+            sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+            cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const bool singleMapping = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (singleMapping)
+            {
+                sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+            }
+
+            sqRing = Map(sqRingSize, IORING_OFF_SQ_RING);
+            cqRing = singleMapping ? sqRing : Map(cqRingSize, IORING_OFF_CQ_RING);
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = reinterpret_cast<io_uring_sqe *>(Map(sqesSize, IORING_OFF_SQES));
+            if (!sqRing || !cqRing || !sqes)
+            {
+                Log::Warning("Could not map the io_uring rings: {0}", std::strerror(errno));
+                return false;
+            }
+
+            sqHead = reinterpret_cast<uint32_t *>(sqRing + params.sq_off.head);
+            sqTail = reinterpret_cast<uint32_t *>(sqRing + params.sq_off.tail);
+            sqArray = reinterpret_cast<uint32_t *>(sqRing + params.sq_off.array);
+            sqMask = *reinterpret_cast<uint32_t *>(sqRing + params.sq_off.ring_mask);
+            sqEntries = params.sq_entries;
+            sqLocalTail = *sqTail;
+            cqHead = reinterpret_cast<uint32_t *>(cqRing + params.cq_off.head);
+            cqTail = reinterpret_cast<uint32_t *>(cqRing + params.cq_off.tail);
+            cqMask = *reinterpret_cast<uint32_t *>(cqRing + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe *>(cqRing + params.cq_off.cqes);
+            return true;
+        }
+
+        bool RegisterBuffer(void *memory, size_t size) override
+        {
+            if (registered)
+            {
+                Register(ring, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+                registered = false;
+            }
+
+            // pins the pages once, counts against RLIMIT_MEMLOCK and fails for mappings that cannot be pinned
+            const iovec buffer{memory, size};
+            if (Register(ring, IORING_REGISTER_BUFFERS, &buffer, 1) < 0)
+            {
+                Log::Warning("Could not register {0} KiB for fixed reads: {1}", size / 1024, std::strerror(errno));
+                return false;
+            }
+            registered = true;
+            return true;
+        }
+
+        void Submit(std::span<const IoBackendRead> reads) override
+        {
+            for (const IoBackendRead &read : reads)
+            {
+                io_uring_sqe *entry = NextSqe();
+                if (!entry)
+                {
+                    overflow.push_back({read.Handle, -EBUSY});
+                    continue;
+                }
+                io_uring_sqe &sqe = *entry;
+                sqe.opcode = read.Registered && registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+                sqe.fd = static_cast<int>(read.File);
+                sqe.off = read.Offset;
+                sqe.addr = reinterpret_cast<uint64_t>(read.Destination);
+                sqe.len = read.Size;
+                sqe.buf_index = 0;
+                sqe.ioprio = read.Priority == IoPriority::Visible ? VisibleIoPriority : PrefetchIoPriority;
+                sqe.user_data = read.Handle;
+            }
+            Flush();
+        }
+
+        void Cancel(IoHandle handle) override
+        {
+            io_uring_sqe *sqe = NextSqe();
+            if (sqe)
+            {
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = -1;
+                sqe->addr = handle;
+                sqe->user_data = CancelTag;
+                Flush();
+            }
+        }
+
+        void Reap(std::vector<IoBackendResult> &results, bool wait) override
+        {
+            const size_t first = results.size();
+            results.insert(results.end(), overflow.begin(), overflow.end());
+            overflow.clear();
+            Drain(results);
+            while (wait && results.size() == first)
+            {
+                if (Enter(ring, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+                {
+                    Log::Error("io_uring_enter failed: {0}", std::strerror(errno));
+                    return;
+                }
+                Drain(results);
+            }
+        }
+
+    private:
+        uint8_t *Map(size_t size, uint64_t offset) const
+        {
+            void *mapping = mmap(
+                nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, static_cast<off_t>(offset));
+            return mapping == MAP_FAILED ? nullptr : static_cast<uint8_t *>(mapping);
+        }
+
+        // the submission queue is only full if an earlier io_uring_enter failed, nullptr if submitting fails again
+        io_uring_sqe *NextSqe()
+        {
+            if (sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries)
+            {
+                Flush();
+                if (sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries)
+                {
+                    return nullptr;
+                }
+            }
+            const uint32_t index = sqLocalTail & sqMask;
+            sqArray[index] = index;
+            sqLocalTail++;
+            unsubmitted++;
+            std::memset(&sqes[index], 0, sizeof(io_uring_sqe));
+            return &sqes[index];
+        }
+
+        void Flush()
+        {
+            __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+            while (unsubmitted > 0)
+            {
+                const int submitted = Enter(ring, unsubmitted, 0, 0);
+                if (submitted >= 0)
+                {
+                    unsubmitted -= std::min<uint32_t>(unsubmitted, static_cast<uint32_t>(submitted));
+                }
+                else if (errno == EBUSY || errno == EAGAIN)
+                {
+                    // the completion queue is backed up, move completions aside until Reap() returns them
+                    Drain(overflow);
+                }
+                else if (errno != EINTR)
+                {
+                    Log::Error("io_uring_enter failed: {0}", std::strerror(errno));
+                    return;
+                }
+            }
+        }
+
+        void Drain(std::vector<IoBackendResult> &results)
+        {
+            uint32_t head = *cqHead;
+            const uint32_t tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++)
+            {
+                const io_uring_cqe &cqe = cqes[head & cqMask];
+                if (cqe.user_data != CancelTag)
+                {
+                    results.push_back({cqe.user_data, cqe.res});
+                }
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+
+        int ring = -1;
+        uint8_t *sqRing = nullptr;
+        size_t sqRingSize = 0;
+        uint8_t *cqRing = nullptr;
+        size_t cqRingSize = 0;
+        io_uring_sqe *sqes = nullptr;
+        size_t sqesSize = 0;
+
+        uint32_t *sqHead = nullptr;
+        uint32_t *sqTail = nullptr;
+        uint32_t *sqArray = nullptr;
+        uint32_t sqMask = 0;
+        uint32_t sqEntries = 0;
+        uint32_t sqLocalTail = 0;
+        uint32_t unsubmitted = 0;
+
+        uint32_t *cqHead = nullptr;
+        uint32_t *cqTail = nullptr;
+        uint32_t cqMask = 0;
+        io_uring_cqe *cqes = nullptr;
+
+        std::vector<IoBackendResult> overflow;
+        bool registered = false;
+    };
+}
+
+std::unique_ptr<IIoBackend> CreateUringBackend(const AsyncIoProperties &properties)
+{
+    // reads in flight plus one cancel request for each of them
+    auto backend = std::make_unique<UringBackend>();
+    if (!backend->Initialize(properties.QueueDepth * 2))
+    {
+        return nullptr;
+    }
+    return backend;
+}
+
+#else
+
+std::unique_ptr<IIoBackend> CreateUringBackend(const AsyncIoProperties &)
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Baked mesh files (.vmesh) are written by vanadium_bake and uploaded by the MeshLoader without any processing:
+ *
+ *   BakedMeshHeader
+ *   BakedMeshRecord[MeshCount]
+ *   BakedPrimitive[PrimitiveCount]
+ *   mesh names, not terminated
+ *   data block at DataOffset: vertices and indices of every primitive, each range aligned to BakedMeshAlignment
+ *
+ * Offsets in BakedPrimitive are relative to the data block, which is copied into the geometry buffer as a whole.
+ * Vertices are interleaved with BakedPrimitive::VertexStride:
+ *
+ *   position  R32G32B32_SFLOAT, or R16G16B16A16_UNORM with BakedPrimitiveQuantizedPositions, decoded as
+ *             PositionOffset + PositionScale * value
+ *   normal    R16G16_SNORM octahedral
+ *   tangent   R8G8B8A8_SNORM, xy octahedral direction, z bitangent sign
+ *   texcoord  R16G16_SFLOAT
+ */
+
+constexpr uint32_t BakedMeshMagic = 0x48534D56; // "VMSH"
+constexpr uint32_t BakedMeshVersion = 1;
+constexpr uint32_t BakedMeshAlignment = 16;
+
+enum BakedPrimitiveFlags : uint32_t
+{
+    BakedPrimitiveQuantizedPositions = 1 << 0,
+    BakedPrimitiveIndex16 = 1 << 1,
+    BakedPrimitiveHasNormals = 1 << 2,
+    BakedPrimitiveHasTangents = 1 << 3,
+    BakedPrimitiveHasTexCoords = 1 << 4,
+};
+
+struct BakedMeshHeader
+{
+    uint32_t Magic = BakedMeshMagic;
+    uint32_t Version = BakedMeshVersion;
+    uint32_t MeshCount = 0;
+    uint32_t PrimitiveCount = 0;
+    uint64_t NamesOffset = 0;
+    uint64_t NamesSize = 0;
+    uint64_t DataOffset = 0;
+    uint64_t DataSize = 0;
+};
+
+struct BakedMeshRecord
+{
+    // relative to NamesOffset
+    uint32_t NameOffset = 0;
+    uint32_t NameLength = 0;
+};
+
+struct BakedPrimitive
+{
+    uint32_t Mesh = 0;
+    int32_t Material = -1;
+    uint32_t Flags = 0;
+    uint32_t VertexCount = 0;
+    uint32_t IndexCount = 0;
+    uint32_t VertexStride = 0;
+    uint64_t VertexOffset = 0;
+    uint64_t IndexOffset = 0;
+    float PositionOffset[3] = {0.0f, 0.0f, 0.0f};
+    float PositionScale[3] = {1.0f, 1.0f, 1.0f};
+};
+
+static_assert(sizeof(BakedMeshHeader) == 48);
+static_assert(sizeof(BakedMeshRecord) == 8);
+static_assert(sizeof(BakedPrimitive) == 64);
+
+// byte offsets of the attributes inside a baked vertex
+constexpr uint32_t BakedPositionSize(uint32_t flags)
+{
+    return flags & BakedPrimitiveQuantizedPositions ? 8 : 12;
+}
+
+constexpr uint32_t BakedNormalOffset(uint32_t flags)
+{
+    return BakedPositionSize(flags);
+}
+
+constexpr uint32_t BakedTangentOffset(uint32_t flags)
+{
+    return BakedPositionSize(flags) + 4;
+}
+
+constexpr uint32_t BakedTexCoordOffset(uint32_t flags)
+{
+    return BakedPositionSize(flags) + 8;
+}
+
+constexpr uint32_t BakedVertexStride(uint32_t flags)
+{
+    return BakedPositionSize(flags) + 12;
+}
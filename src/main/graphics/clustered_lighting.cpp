@@ -0,0 +1,505 @@
+#include "clustered_lighting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "core/log.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_host_memory.h"
+#include "vulkan/vk_initializers.h"
+#include "vulkan/vk_tools.h"
+
+namespace
+{
+    // must match local_size_x of cluster_build.comp
+    constexpr uint32_t BuildGroupSize = 64;
+}
+
+/**
+ * Create the cluster buffers, descriptors and compute pipelines
+ *
+ * @param device Device to allocate all resources on
+ * @param properties Cluster grid dimensions and light limits
+ * @param shaderDirectory Directory containing the compiled .spv files
+ *
+ * @return VK_SUCCESS if all resources were created
+ */
+VkResult ClusteredLighting::Initialize(VulkanDevice *device,
+                                       const ClusterProperties &properties,
+                                       const std::string &shaderDirectory)
+{
+    vulkanDevice = device;
+    settings = properties;
+
+    const uint32_t sharedMemoryLimit = device->properties.limits.maxComputeSharedMemorySize / sizeof(uint32_t);
+    if (settings.MaxLightsPerCluster + 2 > sharedMemoryLimit)
+    {
+        Log::Warning("MaxLightsPerCluster {0} exceeds compute shared memory, clamping to {1}",
+                     settings.MaxLightsPerCluster,
+                     sharedMemoryLimit - 2);
+        settings.MaxLightsPerCluster = sharedMemoryLimit - 2;
+    }
+
+    settings.FramesInFlight = std::max(settings.FramesInFlight, 1u);
+
+    const VkDeviceSize clusterCount = GetClusterCount();
+
+    Debug::CheckVulkan(device->createBuffer(
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &clusterBoundsBuffer,
+        sizeof(glm::vec4) * 2 * clusterCount));
+
+    // written by the host and read by the cull and the shading, concurrent sharing keeps them valid on both queues
+    // without transferring them back and forth every frame
+    const std::vector<uint32_t> readers = {device->queueFamilyIndices.graphics, device->queueFamilyIndices.compute};
+
+    frames.resize(settings.FramesInFlight);
+    for (FrameBuffers &frame : frames)
+    {
+        Debug::CheckVulkan(device->createBuffer(
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &frame.params,
+            sizeof(GpuParams),
+            nullptr,
+            readers));
+        Debug::CheckVulkan(frame.params.map());
+
+        Debug::CheckVulkan(device->createBuffer(
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &frame.lights,
+            sizeof(GpuLight) * settings.MaxLights,
+            nullptr,
+            readers));
+        Debug::CheckVulkan(frame.lights.map());
+
+        Debug::CheckVulkan(device->createBuffer(
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &frame.lightGrid,
+            sizeof(glm::uvec2) * clusterCount));
+
+        Debug::CheckVulkan(device->createBuffer(
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &frame.lightIndex,
+            sizeof(uint32_t) * settings.MaxLightsPerCluster * clusterCount));
+
+        Debug::CheckVulkan(device->createBuffer(
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &frame.lightIndexCounter,
+            sizeof(uint32_t)));
+    }
+
+    params.view = glm::mat4(1.0f);
+    params.inverseProjection = glm::mat4(1.0f);
+    params.gridSize = glm::uvec4(settings.TilesX, settings.TilesY, settings.SlicesZ, 0);
+    params.options = glm::uvec4(settings.MaxLightsPerCluster, 0, 0, 0);
+
+    CreateDescriptors();
+    CreatePipelines(shaderDirectory);
+
+    if (!buildPipeline || !cullPipeline)
+    {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    Log::System("Clustered Lighting Init ({0}x{1}x{2} clusters, {3} lights, {4} frames)",
+                settings.TilesX,
+                settings.TilesY,
+                settings.SlicesZ,
+                settings.MaxLights,
+                settings.FramesInFlight);
+    return VK_SUCCESS;
+}
+
+void ClusteredLighting::Destroy()
+{
+    if (!vulkanDevice)
+    {
+        return;
+    }
+
+    const VkDevice device = vulkanDevice->logicalDevice;
+    vkDestroyPipeline(device, buildPipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipeline(device, cullPipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipelineLayout(device, pipelineLayout, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+    vkDestroyDescriptorPool(device, descriptorPool, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+    vkDestroyDescriptorSetLayout(device,
+                                 descriptorSetLayout,
+                                 vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+
+    for (FrameBuffers &frame : frames)
+    {
+        frame.params.unmap();
+        frame.lights.unmap();
+        frame.params.destroy();
+        frame.lights.destroy();
+        frame.lightGrid.destroy();
+        frame.lightIndex.destroy();
+        frame.lightIndexCounter.destroy();
+    }
+    frames.clear();
+    frameIndex = 0;
+    clusterBoundsBuffer.destroy();
+
+    vulkanDevice = nullptr;
+}
+
+/**
+ * Set the lights culled from the next BeginFrame() on
+ *
+ * @note Lights past ClusterProperties::MaxLights are ignored
+ */
+void ClusteredLighting::SetLights(const std::vector<Light> &lights)
+{
+    uint32_t count = static_cast<uint32_t>(lights.size());
+    if (count > settings.MaxLights)
+    {
+        Log::Warning("{0} lights submitted, only the first {1} are used", count, settings.MaxLights);
+        count = settings.MaxLights;
+    }
+
+    gpuLights.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const Light &light = lights[i];
+        gpuLights[i].positionRange = glm::vec4(light.Position, light.Range);
+        gpuLights[i].colorIntensity = glm::vec4(light.Color, light.Intensity);
+        gpuLights[i].directionType = glm::vec4(glm::normalize(light.Direction),
+                                               static_cast<float>(light.Type));
+        gpuLights[i].spotCone = glm::vec4(std::cos(light.InnerConeAngle),
+                                          std::cos(light.OuterConeAngle),
+                                          std::sin(light.OuterConeAngle),
+                                          0.0f);
+    }
+
+    params.gridSize.w = count;
+    lightsVersion++;
+}
+
+/**
+ * Update the camera used for binning, cluster bounds are only rebuilt if projection or render size changed
+ *
+ * @param zNear Near plane distance the depth slices start at
+ * @param zFar Far plane distance the depth slices end at
+ * @param width Render width in pixels
+ * @param height Render height in pixels
+ */
+void ClusteredLighting::SetCamera(const glm::mat4 &view,
+                                  const glm::mat4 &projection,
+                                  float zNear,
+                                  float zFar,
+                                  uint32_t width,
+                                  uint32_t height)
+{
+    params.view = view;
+
+    const glm::mat4 inverseProjection = glm::inverse(projection);
+    const glm::vec4 screenSize(static_cast<float>(width),
+                               static_cast<float>(height),
+                               std::ceil(static_cast<float>(width) / static_cast<float>(settings.TilesX)),
+                               std::ceil(static_cast<float>(height) / static_cast<float>(settings.TilesY)));
+    const float logDepthRange = std::log(zFar / zNear);
+    const glm::vec4 depthSlice(zNear,
+                               zFar,
+                               static_cast<float>(settings.SlicesZ) / logDepthRange,
+                               static_cast<float>(settings.SlicesZ) * std::log(zNear) / logDepthRange);
+
+    if (inverseProjection != params.inverseProjection ||
+        screenSize != params.screenSize ||
+        depthSlice != params.depthSlice)
+    {
+        params.inverseProjection = inverseProjection;
+        params.screenSize = screenSize;
+        params.depthSlice = depthSlice;
+        boundsDirty = true;
+    }
+}
+
+// Forward shaders output the per cluster light count instead of lighting while enabled
+void ClusteredLighting::SetDebugHeatmap(bool enabled)
+{
+    params.options.y = enabled ? 1 : 0;
+}
+
+/**
+ * Switch to the next frame's buffers and upload the camera and, if they changed since that frame's buffers were last
+ * used, the lights
+ *
+ * @note The frame that used these buffers FramesInFlight frames ago has to be finished on the GPU
+ */
+void ClusteredLighting::BeginFrame()
+{
+    frameIndex = (frameIndex + 1) % settings.FramesInFlight;
+    FrameBuffers &frame = frames[frameIndex];
+
+    memcpy(frame.params.mapped, &params, sizeof(GpuParams));
+    if (frame.lightsVersion != lightsVersion)
+    {
+        memcpy(frame.lights.mapped, gpuLights.data(), gpuLights.size() * sizeof(GpuLight));
+        frame.lightsVersion = lightsVersion;
+    }
+}
+
+/**
+ * Record the light binning of the current frame, rebuilding the cluster bounds first if needed
+ *
+ * @param commandBuffer Command buffer allocated from queueFamilyIndex
+ * @param queueFamilyIndex Family the cull is submitted to, the compute or the graphics family. The light lists are
+ *                         released to the graphics family if it differs.
+ */
+void ClusteredLighting::Cull(VkCommandBuffer commandBuffer, uint32_t queueFamilyIndex)
+{
+    const FrameBuffers &frame = frames[frameIndex];
+
+    Debug::BeginLabel(commandBuffer, "Light Culling", {1.0f, 0.8f, 0.2f, 1.0f});
+
+    vkCmdBindDescriptorSets(commandBuffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipelineLayout,
+                            0,
+                            1,
+                            &frame.descriptorSet,
+                            0,
+                            nullptr);
+
+    if (boundsDirty)
+    {
+        // the bounds are shared by all frames, earlier culls on this queue may still be reading them
+        VkBufferMemoryBarrier rebuildBarrier = vkinit::bufferMemoryBarrier();
+        rebuildBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        rebuildBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        rebuildBarrier.buffer = clusterBoundsBuffer.buffer;
+        rebuildBarrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             1,
+                             &rebuildBarrier,
+                             0,
+                             nullptr);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, buildPipeline);
+        vkCmdDispatch(commandBuffer, vktools::divideRoundUp(GetClusterCount(), BuildGroupSize), 1, 1);
+
+        VkBufferMemoryBarrier boundsBarrier = vkinit::bufferMemoryBarrier();
+        boundsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        boundsBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        boundsBarrier.buffer = clusterBoundsBuffer.buffer;
+        boundsBarrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             1,
+                             &boundsBarrier,
+                             0,
+                             nullptr);
+        boundsDirty = false;
+    }
+
+    vkCmdFillBuffer(commandBuffer, frame.lightIndexCounter.buffer, 0, sizeof(uint32_t), 0);
+
+    VkBufferMemoryBarrier counterBarrier = vkinit::bufferMemoryBarrier();
+    counterBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    counterBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    counterBarrier.buffer = frame.lightIndexCounter.buffer;
+    counterBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         0,
+                         nullptr,
+                         1,
+                         &counterBarrier,
+                         0,
+                         nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdDispatch(commandBuffer, settings.TilesX, settings.TilesY, settings.SlicesZ);
+
+    ReleaseBarrier(commandBuffer, queueFamilyIndex);
+
+    Debug::EndLabel(commandBuffer);
+}
+
+/**
+ * Make the current frame's light lists visible to fragment shaders
+ *
+ * @param commandBuffer Command buffer allocated from the graphics queue family, recorded before the forward pass
+ * @param cullQueueFamilyIndex Family Cull() was recorded for, its submission has to be waited on with a semaphore
+ *                             if it is not the graphics family
+ *
+ * @note Acquires queue family ownership when the cull family differs from the graphics family
+ */
+void ClusteredLighting::AcquireForGraphics(VkCommandBuffer commandBuffer, uint32_t cullQueueFamilyIndex)
+{
+    const uint32_t computeFamily = cullQueueFamilyIndex;
+    const uint32_t graphicsFamily = vulkanDevice->queueFamilyIndices.graphics;
+    const FrameBuffers &frame = frames[frameIndex];
+
+    std::vector<VkBufferMemoryBarrier> barriers;
+    for (const Buffer *buffer : {&frame.lightGrid, &frame.lightIndex})
+    {
+        VkBufferMemoryBarrier barrier = vkinit::bufferMemoryBarrier();
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.buffer = buffer->buffer;
+        barrier.size = VK_WHOLE_SIZE;
+        if (computeFamily != graphicsFamily)
+        {
+            barrier.srcQueueFamilyIndex = computeFamily;
+            barrier.dstQueueFamilyIndex = graphicsFamily;
+        }
+        else
+        {
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        }
+        barriers.push_back(barrier);
+    }
+
+    // the semaphore wait between the queues already orders execution for the ownership transfer
+    vkCmdPipelineBarrier(commandBuffer,
+                         computeFamily != graphicsFamily
+                             ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT
+                             : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         0,
+                         nullptr,
+                         static_cast<uint32_t>(barriers.size()),
+                         barriers.data(),
+                         0,
+                         nullptr);
+}
+
+// Release half of the queue family ownership transfer, nothing to do if the cull runs on the graphics family
+void ClusteredLighting::ReleaseBarrier(VkCommandBuffer commandBuffer, uint32_t queueFamilyIndex)
+{
+    const uint32_t computeFamily = queueFamilyIndex;
+    const uint32_t graphicsFamily = vulkanDevice->queueFamilyIndices.graphics;
+    if (computeFamily == graphicsFamily)
+    {
+        return;
+    }
+
+    const FrameBuffers &frame = frames[frameIndex];
+    std::vector<VkBufferMemoryBarrier> barriers;
+    for (const Buffer *buffer : {&frame.lightGrid, &frame.lightIndex})
+    {
+        VkBufferMemoryBarrier barrier = vkinit::bufferMemoryBarrier();
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = computeFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+        barrier.buffer = buffer->buffer;
+        barrier.size = VK_WHOLE_SIZE;
+        barriers.push_back(barrier);
+    }
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0,
+                         0,
+                         nullptr,
+                         static_cast<uint32_t>(barriers.size()),
+                         barriers.data(),
+                         0,
+                         nullptr);
+}
+
+void ClusteredLighting::CreateDescriptors()
+{
+    const VkDevice device = vulkanDevice->logicalDevice;
+    const VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    const uint32_t frameCount = static_cast<uint32_t>(frames.size());
+    const std::vector<VkDescriptorPoolSize> poolSizes = {
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount),
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 * frameCount),
+    };
+    VkDescriptorPoolCreateInfo poolInfo = vkinit::descriptorPoolCreateInfo(poolSizes, frameCount);
+    Debug::CheckVulkan(vkCreateDescriptorPool(device,
+                                              &poolInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL),
+                                              &descriptorPool));
+
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, stages, 0),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages, 1),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages, 2),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages, 3),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages, 4),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stages, 5),
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo = vkinit::descriptorSetLayoutCreateInfo(bindings);
+    Debug::CheckVulkan(vkCreateDescriptorSetLayout(device,
+                                                   &layoutInfo,
+                                                   vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
+                                                   &descriptorSetLayout));
+
+    for (FrameBuffers &frame : frames)
+    {
+        VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocateInfo(descriptorPool,
+                                                                                  &descriptorSetLayout,
+                                                                                  1);
+        Debug::CheckVulkan(vkAllocateDescriptorSets(device, &allocInfo, &frame.descriptorSet));
+
+        const VkDescriptorSet set = frame.descriptorSet;
+        const std::vector<VkWriteDescriptorSet> writes = {
+            vkinit::writeDescriptorSet(set, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &frame.params.descriptor),
+            vkinit::writeDescriptorSet(set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &frame.lights.descriptor),
+            vkinit::writeDescriptorSet(set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &clusterBoundsBuffer.descriptor),
+            vkinit::writeDescriptorSet(set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &frame.lightGrid.descriptor),
+            vkinit::writeDescriptorSet(set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &frame.lightIndex.descriptor),
+            vkinit::writeDescriptorSet(set, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &frame.lightIndexCounter.descriptor),
+        };
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+}
+
+void ClusteredLighting::CreatePipelines(const std::string &shaderDirectory)
+{
+    const VkDevice device = vulkanDevice->logicalDevice;
+
+    VkPipelineLayoutCreateInfo layoutInfo = vkinit::pipelineLayoutCreateInfo(&descriptorSetLayout);
+    Debug::CheckVulkan(vkCreatePipelineLayout(device,
+                                              &layoutInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT),
+                                              &pipelineLayout));
+
+    const VkShaderModule buildShader = vktools::loadShader(shaderDirectory + "/cluster_build.comp.spv", device);
+    const VkShaderModule cullShader = vktools::loadShader(shaderDirectory + "/cluster_cull.comp.spv", device);
+
+    if (buildShader && cullShader)
+    {
+        buildPipeline =
+            vktools::createComputePipeline(device, pipelineLayout, buildShader, nullptr, vulkanDevice->pipelineCache);
+
+        // the shared memory light list of the cull pass is sized by specialization
+        const VkSpecializationMapEntry entry = vkinit::specializationMapEntry(0, 0, sizeof(uint32_t));
+        const VkSpecializationInfo specialization = vkinit::specializationInfo(1,
+                                                                               &entry,
+                                                                               sizeof(uint32_t),
+                                                                               &settings.MaxLightsPerCluster);
+        cullPipeline = vktools::createComputePipeline(device,
+                                                      pipelineLayout,
+                                                      cullShader,
+                                                      &specialization,
+                                                      vulkanDevice->pipelineCache);
+    }
+
+    vkDestroyShaderModule(device, buildShader, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+    vkDestroyShaderModule(device, cullShader, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+}
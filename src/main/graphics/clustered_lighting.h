@@ -0,0 +1,149 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan/vk_buffer.h"
+
+struct VulkanDevice;
+
+struct ClusterProperties
+{
+    // froxel grid dimensions, x/y tiles are stretched over the render size
+    uint32_t TilesX = 16;
+    uint32_t TilesY = 9;
+    uint32_t SlicesZ = 24;
+    uint32_t MaxLights = 4096;
+    // lights beyond this count are dropped from a cluster, also sizes the shared memory of the cull pass
+    uint32_t MaxLightsPerCluster = 128;
+    // copies of the buffers every frame writes, at least the number of frames the caller has in flight
+    uint32_t FramesInFlight = 2;
+};
+
+enum class LightType : uint32_t
+{
+    Point = 0,
+    Spot = 1,
+};
+
+struct Light
+{
+    glm::vec3 Position{0.0f};
+    float Range = 10.0f;
+    glm::vec3 Color{1.0f};
+    float Intensity = 1.0f;
+    // spot lights only
+    glm::vec3 Direction{0.0f, -1.0f, 0.0f};
+    LightType Type = LightType::Point;
+    float InnerConeAngle = glm::radians(20.0f);
+    float OuterConeAngle = glm::radians(30.0f);
+};
+
+/**
+ * @brief Clustered forward light culling
+ *
+ * The view frustum is split into a grid of froxels with exponential depth slices. A compute pass bins all lights
+ * into the froxels they touch and writes compact per-cluster index lists into storage buffers, which forward
+ * fragment shaders walk through resources/shaders/include/clustered_lighting.glsl (descriptor set layout shared).
+ *
+ * BeginFrame() moves on to the next copy of the per frame buffers and uploads the camera and lights into it, frames
+ * still in flight keep reading theirs. Cull() is meant to be recorded on the compute queue and AcquireForGraphics() on
+ * the graphics queue after waiting for the cull's submission, the queue family ownership transfer of the light lists
+ * between them is skipped when the cull runs on the graphics family. Camera and lights are shared by both families.
+ */
+class ClusteredLighting
+{
+public:
+    VkResult Initialize(VulkanDevice *device,
+                        const ClusterProperties &properties,
+                        const std::string &shaderDirectory);
+    void Destroy();
+
+    void SetLights(const std::vector<Light> &lights);
+    void SetCamera(const glm::mat4 &view,
+                   const glm::mat4 &projection,
+                   float zNear,
+                   float zFar,
+                   uint32_t width,
+                   uint32_t height);
+    void SetDebugHeatmap(bool enabled);
+
+    void BeginFrame();
+    void Cull(VkCommandBuffer commandBuffer, uint32_t queueFamilyIndex);
+    void AcquireForGraphics(VkCommandBuffer commandBuffer, uint32_t cullQueueFamilyIndex);
+
+    [[nodiscard]] VkDescriptorSetLayout GetDescriptorSetLayout() const
+    {
+        return descriptorSetLayout;
+    }
+
+    // set of the current frame
+    [[nodiscard]] VkDescriptorSet GetDescriptorSet() const
+    {
+        return frames[frameIndex].descriptorSet;
+    }
+
+    [[nodiscard]] uint32_t GetClusterCount() const
+    {
+        return settings.TilesX * settings.TilesY * settings.SlicesZ;
+    }
+
+private:
+    // mirrors ClusterParams in clustered_lighting.glsl
+    struct GpuParams
+    {
+        glm::mat4 view;
+        glm::mat4 inverseProjection;
+        glm::uvec4 gridSize;
+        glm::vec4 screenSize;
+        glm::vec4 depthSlice;
+        glm::uvec4 options;
+    };
+
+    // mirrors Light in clustered_lighting.glsl
+    struct GpuLight
+    {
+        glm::vec4 positionRange;
+        glm::vec4 colorIntensity;
+        glm::vec4 directionType;
+        glm::vec4 spotCone;
+    };
+
+    // everything a frame writes, the cluster bounds are only written by the cull queue and shared
+    struct FrameBuffers
+    {
+        Buffer params;
+        Buffer lights;
+        Buffer lightGrid;
+        Buffer lightIndex;
+        Buffer lightIndexCounter;
+        VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+        // value of lightsVersion the lights buffer was last filled at
+        uint64_t lightsVersion = 0;
+    };
+
+    void CreateDescriptors();
+    void CreatePipelines(const std::string &shaderDirectory);
+    void ReleaseBarrier(VkCommandBuffer commandBuffer, uint32_t queueFamilyIndex);
+
+    ClusterProperties settings;
+    VulkanDevice *vulkanDevice = nullptr;
+
+    GpuParams params{};
+    bool boundsDirty = true;
+    // lights of the last SetLights(), copied into every frame's buffer once
+    std::vector<GpuLight> gpuLights;
+    uint64_t lightsVersion = 1;
+
+    std::vector<FrameBuffers> frames;
+    uint32_t frameIndex = 0;
+    Buffer clusterBoundsBuffer;
+
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline buildPipeline{VK_NULL_HANDLE};
+    VkPipeline cullPipeline{VK_NULL_HANDLE};
+};
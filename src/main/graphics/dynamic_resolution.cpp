@@ -0,0 +1,252 @@
+#include "dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/log.h"
+#include "gpu_profiler.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_initializers.h"
+#include "vulkan/vk_tools.h"
+
+namespace
+{
+    // render extents are snapped to this so compute passes over the target work on full tiles
+    constexpr uint32_t ExtentAlignment = 8;
+    // anti windup bound of the accumulated relative error
+    constexpr float IntegralLimit = 4.0f;
+
+    float Percentile(std::vector<float> &samples, float percentile)
+    {
+        const size_t index = std::min(samples.size() - 1,
+                                      static_cast<size_t>(percentile * static_cast<float>(samples.size())));
+        std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+        return samples[index];
+    }
+}
+
+ResolutionController::ResolutionController(const DynamicResolutionProperties &properties)
+    : settings(properties),
+      scale(properties.MaxScale)
+{
+}
+
+void ResolutionController::Reset()
+{
+    scale = settings.MaxScale;
+    integral = 0.0f;
+    previousError = 0.0f;
+    framesUnderBudget = 0;
+}
+
+/**
+ * Feed one GPU frame time into the controller
+ *
+ * @param gpuFrameTimeMs Measured GPU time of a frame rendered at the current scale
+ *
+ * @return Per axis render scale to use for the next frame
+ */
+float ResolutionController::Update(float gpuFrameTimeMs)
+{
+    // positive when over budget
+    const float error = (gpuFrameTimeMs - settings.TargetFrameTimeMs) / settings.TargetFrameTimeMs;
+    const float derivative = error - previousError;
+    previousError = error;
+
+    if (std::abs(error) < settings.DeadBand)
+    {
+        framesUnderBudget = 0;
+        return scale;
+    }
+
+    // only integrate while the output can still move, otherwise the integral winds up at the scale bounds
+    const bool saturated = (error < 0.0f && scale >= settings.MaxScale) ||
+                           (error > 0.0f && scale <= settings.MinScale);
+    if (!saturated)
+    {
+        integral = std::clamp(integral + error, -IntegralLimit, IntegralLimit);
+    }
+
+    if (error < 0.0f)
+    {
+        if (++framesUnderBudget < settings.UpscaleDelayFrames)
+        {
+            return scale;
+        }
+    }
+    else
+    {
+        framesUnderBudget = 0;
+    }
+
+    // GPU cost is roughly proportional to the pixel count, so the output steers scale squared
+    const float output = settings.Kp * error + settings.Ki * integral + settings.Kd * derivative;
+    const float pixelRatio = std::clamp(1.0f - output, 0.25f, 2.0f);
+    const float newScale = std::clamp(scale * std::sqrt(pixelRatio), settings.MinScale, settings.MaxScale);
+
+    if (std::abs(newScale - scale) < settings.MinScaleChange &&
+        newScale != settings.MinScale && newScale != settings.MaxScale)
+    {
+        return scale;
+    }
+
+    scale = newScale;
+    framesUnderBudget = 0;
+    return scale;
+}
+
+/**
+ * Allocate the offscreen targets at the maximum size
+ *
+ * @param profiler Source of the GPU frame time, BeginFrame() has to run after the profiler's BeginFrame()
+ * @param colorFormat Format of the color target, usable as color attachment, sampled and storage image
+ * @param depthFormat Format of the depth target
+ *
+ * @return VK_SUCCESS if all resources were created
+ */
+VkResult DynamicResolution::Initialize(VulkanDevice *device,
+                                       const DynamicResolutionProperties &properties,
+                                       const GpuProfiler *profiler,
+                                       VkFormat colorFormat,
+                                       VkFormat depthFormat)
+{
+    vulkanDevice = device;
+    settings = properties;
+    settings.MinScale = std::clamp(settings.MinScale, 0.1f, 1.0f);
+    settings.MaxScale = std::clamp(settings.MaxScale, settings.MinScale, 1.0f);
+    controller = ResolutionController(settings);
+
+    const VkExtent2D maxExtent{settings.MaxWidth, settings.MaxHeight};
+    Debug::CheckVulkan(device->createImage(colorFormat,
+                                           maxExtent,
+                                           VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                               VK_IMAGE_USAGE_SAMPLED_BIT |
+                                               VK_IMAGE_USAGE_STORAGE_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           &colorTarget));
+    Debug::CheckVulkan(device->createImage(depthFormat,
+                                           maxExtent,
+                                           VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                               VK_IMAGE_USAGE_SAMPLED_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           &depthTarget));
+
+    gpuProfiler = profiler;
+    if (!gpuProfiler || !gpuProfiler->IsSupported())
+    {
+        Log::Warning("No GPU timings available, dynamic resolution stays at maximum scale");
+    }
+    frameTimes.reserve(settings.LogIntervalFrames);
+
+    ApplyScale();
+
+    Log::System("Dynamic Resolution Init (max {0}x{1}, scale {2:.2f}-{3:.2f}, target {4:.2f} ms)",
+                settings.MaxWidth,
+                settings.MaxHeight,
+                settings.MinScale,
+                settings.MaxScale,
+                settings.TargetFrameTimeMs);
+    return VK_SUCCESS;
+}
+
+void DynamicResolution::Destroy()
+{
+    if (!vulkanDevice)
+    {
+        return;
+    }
+
+    colorTarget.destroy();
+    depthTarget.destroy();
+
+    vulkanDevice = nullptr;
+}
+
+/**
+ * Feed the latest resolved GPU frame time into the controller
+ *
+ * @note Has to be called before recording the scene, the render extent may change here
+ */
+void DynamicResolution::BeginFrame()
+{
+    if (!gpuProfiler || !gpuProfiler->HasNewResults())
+    {
+        return;
+    }
+
+    const float frameTimeMs = gpuProfiler->GetFrameMs();
+    const float previousScale = controller.GetScale();
+    if (controller.Update(frameTimeMs) != previousScale)
+    {
+        ApplyScale();
+    }
+
+    if (settings.LogIntervalFrames > 0)
+    {
+        frameTimes.push_back(frameTimeMs);
+        if (++framesSinceLog >= settings.LogIntervalFrames)
+        {
+            LogStatistics();
+        }
+    }
+}
+
+/**
+ * Viewport covering the current render extent in the top left corner of the targets
+ */
+VkViewport DynamicResolution::GetViewport() const
+{
+    return vkinit::viewport(static_cast<float>(renderExtent.width),
+                            static_cast<float>(renderExtent.height),
+                            0.0f,
+                            1.0f);
+}
+
+VkRect2D DynamicResolution::GetScissor() const
+{
+    return vkinit::rect2D(static_cast<int32_t>(renderExtent.width),
+                          static_cast<int32_t>(renderExtent.height),
+                          0,
+                          0);
+}
+
+/**
+ * Ratio of the render extent to the full target size, for passes sampling the color target with normalized UVs
+ */
+std::pair<float, float> DynamicResolution::GetUvScale() const
+{
+    return {static_cast<float>(renderExtent.width) / static_cast<float>(settings.MaxWidth),
+            static_cast<float>(renderExtent.height) / static_cast<float>(settings.MaxHeight)};
+}
+
+void DynamicResolution::ApplyScale()
+{
+    const auto alignedExtent = [](uint32_t maxSize, float scale)
+    {
+        const uint32_t scaled = static_cast<uint32_t>(static_cast<float>(maxSize) * scale);
+        const uint32_t aligned = scaled / ExtentAlignment * ExtentAlignment;
+        return std::clamp(aligned, std::min(ExtentAlignment, maxSize), maxSize);
+    };
+
+    const float scale = controller.GetScale();
+    renderExtent.width = alignedExtent(settings.MaxWidth, scale);
+    renderExtent.height = alignedExtent(settings.MaxHeight, scale);
+}
+
+void DynamicResolution::LogStatistics()
+{
+    const float p50 = Percentile(frameTimes, 0.50f);
+    const float p95 = Percentile(frameTimes, 0.95f);
+    const float p99 = Percentile(frameTimes, 0.99f);
+    Log::Info("Dynamic resolution: scale {0:.2f} ({1}x{2}), GPU frame p50 {3:.2f} ms, "
+              "p95 {4:.2f} ms, p99 {5:.2f} ms",
+              controller.GetScale(),
+              renderExtent.width,
+              renderExtent.height,
+              p50,
+              p95,
+              p99);
+    frameTimes.clear();
+    framesSinceLog = 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan/vk_image.h"
+
+class GpuProfiler;
+struct VulkanDevice;
+
+struct DynamicResolutionProperties
+{
+    // GPU frame time the controller tries to hold, in milliseconds
+    float TargetFrameTimeMs = 16.6f;
+    // bounds of the per-axis render scale
+    float MinScale = 0.5f;
+    float MaxScale = 1.0f;
+    // PID gains on the normalized frame time error
+    float Kp = 0.25f;
+    float Ki = 0.02f;
+    float Kd = 0.05f;
+    // relative error below which the scale is left alone
+    float DeadBand = 0.05f;
+    // scale steps smaller than this are ignored to avoid jitter
+    float MinScaleChange = 0.02f;
+    // frames under budget required before the scale is raised again
+    uint32_t UpscaleDelayFrames = 30;
+    // size of the offscreen targets, the render extent never exceeds this
+    uint32_t MaxWidth = 1920;
+    uint32_t MaxHeight = 1080;
+    // 0 disables the periodic scale / frame time log
+    uint32_t LogIntervalFrames = 300;
+};
+
+/**
+ * @brief Frame time controller without any Vulkan state
+ *
+ * A PID loop on the relative frame time error. Scaling down reacts immediately to spikes, scaling up waits until
+ * the frame time stayed under budget for UpscaleDelayFrames so the resolution does not oscillate around the target.
+ */
+class ResolutionController
+{
+public:
+    explicit ResolutionController(const DynamicResolutionProperties &properties);
+
+    float Update(float gpuFrameTimeMs);
+    void Reset();
+
+    [[nodiscard]] float GetScale() const
+    {
+        return scale;
+    }
+
+private:
+    DynamicResolutionProperties settings;
+    float scale;
+    float integral = 0.0f;
+    float previousError = 0.0f;
+    uint32_t framesUnderBudget = 0;
+};
+
+/**
+ * @brief Renders into oversized offscreen targets at a varying internal resolution
+ *
+ * Color and depth targets are allocated once at MaxWidth x MaxHeight, the scene is rendered into the top left
+ * corner using GetViewport() / GetScissor() as dynamic state, so scale changes never reallocate. Passes sampling
+ * the color target have to multiply their UVs with GetUvScale().
+ *
+ * The controller is fed the frame scope time of the GpuProfiler, which lags framesInFlight frames behind. Without
+ * profiler or timestamp support the scale stays at MaxScale.
+ */
+class DynamicResolution
+{
+public:
+    VkResult Initialize(VulkanDevice *device,
+                        const DynamicResolutionProperties &properties,
+                        const GpuProfiler *profiler,
+                        VkFormat colorFormat,
+                        VkFormat depthFormat);
+    void Destroy();
+
+    void BeginFrame();
+
+    [[nodiscard]] VkExtent2D GetRenderExtent() const
+    {
+        return renderExtent;
+    }
+
+    [[nodiscard]] float GetScale() const
+    {
+        return controller.GetScale();
+    }
+
+    [[nodiscard]] Image &GetColorTarget()
+    {
+        return colorTarget;
+    }
+
+    [[nodiscard]] Image &GetDepthTarget()
+    {
+        return depthTarget;
+    }
+
+    [[nodiscard]] VkViewport GetViewport() const;
+    [[nodiscard]] VkRect2D GetScissor() const;
+    [[nodiscard]] std::pair<float, float> GetUvScale() const;
+
+private:
+    void ApplyScale();
+    void LogStatistics();
+
+    DynamicResolutionProperties settings;
+    ResolutionController controller{settings};
+    VulkanDevice *vulkanDevice = nullptr;
+
+    Image colorTarget;
+    Image depthTarget;
+    VkExtent2D renderExtent{};
+
+    const GpuProfiler *gpuProfiler = nullptr;
+
+    std::vector<float> frameTimes;
+    uint32_t framesSinceLog = 0;
+};
@@ -0,0 +1,364 @@
+#include "frame_capture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <type_traits>
+
+#include "core/log.h"
+
+namespace
+{
+    constexpr uint64_t RecordAlignment = 8;
+    // record sizes are 32 bit, larger uploads are split into several records
+    constexpr uint64_t MaxRecordSize = std::numeric_limits<uint32_t>::max();
+    constexpr uint64_t MaxUploadChunk = uint64_t(1) << 31;
+
+    static_assert(sizeof(CaptureFileHeader) % RecordAlignment == 0);
+    static_assert(sizeof(CaptureRecordHeader) % RecordAlignment == 0);
+    static_assert(sizeof(CaptureUpload) % RecordAlignment == 0);
+    static_assert(std::is_trivially_copyable_v<Light> && std::is_trivially_copyable_v<CaptureCamera>);
+
+    uint64_t AlignRecord(uint64_t size)
+    {
+        return (size + RecordAlignment - 1) & ~(RecordAlignment - 1);
+    }
+
+    // light count, padded so the Light array stays aligned
+    struct CaptureLights
+    {
+        uint32_t Count;
+        uint32_t Padding;
+    };
+
+    // whether the payload holds everything the record claims, counts and sizes inside it included
+    bool PayloadFits(const CaptureRecordHeader &record, const uint8_t *payload)
+    {
+        switch (record.Type)
+        {
+        case CaptureRecordType::CreateBuffer:
+            return record.Size >= sizeof(CaptureBuffer);
+        case CaptureRecordType::Upload:
+            return record.Size >= sizeof(CaptureUpload) &&
+                   reinterpret_cast<const CaptureUpload *>(payload)->Size <= record.Size - sizeof(CaptureUpload);
+        case CaptureRecordType::Camera:
+            return record.Size >= sizeof(CaptureCamera);
+        case CaptureRecordType::Lights:
+            return record.Size >= sizeof(CaptureLights) &&
+                   static_cast<uint64_t>(reinterpret_cast<const CaptureLights *>(payload)->Count) * sizeof(Light) <=
+                       record.Size - sizeof(CaptureLights);
+        case CaptureRecordType::Packet:
+            return record.Size >= sizeof(CapturePacket);
+        case CaptureRecordType::EndFrame:
+            return record.Size >= sizeof(CaptureEndFrame);
+        default:
+            return true;
+        }
+    }
+}
+
+FrameCaptureWriter::~FrameCaptureWriter()
+{
+    Close();
+}
+
+/**
+ * Create a capture file, an already open capture is closed first
+ *
+ * @return False if the file could not be created
+ */
+bool FrameCaptureWriter::Open(const std::string &path)
+{
+    Close();
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        Log::Error("Could not create capture file {0}", path);
+        return false;
+    }
+
+    const CaptureFileHeader header{};
+    std::fwrite(&header, sizeof(header), 1, file);
+    bytesWritten = sizeof(header);
+    frameIndex = 0;
+    pending.clear();
+    return true;
+}
+
+/**
+ * Close the file, records after the last EndFrame() are dropped like they would be by a reader
+ */
+void FrameCaptureWriter::Close()
+{
+    if (!file)
+    {
+        return;
+    }
+
+    std::fclose(file);
+    file = nullptr;
+    pending.clear();
+    Log::Info("Captured {0} frames, {1:.1f} MiB", frameIndex, static_cast<double>(bytesWritten) / (1024.0 * 1024.0));
+}
+
+// returns null and drops the record if its size does not fit the record header
+void *FrameCaptureWriter::BeginRecord(CaptureRecordType type, uint64_t size)
+{
+    if (size > MaxRecordSize)
+    {
+        Log::Error("Capture record of type {0} is {1} bytes, larger than a record can hold, dropped",
+                   static_cast<uint32_t>(type),
+                   size);
+        return nullptr;
+    }
+    const CaptureRecordHeader header{type, static_cast<uint32_t>(size)};
+    const size_t offset = pending.size();
+    // resize zero fills the alignment padding
+    pending.resize(offset + sizeof(header) + AlignRecord(size));
+    std::memcpy(pending.data() + offset, &header, sizeof(header));
+    return pending.data() + offset + sizeof(header);
+}
+
+void FrameCaptureWriter::WriteMetadata(std::string_view text)
+{
+    if (!file)
+    {
+        return;
+    }
+    if (void *payload = BeginRecord(CaptureRecordType::Metadata, text.size()))
+    {
+        std::memcpy(payload, text.data(), text.size());
+    }
+}
+
+void FrameCaptureWriter::CreateBuffer(uint32_t id, uint32_t usage, uint64_t size)
+{
+    if (file)
+    {
+        const CaptureBuffer buffer{id, usage, size};
+        std::memcpy(BeginRecord(CaptureRecordType::CreateBuffer, sizeof(buffer)), &buffer, sizeof(buffer));
+    }
+}
+
+/**
+ * Record an upload into a buffer created with CreateBuffer()
+ *
+ * @note Uploads larger than MaxUploadChunk are recorded as consecutive uploads of at most that size
+ */
+void FrameCaptureWriter::Upload(uint32_t bufferId, uint64_t offset, const void *data, uint64_t size)
+{
+    if (!file)
+    {
+        return;
+    }
+
+    const uint8_t *source = static_cast<const uint8_t *>(data);
+    do
+    {
+        const uint64_t chunk = std::min(size, MaxUploadChunk);
+        const CaptureUpload upload{bufferId, 0, offset, chunk};
+        uint8_t *payload = static_cast<uint8_t *>(BeginRecord(CaptureRecordType::Upload, sizeof(upload) + chunk));
+        std::memcpy(payload, &upload, sizeof(upload));
+        std::memcpy(payload + sizeof(upload), source, chunk);
+        source += chunk;
+        offset += chunk;
+        size -= chunk;
+    } while (size > 0);
+}
+
+void FrameCaptureWriter::SetCamera(const CaptureCamera &camera)
+{
+    if (file)
+    {
+        std::memcpy(BeginRecord(CaptureRecordType::Camera, sizeof(camera)), &camera, sizeof(camera));
+    }
+}
+
+void FrameCaptureWriter::SetLights(const std::vector<Light> &lights)
+{
+    if (!file)
+    {
+        return;
+    }
+
+    const CaptureLights header{static_cast<uint32_t>(lights.size()), 0};
+    const uint64_t lightBytes = sizeof(Light) * lights.size();
+    uint8_t *payload = static_cast<uint8_t *>(BeginRecord(CaptureRecordType::Lights, sizeof(header) + lightBytes));
+    if (!payload)
+    {
+        return;
+    }
+    std::memcpy(payload, &header, sizeof(header));
+    std::memcpy(payload + sizeof(header), lights.data(), lightBytes);
+}
+
+void FrameCaptureWriter::Submit(const CapturePacket &packet)
+{
+    if (file)
+    {
+        std::memcpy(BeginRecord(CaptureRecordType::Packet, sizeof(packet)), &packet, sizeof(packet));
+    }
+}
+
+/**
+ * Close the frame and write all of its records to the file
+ */
+void FrameCaptureWriter::EndFrame()
+{
+    if (!file)
+    {
+        return;
+    }
+
+    const CaptureEndFrame endFrame{frameIndex++};
+    std::memcpy(BeginRecord(CaptureRecordType::EndFrame, sizeof(endFrame)), &endFrame, sizeof(endFrame));
+
+    if (std::fwrite(pending.data(), 1, pending.size(), file) != pending.size())
+    {
+        Log::Error("Writing the capture failed, capturing stopped");
+        std::fclose(file);
+        file = nullptr;
+    }
+    bytesWritten += pending.size();
+    pending.clear();
+}
+
+/**
+ * Map a capture file and count its complete frames
+ *
+ * @return False if the file could not be mapped or is not a capture of this version
+ */
+bool FrameCaptureReader::Open(const std::string &path)
+{
+    Close();
+    if (!mapping.Open(path, MappedFileAccess::Sequential))
+    {
+        return false;
+    }
+
+    CaptureFileHeader header{};
+    if (mapping.Size() < sizeof(header))
+    {
+        Log::Error("{0} is not a capture file", path);
+        Close();
+        return false;
+    }
+    std::memcpy(&header, mapping.Data(), sizeof(header));
+    if (header.Magic != CaptureMagic || header.Version != CaptureVersion)
+    {
+        Log::Error("{0} is not a version {1} capture file", path, CaptureVersion);
+        Close();
+        return false;
+    }
+
+    // one pass over the record headers only, payloads are not touched until they are replayed
+    firstFrameOffset = sizeof(header);
+    size_t scan = firstFrameOffset;
+    const CaptureRecordHeader *record = nullptr;
+    const uint8_t *payload = nullptr;
+    while (ReadRecord(scan, record, payload))
+    {
+        if (record->Type == CaptureRecordType::Metadata)
+        {
+            metadata.append(reinterpret_cast<const char *>(payload), record->Size);
+        }
+        else if (record->Type == CaptureRecordType::EndFrame)
+        {
+            frameCount++;
+        }
+    }
+    if (scan != mapping.Size())
+    {
+        Log::Warning("{0} ends with an incomplete record, replaying {1} complete frames", path, frameCount);
+    }
+
+    offset = firstFrameOffset;
+    return true;
+}
+
+void FrameCaptureReader::Close()
+{
+    mapping.Close();
+    metadata.clear();
+    frameCount = 0;
+    firstFrameOffset = 0;
+    offset = 0;
+}
+
+bool FrameCaptureReader::ReadRecord(size_t &recordOffset,
+                                    const CaptureRecordHeader *&header,
+                                    const uint8_t *&payload) const
+{
+    if (recordOffset + sizeof(CaptureRecordHeader) > mapping.Size())
+    {
+        return false;
+    }
+    header = reinterpret_cast<const CaptureRecordHeader *>(mapping.Data() + recordOffset);
+    const size_t end = recordOffset + sizeof(CaptureRecordHeader) + AlignRecord(header->Size);
+    if (end > mapping.Size())
+    {
+        return false;
+    }
+    payload = mapping.Data() + recordOffset + sizeof(CaptureRecordHeader);
+    recordOffset = end;
+    return true;
+}
+
+bool FrameCaptureReader::NextFrame(CaptureFrame &frame)
+{
+    frame = CaptureFrame{};
+
+    size_t scan = offset;
+    const CaptureRecordHeader *record = nullptr;
+    const uint8_t *payload = nullptr;
+    while (ReadRecord(scan, record, payload))
+    {
+        if (!PayloadFits(*record, payload))
+        {
+            Log::Error("Capture record of type {0} is smaller than its contents, replay stopped",
+                       static_cast<uint32_t>(record->Type));
+            break;
+        }
+
+        switch (record->Type)
+        {
+        case CaptureRecordType::CreateBuffer:
+            frame.CreatedBuffers.push_back(reinterpret_cast<const CaptureBuffer *>(payload));
+            break;
+        case CaptureRecordType::Upload:
+        {
+            const CaptureUpload *upload = reinterpret_cast<const CaptureUpload *>(payload);
+            frame.Uploads.push_back({upload, payload + sizeof(CaptureUpload)});
+            break;
+        }
+        case CaptureRecordType::Camera:
+            frame.Camera = reinterpret_cast<const CaptureCamera *>(payload);
+            break;
+        case CaptureRecordType::Lights:
+            frame.LightCount = reinterpret_cast<const CaptureLights *>(payload)->Count;
+            frame.Lights = reinterpret_cast<const Light *>(payload + sizeof(CaptureLights));
+            break;
+        case CaptureRecordType::Packet:
+            frame.Packets.push_back(reinterpret_cast<const CapturePacket *>(payload));
+            break;
+        case CaptureRecordType::EndFrame:
+            frame.Index = reinterpret_cast<const CaptureEndFrame *>(payload)->FrameIndex;
+            offset = scan;
+            return true;
+        default:
+            // metadata and record types of newer writers
+            break;
+        }
+    }
+
+    // trailing records without an EndFrame are an incomplete frame, so is a frame cut short by a malformed record
+    frame = CaptureFrame{};
+    return false;
+}
+
+void FrameCaptureReader::Rewind()
+{
+    offset = firstFrameOffset;
+}
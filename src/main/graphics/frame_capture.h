@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "clustered_lighting.h"
+#include "core/mapped_file.h"
+
+/*
+ * Capture file layout, all values little endian:
+ *
+ *   CaptureFileHeader
+ *   record*    CaptureRecordHeader followed by Size payload bytes, padded to 8 bytes
+ *
+ * Records are only appended and every frame ends with an EndFrame record, so a capture that was cut short still
+ * replays up to its last complete frame. Payloads are plain structs that are read in place from the mapping.
+ */
+
+constexpr uint32_t CaptureMagic = 0x50414356; // "VCAP"
+constexpr uint32_t CaptureVersion = 1;
+
+struct CaptureFileHeader
+{
+    uint32_t Magic = CaptureMagic;
+    uint32_t Version = CaptureVersion;
+    uint64_t Reserved = 0;
+};
+
+enum class CaptureRecordType : uint32_t
+{
+    // free form text describing how to rebuild the capturing application's resources
+    Metadata = 1,
+    CreateBuffer,
+    // CaptureUpload followed by the uploaded bytes
+    Upload,
+    Camera,
+    // light count followed by the Light array
+    Lights,
+    Packet,
+    EndFrame,
+};
+
+struct CaptureRecordHeader
+{
+    CaptureRecordType Type;
+    uint32_t Size;
+};
+
+struct CaptureBuffer
+{
+    uint32_t Id;
+    uint32_t Usage;
+    uint64_t Size;
+};
+
+struct CaptureUpload
+{
+    uint32_t BufferId;
+    uint32_t Padding;
+    uint64_t Offset;
+    uint64_t Size;
+};
+
+struct CaptureCamera
+{
+    glm::mat4 View;
+    glm::mat4 Projection;
+    float ZNear;
+    float ZFar;
+    uint32_t Width;
+    uint32_t Height;
+};
+
+/** @brief One unit of GPU work, what a pass and pipeline mean is up to the application that captured it */
+struct CapturePacket
+{
+    uint32_t Pass;
+    uint32_t Pipeline;
+    uint32_t Material;
+    uint32_t FirstInstance;
+    uint32_t InstanceCount;
+    uint32_t GroupCountX;
+    uint32_t GroupCountY;
+    uint32_t GroupCountZ;
+};
+
+struct CaptureEndFrame
+{
+    uint64_t FrameIndex;
+};
+
+/**
+ * @brief Records the renderer level submissions of every frame into a capture file
+ *
+ * Records of a frame are collected in memory and written with one call on EndFrame(), so long captures stream to
+ * disk with a bounded footprint and stay readable if the application dies mid frame.
+ */
+class FrameCaptureWriter
+{
+public:
+    ~FrameCaptureWriter();
+
+    bool Open(const std::string &path);
+    void Close();
+
+    [[nodiscard]] bool IsOpen() const
+    {
+        return file != nullptr;
+    }
+
+    void WriteMetadata(std::string_view text);
+    void CreateBuffer(uint32_t id, uint32_t usage, uint64_t size);
+    void Upload(uint32_t bufferId, uint64_t offset, const void *data, uint64_t size);
+    void SetCamera(const CaptureCamera &camera);
+    void SetLights(const std::vector<Light> &lights);
+    void Submit(const CapturePacket &packet);
+    void EndFrame();
+
+    [[nodiscard]] uint64_t GetFrameCount() const
+    {
+        return frameIndex;
+    }
+
+private:
+    void *BeginRecord(CaptureRecordType type, uint64_t size);
+
+    std::FILE *file = nullptr;
+    std::vector<uint8_t> pending;
+    uint64_t frameIndex = 0;
+    uint64_t bytesWritten = 0;
+};
+
+struct CaptureUploadView
+{
+    const CaptureUpload *Upload;
+    const uint8_t *Data;
+};
+
+/** @brief Everything recorded for one frame, pointers reference the mapped capture file */
+struct CaptureFrame
+{
+    uint64_t Index = 0;
+    std::vector<const CaptureBuffer *> CreatedBuffers;
+    std::vector<CaptureUploadView> Uploads;
+    std::vector<const CapturePacket *> Packets;
+    // null if the camera did not change this frame
+    const CaptureCamera *Camera = nullptr;
+    // null if the lights did not change this frame
+    const Light *Lights = nullptr;
+    uint32_t LightCount = 0;
+};
+
+/**
+ * @brief Reads a capture file frame by frame straight from a memory mapping
+ */
+class FrameCaptureReader
+{
+public:
+    bool Open(const std::string &path);
+    void Close();
+
+    /** @brief Metadata records before the first frame joined in order */
+    [[nodiscard]] const std::string &GetMetadata() const
+    {
+        return metadata;
+    }
+
+    /** @brief Number of complete frames, a trailing incomplete frame is ignored */
+    [[nodiscard]] uint64_t GetFrameCount() const
+    {
+        return frameCount;
+    }
+
+    /**
+     * Read the next complete frame
+     *
+     * @return False at the end of the capture
+     */
+    bool NextFrame(CaptureFrame &frame);
+    /** @brief Continue with the first frame again */
+    void Rewind();
+
+private:
+    bool ReadRecord(size_t &offset, const CaptureRecordHeader *&header, const uint8_t *&payload) const;
+
+    MappedFile mapping;
+    std::string metadata;
+    uint64_t frameCount = 0;
+    size_t firstFrameOffset = 0;
+    size_t offset = 0;
+};
@@ -0,0 +1,310 @@
+#include "gpu_profiler.h"
+
+#include <algorithm>
+
+#include "core/log.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_host_memory.h"
+
+namespace
+{
+    // the root scope opened by BeginFrame(), its time is the GPU frame time
+    const char *const FrameScopeName = "Frame";
+    const glm::vec4 FrameScopeColor{0.6f, 0.6f, 0.6f, 1.0f};
+}
+
+/**
+ * Create the timestamp queries for all frames in flight
+ *
+ * @param framesInFlight Number of frames recorded before the first one is waited on
+ * @param queueFamilyIndex Family of the queue the profiled command buffers are submitted to
+ *
+ * @return VK_SUCCESS, also when the queue does not support timestamps and only labels are emitted
+ */
+VkResult GpuProfiler::Initialize(VulkanDevice *device,
+                                 const GpuProfilerProperties &properties,
+                                 uint32_t framesInFlight,
+                                 uint32_t queueFamilyIndex)
+{
+    vulkanDevice = device;
+    settings = properties;
+    settings.MaxScopes = std::max(settings.MaxScopes, 1u);
+    settings.AverageFrames = std::max(settings.AverageFrames, 1u);
+
+    frames.assign(framesInFlight, FrameSlot{});
+    for (FrameSlot &frame : frames)
+    {
+        frame.scopes.reserve(settings.MaxScopes);
+    }
+    openScopes.reserve(16);
+    timings.reserve(settings.MaxScopes);
+
+    const uint32_t validBits = device->queueFamilyProperties[queueFamilyIndex].timestampValidBits;
+    if (validBits == 0)
+    {
+        Log::Warning("Queue family does not support timestamps, GPU profiler only emits debug labels");
+        return VK_SUCCESS;
+    }
+
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    timestampPeriod = device->properties.limits.timestampPeriod;
+    queriesPerFrame = settings.MaxScopes * 2;
+    // value and availability per query
+    queryResults.resize(static_cast<size_t>(queriesPerFrame) * 2);
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = framesInFlight * queriesPerFrame;
+    const VkResult result = vkCreateQueryPool(device->logicalDevice,
+                                              &queryPoolInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_QUERY_POOL),
+                                              &timestampPool);
+    Debug::CheckVulkan(result);
+
+    Log::System("GPU Profiler Init ({0} scopes per frame, {1} valid timestamp bits, {2:.2f} ns per tick)",
+                settings.MaxScopes,
+                validBits,
+                timestampPeriod);
+    return result;
+}
+
+void GpuProfiler::Destroy()
+{
+    if (!vulkanDevice)
+    {
+        return;
+    }
+
+    if (timestampPool)
+    {
+        vkDestroyQueryPool(vulkanDevice->logicalDevice,
+                           timestampPool,
+                           vkhost::allocationCallbacks(VK_OBJECT_TYPE_QUERY_POOL));
+        timestampPool = VK_NULL_HANDLE;
+    }
+    frames.clear();
+    timings.clear();
+    statistics.clear();
+
+    vulkanDevice = nullptr;
+}
+
+/**
+ * Resolve the last frame that used this slot, reset its queries and open the frame scope
+ *
+ * @note Has to be recorded outside of a render pass and after the slot's fence has been waited on
+ */
+void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    newResults = false;
+    if (timestampPool && frames[frameIndex].pending)
+    {
+        Resolve(frameIndex);
+    }
+
+    currentFrame = frameIndex;
+    FrameSlot &frame = frames[frameIndex];
+    frame.scopes.clear();
+    frame.queryCount = 0;
+    frame.pending = false;
+    openScopes.clear();
+
+    if (timestampPool)
+    {
+        vkCmdResetQueryPool(commandBuffer, timestampPool, frameIndex * queriesPerFrame, queriesPerFrame);
+    }
+    BeginScope(commandBuffer, FrameScopeName, FrameScopeColor);
+}
+
+void GpuProfiler::EndFrame(VkCommandBuffer commandBuffer)
+{
+    if (openScopes.size() > 1)
+    {
+        Log::Warning("GPU profiler frame ended with {0} unclosed scopes", openScopes.size() - 1);
+    }
+    while (!openScopes.empty())
+    {
+        EndScope(commandBuffer);
+    }
+    frames[currentFrame].pending = timestampPool != VK_NULL_HANDLE;
+}
+
+/**
+ * Open a labeled scope, scopes nest and have to be closed in reverse order within the frame
+ *
+ * @param color Color of the debug label in capture tools
+ */
+void GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const std::string &name, glm::vec4 color)
+{
+    Debug::BeginLabel(commandBuffer, name, color);
+    if (frames.empty())
+    {
+        return;
+    }
+
+    FrameSlot &frame = frames[currentFrame];
+    RecordedScope scope;
+    scope.name = name;
+    scope.depth = static_cast<uint32_t>(openScopes.size());
+    scope.parent = openScopes.empty() ? UINT32_MAX : openScopes.back();
+    // a scope starts once all earlier commands finished, so overlapping work is attributed to the earlier scope
+    scope.beginQuery = WriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, true);
+    openScopes.push_back(static_cast<uint32_t>(frame.scopes.size()));
+    frame.scopes.push_back(std::move(scope));
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer commandBuffer)
+{
+    Debug::EndLabel(commandBuffer);
+    if (openScopes.empty())
+    {
+        return;
+    }
+
+    RecordedScope &scope = frames[currentFrame].scopes[openScopes.back()];
+    openScopes.pop_back();
+    if (scope.beginQuery != UINT32_MAX)
+    {
+        scope.endQuery = WriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, false);
+    }
+}
+
+/**
+ * GPU time of the frame scope of the last resolved frame
+ */
+float GpuProfiler::GetFrameMs() const
+{
+    return timings.empty() ? 0.0f : timings.front().LastMs;
+}
+
+/**
+ * @param path Scope names joined with '/', starting with the frame scope, e.g. "Frame/Post/Bloom"
+ *
+ * @return Time of the scope in the last resolved frame it was recorded in, 0 if it was never resolved
+ */
+float GpuProfiler::GetLastMs(const std::string &path) const
+{
+    const auto it = statistics.find(path);
+    return it != statistics.end() ? it->second.lastMs : 0.0f;
+}
+
+float GpuProfiler::GetAverageMs(const std::string &path) const
+{
+    const auto it = statistics.find(path);
+    return it != statistics.end() ? it->second.averageMs : 0.0f;
+}
+
+void GpuProfiler::LogTimings() const
+{
+    for (const GpuScopeTiming &timing : timings)
+    {
+        Log::Info("{0:>{1}}{2}: {3:.3f} ms (avg {4:.3f} ms)",
+                  "",
+                  timing.Depth * 2,
+                  timing.Name,
+                  timing.LastMs,
+                  timing.AverageMs);
+    }
+}
+
+/**
+ * @param opensScope Begin timestamps also reserve the matching end query, so every begun scope can be closed
+ *
+ * @return Query index relative to the slot, UINT32_MAX if none was written
+ */
+uint32_t GpuProfiler::WriteTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 stage, bool opensScope)
+{
+    if (!timestampPool)
+    {
+        return UINT32_MAX;
+    }
+
+    FrameSlot &frame = frames[currentFrame];
+    // end queries of all open scopes are already reserved
+    const uint32_t required = opensScope ? static_cast<uint32_t>(openScopes.size()) + 2 : 1;
+    if (frame.queryCount + required > queriesPerFrame)
+    {
+        if (!overflowWarned)
+        {
+            Log::Warning("GPU profiler ran out of queries, raise MaxScopes above {0}", settings.MaxScopes);
+            overflowWarned = true;
+        }
+        return UINT32_MAX;
+    }
+
+    const uint32_t query = frame.queryCount++;
+    vkCmdWriteTimestamp2(commandBuffer, stage, timestampPool, currentFrame * queriesPerFrame + query);
+    return query;
+}
+
+void GpuProfiler::Resolve(uint32_t frameIndex)
+{
+    FrameSlot &frame = frames[frameIndex];
+    frame.pending = false;
+    if (frame.queryCount == 0)
+    {
+        return;
+    }
+
+    // VK_NOT_READY is fine, availability is checked per scope and incomplete frames are dropped
+    const VkResult result = vkGetQueryPoolResults(vulkanDevice->logicalDevice,
+                                                  timestampPool,
+                                                  frameIndex * queriesPerFrame,
+                                                  frame.queryCount,
+                                                  sizeof(uint64_t) * 2 * frame.queryCount,
+                                                  queryResults.data(),
+                                                  sizeof(uint64_t) * 2,
+                                                  VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS && result != VK_NOT_READY)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < frame.queryCount; i++)
+    {
+        if (queryResults[i * 2 + 1] == 0)
+        {
+            return;
+        }
+    }
+
+    const float weight = 1.0f / static_cast<float>(settings.AverageFrames);
+    timings.clear();
+    scopePaths.resize(frame.scopes.size());
+    for (size_t i = 0; i < frame.scopes.size(); i++)
+    {
+        // parents are recorded before their children, so their path is always built already
+        const RecordedScope &scope = frame.scopes[i];
+        scopePaths[i] = scope.parent != UINT32_MAX ? scopePaths[scope.parent] + "/" + scope.name : scope.name;
+        if (scope.beginQuery == UINT32_MAX || scope.endQuery == UINT32_MAX)
+        {
+            continue;
+        }
+
+        GpuScopeTiming timing;
+        timing.Name = scope.name;
+        timing.Depth = scope.depth;
+        timing.Path = scopePaths[i];
+
+        const uint64_t ticks = (queryResults[scope.endQuery * 2] - queryResults[scope.beginQuery * 2]) &
+                               timestampMask;
+        timing.LastMs = static_cast<float>(ticks) * timestampPeriod / 1e6f;
+
+        const auto [it, inserted] = statistics.try_emplace(timing.Path, ScopeStatistics{});
+        ScopeStatistics &scopeStatistics = it->second;
+        scopeStatistics.lastMs = timing.LastMs;
+        scopeStatistics.averageMs = inserted ? timing.LastMs
+                                             : scopeStatistics.averageMs +
+                                                   (timing.LastMs - scopeStatistics.averageMs) * weight;
+        timing.AverageMs = scopeStatistics.averageMs;
+        timings.push_back(std::move(timing));
+    }
+    newResults = true;
+
+    if (settings.LogIntervalFrames > 0 && ++framesSinceLog >= settings.LogIntervalFrames)
+    {
+        LogTimings();
+        framesSinceLog = 0;
+    }
+}
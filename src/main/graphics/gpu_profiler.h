@@ -0,0 +1,129 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+struct VulkanDevice;
+
+struct GpuProfilerProperties
+{
+    // timestamp scopes per frame including the frame scope, further scopes only get a debug label
+    uint32_t MaxScopes = 128;
+    // rolling averages weigh the last frame with 1 / AverageFrames
+    uint32_t AverageFrames = 60;
+    // 0 disables the periodic log of the scope hierarchy
+    uint32_t LogIntervalFrames = 0;
+};
+
+/** @brief Timing of one scope of the last resolved frame in milliseconds */
+struct GpuScopeTiming
+{
+    std::string Name;
+    // names of all enclosing scopes and this one joined with '/', e.g. "Frame/Post/Bloom"
+    std::string Path;
+    uint32_t Depth = 0;
+    float LastMs = 0.0f;
+    float AverageMs = 0.0f;
+};
+
+/**
+ * @brief Hierarchical GPU timings from timestamp queries
+ *
+ * BeginScope() / EndScope() mark a region with a debug label, exactly like Debug::BeginLabel / EndLabel, and
+ * write a timestamp at both ends. Every frame in flight has its own range of queries; they are read back without
+ * waiting the next time BeginFrame() is called for the same slot, so timings lag framesInFlight frames behind.
+ * Frames whose results are not available yet are skipped.
+ *
+ * If the queue family has no timestampValidBits the profiler only emits the debug labels and all timings stay 0.
+ */
+class GpuProfiler
+{
+public:
+    VkResult Initialize(VulkanDevice *device,
+                        const GpuProfilerProperties &properties,
+                        uint32_t framesInFlight,
+                        uint32_t queueFamilyIndex);
+    void Destroy();
+
+    void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    void EndFrame(VkCommandBuffer commandBuffer);
+
+    void BeginScope(VkCommandBuffer commandBuffer,
+                    const std::string &name,
+                    glm::vec4 color = glm::vec4(1.0f));
+    void EndScope(VkCommandBuffer commandBuffer);
+
+    [[nodiscard]] bool IsSupported() const
+    {
+        return timestampPool != VK_NULL_HANDLE;
+    }
+
+    // set by BeginFrame() when it resolved a frame, GetFrameMs() and the scope timings are fresh
+    [[nodiscard]] bool HasNewResults() const
+    {
+        return newResults;
+    }
+
+    [[nodiscard]] float GetFrameMs() const;
+    [[nodiscard]] float GetLastMs(const std::string &path) const;
+    [[nodiscard]] float GetAverageMs(const std::string &path) const;
+
+    [[nodiscard]] const std::vector<GpuScopeTiming> &GetTimings() const
+    {
+        return timings;
+    }
+
+    void LogTimings() const;
+
+private:
+    struct RecordedScope
+    {
+        std::string name;
+        uint32_t depth = 0;
+        // index into the slot's scopes, UINT32_MAX for the frame scope
+        uint32_t parent = UINT32_MAX;
+        // relative to the first query of the slot, UINT32_MAX once the slot ran out of queries
+        uint32_t beginQuery = UINT32_MAX;
+        uint32_t endQuery = UINT32_MAX;
+    };
+
+    struct FrameSlot
+    {
+        std::vector<RecordedScope> scopes;
+        uint32_t queryCount = 0;
+        bool pending = false;
+    };
+
+    struct ScopeStatistics
+    {
+        float lastMs = 0.0f;
+        float averageMs = 0.0f;
+    };
+
+    uint32_t WriteTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 stage, bool opensScope);
+    void Resolve(uint32_t frameIndex);
+
+    GpuProfilerProperties settings;
+    VulkanDevice *vulkanDevice = nullptr;
+
+    VkQueryPool timestampPool{VK_NULL_HANDLE};
+    uint64_t timestampMask = 0;
+    float timestampPeriod = 1.0f;
+    uint32_t queriesPerFrame = 0;
+
+    std::vector<FrameSlot> frames;
+    uint32_t currentFrame = 0;
+    // indices into the current slot's scopes of all scopes that are still open
+    std::vector<uint32_t> openScopes;
+    bool overflowWarned = false;
+
+    std::vector<uint64_t> queryResults;
+    std::vector<std::string> scopePaths;
+    std::vector<GpuScopeTiming> timings;
+    std::unordered_map<std::string, ScopeStatistics> statistics;
+    bool newResults = false;
+    uint32_t framesSinceLog = 0;
+};
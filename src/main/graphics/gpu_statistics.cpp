@@ -0,0 +1,338 @@
+#include "gpu_statistics.h"
+
+#include <algorithm>
+
+#include "core/log.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_host_memory.h"
+
+namespace
+{
+    // results are returned in bit order, PassStatistics is filled in the same order
+    constexpr VkQueryPipelineStatisticFlags StatisticFlags =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+    constexpr uint32_t StatisticCount = 6;
+    // counters plus availability
+    constexpr uint32_t StatisticStride = StatisticCount + 1;
+}
+
+/**
+ * Create the query pools for all frames in flight
+ *
+ * @param framesInFlight Number of frames recorded before the first one is waited on
+ *
+ * @return VK_SUCCESS if the pools were created
+ */
+VkResult GpuStatistics::Initialize(VulkanDevice *device,
+                                   const GpuStatisticsProperties &properties,
+                                   uint32_t framesInFlight)
+{
+    vulkanDevice = device;
+    settings = properties;
+    settings.MaxPasses = std::max(settings.MaxPasses, 1u);
+    settings.MaxOcclusionQueries = std::max(settings.MaxOcclusionQueries, 1u);
+
+    frames.assign(framesInFlight, FrameSlot{});
+    for (FrameSlot &frame : frames)
+    {
+        frame.passNames.reserve(settings.MaxPasses);
+        frame.occlusionKeys.reserve(settings.MaxOcclusionQueries);
+    }
+    queryResults.resize(std::max(static_cast<size_t>(settings.MaxPasses) * StatisticStride,
+                                 static_cast<size_t>(settings.MaxOcclusionQueries) * 2));
+    passStatistics.reserve(settings.MaxPasses);
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+
+    if (device->enabledFeatures.pipelineStatisticsQuery)
+    {
+        queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        queryPoolInfo.queryCount = framesInFlight * settings.MaxPasses;
+        queryPoolInfo.pipelineStatistics = StatisticFlags;
+        Debug::CheckVulkan(vkCreateQueryPool(device->logicalDevice,
+                                             &queryPoolInfo,
+                                             vkhost::allocationCallbacks(VK_OBJECT_TYPE_QUERY_POOL),
+                                             &statisticsPool));
+    }
+    else
+    {
+        Log::Warning("pipelineStatisticsQuery is not enabled, pass statistics are disabled");
+    }
+
+    queryPoolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+    queryPoolInfo.queryCount = framesInFlight * settings.MaxOcclusionQueries;
+    queryPoolInfo.pipelineStatistics = 0;
+    const VkResult result = vkCreateQueryPool(device->logicalDevice,
+                                              &queryPoolInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_QUERY_POOL),
+                                              &occlusionPool);
+    Debug::CheckVulkan(result);
+
+    if (settings.PreciseOcclusion && device->enabledFeatures.occlusionQueryPrecise)
+    {
+        occlusionFlags = VK_QUERY_CONTROL_PRECISE_BIT;
+    }
+
+    Log::System("GPU Statistics Init (pipeline statistics {0}, {1} occlusion queries, precise {2})",
+                statisticsPool != VK_NULL_HANDLE,
+                settings.MaxOcclusionQueries,
+                occlusionFlags != 0);
+    return result;
+}
+
+void GpuStatistics::Destroy()
+{
+    if (!vulkanDevice)
+    {
+        return;
+    }
+
+    if (statisticsPool)
+    {
+        vkDestroyQueryPool(vulkanDevice->logicalDevice,
+                           statisticsPool,
+                           vkhost::allocationCallbacks(VK_OBJECT_TYPE_QUERY_POOL));
+        statisticsPool = VK_NULL_HANDLE;
+    }
+    if (occlusionPool)
+    {
+        vkDestroyQueryPool(vulkanDevice->logicalDevice,
+                           occlusionPool,
+                           vkhost::allocationCallbacks(VK_OBJECT_TYPE_QUERY_POOL));
+        occlusionPool = VK_NULL_HANDLE;
+    }
+    frames.clear();
+    passStatistics.clear();
+    samplesPassed.clear();
+
+    vulkanDevice = nullptr;
+}
+
+/**
+ * Resolve the last frame that used this slot and reset its queries
+ *
+ * @note Has to be recorded outside of a render pass and after the slot's fence has been waited on
+ */
+void GpuStatistics::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    if (frames[frameIndex].pending)
+    {
+        Resolve(frameIndex);
+    }
+
+    currentFrame = frameIndex;
+    FrameSlot &frame = frames[frameIndex];
+    frame.passNames.clear();
+    frame.occlusionKeys.clear();
+    frame.pending = true;
+    passActive = false;
+    occlusionActive = false;
+
+    if (statisticsPool)
+    {
+        vkCmdResetQueryPool(commandBuffer,
+                            statisticsPool,
+                            frameIndex * settings.MaxPasses,
+                            settings.MaxPasses);
+    }
+    vkCmdResetQueryPool(commandBuffer,
+                        occlusionPool,
+                        frameIndex * settings.MaxOcclusionQueries,
+                        settings.MaxOcclusionQueries);
+}
+
+/**
+ * Start counting the work of a pass, statistics of passes with the same name are reported separately
+ */
+void GpuStatistics::BeginPass(VkCommandBuffer commandBuffer, const std::string &name)
+{
+    if (!statisticsPool)
+    {
+        return;
+    }
+
+    FrameSlot &frame = frames[currentFrame];
+    if (passActive || frame.passNames.size() >= settings.MaxPasses)
+    {
+        if (!overflowWarned)
+        {
+            Log::Warning("Skipping statistics of pass {0}, passes cannot nest and at most {1} "
+                         "fit into a frame",
+                         name,
+                         settings.MaxPasses);
+            overflowWarned = true;
+        }
+        return;
+    }
+
+    const uint32_t query = currentFrame * settings.MaxPasses + static_cast<uint32_t>(frame.passNames.size());
+    vkCmdBeginQuery(commandBuffer, statisticsPool, query, 0);
+    frame.passNames.push_back(name);
+    passActive = true;
+}
+
+void GpuStatistics::EndPass(VkCommandBuffer commandBuffer)
+{
+    if (!passActive)
+    {
+        return;
+    }
+
+    const FrameSlot &frame = frames[currentFrame];
+    const uint32_t query = currentFrame * settings.MaxPasses + static_cast<uint32_t>(frame.passNames.size()) - 1;
+    vkCmdEndQuery(commandBuffer, statisticsPool, query);
+    passActive = false;
+}
+
+/**
+ * Count the samples passing depth and stencil tests until EndOcclusion(), e.g. for a bounding box draw
+ *
+ * @param key Caller defined id the result is looked up with, usually an object or cluster index
+ */
+void GpuStatistics::BeginOcclusion(VkCommandBuffer commandBuffer, uint32_t key)
+{
+    FrameSlot &frame = frames[currentFrame];
+    if (occlusionActive || frame.occlusionKeys.size() >= settings.MaxOcclusionQueries)
+    {
+        if (!overflowWarned)
+        {
+            Log::Warning("Skipping occlusion query {0}, queries cannot nest and at most {1} fit "
+                         "into a frame",
+                         key,
+                         settings.MaxOcclusionQueries);
+            overflowWarned = true;
+        }
+        return;
+    }
+
+    const uint32_t query = currentFrame * settings.MaxOcclusionQueries +
+                           static_cast<uint32_t>(frame.occlusionKeys.size());
+    vkCmdBeginQuery(commandBuffer, occlusionPool, query, occlusionFlags);
+    frame.occlusionKeys.push_back(key);
+    occlusionActive = true;
+}
+
+void GpuStatistics::EndOcclusion(VkCommandBuffer commandBuffer)
+{
+    if (!occlusionActive)
+    {
+        return;
+    }
+
+    const FrameSlot &frame = frames[currentFrame];
+    const uint32_t query = currentFrame * settings.MaxOcclusionQueries +
+                           static_cast<uint32_t>(frame.occlusionKeys.size()) - 1;
+    vkCmdEndQuery(commandBuffer, occlusionPool, query);
+    occlusionActive = false;
+}
+
+const PassStatistics *GpuStatistics::FindPass(const std::string &name) const
+{
+    const auto it = std::find_if(passStatistics.begin(),
+                                 passStatistics.end(),
+                                 [&name](const PassStatistics &pass)
+                                 { return pass.Name == name; });
+    return it != passStatistics.end() ? &*it : nullptr;
+}
+
+/**
+ * @return Samples passed in the last resolved frame that queried key, empty if it was never resolved
+ */
+std::optional<uint64_t> GpuStatistics::GetSamplesPassed(uint32_t key) const
+{
+    const auto it = samplesPassed.find(key);
+    if (it == samplesPassed.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void GpuStatistics::LogPassStatistics() const
+{
+    for (const PassStatistics &pass : passStatistics)
+    {
+        Log::Info("{0}: {1} primitives, {2} vertex, {3} fragment, {4} compute invocations, "
+                  "{5} of {6} primitives left the clipper",
+                  pass.Name,
+                  pass.InputPrimitives,
+                  pass.VertexInvocations,
+                  pass.FragmentInvocations,
+                  pass.ComputeInvocations,
+                  pass.ClippingPrimitives,
+                  pass.ClippingInvocations);
+    }
+}
+
+void GpuStatistics::Resolve(uint32_t frameIndex)
+{
+    FrameSlot &frame = frames[frameIndex];
+    frame.pending = false;
+    const VkQueryResultFlags resultFlags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+
+    // VK_NOT_READY is fine, availability is checked per query and unfinished ones are skipped
+    const uint32_t passCount = static_cast<uint32_t>(frame.passNames.size());
+    if (statisticsPool && passCount > 0)
+    {
+        const VkResult result = vkGetQueryPoolResults(vulkanDevice->logicalDevice,
+                                                      statisticsPool,
+                                                      frameIndex * settings.MaxPasses,
+                                                      passCount,
+                                                      sizeof(uint64_t) * StatisticStride * passCount,
+                                                      queryResults.data(),
+                                                      sizeof(uint64_t) * StatisticStride,
+                                                      resultFlags);
+        if (result == VK_SUCCESS || result == VK_NOT_READY)
+        {
+            passStatistics.clear();
+            for (uint32_t i = 0; i < passCount; i++)
+            {
+                const uint64_t *values = &queryResults[static_cast<size_t>(i) * StatisticStride];
+                if (values[StatisticCount] == 0)
+                {
+                    continue;
+                }
+
+                PassStatistics pass;
+                pass.Name = frame.passNames[i];
+                pass.InputPrimitives = values[0];
+                pass.VertexInvocations = values[1];
+                pass.ClippingInvocations = values[2];
+                pass.ClippingPrimitives = values[3];
+                pass.FragmentInvocations = values[4];
+                pass.ComputeInvocations = values[5];
+                passStatistics.push_back(std::move(pass));
+            }
+        }
+    }
+
+    const uint32_t occlusionCount = static_cast<uint32_t>(frame.occlusionKeys.size());
+    if (occlusionCount > 0)
+    {
+        const VkResult result = vkGetQueryPoolResults(vulkanDevice->logicalDevice,
+                                                      occlusionPool,
+                                                      frameIndex * settings.MaxOcclusionQueries,
+                                                      occlusionCount,
+                                                      sizeof(uint64_t) * 2 * occlusionCount,
+                                                      queryResults.data(),
+                                                      sizeof(uint64_t) * 2,
+                                                      resultFlags);
+        if (result == VK_SUCCESS || result == VK_NOT_READY)
+        {
+            for (uint32_t i = 0; i < occlusionCount; i++)
+            {
+                if (queryResults[i * 2 + 1] != 0)
+                {
+                    samplesPassed[frame.occlusionKeys[i]] = queryResults[i * 2];
+                }
+            }
+        }
+    }
+}
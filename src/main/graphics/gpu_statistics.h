@@ -0,0 +1,99 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+struct VulkanDevice;
+
+struct GpuStatisticsProperties
+{
+    // pipeline statistics passes per frame
+    uint32_t MaxPasses = 32;
+    // occlusion queries per frame
+    uint32_t MaxOcclusionQueries = 1024;
+    // exact sample counts when occlusionQueryPrecise is enabled, otherwise only zero / non zero is meaningful
+    bool PreciseOcclusion = false;
+};
+
+/** @brief What the GPU processed during one pass of the last resolved frame */
+struct PassStatistics
+{
+    std::string Name;
+    uint64_t InputPrimitives = 0;
+    uint64_t VertexInvocations = 0;
+    // primitives entering the clipper and primitives leaving it, clipping can also split primitives
+    uint64_t ClippingInvocations = 0;
+    uint64_t ClippingPrimitives = 0;
+    uint64_t FragmentInvocations = 0;
+    uint64_t ComputeInvocations = 0;
+};
+
+/**
+ * @brief Pipeline statistics per pass and keyed occlusion queries
+ *
+ * Both query types are pooled per frame in flight and read back without waiting the next time BeginFrame() is
+ * called for the same slot, like the GpuProfiler. Passes cannot nest since only one pipeline statistics query may
+ * be active in a command buffer; a pass begun inside a render pass instance has to end inside it.
+ *
+ * Pipeline statistics are disabled when the device was created without pipelineStatisticsQuery, occlusion
+ * queries are always available. Both have to be recorded on a graphics queue.
+ */
+class GpuStatistics
+{
+public:
+    VkResult Initialize(VulkanDevice *device, const GpuStatisticsProperties &properties, uint32_t framesInFlight);
+    void Destroy();
+
+    void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    void BeginPass(VkCommandBuffer commandBuffer, const std::string &name);
+    void EndPass(VkCommandBuffer commandBuffer);
+
+    void BeginOcclusion(VkCommandBuffer commandBuffer, uint32_t key);
+    void EndOcclusion(VkCommandBuffer commandBuffer);
+
+    [[nodiscard]] bool IsPipelineStatisticsSupported() const
+    {
+        return statisticsPool != VK_NULL_HANDLE;
+    }
+
+    [[nodiscard]] const std::vector<PassStatistics> &GetPassStatistics() const
+    {
+        return passStatistics;
+    }
+
+    [[nodiscard]] const PassStatistics *FindPass(const std::string &name) const;
+    [[nodiscard]] std::optional<uint64_t> GetSamplesPassed(uint32_t key) const;
+
+    void LogPassStatistics() const;
+
+private:
+    struct FrameSlot
+    {
+        std::vector<std::string> passNames;
+        std::vector<uint32_t> occlusionKeys;
+        bool pending = false;
+    };
+
+    void Resolve(uint32_t frameIndex);
+
+    GpuStatisticsProperties settings;
+    VulkanDevice *vulkanDevice = nullptr;
+
+    VkQueryPool statisticsPool{VK_NULL_HANDLE};
+    VkQueryPool occlusionPool{VK_NULL_HANDLE};
+    VkQueryControlFlags occlusionFlags = 0;
+
+    std::vector<FrameSlot> frames;
+    uint32_t currentFrame = 0;
+    bool passActive = false;
+    bool occlusionActive = false;
+    bool overflowWarned = false;
+
+    std::vector<uint64_t> queryResults;
+    std::vector<PassStatistics> passStatistics;
+    std::unordered_map<uint32_t, uint64_t> samplesPassed;
+};
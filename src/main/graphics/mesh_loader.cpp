@@ -0,0 +1,768 @@
+#include "mesh_loader.h"
+
+#include <array>
+#include <cstring>
+#include <limits>
+
+#include "baked_mesh.h"
+#include "core/asset_archive.h"
+#include "core/gltf.h"
+#include "core/job_system.h"
+#include "core/json.h"
+#include "core/log.h"
+#include "core/mapped_file.h"
+#include "core/profiler.h"
+#include "upload_queue.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_host_memory.h"
+#include "vulkan/vk_initializers.h"
+
+namespace
+{
+    // offsets of the buffer views inside the geometry buffer, enough for every index type and vertex format
+    constexpr VkDeviceSize ViewAlignment = 16;
+
+    constexpr uint32_t NoView = ~0u;
+    constexpr uint64_t MaxI32 = std::numeric_limits<int32_t>::max();
+    constexpr uint64_t MaxU32 = std::numeric_limits<uint32_t>::max();
+    constexpr uint64_t MaxU64 = std::numeric_limits<uint64_t>::max();
+
+    struct ParsedFile
+    {
+        std::string path;
+        // set when the file is an entry of an archive instead of a file of its own
+        const AssetArchive *archive = nullptr;
+        const AssetArchiveEntry *entry = nullptr;
+        MappedFile file;
+        // contents of the mapped file or the archive entry
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        bool valid = false;
+
+        // .vmesh written by vanadium_bake
+        bool baked = false;
+        BakedMeshHeader bakedHeader;
+
+        // .glb
+        JsonDocument json;
+        const uint8_t *bin = nullptr;
+        uint64_t binSize = 0;
+    };
+
+    struct ParseContext
+    {
+        ParsedFile *Files;
+    };
+
+    bool InRange(uint64_t offset, uint64_t size, uint64_t limit)
+    {
+        return offset <= limit && size <= limit - offset;
+    }
+
+    // checks every table and range up front, the upload trusts the file afterwards
+    bool ValidateBaked(ParsedFile &parsed)
+    {
+        const uint8_t *data = parsed.data;
+        const size_t size = parsed.size;
+        BakedMeshHeader &header = parsed.bakedHeader;
+        if (size < sizeof(header))
+        {
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+
+        const uint64_t tablesSize = static_cast<uint64_t>(header.MeshCount) * sizeof(BakedMeshRecord) +
+                                    static_cast<uint64_t>(header.PrimitiveCount) * sizeof(BakedPrimitive);
+        if (header.Version != BakedMeshVersion || !InRange(sizeof(header), tablesSize, size) ||
+            !InRange(header.NamesOffset, header.NamesSize, size) || !InRange(header.DataOffset, header.DataSize, size))
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < header.MeshCount; i++)
+        {
+            BakedMeshRecord record;
+            std::memcpy(&record, data + sizeof(header) + i * sizeof(record), sizeof(record));
+            if (!InRange(record.NameOffset, record.NameLength, header.NamesSize))
+            {
+                return false;
+            }
+        }
+
+        const uint8_t *primitives = data + sizeof(header) + header.MeshCount * sizeof(BakedMeshRecord);
+        for (uint32_t i = 0; i < header.PrimitiveCount; i++)
+        {
+            BakedPrimitive primitive;
+            std::memcpy(&primitive, primitives + i * sizeof(primitive), sizeof(primitive));
+            const uint64_t vertexBytes = static_cast<uint64_t>(primitive.VertexCount) * primitive.VertexStride;
+            const uint64_t indexBytes =
+                static_cast<uint64_t>(primitive.IndexCount) * (primitive.Flags & BakedPrimitiveIndex16 ? 2 : 4);
+            if (primitive.Mesh >= header.MeshCount || primitive.VertexStride != BakedVertexStride(primitive.Flags) ||
+                !InRange(primitive.VertexOffset, vertexBytes, header.DataSize) ||
+                !InRange(primitive.IndexOffset, indexBytes, header.DataSize))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ParseFile(ParsedFile &parsed)
+    {
+        if (parsed.entry)
+        {
+            const std::span<const uint8_t> contents = parsed.archive->GetData(*parsed.entry);
+            parsed.data = contents.data();
+            parsed.size = contents.size();
+        }
+        else
+        {
+            if (!parsed.file.Open(parsed.path, MappedFileAccess::Sequential))
+            {
+                return false;
+            }
+            parsed.data = parsed.file.Data();
+            parsed.size = parsed.file.Size();
+        }
+
+        const uint8_t *data = parsed.data;
+        const size_t size = parsed.size;
+        uint32_t magic = 0;
+        if (size >= sizeof(magic))
+        {
+            std::memcpy(&magic, data, sizeof(magic));
+        }
+
+        if (magic == BakedMeshMagic)
+        {
+            parsed.baked = true;
+            if (!ValidateBaked(parsed))
+            {
+                Log::Error("{0} is not a valid baked mesh of version {1}", parsed.path, BakedMeshVersion);
+                return false;
+            }
+            return true;
+        }
+
+        Gltf::GlbChunks chunks;
+        std::string error;
+        if (!Gltf::ParseGlb(data, size, chunks, error))
+        {
+            Log::Error("{0}: {1}", parsed.path, error);
+            return false;
+        }
+        parsed.bin = chunks.Bin;
+        parsed.binSize = chunks.BinSize;
+
+        if (!parsed.json.Parse(chunks.Json))
+        {
+            Log::Error("{0}: {1}", parsed.path, parsed.json.GetError());
+            return false;
+        }
+        return true;
+    }
+
+    void ParseJob(const void *context, uint32_t begin, uint32_t end)
+    {
+        VANADIUM_ZONE("Parse mesh file");
+        const ParseContext &parse = *static_cast<const ParseContext *>(context);
+        for (uint32_t i = begin; i < end; i++)
+        {
+            parse.Files[i].valid = ParseFile(parse.Files[i]);
+        }
+    }
+
+    VkFormat AttributeFormat(uint32_t componentType, uint32_t components, bool normalized)
+    {
+        using Formats = std::array<VkFormat, 4>;
+        static constexpr Formats Float = {VK_FORMAT_R32_SFLOAT,
+                                          VK_FORMAT_R32G32_SFLOAT,
+                                          VK_FORMAT_R32G32B32_SFLOAT,
+                                          VK_FORMAT_R32G32B32A32_SFLOAT};
+        static constexpr Formats Unorm8 = {VK_FORMAT_R8_UNORM,
+                                           VK_FORMAT_R8G8_UNORM,
+                                           VK_FORMAT_R8G8B8_UNORM,
+                                           VK_FORMAT_R8G8B8A8_UNORM};
+        static constexpr Formats Snorm8 = {VK_FORMAT_R8_SNORM,
+                                           VK_FORMAT_R8G8_SNORM,
+                                           VK_FORMAT_R8G8B8_SNORM,
+                                           VK_FORMAT_R8G8B8A8_SNORM};
+        static constexpr Formats Unorm16 = {VK_FORMAT_R16_UNORM,
+                                            VK_FORMAT_R16G16_UNORM,
+                                            VK_FORMAT_R16G16B16_UNORM,
+                                            VK_FORMAT_R16G16B16A16_UNORM};
+        static constexpr Formats Snorm16 = {VK_FORMAT_R16_SNORM,
+                                            VK_FORMAT_R16G16_SNORM,
+                                            VK_FORMAT_R16G16B16_SNORM,
+                                            VK_FORMAT_R16G16B16A16_SNORM};
+
+        if (components < 1 || components > 4)
+        {
+            return VK_FORMAT_UNDEFINED;
+        }
+        const uint32_t index = components - 1;
+        switch (componentType)
+        {
+        case Gltf::ComponentFloat:
+            return Float[index];
+        case Gltf::ComponentUnsignedByte:
+            return normalized ? Unorm8[index] : VK_FORMAT_UNDEFINED;
+        case Gltf::ComponentByte:
+            return normalized ? Snorm8[index] : VK_FORMAT_UNDEFINED;
+        case Gltf::ComponentUnsignedShort:
+            return normalized ? Unorm16[index] : VK_FORMAT_UNDEFINED;
+        case Gltf::ComponentShort:
+            return normalized ? Snorm16[index] : VK_FORMAT_UNDEFINED;
+        default:
+            return VK_FORMAT_UNDEFINED;
+        }
+    }
+
+    struct ViewRange
+    {
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        uint32_t stride = 0;
+        bool used = false;
+        // where the view lands in the geometry buffer
+        VkDeviceSize target = 0;
+    };
+
+    struct AccessorRange
+    {
+        uint32_t view = NoView;
+        uint64_t offset = 0;
+        uint32_t count = 0;
+        uint32_t componentType = 0;
+        uint32_t components = 0;
+        bool normalized = false;
+    };
+
+    // primitive with attribute offsets relative to their view until the geometry buffer layout is known
+    struct PendingPrimitive
+    {
+        uint32_t mesh = 0;
+        MeshPrimitive primitive;
+        std::array<uint32_t, 5> views = {NoView, NoView, NoView, NoView, NoView};
+    };
+
+    /**
+     * Collects everything the primitives of a parsed file need from its JSON, no geometry is touched yet
+     */
+    class GltfLayout
+    {
+    public:
+        explicit GltfLayout(const ParsedFile &parsed)
+            : parsed(parsed), json(parsed.json)
+        {
+        }
+
+        void Build(MeshModel &model)
+        {
+            const JsonValue &root = json.Root();
+            const std::vector<const JsonValue *> buffers = json.Elements(json.Find(root, "buffers"));
+            // buffer 0 without a uri is the BIN chunk, anything else would need to be read from another file
+            embeddedBuffer = !buffers.empty() && !json.Find(*buffers[0], "uri");
+
+            for (const JsonValue *view : json.Elements(json.Find(root, "bufferViews")))
+            {
+                ViewRange range;
+                uint64_t stride = 0;
+                const bool valid = embeddedBuffer && json.GetNumber(*view, "buffer", -1.0) == 0.0 &&
+                                   Gltf::ToUnsigned(json.GetNumber(*view, "byteOffset", 0.0), MaxU64, range.offset) &&
+                                   Gltf::ToUnsigned(json.GetNumber(*view, "byteLength", 0.0), MaxU64, range.length) &&
+                                   Gltf::ToUnsigned(json.GetNumber(*view, "byteStride", 0.0), MaxU32, stride) &&
+                                   InRange(range.offset, range.length, parsed.binSize);
+                range.stride = static_cast<uint32_t>(stride);
+                views.push_back(valid ? range : ViewRange{});
+                viewValid.push_back(valid);
+            }
+            accessors = json.Elements(json.Find(root, "accessors"));
+
+            const std::vector<const JsonValue *> meshes = json.Elements(json.Find(root, "meshes"));
+            model.Meshes.resize(meshes.size());
+            for (uint32_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+            {
+                model.Meshes[meshIndex].Name = std::string(json.GetString(*meshes[meshIndex], "name"));
+                for (const JsonValue *primitive : json.Elements(json.Find(*meshes[meshIndex], "primitives")))
+                {
+                    PendingPrimitive pending;
+                    pending.mesh = meshIndex;
+                    if (BuildPrimitive(*primitive, pending))
+                    {
+                        primitives.push_back(pending);
+                    }
+                    else
+                    {
+                        skipped++;
+                    }
+                }
+            }
+        }
+
+        std::vector<ViewRange> views;
+        std::vector<PendingPrimitive> primitives;
+        uint32_t skipped = 0;
+
+    private:
+        bool ResolveAccessor(double index, AccessorRange &range) const
+        {
+            uint64_t accessorIndex = 0;
+            if (!Gltf::ToUnsigned(index, MaxU64, accessorIndex) || accessorIndex >= accessors.size())
+            {
+                return false;
+            }
+            const JsonValue &accessor = *accessors[accessorIndex];
+            uint64_t view = 0;
+            if (json.Find(accessor, "sparse") ||
+                !Gltf::ToUnsigned(json.GetNumber(accessor, "bufferView", -1.0), MaxU64, view) || view >= views.size() ||
+                !viewValid[view])
+            {
+                return false;
+            }
+
+            uint64_t count = 0;
+            uint64_t componentType = 0;
+            if (!Gltf::ToUnsigned(json.GetNumber(accessor, "byteOffset", 0.0), MaxU64, range.offset) ||
+                !Gltf::ToUnsigned(json.GetNumber(accessor, "count", 0.0), MaxU32, count) ||
+                !Gltf::ToUnsigned(json.GetNumber(accessor, "componentType", 0.0), MaxU32, componentType))
+            {
+                return false;
+            }
+            range.view = static_cast<uint32_t>(view);
+            range.count = static_cast<uint32_t>(count);
+            range.componentType = static_cast<uint32_t>(componentType);
+            range.components = Gltf::ComponentCount(json.GetString(accessor, "type"));
+            const JsonValue *normalized = json.Find(accessor, "normalized");
+            range.normalized = normalized && normalized->Type == JsonType::Bool && normalized->Bool;
+
+            // the last element has to end inside the view, stride and count are 32 bit so the span cannot wrap
+            const ViewRange &viewRange = views[range.view];
+            const uint64_t elementSize =
+                static_cast<uint64_t>(Gltf::ComponentSize(range.componentType)) * range.components;
+            const uint64_t stride = viewRange.stride ? viewRange.stride : elementSize;
+            return elementSize > 0 && range.count > 0 &&
+                   InRange(range.offset, stride * (range.count - 1) + elementSize, viewRange.length);
+        }
+
+        bool BuildAttribute(const JsonValue &attributes,
+                            std::string_view name,
+                            MeshAttribute &attribute,
+                            uint32_t &view,
+                            uint32_t *count)
+        {
+            const JsonValue *index = json.Find(attributes, name);
+            if (!index)
+            {
+                // only the position is required
+                return name != "POSITION";
+            }
+
+            AccessorRange range;
+            if (index->Type != JsonType::Number || !ResolveAccessor(index->Number, range))
+            {
+                return false;
+            }
+            attribute.Format = AttributeFormat(range.componentType, range.components, range.normalized);
+            if (attribute.Format == VK_FORMAT_UNDEFINED)
+            {
+                return false;
+            }
+            attribute.Offset = range.offset;
+            const uint32_t stride = views[range.view].stride;
+            attribute.Stride = stride ? stride : Gltf::ComponentSize(range.componentType) * range.components;
+            view = range.view;
+            if (count)
+            {
+                *count = range.count;
+            }
+            return true;
+        }
+
+        bool BuildPrimitive(const JsonValue &primitive, PendingPrimitive &pending)
+        {
+            const JsonValue *attributes = json.Find(primitive, "attributes");
+            if (!attributes || json.GetNumber(primitive, "mode", Gltf::ModeTriangles) != Gltf::ModeTriangles)
+            {
+                return false;
+            }
+
+            MeshPrimitive &result = pending.primitive;
+            if (!BuildAttribute(*attributes, "POSITION", result.Position, pending.views[0], &result.VertexCount) ||
+                !BuildAttribute(*attributes, "NORMAL", result.Normal, pending.views[1], nullptr) ||
+                !BuildAttribute(*attributes, "TEXCOORD_0", result.TexCoord, pending.views[2], nullptr) ||
+                !BuildAttribute(*attributes, "TANGENT", result.Tangent, pending.views[3], nullptr))
+            {
+                return false;
+            }
+
+            if (const JsonValue *indices = json.Find(primitive, "indices"))
+            {
+                AccessorRange range;
+                if (indices->Type != JsonType::Number || !ResolveAccessor(indices->Number, range) ||
+                    range.components != 1 || views[range.view].stride != 0)
+                {
+                    return false;
+                }
+                // 8 bit indices would need VK_EXT_index_type_uint8
+                if (range.componentType == Gltf::ComponentUnsignedShort)
+                {
+                    result.IndexType = VK_INDEX_TYPE_UINT16;
+                }
+                else if (range.componentType == Gltf::ComponentUnsignedInt)
+                {
+                    result.IndexType = VK_INDEX_TYPE_UINT32;
+                }
+                else
+                {
+                    return false;
+                }
+                result.IndexOffset = range.offset;
+                result.IndexCount = range.count;
+                pending.views[4] = range.view;
+            }
+
+            // a missing or malformed material index leaves the primitive without material
+            uint64_t material = 0;
+            result.Material = Gltf::ToUnsigned(json.GetNumber(primitive, "material", -1.0), MaxI32, material)
+                                  ? static_cast<int32_t>(material)
+                                  : -1;
+
+            for (const uint32_t view : pending.views)
+            {
+                if (view != NoView)
+                {
+                    views[view].used = true;
+                }
+            }
+            return true;
+        }
+
+        const ParsedFile &parsed;
+        const JsonDocument &json;
+        std::vector<const JsonValue *> accessors;
+        std::vector<bool> viewValid;
+        bool embeddedBuffer = false;
+    };
+
+    VkResult CreateGeometryBuffer(VulkanDevice *device,
+                                  VkDeviceSize size,
+                                  uint32_t uploadFamily,
+                                  uint32_t consumerFamily,
+                                  Buffer &buffer)
+    {
+        buffer.device = device->logicalDevice;
+
+        const VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        VkBufferCreateInfo bufferInfo = vkinit::bufferCreateInfo(usage, size);
+        // concurrent sharing saves the ownership transfer barriers on both queues for data written exactly once
+        const uint32_t families[] = {uploadFamily, consumerFamily};
+        if (uploadFamily != consumerFamily)
+        {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = 2;
+            bufferInfo.pQueueFamilyIndices = families;
+        }
+        VkResult result = vkCreateBuffer(device->logicalDevice,
+                                         &bufferInfo,
+                                         vkhost::allocationCallbacks(VK_OBJECT_TYPE_BUFFER),
+                                         &buffer.buffer);
+        if (result != VK_SUCCESS)
+        {
+            return result;
+        }
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements(device->logicalDevice, buffer.buffer, &memoryRequirements);
+        VkMemoryAllocateInfo allocateInfo = vkinit::memoryAllocateInfo();
+        allocateInfo.allocationSize = memoryRequirements.size;
+        allocateInfo.memoryTypeIndex =
+            device->getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        result = vkAllocateMemory(device->logicalDevice,
+                                  &allocateInfo,
+                                  vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY),
+                                  &buffer.memory);
+        if (result != VK_SUCCESS)
+        {
+            return result;
+        }
+
+        buffer.alignment = memoryRequirements.alignment;
+        buffer.size = size;
+        buffer.usageFlags = usage;
+        buffer.memoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        buffer.setupDescriptor();
+        return buffer.bind();
+    }
+
+    // geometrySize receives the size of the geometry buffer, returns false if it could not be allocated
+    bool UploadGltf(ParsedFile &file,
+                    MeshModel &model,
+                    VulkanDevice *device,
+                    UploadQueue &uploads,
+                    uint32_t consumerFamily,
+                    VkDeviceSize &geometrySize)
+    {
+        GltfLayout layout(file);
+        layout.Build(model);
+        if (layout.skipped > 0)
+        {
+            Log::Warning("{0}: skipped {1} primitives that are not indexed triangle lists with embedded data",
+                         file.path,
+                         layout.skipped);
+        }
+
+        geometrySize = 0;
+        for (ViewRange &view : layout.views)
+        {
+            if (view.used)
+            {
+                view.target = geometrySize;
+                geometrySize += (view.length + ViewAlignment - 1) & ~(ViewAlignment - 1);
+            }
+        }
+        if (geometrySize > 0)
+        {
+            if (CreateGeometryBuffer(
+                    device, geometrySize, uploads.GetQueueFamilyIndex(), consumerFamily, model.Geometry) != VK_SUCCESS)
+            {
+                Log::Error("Could not allocate {0} bytes of geometry for {1}", geometrySize, file.path);
+                return false;
+            }
+
+            for (const ViewRange &view : layout.views)
+            {
+                if (view.used)
+                {
+                    uploads.CopyToBuffer(file.bin + view.offset, view.length, model.Geometry.buffer, view.target);
+                }
+            }
+            model.UploadValue = uploads.Submit();
+        }
+
+        for (PendingPrimitive &pending : layout.primitives)
+        {
+            MeshPrimitive &primitive = pending.primitive;
+            MeshAttribute *attributes[] = {
+                &primitive.Position, &primitive.Normal, &primitive.TexCoord, &primitive.Tangent};
+            for (uint32_t attribute = 0; attribute < 4; attribute++)
+            {
+                if (pending.views[attribute] != NoView)
+                {
+                    attributes[attribute]->Offset += layout.views[pending.views[attribute]].target;
+                }
+            }
+            if (pending.views[4] != NoView)
+            {
+                primitive.IndexOffset += layout.views[pending.views[4]].target;
+            }
+            model.Meshes[pending.mesh].Primitives.push_back(primitive);
+        }
+        return true;
+    }
+
+    // the data block is laid out exactly like the geometry buffer, a single copy uploads the whole file
+    bool UploadBaked(ParsedFile &file,
+                     MeshModel &model,
+                     VulkanDevice *device,
+                     UploadQueue &uploads,
+                     uint32_t consumerFamily,
+                     VkDeviceSize &geometrySize)
+    {
+        const uint8_t *data = file.data;
+        const BakedMeshHeader &header = file.bakedHeader;
+
+        model.Meshes.resize(header.MeshCount);
+        const char *names = reinterpret_cast<const char *>(data + header.NamesOffset);
+        for (uint32_t i = 0; i < header.MeshCount; i++)
+        {
+            BakedMeshRecord record;
+            std::memcpy(&record, data + sizeof(header) + i * sizeof(record), sizeof(record));
+            model.Meshes[i].Name = std::string(names + record.NameOffset, record.NameLength);
+        }
+
+        const uint8_t *primitives = data + sizeof(header) + header.MeshCount * sizeof(BakedMeshRecord);
+        for (uint32_t i = 0; i < header.PrimitiveCount; i++)
+        {
+            BakedPrimitive baked;
+            std::memcpy(&baked, primitives + i * sizeof(baked), sizeof(baked));
+
+            MeshPrimitive primitive;
+            primitive.VertexCount = baked.VertexCount;
+            primitive.IndexOffset = baked.IndexOffset;
+            primitive.IndexCount = baked.IndexCount;
+            primitive.IndexType = baked.Flags & BakedPrimitiveIndex16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+            primitive.Material = baked.Material;
+            primitive.PositionOffset =
+                glm::vec3(baked.PositionOffset[0], baked.PositionOffset[1], baked.PositionOffset[2]);
+            primitive.PositionScale = glm::vec3(baked.PositionScale[0], baked.PositionScale[1], baked.PositionScale[2]);
+
+            const auto attribute = [&](MeshAttribute &target, VkFormat format, uint32_t offset)
+            {
+                target.Format = format;
+                target.Offset = baked.VertexOffset + offset;
+                target.Stride = baked.VertexStride;
+            };
+            attribute(primitive.Position,
+                      baked.Flags & BakedPrimitiveQuantizedPositions ? VK_FORMAT_R16G16B16A16_UNORM
+                                                                     : VK_FORMAT_R32G32B32_SFLOAT,
+                      0);
+            if (baked.Flags & BakedPrimitiveHasNormals)
+            {
+                attribute(primitive.Normal, VK_FORMAT_R16G16_SNORM, BakedNormalOffset(baked.Flags));
+            }
+            if (baked.Flags & BakedPrimitiveHasTangents)
+            {
+                attribute(primitive.Tangent, VK_FORMAT_R8G8B8A8_SNORM, BakedTangentOffset(baked.Flags));
+            }
+            if (baked.Flags & BakedPrimitiveHasTexCoords)
+            {
+                attribute(primitive.TexCoord, VK_FORMAT_R16G16_SFLOAT, BakedTexCoordOffset(baked.Flags));
+            }
+            model.Meshes[baked.Mesh].Primitives.push_back(primitive);
+        }
+
+        geometrySize = header.DataSize;
+        if (geometrySize > 0)
+        {
+            if (CreateGeometryBuffer(
+                    device, geometrySize, uploads.GetQueueFamilyIndex(), consumerFamily, model.Geometry) != VK_SUCCESS)
+            {
+                Log::Error("Could not allocate {0} bytes of geometry for {1}", geometrySize, file.path);
+                return false;
+            }
+            uploads.CopyToBuffer(data + header.DataOffset, geometrySize, model.Geometry.buffer, 0);
+            model.UploadValue = uploads.Submit();
+        }
+        return true;
+    }
+
+    // takes the files in order as their parse job finishes and queues their upload
+    bool UploadFiles(std::vector<ParsedFile> &files,
+                     std::vector<JobCounter> &parsed,
+                     JobSystem &jobs,
+                     VulkanDevice *device,
+                     UploadQueue &uploads,
+                     uint32_t consumerFamily,
+                     std::vector<MeshModel> &models)
+    {
+        bool success = true;
+        for (uint32_t i = 0; i < files.size(); i++)
+        {
+            // helps with the remaining parse jobs while this one is not done yet
+            jobs.Wait(parsed[i]);
+            ParsedFile &file = files[i];
+            if (!file.valid)
+            {
+                success = false;
+                continue;
+            }
+
+            MeshModel model;
+            model.Path = file.path;
+            VkDeviceSize geometrySize = 0;
+            const bool uploaded = file.baked
+                                      ? UploadBaked(file, model, device, uploads, consumerFamily, geometrySize)
+                                      : UploadGltf(file, model, device, uploads, consumerFamily, geometrySize);
+            if (!uploaded)
+            {
+                model.Destroy();
+                success = false;
+                continue;
+            }
+
+            size_t primitiveCount = 0;
+            for (const Mesh &mesh : model.Meshes)
+            {
+                primitiveCount += mesh.Primitives.size();
+            }
+            Log::Info("Loaded {0}: {1} meshes, {2} primitives, {3:.1f} MiB of geometry",
+                      file.path,
+                      model.Meshes.size(),
+                      primitiveCount,
+                      static_cast<double>(geometrySize) / (1024.0 * 1024.0));
+
+            // everything was copied into the staging ring, the pages of the file are not needed anymore
+            if (file.entry)
+            {
+                file.archive->Release(*file.entry);
+            }
+            file.file.Close();
+            models.push_back(std::move(model));
+        }
+        return success;
+    }
+}
+
+MeshLoader::MeshLoader(VulkanDevice *device, JobSystem &jobs, UploadQueue &uploads, uint32_t consumerQueueFamily)
+    : vulkanDevice(device), jobSystem(jobs), uploadQueue(uploads), consumerFamily(consumerQueueFamily)
+{
+}
+
+/**
+ * Load every file and queue the upload of its geometry, returns before the GPU copies finished
+ *
+ * @param paths .glb or .vmesh files to load, the format is detected from the file's contents
+ * @param models Receives one model per file that loaded, wait for its UploadValue before drawing it
+ *
+ * @return False if any file could not be loaded, the others are still returned
+ */
+bool MeshLoader::Load(const std::vector<std::string> &paths, std::vector<MeshModel> &models)
+{
+    VANADIUM_ZONE("MeshLoader::Load");
+
+    std::vector<ParsedFile> files(paths.size());
+    std::vector<JobCounter> parsed(paths.size());
+    const ParseContext context{files.data()};
+    for (uint32_t i = 0; i < paths.size(); i++)
+    {
+        files[i].path = paths[i];
+        jobSystem.Run(&ParseJob, &context, i, i + 1, parsed[i]);
+    }
+
+    return UploadFiles(files, parsed, jobSystem, vulkanDevice, uploadQueue, consumerFamily, models);
+}
+
+/**
+ * Load meshes packed into an asset archive, the payloads are read in place from the archive's mapping
+ *
+ * @param archive Open archive, has to stay open until this returns
+ * @param names Entry names of .glb or .vmesh payloads, the models' Path is set to the name
+ * @param models Receives one model per entry that loaded, wait for its UploadValue before drawing it
+ *
+ * @return False if any entry is missing or could not be loaded, the others are still returned
+ */
+bool MeshLoader::Load(const AssetArchive &archive,
+                      const std::vector<std::string> &names,
+                      std::vector<MeshModel> &models)
+{
+    VANADIUM_ZONE("MeshLoader::Load archive");
+
+    std::vector<ParsedFile> files(names.size());
+    std::vector<JobCounter> parsed(names.size());
+    const ParseContext context{files.data()};
+    for (uint32_t i = 0; i < names.size(); i++)
+    {
+        files[i].path = names[i];
+        files[i].archive = &archive;
+        files[i].entry = archive.Find(names[i]);
+        if (!files[i].entry)
+        {
+            Log::Error("Asset archive does not contain {0}", names[i]);
+            continue;
+        }
+        // the OS pages in the later entries while the first ones are parsed and uploaded
+        archive.Prefetch(*files[i].entry);
+    }
+    for (uint32_t i = 0; i < names.size(); i++)
+    {
+        if (files[i].entry)
+        {
+            jobSystem.Run(&ParseJob, &context, i, i + 1, parsed[i]);
+        }
+    }
+
+    return UploadFiles(files, parsed, jobSystem, vulkanDevice, uploadQueue, consumerFamily, models);
+}
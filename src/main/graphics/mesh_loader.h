@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan/vk_buffer.h"
+
+class AssetArchive;
+class JobSystem;
+class UploadQueue;
+struct VulkanDevice;
+
+/** @brief One vertex stream of a primitive inside the model's geometry buffer */
+struct MeshAttribute
+{
+    // VK_FORMAT_UNDEFINED if the primitive does not have this attribute
+    VkFormat Format = VK_FORMAT_UNDEFINED;
+    VkDeviceSize Offset = 0;
+    uint32_t Stride = 0;
+};
+
+/**
+ * @brief Draw ranges of one primitive
+ *
+ * Normals and tangents with two components are octahedral encoded, the tangent's third component is then the sign
+ * of the bitangent. Quantized positions are decoded as PositionOffset + PositionScale * value.
+ */
+struct MeshPrimitive
+{
+    MeshAttribute Position;
+    MeshAttribute Normal;
+    MeshAttribute TexCoord;
+    MeshAttribute Tangent;
+    uint32_t VertexCount = 0;
+
+    // IndexCount is 0 for non-indexed primitives
+    VkDeviceSize IndexOffset = 0;
+    uint32_t IndexCount = 0;
+    VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+
+    // index into the glTF materials, -1 for the default material
+    int32_t Material = -1;
+
+    glm::vec3 PositionOffset{0.0f};
+    glm::vec3 PositionScale{1.0f};
+};
+
+struct Mesh
+{
+    std::string Name;
+    std::vector<MeshPrimitive> Primitives;
+};
+
+/** @brief Geometry of one glTF or baked mesh file, all primitives read from a single device local buffer */
+struct MeshModel
+{
+    std::string Path;
+    Buffer Geometry;
+    std::vector<Mesh> Meshes;
+    // Geometry may only be read once the upload queue's timeline reached this value
+    uint64_t UploadValue = 0;
+
+    void Destroy()
+    {
+        Geometry.destroy();
+        Geometry = {};
+        Meshes.clear();
+    }
+};
+
+/**
+ * @brief Loads binary glTF (.glb) and baked (.vmesh) files straight from a memory mapping into device local buffers
+ *
+ * Mapping the files and parsing their JSON chunk runs on the job system, one job per file. The calling thread takes
+ * the files in order as soon as their job finished and copies every buffer view a primitive uses directly from the
+ * mapped BIN chunk into the upload queue's staging ring, so the vertex data is never copied into an intermediate
+ * container. Only triangle lists with 16 or 32 bit indices and data embedded in the BIN chunk are supported, other
+ * primitives are skipped with a warning.
+ *
+ * Baked meshes written by vanadium_bake are already laid out like the geometry buffer: their data block is uploaded
+ * with a single copy and only the small primitive table is read on the CPU.
+ *
+ * Both formats can also be read from an asset archive, which saves opening and mapping every file on its own.
+ */
+class MeshLoader
+{
+public:
+    /**
+     * @param consumerQueueFamily Family of the queue that reads the geometry, the buffers are shared concurrently
+     *                            with the upload queue's family if the two differ
+     */
+    MeshLoader(VulkanDevice *device, JobSystem &jobs, UploadQueue &uploads, uint32_t consumerQueueFamily);
+
+    bool Load(const std::vector<std::string> &paths, std::vector<MeshModel> &models);
+    bool Load(const AssetArchive &archive, const std::vector<std::string> &names, std::vector<MeshModel> &models);
+
+private:
+    VulkanDevice *vulkanDevice;
+    JobSystem &jobSystem;
+    UploadQueue &uploadQueue;
+    uint32_t consumerFamily;
+};
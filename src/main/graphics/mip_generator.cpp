@@ -0,0 +1,283 @@
+#include "mip_generator.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "core/log.h"
+#include "texture.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_host_memory.h"
+#include "vulkan/vk_initializers.h"
+#include "vulkan/vk_tools.h"
+
+namespace
+{
+    // a group covers a 32x32 block of level 1, must match GROUP_SIZE * 2 of mip_generation.glsl
+    constexpr uint32_t GroupTexels = 32;
+}
+
+/**
+ * Create the counter ring, descriptor pool and the pipelines for every supported format
+ *
+ * @param device Device to create all resources on
+ * @param shaderDirectory Directory containing the compiled .spv files
+ * @param maxTextures (Optional) Number of textures with mips that can exist at once
+ *
+ * @return VK_SUCCESS if all resources were created
+ */
+VkResult MipGenerator::Initialize(VulkanDevice *device, const std::string &shaderDirectory, uint32_t maxTextures)
+{
+    vulkanDevice = device;
+    this->shaderDirectory = shaderDirectory;
+    const VkDevice logicalDevice = device->logicalDevice;
+
+    std::array<uint32_t, CounterSlots> zeros{};
+    Debug::CheckVulkan(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                            &counters,
+                                            sizeof(zeros),
+                                            zeros.data()));
+    nextCounter = 0;
+
+    // textures hand their set back when they are destroyed
+    const std::vector<VkDescriptorPoolSize> poolSizes = {
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxTextures * MaxMipLevels),
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxTextures),
+    };
+    VkDescriptorPoolCreateInfo poolInfo = vkinit::descriptorPoolCreateInfo(poolSizes, maxTextures);
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    Debug::CheckVulkan(vkCreateDescriptorPool(logicalDevice,
+                                              &poolInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL),
+                                              &descriptorPool));
+
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                           VK_SHADER_STAGE_COMPUTE_BIT,
+                                           0,
+                                           MaxMipLevels),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo = vkinit::descriptorSetLayoutCreateInfo(bindings);
+    Debug::CheckVulkan(vkCreateDescriptorSetLayout(logicalDevice,
+                                                   &layoutInfo,
+                                                   vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
+                                                   &descriptorSetLayout));
+
+    VkPushConstantRange pushRange = vkinit::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                              sizeof(PushConstants),
+                                                              0);
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = vkinit::pipelineLayoutCreateInfo(&descriptorSetLayout);
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    Debug::CheckVulkan(vkCreatePipelineLayout(logicalDevice,
+                                              &pipelineLayoutInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT),
+                                              &pipelineLayout));
+
+    unormPipeline = CreatePipeline("mip_generation_rgba8.comp.spv", false);
+    srgbPipeline = CreatePipeline("mip_generation_rgba8.comp.spv", true);
+    floatPipeline = CreatePipeline("mip_generation_rgba16f.comp.spv", false);
+    if (!unormPipeline || !srgbPipeline || !floatPipeline)
+    {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    Log::System("Mip Generator Init (up to {0} textures)", maxTextures);
+    return VK_SUCCESS;
+}
+
+void MipGenerator::Destroy()
+{
+    if (!vulkanDevice)
+    {
+        return;
+    }
+
+    const VkDevice device = vulkanDevice->logicalDevice;
+    vkDestroyPipeline(device, unormPipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipeline(device, srgbPipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipeline(device, floatPipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipelineLayout(device, pipelineLayout, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+    vkDestroyDescriptorPool(device, descriptorPool, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+    vkDestroyDescriptorSetLayout(device,
+                                 descriptorSetLayout,
+                                 vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+    counters.destroy();
+
+    unormPipeline = srgbPipeline = floatPipeline = VK_NULL_HANDLE;
+    pipelineLayout = VK_NULL_HANDLE;
+    descriptorPool = VK_NULL_HANDLE;
+    descriptorSetLayout = VK_NULL_HANDLE;
+    vulkanDevice = nullptr;
+}
+
+/**
+ * Record the generation of every level below the base level and the transition to shader reads
+ *
+ * @param commandBuffer Command buffer for a graphics queue, submitted after the texture's upload completed
+ * @param texture Texture whose base level was uploaded, left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL for
+ *                fragment and compute shaders
+ */
+void MipGenerator::Record(VkCommandBuffer commandBuffer, Texture &texture)
+{
+    const Image &image = texture.image;
+    const bool generate = image.mipLevels > 1 && (texture.mipDescriptorSet || AllocateDescriptorSet(texture));
+
+    // after an upload the copies are the previous writes, otherwise only earlier sampling has to finish
+    const bool uploaded = texture.layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    const VkAccessFlags previousAccess = uploaded ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+    const VkPipelineStageFlags previousStages =
+        uploaded ? VK_PIPELINE_STAGE_TRANSFER_BIT
+                 : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    const VkPipelineStageFlags readerStages =
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    if (!generate)
+    {
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          image.image,
+                                          previousAccess,
+                                          VK_ACCESS_SHADER_READ_BIT,
+                                          texture.layout,
+                                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                          previousStages,
+                                          readerStages,
+                                          image.subresourceRange());
+        texture.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        return;
+    }
+
+    if (nextCounter == CounterSlots)
+    {
+        // the slots are reused, the dispatches that used them last have to be done resetting them
+        VkBufferMemoryBarrier barrier = vkinit::bufferMemoryBarrier();
+        barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.buffer = counters.buffer;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             1,
+                             &barrier,
+                             0,
+                             nullptr);
+        nextCounter = 0;
+    }
+
+    // level 0 keeps its contents, the other levels are fully rewritten
+    vktools::insertImageMemoryBarrier(commandBuffer,
+                                      image.image,
+                                      previousAccess,
+                                      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                      texture.layout,
+                                      VK_IMAGE_LAYOUT_GENERAL,
+                                      previousStages,
+                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                      image.subresourceRange());
+
+    const uint32_t groupsX = vktools::divideRoundUp(std::max(image.extent.width / 2, 1u), GroupTexels);
+    const uint32_t groupsY = vktools::divideRoundUp(std::max(image.extent.height / 2, 1u), GroupTexels);
+    PushConstants push{};
+    push.extent[0] = static_cast<int32_t>(image.extent.width);
+    push.extent[1] = static_cast<int32_t>(image.extent.height);
+    push.mipCount = static_cast<int32_t>(image.mipLevels);
+    push.groupCount = groupsX * groupsY;
+    push.counter = nextCounter++;
+
+    const VkPipeline pipeline = image.format == VK_FORMAT_R16G16B16A16_SFLOAT ? floatPipeline
+                                : image.format == VK_FORMAT_R8G8B8A8_SRGB    ? srgbPipeline
+                                                                             : unormPipeline;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipelineLayout,
+                            0,
+                            1,
+                            &texture.mipDescriptorSet,
+                            0,
+                            nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+
+    vktools::insertImageMemoryBarrier(commandBuffer,
+                                      image.image,
+                                      VK_ACCESS_SHADER_WRITE_BIT,
+                                      VK_ACCESS_SHADER_READ_BIT,
+                                      VK_IMAGE_LAYOUT_GENERAL,
+                                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                      readerStages,
+                                      image.subresourceRange());
+    texture.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+/**
+ * Check whether textures of a format can have their mips generated
+ */
+bool MipGenerator::Supports(VkFormat format)
+{
+    return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB ||
+           format == VK_FORMAT_R16G16B16A16_SFLOAT;
+}
+
+bool MipGenerator::AllocateDescriptorSet(Texture &texture)
+{
+    const VkDevice device = vulkanDevice->logicalDevice;
+    VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocateInfo(descriptorPool,
+                                                                              &descriptorSetLayout,
+                                                                              1);
+    if (vkAllocateDescriptorSets(device, &allocInfo, &texture.mipDescriptorSet) != VK_SUCCESS)
+    {
+        Log::Error("Mip generator ran out of descriptor sets, the texture keeps only its base level");
+        texture.mipDescriptorSet = VK_NULL_HANDLE;
+        return false;
+    }
+    texture.mipDescriptorPool = descriptorPool;
+
+    // unused bindings alias the last level, the shader never touches them
+    std::array<VkDescriptorImageInfo, MaxMipLevels> mipInfos;
+    for (uint32_t level = 0; level < MaxMipLevels; level++)
+    {
+        const VkImageView view = texture.mipViews[std::min<size_t>(level, texture.mipViews.size() - 1)];
+        mipInfos[level] = vkinit::descriptorImageInfo(VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_GENERAL);
+    }
+    const std::vector<VkWriteDescriptorSet> writes = {
+        vkinit::writeDescriptorSet(texture.mipDescriptorSet,
+                                   VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                   0,
+                                   mipInfos.data(),
+                                   MaxMipLevels),
+        vkinit::writeDescriptorSet(texture.mipDescriptorSet,
+                                   VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                   1,
+                                   &counters.descriptor),
+    };
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    return true;
+}
+
+VkPipeline MipGenerator::CreatePipeline(const char *shaderName, bool srgb) const
+{
+    const VkDevice device = vulkanDevice->logicalDevice;
+    const VkShaderModule shader = vktools::loadShader(shaderDirectory + "/" + shaderName, device);
+    if (!shader)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    const VkBool32 srgbConstant = srgb ? VK_TRUE : VK_FALSE;
+    const VkSpecializationMapEntry entry = vkinit::specializationMapEntry(0, 0, sizeof(VkBool32));
+    const VkSpecializationInfo specialization =
+        vkinit::specializationInfo(1, &entry, sizeof(srgbConstant), &srgbConstant);
+    const VkPipeline pipeline =
+        vktools::createComputePipeline(device, pipelineLayout, shader, &specialization, vulkanDevice->pipelineCache);
+    vkDestroyShaderModule(device, shader, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+    return pipeline;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan/vk_buffer.h"
+
+class Texture;
+struct VulkanDevice;
+
+/**
+ * @brief Builds the whole mip chain of a Texture from its base level in a single compute dispatch
+ *
+ * mip_generation_*.comp reduces 64x64 blocks of the base level in shared memory down to level 6 and the last group to
+ * finish builds the remaining levels, so an 8k texture needs one dispatch and one read of level 0 instead of thirteen
+ * vkCmdBlitImage calls with a barrier between every pair of levels. Levels are 2x2 box filtered, sRGB textures in
+ * linear space.
+ *
+ * Supports R8G8B8A8_UNORM, R8G8B8A8_SRGB and R16G16B16A16_SFLOAT. Every texture gets a descriptor set on its first
+ * Record(), so the generator has to outlive the textures it recorded. Dispatches share a small ring of atomic
+ * counters, all of them have to be recorded for queues of one family.
+ */
+class MipGenerator
+{
+public:
+    // 16 levels cover textures up to 32768 texels wide
+    static constexpr uint32_t MaxMipLevels = 16;
+
+    VkResult Initialize(VulkanDevice *device, const std::string &shaderDirectory, uint32_t maxTextures = 1024);
+    void Destroy();
+
+    void Record(VkCommandBuffer commandBuffer, Texture &texture);
+
+    [[nodiscard]] static bool Supports(VkFormat format);
+
+private:
+    // mirrors PushConstants in mip_generation.glsl
+    struct PushConstants
+    {
+        int32_t extent[2];
+        int32_t mipCount;
+        uint32_t groupCount;
+        uint32_t counter;
+    };
+
+    // dispatches in flight at once that can use distinct counters, more are separated by a barrier
+    static constexpr uint32_t CounterSlots = 64;
+
+    bool AllocateDescriptorSet(Texture &texture);
+    VkPipeline CreatePipeline(const char *shaderName, bool srgb) const;
+
+    VulkanDevice *vulkanDevice = nullptr;
+    std::string shaderDirectory;
+
+    Buffer counters;
+    uint32_t nextCounter = 0;
+
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline unormPipeline{VK_NULL_HANDLE};
+    VkPipeline srgbPipeline{VK_NULL_HANDLE};
+    VkPipeline floatPipeline{VK_NULL_HANDLE};
+};
@@ -0,0 +1,540 @@
+#include "post_processing.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "core/log.h"
+#include "gpu_profiler.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_host_memory.h"
+#include "vulkan/vk_initializers.h"
+#include "vulkan/vk_tools.h"
+
+namespace
+{
+    // must match GROUP_SIZE of the post shaders
+    constexpr uint32_t DownsampleGroupSize = 16;
+    constexpr uint32_t CompositeGroupSize = 16;
+    constexpr uint32_t IdentityLutSize = 32;
+    const glm::vec4 PostScopeColor{0.9f, 0.5f, 0.2f, 1.0f};
+
+    std::vector<uint32_t> IdentityLut(uint32_t size)
+    {
+        std::vector<uint32_t> texels(static_cast<size_t>(size) * size * size);
+        for (uint32_t b = 0; b < size; b++)
+        {
+            for (uint32_t g = 0; g < size; g++)
+            {
+                for (uint32_t r = 0; r < size; r++)
+                {
+                    const auto channel = [size](uint32_t value)
+                    {
+                        return (value * 255 + (size - 1) / 2) / (size - 1);
+                    };
+                    texels[(b * size + g) * size + r] =
+                        channel(r) | (channel(g) << 8) | (channel(b) << 16) | (255u << 24);
+                }
+            }
+        }
+        return texels;
+    }
+}
+
+/**
+ * Create the bloom chain, the default identity grading LUT, descriptors and pipelines
+ *
+ * @param device Device to create all resources on
+ * @param properties Effect toggles and parameters
+ * @param profiler Optional, times the passes and labels them for capture tools
+ * @param uploadQueue Queue used to upload the default LUT
+ * @param shaderDirectory Directory containing the compiled .spv files
+ *
+ * @return VK_SUCCESS if all resources were created
+ */
+VkResult PostProcessing::Initialize(VulkanDevice *device,
+                                    const PostProcessingProperties &properties,
+                                    GpuProfiler *profiler,
+                                    VkQueue uploadQueue,
+                                    const std::string &shaderDirectory)
+{
+    vulkanDevice = device;
+    gpuProfiler = profiler;
+    settings = properties;
+    this->shaderDirectory = shaderDirectory;
+
+    const VkExtent2D bloomExtent{std::max(settings.MaxWidth / 2, 1u), std::max(settings.MaxHeight / 2, 1u)};
+    const uint32_t supportedMips = std::bit_width(std::min(bloomExtent.width, bloomExtent.height));
+    bloomMipCount = std::clamp(settings.BloomMips, 1u, std::min(MaxBloomMips, supportedMips));
+
+    Debug::CheckVulkan(device->createImage(VK_FORMAT_R16G16B16A16_SFLOAT,
+                                           bloomExtent,
+                                           VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           &bloomChain,
+                                           bloomMipCount));
+
+    // unused storage bindings alias the last level, the shaders never touch them
+    for (uint32_t level = 0; level < MaxBloomMips; level++)
+    {
+        VkImageViewCreateInfo viewInfo = vkinit::imageViewCreateInfo();
+        viewInfo.image = bloomChain.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = bloomChain.format;
+        viewInfo.subresourceRange = bloomChain.subresourceRange();
+        viewInfo.subresourceRange.baseMipLevel = std::min(level, bloomMipCount - 1);
+        viewInfo.subresourceRange.levelCount = 1;
+        Debug::CheckVulkan(vkCreateImageView(device->logicalDevice,
+                                             &viewInfo,
+                                             vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW),
+                                             &bloomMipViews[level]));
+    }
+
+    uint32_t zero = 0;
+    Debug::CheckVulkan(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                            &downsampleCounter,
+                                            sizeof(uint32_t),
+                                            &zero));
+
+    VkSamplerCreateInfo samplerInfo = vkinit::samplerCreateInfo();
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = static_cast<float>(MaxBloomMips);
+    Debug::CheckVulkan(vkCreateSampler(device->logicalDevice,
+                                       &samplerInfo,
+                                       vkhost::allocationCallbacks(VK_OBJECT_TYPE_SAMPLER),
+                                       &linearSampler));
+
+    CreateDescriptors();
+    SetColorGradingLut(IdentityLut(IdentityLutSize), IdentityLutSize, uploadQueue);
+    CreatePipelines();
+    if (!downsamplePipeline || !compositePipeline)
+    {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    Log::System("Post Processing Init (bloom {0} with {1} levels, tonemap {2}, grading {3}, vignette {4})",
+                settings.Bloom,
+                bloomMipCount,
+                settings.Tonemap,
+                settings.ColorGrading,
+                settings.Vignette);
+    return VK_SUCCESS;
+}
+
+void PostProcessing::Destroy()
+{
+    if (!vulkanDevice)
+    {
+        return;
+    }
+
+    const VkDevice device = vulkanDevice->logicalDevice;
+    vkDestroyPipeline(device, downsamplePipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipeline(device, compositePipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipelineLayout(device, pipelineLayout, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+    vkDestroyDescriptorPool(device, descriptorPool, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+    vkDestroyDescriptorSetLayout(device,
+                                 descriptorSetLayout,
+                                 vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+    vkDestroySampler(device, linearSampler, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SAMPLER));
+    for (VkImageView view : bloomMipViews)
+    {
+        vkDestroyImageView(device, view, vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW));
+    }
+    bloomChain.destroy();
+    gradingLut.destroy();
+    downsampleCounter.destroy();
+
+    vulkanDevice = nullptr;
+}
+
+/**
+ * Point the descriptors at new scene and output images, only needed when the images are (re)created
+ *
+ * @note Must not be called while a command buffer using the previous images is pending
+ */
+void PostProcessing::SetImages(const Image &sceneColor, const Image &output)
+{
+    if (output.format != VK_FORMAT_R8G8B8A8_UNORM || !(output.usageFlags & VK_IMAGE_USAGE_STORAGE_BIT))
+    {
+        Log::Error("Post processing output has to be a R8G8B8A8_UNORM storage image");
+        return;
+    }
+
+    VkDescriptorImageInfo sceneInfo = vkinit::descriptorImageInfo(linearSampler,
+                                                                  sceneColor.view,
+                                                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    VkDescriptorImageInfo outputInfo = vkinit::descriptorImageInfo(VK_NULL_HANDLE,
+                                                                   output.view,
+                                                                   VK_IMAGE_LAYOUT_GENERAL);
+    const std::vector<VkWriteDescriptorSet> writes = {
+        vkinit::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &sceneInfo),
+        vkinit::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 5, &outputInfo),
+    };
+    vkUpdateDescriptorSets(vulkanDevice->logicalDevice,
+                           static_cast<uint32_t>(writes.size()),
+                           writes.data(),
+                           0,
+                           nullptr);
+}
+
+/**
+ * Replace the color grading LUT
+ *
+ * @param texels size^3 RGBA8 texels, red varies fastest, authored on sRGB encoded input
+ * @param size Edge length of the LUT cube
+ * @param uploadQueue Graphics queue the upload is submitted to, waits for completion
+ */
+void PostProcessing::SetColorGradingLut(const std::vector<uint32_t> &texels, uint32_t size, VkQueue uploadQueue)
+{
+    if (size < 2 || texels.size() != static_cast<size_t>(size) * size * size)
+    {
+        Log::Error("Color grading LUT needs {0}^3 texels, got {1}", size, texels.size());
+        return;
+    }
+
+    const VkDevice device = vulkanDevice->logicalDevice;
+    if (size != gradingLutSize)
+    {
+        vkDeviceWaitIdle(device);
+        gradingLut.destroy();
+
+        gradingLut.device = device;
+        gradingLut.format = VK_FORMAT_R8G8B8A8_UNORM;
+        gradingLut.extent = {size, size};
+        gradingLut.usageFlags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+        VkImageCreateInfo imageInfo = vkinit::imageCreateInfo();
+        imageInfo.imageType = VK_IMAGE_TYPE_3D;
+        imageInfo.format = gradingLut.format;
+        imageInfo.extent = {size, size, size};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = gradingLut.usageFlags;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        Debug::CheckVulkan(vkCreateImage(device,
+                                         &imageInfo,
+                                         vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE),
+                                         &gradingLut.image));
+
+        VkMemoryRequirements memReqs;
+        vkGetImageMemoryRequirements(device, gradingLut.image, &memReqs);
+        VkMemoryAllocateInfo memAlloc = vkinit::memoryAllocateInfo();
+        memAlloc.allocationSize = memReqs.size;
+        memAlloc.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits,
+                                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        Debug::CheckVulkan(vkAllocateMemory(device,
+                                            &memAlloc,
+                                            vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY),
+                                            &gradingLut.memory));
+        Debug::CheckVulkan(vkBindImageMemory(device, gradingLut.image, gradingLut.memory, 0));
+
+        VkImageViewCreateInfo viewInfo = vkinit::imageViewCreateInfo();
+        viewInfo.image = gradingLut.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_3D;
+        viewInfo.format = gradingLut.format;
+        viewInfo.subresourceRange = gradingLut.subresourceRange();
+        Debug::CheckVulkan(vkCreateImageView(device,
+                                             &viewInfo,
+                                             vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW),
+                                             &gradingLut.view));
+        gradingLutSize = size;
+
+        VkDescriptorImageInfo lutInfo = vkinit::descriptorImageInfo(linearSampler,
+                                                                    gradingLut.view,
+                                                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        VkWriteDescriptorSet write = vkinit::writeDescriptorSet(descriptorSet,
+                                                                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                                4,
+                                                                &lutInfo);
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+
+    Buffer staging;
+    Debug::CheckVulkan(vulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                  &staging,
+                                                  texels.size() * sizeof(uint32_t),
+                                                  const_cast<uint32_t *>(texels.data())));
+
+    VkCommandBuffer commandBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    vktools::insertImageMemoryBarrier(commandBuffer,
+                                      gradingLut.image,
+                                      0,
+                                      VK_ACCESS_TRANSFER_WRITE_BIT,
+                                      VK_IMAGE_LAYOUT_UNDEFINED,
+                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                      VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                      gradingLut.subresourceRange());
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {size, size, size};
+    vkCmdCopyBufferToImage(commandBuffer,
+                           staging.buffer,
+                           gradingLut.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1,
+                           &region);
+    vktools::insertImageMemoryBarrier(commandBuffer,
+                                      gradingLut.image,
+                                      VK_ACCESS_TRANSFER_WRITE_BIT,
+                                      VK_ACCESS_SHADER_READ_BIT,
+                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                      VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                      gradingLut.subresourceRange());
+    vulkanDevice->flushCommandBuffer(commandBuffer, uploadQueue);
+    staging.destroy();
+}
+
+/**
+ * Toggle effects, rebuilds the composite pipeline so it should not be called every frame
+ */
+void PostProcessing::SetEffects(bool bloom, bool tonemap, bool colorGrading, bool vignette)
+{
+    if (bloom == settings.Bloom && tonemap == settings.Tonemap &&
+        colorGrading == settings.ColorGrading && vignette == settings.Vignette)
+    {
+        return;
+    }
+
+    settings.Bloom = bloom;
+    settings.Tonemap = tonemap;
+    settings.ColorGrading = colorGrading;
+    settings.Vignette = vignette;
+
+    vkDeviceWaitIdle(vulkanDevice->logicalDevice);
+    CreatePipelines();
+}
+
+void PostProcessing::SetExposure(float exposure)
+{
+    settings.Exposure = exposure;
+}
+
+/**
+ * Record the post stack for the render extent of the scene color into the output
+ */
+void PostProcessing::Record(VkCommandBuffer commandBuffer, VkExtent2D renderExtent)
+{
+    BeginScope(commandBuffer, "Post");
+
+    const uint32_t bloomWidth = std::max(renderExtent.width / 2, 1u);
+    const uint32_t bloomHeight = std::max(renderExtent.height / 2, 1u);
+    const uint32_t downsampleGroupsX = vktools::divideRoundUp(bloomWidth, DownsampleGroupSize);
+    const uint32_t downsampleGroupsY = vktools::divideRoundUp(bloomHeight, DownsampleGroupSize);
+
+    PushConstants push{};
+    push.sceneExtent[0] = static_cast<float>(renderExtent.width);
+    push.sceneExtent[1] = static_cast<float>(renderExtent.height);
+    push.sceneExtent[2] = 1.0f / static_cast<float>(settings.MaxWidth);
+    push.sceneExtent[3] = 1.0f / static_cast<float>(settings.MaxHeight);
+    push.bloom[0] = settings.BloomThreshold;
+    push.bloom[1] = settings.BloomKnee;
+    push.bloom[2] = static_cast<float>(bloomMipCount);
+    push.bloom[3] = static_cast<float>(downsampleGroupsX * downsampleGroupsY);
+    push.composite[0] = settings.BloomIntensity;
+    push.composite[1] = settings.Exposure;
+    push.composite[2] = settings.VignetteIntensity;
+
+    vkCmdBindDescriptorSets(commandBuffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipelineLayout,
+                            0,
+                            1,
+                            &descriptorSet,
+                            0,
+                            nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+
+    BeginScope(commandBuffer, "Bloom");
+    if (settings.Bloom)
+    {
+        // previous contents are fully rewritten inside the render extent
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          bloomChain.image,
+                                          VK_ACCESS_SHADER_READ_BIT,
+                                          VK_ACCESS_SHADER_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_UNDEFINED,
+                                          VK_IMAGE_LAYOUT_GENERAL,
+                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                          bloomChain.subresourceRange());
+        // the last group of the previous downsample resets the counter, this one has to see the reset
+        VkBufferMemoryBarrier counterBarrier = vkinit::bufferMemoryBarrier();
+        counterBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        counterBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        counterBarrier.buffer = downsampleCounter.buffer;
+        counterBarrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             1,
+                             &counterBarrier,
+                             0,
+                             nullptr);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, downsamplePipeline);
+        vkCmdDispatch(commandBuffer, downsampleGroupsX, downsampleGroupsY, 1);
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          bloomChain.image,
+                                          VK_ACCESS_SHADER_WRITE_BIT,
+                                          VK_ACCESS_SHADER_READ_BIT,
+                                          VK_IMAGE_LAYOUT_GENERAL,
+                                          VK_IMAGE_LAYOUT_GENERAL,
+                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                          bloomChain.subresourceRange());
+    }
+    EndScope(commandBuffer);
+
+    BeginScope(commandBuffer, "Composite");
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compositePipeline);
+    vkCmdDispatch(commandBuffer,
+                  vktools::divideRoundUp(renderExtent.width, CompositeGroupSize),
+                  vktools::divideRoundUp(renderExtent.height, CompositeGroupSize),
+                  1);
+    EndScope(commandBuffer);
+    EndScope(commandBuffer);
+}
+
+void PostProcessing::CreateDescriptors()
+{
+    const VkDevice device = vulkanDevice->logicalDevice;
+
+    const std::vector<VkDescriptorPoolSize> poolSizes = {
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3),
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MaxBloomMips + 1),
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1),
+    };
+    VkDescriptorPoolCreateInfo poolInfo = vkinit::descriptorPoolCreateInfo(poolSizes, 1);
+    Debug::CheckVulkan(vkCreateDescriptorPool(device,
+                                              &poolInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL),
+                                              &descriptorPool));
+
+    const VkShaderStageFlags stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, stage, 0),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, stage, 1, MaxBloomMips),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stage, 2),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, stage, 3),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, stage, 4),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, stage, 5),
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo = vkinit::descriptorSetLayoutCreateInfo(bindings);
+    Debug::CheckVulkan(vkCreateDescriptorSetLayout(device,
+                                                   &layoutInfo,
+                                                   vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
+                                                   &descriptorSetLayout));
+
+    VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocateInfo(descriptorPool,
+                                                                              &descriptorSetLayout,
+                                                                              1);
+    Debug::CheckVulkan(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
+
+    std::array<VkDescriptorImageInfo, MaxBloomMips> mipInfos;
+    for (uint32_t level = 0; level < MaxBloomMips; level++)
+    {
+        mipInfos[level] = vkinit::descriptorImageInfo(VK_NULL_HANDLE, bloomMipViews[level], VK_IMAGE_LAYOUT_GENERAL);
+    }
+    VkDescriptorImageInfo chainInfo = vkinit::descriptorImageInfo(linearSampler,
+                                                                  bloomChain.view,
+                                                                  VK_IMAGE_LAYOUT_GENERAL);
+    const std::vector<VkWriteDescriptorSet> writes = {
+        vkinit::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, mipInfos.data(), MaxBloomMips),
+        vkinit::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &downsampleCounter.descriptor),
+        vkinit::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &chainInfo),
+    };
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    VkPushConstantRange pushRange = vkinit::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                              sizeof(PushConstants),
+                                                              0);
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = vkinit::pipelineLayoutCreateInfo(&descriptorSetLayout);
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    Debug::CheckVulkan(vkCreatePipelineLayout(device,
+                                              &pipelineLayoutInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT),
+                                              &pipelineLayout));
+}
+
+void PostProcessing::CreatePipelines()
+{
+    const VkDevice device = vulkanDevice->logicalDevice;
+
+    if (!downsamplePipeline)
+    {
+        const VkShaderModule downsampleShader = vktools::loadShader(shaderDirectory + "/post_bloom_downsample.comp.spv",
+                                                                    device);
+        if (downsampleShader)
+        {
+            downsamplePipeline = vktools::createComputePipeline(device,
+                                                                pipelineLayout,
+                                                                downsampleShader,
+                                                                nullptr,
+                                                                vulkanDevice->pipelineCache);
+        }
+        vkDestroyShaderModule(device, downsampleShader, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+    }
+
+    vkDestroyPipeline(device, compositePipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    compositePipeline = VK_NULL_HANDLE;
+
+    const VkShaderModule compositeShader = vktools::loadShader(shaderDirectory + "/post_composite.comp.spv", device);
+    if (!compositeShader)
+    {
+        return;
+    }
+
+    const VkBool32 effects[] = {
+        settings.Bloom ? VK_TRUE : VK_FALSE,
+        settings.Tonemap ? VK_TRUE : VK_FALSE,
+        settings.ColorGrading ? VK_TRUE : VK_FALSE,
+        settings.Vignette ? VK_TRUE : VK_FALSE,
+    };
+    VkSpecializationMapEntry entries[4];
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        entries[i] = vkinit::specializationMapEntry(i, i * sizeof(VkBool32), sizeof(VkBool32));
+    }
+    const VkSpecializationInfo specialization = vkinit::specializationInfo(4, entries, sizeof(effects), effects);
+    compositePipeline = vktools::createComputePipeline(device,
+                                                       pipelineLayout,
+                                                       compositeShader,
+                                                       &specialization,
+                                                       vulkanDevice->pipelineCache);
+    vkDestroyShaderModule(device, compositeShader, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+}
+
+void PostProcessing::BeginScope(VkCommandBuffer commandBuffer, const char *name)
+{
+    if (gpuProfiler)
+    {
+        gpuProfiler->BeginScope(commandBuffer, name, PostScopeColor);
+    }
+}
+
+void PostProcessing::EndScope(VkCommandBuffer commandBuffer)
+{
+    if (gpuProfiler)
+    {
+        gpuProfiler->EndScope(commandBuffer);
+    }
+}
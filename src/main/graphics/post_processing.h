@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan/vk_buffer.h"
+#include "vulkan/vk_image.h"
+
+class GpuProfiler;
+struct VulkanDevice;
+
+struct PostProcessingProperties
+{
+    // effect toggles, baked into the composite pipeline as specialization constants
+    bool Bloom = true;
+    bool Tonemap = true;
+    bool ColorGrading = true;
+    bool Vignette = true;
+
+    float BloomThreshold = 1.0f;
+    // fraction of the threshold over which bloom fades in
+    float BloomKnee = 0.5f;
+    float BloomIntensity = 0.05f;
+    // clamped to what the half resolution chain of the maximum extent supports
+    uint32_t BloomMips = 8;
+    float Exposure = 1.0f;
+    float VignetteIntensity = 0.25f;
+
+    // size of the scene color target, the render extent never exceeds this
+    uint32_t MaxWidth = 1920;
+    uint32_t MaxHeight = 1080;
+};
+
+/**
+ * @brief Compute post processing stack: bloom, tonemapping, 3D LUT color grading and vignette
+ *
+ * Two dispatches with at most two full frame reads and one full frame write:
+ *  - post_bloom_downsample.comp builds the whole bloom chain in a single pass (shared memory reduction)
+ *  - post_composite.comp upsamples bloom per tile in shared memory and applies every other effect
+ *
+ * The scene color has to be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and the R8G8B8A8_UNORM output in
+ * VK_IMAGE_LAYOUT_GENERAL when Record() is called. The output is sRGB encoded and display referred, ready for the
+ * Upscaler or a copy to the swapchain.
+ *
+ * With a GpuProfiler the passes are timed as the scopes "Post/Bloom" and "Post/Composite".
+ */
+class PostProcessing
+{
+public:
+    VkResult Initialize(VulkanDevice *device,
+                        const PostProcessingProperties &properties,
+                        GpuProfiler *profiler,
+                        VkQueue uploadQueue,
+                        const std::string &shaderDirectory);
+    void Destroy();
+
+    void SetImages(const Image &sceneColor, const Image &output);
+    void SetColorGradingLut(const std::vector<uint32_t> &texels, uint32_t size, VkQueue uploadQueue);
+    void SetEffects(bool bloom, bool tonemap, bool colorGrading, bool vignette);
+    void SetExposure(float exposure);
+
+    void Record(VkCommandBuffer commandBuffer, VkExtent2D renderExtent);
+
+private:
+    static constexpr uint32_t MaxBloomMips = 8;
+
+    // mirrors PushConstants in post_processing.glsl
+    struct PushConstants
+    {
+        float sceneExtent[4];
+        float bloom[4];
+        float composite[4];
+    };
+
+    void CreateDescriptors();
+    void CreatePipelines();
+    void BeginScope(VkCommandBuffer commandBuffer, const char *name);
+    void EndScope(VkCommandBuffer commandBuffer);
+
+    PostProcessingProperties settings;
+    VulkanDevice *vulkanDevice = nullptr;
+    GpuProfiler *gpuProfiler = nullptr;
+    std::string shaderDirectory;
+
+    Image bloomChain;
+    std::array<VkImageView, MaxBloomMips> bloomMipViews{};
+    uint32_t bloomMipCount = 0;
+    Buffer downsampleCounter;
+
+    Image gradingLut;
+    uint32_t gradingLutSize = 0;
+
+    VkSampler linearSampler{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+    VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline downsamplePipeline{VK_NULL_HANDLE};
+    VkPipeline compositePipeline{VK_NULL_HANDLE};
+};
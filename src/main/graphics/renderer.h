@@ -1,18 +1,41 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 struct RendererProperties
 {
     std::string Title = "Renderer";
     bool Debug = false;
     bool PreferIntegratedGraphics = false;
+    // device name substring or UUID that wins over the device score, every candidate's UUID is logged at startup
+    std::string DeviceOverride;
+    // serve small driver host allocations from a thread caching pool instead of malloc
+    bool PoolDriverAllocations = false;
+    // validation messageIdNumbers that break into the debugger, see Debug::ValidationFilterProperties
+    std::vector<int32_t> ValidationBreakIds;
+    // pipeline cache loaded at startup and written back on shutdown, empty disables it
+    std::string PipelineCachePath = "pipeline_cache.bin";
+};
+
+// simulation state handed to the render thread, see FrameLoop
+struct FrameSnapshot
+{
+    uint64_t Tick = 0;
+    double SimulationTime = 0.0;
+    // input events applied by this tick, and when the newest of them arrived (steady_clock nanoseconds)
+    uint32_t InputEvents = 0;
+    int64_t LastInputTimestampNs = 0;
+    uint32_t ViewportWidth = 0;
+    uint32_t ViewportHeight = 0;
 };
 
 class IRenderer
 {
 public:
     virtual bool Initialize() = 0;
-    virtual void OnUpdate() = 0;
+    // called on the render thread with the latest simulation snapshot
+    virtual void OnUpdate(const FrameSnapshot &frame) = 0;
     virtual ~IRenderer() = default;
 };
\ No newline at end of file
@@ -0,0 +1,816 @@
+#include "shadow_atlas.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "core/log.h"
+#include "core/profiler.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_initializers.h"
+#include "vulkan/vk_tools.h"
+
+namespace
+{
+    // weight between logarithmic (1) and uniform (0) cascade splits
+    constexpr float CascadeSplitLambda = 0.75f;
+    // cascade centers move along the light direction in steps of this many texels, the depth range is padded by one
+    constexpr float CascadeDepthSnapTexels = 16.0f;
+
+    glm::vec3 UpVector(const glm::vec3 &direction)
+    {
+        return std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    // planes of a [0, 1] depth clip space frustum (Gribb / Hartmann)
+    bool SphereInFrustum(const glm::mat4 &viewProjection, const glm::vec3 &center, float radius)
+    {
+        const auto row = [&viewProjection](int i)
+        {
+            return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        };
+        const glm::vec4 planes[6] = {
+            row(3) + row(0),
+            row(3) - row(0),
+            row(3) + row(1),
+            row(3) - row(1),
+            row(2),
+            row(3) - row(2),
+        };
+        for (const glm::vec4 &plane : planes)
+        {
+            const glm::vec3 normal(plane);
+            if (glm::dot(normal, center) + plane.w < -radius * glm::length(normal))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+void ShadowAtlasAllocator::Initialize(uint32_t atlasSize, uint32_t newSlabSize)
+{
+    slabSize = newSlabSize;
+    const uint32_t slabsPerRow = atlasSize / slabSize;
+
+    slabs.clear();
+    slabs.resize(static_cast<size_t>(slabsPerRow) * slabsPerRow);
+    for (uint32_t i = 0; i < slabs.size(); i++)
+    {
+        slabs[i].X = (i % slabsPerRow) * slabSize;
+        slabs[i].Y = (i / slabsPerRow) * slabSize;
+    }
+}
+
+/**
+ * Allocate a tile from a slab of the same size, or bind an empty slab to that size
+ *
+ * @param size Power of two edge length, at most the slab size
+ *
+ * @return The allocated tile, an invalid tile (Size 0) if the atlas is full
+ */
+ShadowTile ShadowAtlasAllocator::Allocate(uint32_t size)
+{
+    assert(std::has_single_bit(size) && size <= slabSize);
+
+    Slab *target = nullptr;
+    uint32_t targetIndex = 0;
+    for (uint32_t i = 0; i < slabs.size(); i++)
+    {
+        if (slabs[i].TileSize == size && !slabs[i].freeTiles.empty())
+        {
+            target = &slabs[i];
+            targetIndex = i;
+            break;
+        }
+    }
+
+    if (!target)
+    {
+        for (uint32_t i = 0; i < slabs.size(); i++)
+        {
+            if (slabs[i].TileSize == 0)
+            {
+                target = &slabs[i];
+                targetIndex = i;
+                const uint32_t tilesPerRow = slabSize / size;
+                target->TileSize = size;
+                // reversed so tiles are handed out in row order
+                target->freeTiles.resize(static_cast<size_t>(tilesPerRow) * tilesPerRow);
+                std::iota(target->freeTiles.rbegin(), target->freeTiles.rend(), 0u);
+                break;
+            }
+        }
+    }
+
+    if (!target)
+    {
+        return {};
+    }
+
+    const uint32_t index = target->freeTiles.back();
+    target->freeTiles.pop_back();
+
+    const uint32_t tilesPerRow = slabSize / size;
+    ShadowTile tile;
+    tile.X = target->X + (index % tilesPerRow) * size;
+    tile.Y = target->Y + (index / tilesPerRow) * size;
+    tile.Size = size;
+    tile.Slab = targetIndex;
+    tile.Index = index;
+    return tile;
+}
+
+void ShadowAtlasAllocator::Free(const ShadowTile &tile)
+{
+    if (!tile.Valid())
+    {
+        return;
+    }
+
+    Slab &slab = slabs[tile.Slab];
+    slab.freeTiles.push_back(tile.Index);
+
+    const uint32_t tilesPerRow = slabSize / slab.TileSize;
+    if (slab.freeTiles.size() == static_cast<size_t>(tilesPerRow) * tilesPerRow)
+    {
+        slab.TileSize = 0;
+        slab.freeTiles.clear();
+    }
+}
+
+uint32_t ShadowAtlasAllocator::GetUsedSlabCount() const
+{
+    return static_cast<uint32_t>(std::count_if(slabs.begin(),
+                                               slabs.end(),
+                                               [](const Slab &slab)
+                                               { return slab.TileSize != 0; }));
+}
+
+ShadowAtlas::ShadowAtlas(const ShadowAtlasProperties &properties)
+    : settings(properties)
+{
+    settings.MaxTileSize = std::bit_floor(std::min(settings.MaxTileSize, settings.AtlasSize));
+    settings.MinTileSize = std::bit_floor(std::clamp(settings.MinTileSize, 16u, settings.MaxTileSize));
+    settings.CascadeTileSize = std::bit_floor(std::clamp(settings.CascadeTileSize,
+                                                         settings.MinTileSize,
+                                                         settings.MaxTileSize));
+    allocator.Initialize(settings.AtlasSize, settings.MaxTileSize);
+}
+
+/**
+ * Create the atlas and the static cache atlas, both share the tile layout
+ *
+ * @return VK_SUCCESS if both depth images were created
+ */
+VkResult ShadowAtlas::Initialize(VulkanDevice *device)
+{
+    vulkanDevice = device;
+
+    // D16 is the only depth format guaranteed to be usable as attachment and sampled image
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(device->physicalDevice, settings.DepthFormat, &formatProperties);
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                          VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                          VK_FORMAT_FEATURE_TRANSFER_SRC_BIT |
+                                          VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    if ((formatProperties.optimalTilingFeatures & required) != required)
+    {
+        Log::Warning("Shadow depth format not supported, falling back to D16_UNORM");
+        settings.DepthFormat = VK_FORMAT_D16_UNORM;
+    }
+
+    const VkExtent2D extent{settings.AtlasSize, settings.AtlasSize};
+    Debug::CheckVulkan(device->createImage(settings.DepthFormat,
+                                           extent,
+                                           VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                               VK_IMAGE_USAGE_SAMPLED_BIT |
+                                               VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           &atlas));
+    Debug::CheckVulkan(device->createImage(settings.DepthFormat,
+                                           extent,
+                                           VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                               VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           &staticCache));
+
+    Log::System("Shadow Atlas Init ({0}x{0}, tiles {1}-{2}, {3} cascades, caching {4})",
+                settings.AtlasSize,
+                settings.MinTileSize,
+                settings.MaxTileSize,
+                settings.CascadeCount,
+                settings.Caching);
+    return VK_SUCCESS;
+}
+
+void ShadowAtlas::Destroy()
+{
+    if (!vulkanDevice)
+    {
+        return;
+    }
+
+    atlas.destroy();
+    staticCache.destroy();
+
+    vulkanDevice = nullptr;
+}
+
+ShadowLightHandle ShadowAtlas::AddLight(const ShadowLight &light)
+{
+    ShadowLightHandle handle;
+    if (!freeLights.empty())
+    {
+        handle = freeLights.back();
+        freeLights.pop_back();
+    }
+    else
+    {
+        handle = static_cast<ShadowLightHandle>(lights.size());
+        lights.emplace_back();
+    }
+
+    LightState &state = lights[handle];
+    state = {};
+    state.light = light;
+    state.alive = true;
+    return handle;
+}
+
+/**
+ * Change a light, its static cache is re-rendered only if the resulting view matrices change
+ */
+void ShadowAtlas::UpdateLight(ShadowLightHandle handle, const ShadowLight &light)
+{
+    LightState &state = lights[handle];
+    if (light.Type != state.light.Type)
+    {
+        ReleaseTiles(state);
+    }
+    state.light = light;
+}
+
+void ShadowAtlas::RemoveLight(ShadowLightHandle handle)
+{
+    LightState &state = lights[handle];
+    ReleaseTiles(state);
+    state.alive = false;
+    freeLights.push_back(handle);
+}
+
+ShadowCasterHandle ShadowAtlas::AddCaster(const glm::vec3 &center, float radius, bool isStatic)
+{
+    ShadowCasterHandle handle;
+    if (!freeCasters.empty())
+    {
+        handle = freeCasters.back();
+        freeCasters.pop_back();
+    }
+    else
+    {
+        handle = static_cast<ShadowCasterHandle>(casters.size());
+        casters.emplace_back();
+    }
+
+    casters[handle] = {center, radius, isStatic, true};
+    if (isStatic)
+    {
+        InvalidateStatic(center, radius);
+    }
+    return handle;
+}
+
+/**
+ * Update the bounds of a caster, moving a static caster invalidates the cache of every view it was or is in
+ */
+void ShadowAtlas::MoveCaster(ShadowCasterHandle handle, const glm::vec3 &center, float radius)
+{
+    Caster &caster = casters[handle];
+    if (caster.isStatic)
+    {
+        InvalidateStatic(caster.center, caster.radius);
+        InvalidateStatic(center, radius);
+    }
+    caster.center = center;
+    caster.radius = radius;
+}
+
+void ShadowAtlas::RemoveCaster(ShadowCasterHandle handle)
+{
+    Caster &caster = casters[handle];
+    if (caster.isStatic)
+    {
+        InvalidateStatic(caster.center, caster.radius);
+    }
+    caster.alive = false;
+    freeCasters.push_back(handle);
+}
+
+void ShadowAtlas::SetCaching(bool enabled)
+{
+    settings.Caching = enabled;
+    for (LightState &state : lights)
+    {
+        for (LightView &view : state.lightViews)
+        {
+            view.staticValid = false;
+        }
+    }
+}
+
+/**
+ * Assign atlas tiles, update the view matrices and collect the casters every view has to draw this frame
+ *
+ * @note Static caches are assumed to be valid after this, Record() (or an equivalent) has to consume the passes
+ */
+void ShadowAtlas::Plan(const ShadowCamera &camera)
+{
+    VANADIUM_ZONE("ShadowAtlas::Plan");
+    views.clear();
+    passes.clear();
+    stats = {};
+
+    // larger requests first so small tiles do not claim the slabs big ones need
+    std::vector<std::pair<uint32_t, ShadowLightHandle>> requests;
+    for (ShadowLightHandle handle = 0; handle < lights.size(); handle++)
+    {
+        if (lights[handle].alive)
+        {
+            requests.emplace_back(DesiredTileSize(lights[handle].light, camera), handle);
+        }
+    }
+    std::sort(requests.begin(), requests.end(), std::greater<>());
+
+    for (const auto &[desiredSize, handle] : requests)
+    {
+        LightState &state = lights[handle];
+        if (state.lightViews.empty() || desiredSize > state.tileSize)
+        {
+            AssignTiles(state, desiredSize);
+            state.downsizeFrames = 0;
+        }
+        else if (desiredSize < state.tileSize)
+        {
+            // hysteresis, every reassignment throws away the static cache
+            if (++state.downsizeFrames >= settings.DownsizeDelayFrames)
+            {
+                AssignTiles(state, desiredSize);
+                state.downsizeFrames = 0;
+            }
+        }
+        else
+        {
+            state.downsizeFrames = 0;
+        }
+
+        ComputeViewMatrices(state, camera);
+
+        for (LightView &lightView : state.lightViews)
+        {
+            if (!lightView.tile.Valid())
+            {
+                continue;
+            }
+
+            const float atlasScale = 1.0f / static_cast<float>(settings.AtlasSize);
+            ShadowView view;
+            view.ViewProjection = lightView.viewProjection;
+            view.AtlasRect = glm::vec4(static_cast<float>(lightView.tile.X) * atlasScale,
+                                       static_cast<float>(lightView.tile.Y) * atlasScale,
+                                       static_cast<float>(lightView.tile.Size) * atlasScale,
+                                       static_cast<float>(lightView.tile.Size) * atlasScale);
+            view.Light = handle;
+
+            ShadowPass pass;
+            pass.View = static_cast<uint32_t>(views.size());
+            pass.Tile = lightView.tile;
+            pass.RenderStatic = !settings.Caching || !lightView.staticValid;
+
+            for (ShadowCasterHandle caster = 0; caster < casters.size(); caster++)
+            {
+                const Caster &candidate = casters[caster];
+                if (!candidate.alive || (candidate.isStatic && !pass.RenderStatic))
+                {
+                    continue;
+                }
+                if (SphereInFrustum(lightView.viewProjection, candidate.center, candidate.radius))
+                {
+                    (candidate.isStatic ? pass.StaticCasters : pass.DynamicCasters).push_back(caster);
+                }
+            }
+
+            stats.Views++;
+            stats.StaticViewsRendered += pass.RenderStatic ? 1 : 0;
+            stats.StaticDraws += static_cast<uint32_t>(pass.StaticCasters.size());
+            stats.DynamicDraws += static_cast<uint32_t>(pass.DynamicCasters.size());
+
+            lightView.staticValid = settings.Caching;
+            views.push_back(view);
+            passes.push_back(std::move(pass));
+        }
+    }
+}
+
+/**
+ * Record the planned passes, the callback draws the given casters with a depth only pipeline
+ *
+ * The atlas ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, dynamic rendering has to be enabled.
+ */
+void ShadowAtlas::Record(VkCommandBuffer commandBuffer, const DrawCallback &draw)
+{
+    VANADIUM_ZONE("ShadowAtlas::Record");
+    const auto renderTile = [&](const Image &target, const ShadowTile &tile, VkAttachmentLoadOp loadOp)
+    {
+        VkRenderingAttachmentInfo depthAttachment{};
+        depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        depthAttachment.imageView = target.view;
+        depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+        depthAttachment.loadOp = loadOp;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        depthAttachment.clearValue.depthStencil = {1.0f, 0};
+
+        VkRenderingInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        renderingInfo.renderArea = vkinit::rect2D(static_cast<int32_t>(tile.Size),
+                                                  static_cast<int32_t>(tile.Size),
+                                                  static_cast<int32_t>(tile.X),
+                                                  static_cast<int32_t>(tile.Y));
+        renderingInfo.layerCount = 1;
+        renderingInfo.pDepthAttachment = &depthAttachment;
+        vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+        VkViewport viewport = vkinit::viewport(static_cast<float>(tile.Size), static_cast<float>(tile.Size), 0.0f, 1.0f);
+        viewport.x = static_cast<float>(tile.X);
+        viewport.y = static_cast<float>(tile.Y);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &renderingInfo.renderArea);
+    };
+
+    const VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                             VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    const VkAccessFlags depthAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    if (settings.Caching)
+    {
+        const bool anyStatic = std::any_of(passes.begin(),
+                                           passes.end(),
+                                           [](const ShadowPass &pass)
+                                           { return pass.RenderStatic; });
+        if (anyStatic)
+        {
+            // the cache lives in TRANSFER_SRC between frames, tiles not rendered here are preserved
+            vktools::insertImageMemoryBarrier(commandBuffer,
+                                              staticCache.image,
+                                              VK_ACCESS_TRANSFER_READ_BIT,
+                                              depthAccess,
+                                              staticCacheInitialized ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                                                     : VK_IMAGE_LAYOUT_UNDEFINED,
+                                              VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                              depthStages,
+                                              staticCache.subresourceRange());
+            for (const ShadowPass &pass : passes)
+            {
+                if (!pass.RenderStatic)
+                {
+                    continue;
+                }
+                renderTile(staticCache, pass.Tile, VK_ATTACHMENT_LOAD_OP_CLEAR);
+                draw(commandBuffer, views[pass.View].ViewProjection, pass.StaticCasters);
+                vkCmdEndRendering(commandBuffer);
+            }
+            vktools::insertImageMemoryBarrier(commandBuffer,
+                                              staticCache.image,
+                                              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                                              VK_ACCESS_TRANSFER_READ_BIT,
+                                              VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                              VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                              depthStages,
+                                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                              staticCache.subresourceRange());
+            staticCacheInitialized = true;
+        }
+
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          atlas.image,
+                                          VK_ACCESS_SHADER_READ_BIT,
+                                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_UNDEFINED,
+                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          atlas.subresourceRange());
+        std::vector<VkImageCopy> regions;
+        regions.reserve(passes.size());
+        for (const ShadowPass &pass : passes)
+        {
+            VkImageCopy region{};
+            region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+            region.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+            region.srcOffset = {static_cast<int32_t>(pass.Tile.X), static_cast<int32_t>(pass.Tile.Y), 0};
+            region.dstOffset = region.srcOffset;
+            region.extent = {pass.Tile.Size, pass.Tile.Size, 1};
+            regions.push_back(region);
+        }
+        if (!regions.empty())
+        {
+            vkCmdCopyImage(commandBuffer,
+                           staticCache.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           atlas.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(regions.size()),
+                           regions.data());
+        }
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          atlas.image,
+                                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                                          depthAccess,
+                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                          VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                          depthStages,
+                                          atlas.subresourceRange());
+
+        // dynamic casters on top of the cached static depth
+        for (const ShadowPass &pass : passes)
+        {
+            if (pass.DynamicCasters.empty())
+            {
+                continue;
+            }
+            renderTile(atlas, pass.Tile, VK_ATTACHMENT_LOAD_OP_LOAD);
+            draw(commandBuffer, views[pass.View].ViewProjection, pass.DynamicCasters);
+            vkCmdEndRendering(commandBuffer);
+        }
+    }
+    else
+    {
+        vktools::insertImageMemoryBarrier(commandBuffer,
+                                          atlas.image,
+                                          VK_ACCESS_SHADER_READ_BIT,
+                                          depthAccess,
+                                          VK_IMAGE_LAYOUT_UNDEFINED,
+                                          VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                          depthStages,
+                                          atlas.subresourceRange());
+        for (const ShadowPass &pass : passes)
+        {
+            renderTile(atlas, pass.Tile, VK_ATTACHMENT_LOAD_OP_CLEAR);
+            draw(commandBuffer, views[pass.View].ViewProjection, pass.StaticCasters);
+            draw(commandBuffer, views[pass.View].ViewProjection, pass.DynamicCasters);
+            vkCmdEndRendering(commandBuffer);
+        }
+    }
+
+    vktools::insertImageMemoryBarrier(commandBuffer,
+                                      atlas.image,
+                                      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                                      VK_ACCESS_SHADER_READ_BIT,
+                                      VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                      depthStages,
+                                      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                      atlas.subresourceRange());
+}
+
+uint32_t ShadowAtlas::ViewCount(const ShadowLight &light) const
+{
+    switch (light.Type)
+    {
+    case ShadowLightType::Point:
+        return 6;
+    case ShadowLightType::Directional:
+        return settings.CascadeCount;
+    default:
+        return 1;
+    }
+}
+
+/**
+ * Tile size from the projected size of the light's range sphere relative to the screen height
+ */
+uint32_t ShadowAtlas::DesiredTileSize(const ShadowLight &light, const ShadowCamera &camera) const
+{
+    if (light.Type == ShadowLightType::Directional)
+    {
+        return settings.CascadeTileSize;
+    }
+
+    const float distance = glm::length(light.Position - camera.Position);
+    float importance = 1.0f;
+    if (distance > light.Range)
+    {
+        importance = std::min(light.Range / (distance * std::tan(camera.FovY * 0.5f)), 1.0f);
+    }
+
+    // cube faces only cover 90 degrees each, half the resolution keeps the texel density of a spot light
+    const uint32_t maxSize = light.Type == ShadowLightType::Point ? settings.MaxTileSize / 2 : settings.MaxTileSize;
+    const uint32_t size = static_cast<uint32_t>(importance * static_cast<float>(maxSize));
+    return std::bit_floor(std::clamp(size, settings.MinTileSize, std::max(maxSize, settings.MinTileSize)));
+}
+
+void ShadowAtlas::ComputeViewMatrices(LightState &state, const ShadowCamera &camera) const
+{
+    const ShadowLight &light = state.light;
+    std::vector<glm::mat4> matrices;
+    matrices.reserve(state.lightViews.size());
+    // snapped light space center and radius of every cascade
+    std::vector<glm::vec4> cascadeBounds;
+
+    if (light.Type == ShadowLightType::Spot)
+    {
+        const glm::vec3 direction = glm::normalize(light.Direction);
+        const glm::mat4 view = glm::lookAt(light.Position, light.Position + direction, UpVector(direction));
+        const glm::mat4 projection = glm::perspectiveRH_ZO(2.0f * light.OuterConeAngle,
+                                                           1.0f,
+                                                           light.Range * 0.01f,
+                                                           light.Range);
+        matrices.push_back(projection * view);
+    }
+    else if (light.Type == ShadowLightType::Point)
+    {
+        const glm::vec3 directions[6] = {
+            {1.0f, 0.0f, 0.0f},
+            {-1.0f, 0.0f, 0.0f},
+            {0.0f, 1.0f, 0.0f},
+            {0.0f, -1.0f, 0.0f},
+            {0.0f, 0.0f, 1.0f},
+            {0.0f, 0.0f, -1.0f},
+        };
+        const glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(90.0f), 1.0f, light.Range * 0.01f, light.Range);
+        for (const glm::vec3 &direction : directions)
+        {
+            matrices.push_back(projection *
+                               glm::lookAt(light.Position, light.Position + direction, UpVector(direction)));
+        }
+    }
+    else
+    {
+        const glm::vec3 direction = glm::normalize(light.Direction);
+        const glm::vec3 up = UpVector(direction);
+        const glm::mat4 inverseView = glm::inverse(camera.View);
+        const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), direction, up);
+        const float tanHalfFov = std::tan(camera.FovY * 0.5f);
+        const uint32_t cascadeCount = static_cast<uint32_t>(state.lightViews.size());
+
+        const auto splitDistance = [&](uint32_t index)
+        {
+            const float ratio = static_cast<float>(index) / static_cast<float>(cascadeCount);
+            const float logarithmic = camera.Near * std::pow(camera.Far / camera.Near, ratio);
+            const float uniform = camera.Near + (camera.Far - camera.Near) * ratio;
+            return CascadeSplitLambda * logarithmic + (1.0f - CascadeSplitLambda) * uniform;
+        };
+
+        for (uint32_t cascade = 0; cascade < cascadeCount; cascade++)
+        {
+            glm::vec3 corners[8];
+            glm::vec3 center(0.0f);
+            for (uint32_t i = 0; i < 8; i++)
+            {
+                const float z = splitDistance(cascade + (i >> 2));
+                const float y = z * tanHalfFov * ((i & 2) ? 1.0f : -1.0f);
+                const float x = z * tanHalfFov * camera.Aspect * ((i & 1) ? 1.0f : -1.0f);
+                corners[i] = glm::vec3(inverseView * glm::vec4(x, y, -z, 1.0f));
+                center += corners[i] / 8.0f;
+            }
+
+            // a bounding sphere keeps the cascade size constant while the camera rotates
+            float radius = 0.0f;
+            for (const glm::vec3 &corner : corners)
+            {
+                radius = std::max(radius, glm::length(corner - center));
+            }
+            radius = std::ceil(radius * 16.0f) / 16.0f;
+
+            // snap the center in light space so static depth stays valid under small movements, whole texels across
+            // the light and coarser steps along it
+            const uint32_t tileSize = state.lightViews[cascade].tile.Valid() ? state.lightViews[cascade].tile.Size
+                                                                              : settings.CascadeTileSize;
+            const float texelSize = 2.0f * radius / static_cast<float>(tileSize);
+            const float depthStep = texelSize * CascadeDepthSnapTexels;
+            glm::vec3 lightSpaceCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+            lightSpaceCenter.x = std::floor(lightSpaceCenter.x / texelSize) * texelSize;
+            lightSpaceCenter.y = std::floor(lightSpaceCenter.y / texelSize) * texelSize;
+            lightSpaceCenter.z = std::floor(lightSpaceCenter.z / depthStep) * depthStep;
+            cascadeBounds.emplace_back(lightSpaceCenter, radius);
+
+            // built from the snapped values directly, a round trip through world space would reintroduce rounding.
+            // The light looks down -z in light space, flooring z moved the center away from it by up to depthStep.
+            const float backOffset = radius + depthStep + settings.CascadeCasterDistance;
+            const glm::vec3 lightSpaceEye = lightSpaceCenter + glm::vec3(0.0f, 0.0f, backOffset);
+            const glm::mat4 view = glm::translate(glm::mat4(1.0f), -lightSpaceEye) * lightRotation;
+            const glm::mat4 projection = glm::orthoRH_ZO(-radius, radius, -radius, radius, 0.0f, backOffset + radius);
+            matrices.push_back(projection * view);
+        }
+    }
+
+    for (size_t i = 0; i < state.lightViews.size(); i++)
+    {
+        LightView &lightView = state.lightViews[i];
+        // cascades compare what they were snapped to, the same view rebuilt from floats may differ in the last bits
+        const bool changed = cascadeBounds.empty() ? lightView.viewProjection != matrices[i]
+                                                   : lightView.cascadeBounds != cascadeBounds[i] ||
+                                                         lightView.lightDirection != light.Direction;
+        lightView.viewProjection = matrices[i];
+        if (changed)
+        {
+            lightView.staticValid = false;
+            if (!cascadeBounds.empty())
+            {
+                lightView.cascadeBounds = cascadeBounds[i];
+                lightView.lightDirection = light.Direction;
+            }
+        }
+    }
+}
+
+/**
+ * Move all views of a light to tiles of the given size, keeps the current tiles if the atlas has no room
+ */
+void ShadowAtlas::AssignTiles(LightState &state, uint32_t tileSize)
+{
+    const uint32_t viewCount = ViewCount(state.light);
+
+    for (uint32_t size = tileSize; size >= settings.MinTileSize; size /= 2)
+    {
+        std::vector<ShadowTile> tiles;
+        for (uint32_t i = 0; i < viewCount; i++)
+        {
+            const ShadowTile tile = allocator.Allocate(size);
+            if (!tile.Valid())
+            {
+                break;
+            }
+            tiles.push_back(tile);
+        }
+
+        if (tiles.size() == viewCount)
+        {
+            ReleaseTiles(state);
+            state.tileSize = size;
+            state.lightViews.resize(viewCount);
+            for (uint32_t i = 0; i < viewCount; i++)
+            {
+                state.lightViews[i].tile = tiles[i];
+                state.lightViews[i].staticValid = false;
+            }
+            return;
+        }
+
+        for (const ShadowTile &tile : tiles)
+        {
+            allocator.Free(tile);
+        }
+
+        // a light that already has tiles keeps them instead of shrinking because the atlas is full
+        if (state.tileSize > 0)
+        {
+            return;
+        }
+    }
+
+    // retried every frame, only reported the first time
+    if (state.lightViews.empty())
+    {
+        Log::Warning("Shadow atlas full, light has no shadow ({0} views)", viewCount);
+    }
+    state.lightViews.assign(viewCount, {});
+    state.tileSize = 0;
+}
+
+void ShadowAtlas::ReleaseTiles(LightState &state)
+{
+    for (const LightView &lightView : state.lightViews)
+    {
+        allocator.Free(lightView.tile);
+    }
+    state.lightViews.clear();
+    state.tileSize = 0;
+}
+
+void ShadowAtlas::InvalidateStatic(const glm::vec3 &center, float radius)
+{
+    for (LightState &state : lights)
+    {
+        if (!state.alive)
+        {
+            continue;
+        }
+        for (LightView &lightView : state.lightViews)
+        {
+            if (lightView.staticValid && SphereInFrustum(lightView.viewProjection, center, radius))
+            {
+                lightView.staticValid = false;
+            }
+        }
+    }
+}
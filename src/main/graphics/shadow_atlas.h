@@ -0,0 +1,246 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan/vk_image.h"
+
+struct VulkanDevice;
+
+using ShadowLightHandle = uint32_t;
+using ShadowCasterHandle = uint32_t;
+constexpr uint32_t InvalidShadowHandle = UINT32_MAX;
+
+struct ShadowAtlasProperties
+{
+    // edge length of the square atlas, split into slabs of MaxTileSize
+    uint32_t AtlasSize = 4096;
+    // tile sizes are powers of two in [MinTileSize, MaxTileSize]
+    uint32_t MinTileSize = 128;
+    uint32_t MaxTileSize = 1024;
+    uint32_t CascadeCount = 4;
+    uint32_t CascadeTileSize = 1024;
+    // distance along the light direction in front of a cascade from which casters are still rendered
+    float CascadeCasterDistance = 200.0f;
+    // frames a smaller resolution has to be requested before a light gives up its tile
+    uint32_t DownsizeDelayFrames = 60;
+    // render static casters once into a cache atlas and only copy them each frame
+    bool Caching = true;
+    VkFormat DepthFormat = VK_FORMAT_D32_SFLOAT;
+};
+
+enum class ShadowLightType : uint32_t
+{
+    Spot = 0,
+    Point = 1,
+    Directional = 2,
+};
+
+struct ShadowLight
+{
+    ShadowLightType Type = ShadowLightType::Spot;
+    glm::vec3 Position{0.0f};
+    glm::vec3 Direction{0.0f, -1.0f, 0.0f};
+    // spot and point only
+    float Range = 10.0f;
+    float OuterConeAngle = glm::radians(30.0f);
+};
+
+struct ShadowCamera
+{
+    glm::mat4 View{1.0f};
+    glm::vec3 Position{0.0f};
+    float FovY = glm::radians(60.0f);
+    float Aspect = 16.0f / 9.0f;
+    float Near = 0.1f;
+    float Far = 250.0f;
+};
+
+/** @brief Square region of the atlas in texels */
+struct ShadowTile
+{
+    uint32_t X = 0;
+    uint32_t Y = 0;
+    uint32_t Size = 0;
+    uint32_t Slab = UINT32_MAX;
+    uint32_t Index = 0;
+
+    [[nodiscard]] bool Valid() const
+    {
+        return Size > 0;
+    }
+};
+
+/**
+ * @brief Slab allocator for square power of two tiles
+ *
+ * The atlas is split into equally sized slabs. A slab is bound to one tile size on first use and handed back to
+ * the empty pool once its last tile is freed, so tiles of one size never fragment the space of another.
+ */
+class ShadowAtlasAllocator
+{
+public:
+    void Initialize(uint32_t atlasSize, uint32_t slabSize);
+
+    ShadowTile Allocate(uint32_t size);
+    void Free(const ShadowTile &tile);
+
+    [[nodiscard]] uint32_t GetUsedSlabCount() const;
+
+private:
+    struct Slab
+    {
+        uint32_t X = 0;
+        uint32_t Y = 0;
+        // 0 while the slab is empty
+        uint32_t TileSize = 0;
+        std::vector<uint32_t> freeTiles;
+    };
+
+    uint32_t slabSize = 0;
+    std::vector<Slab> slabs;
+};
+
+/** @brief One depth view rendered into the atlas, a spot light has one, a point light six */
+struct ShadowView
+{
+    glm::mat4 ViewProjection{1.0f};
+    // xy offset and zw scale of the tile in atlas UVs
+    glm::vec4 AtlasRect{0.0f};
+    ShadowLightHandle Light = InvalidShadowHandle;
+};
+
+/** @brief Work for one view this frame, consumed by Record or a custom renderer */
+struct ShadowPass
+{
+    uint32_t View = 0;
+    ShadowTile Tile;
+    // static casters have to be rendered (into the cache when caching is enabled)
+    bool RenderStatic = false;
+    std::vector<ShadowCasterHandle> StaticCasters;
+    std::vector<ShadowCasterHandle> DynamicCasters;
+};
+
+struct ShadowStats
+{
+    uint32_t Views = 0;
+    uint32_t StaticViewsRendered = 0;
+    uint32_t StaticDraws = 0;
+    uint32_t DynamicDraws = 0;
+
+    [[nodiscard]] uint32_t Draws() const
+    {
+        return StaticDraws + DynamicDraws;
+    }
+};
+
+/**
+ * @brief Shadow maps of all spot, point and directional (cascaded) lights packed into one depth atlas
+ *
+ * Each light gets atlas resolution by its projected size on screen. Static caster depth is rendered once per
+ * view into a cache atlas with the same layout and copied into the atlas every frame; it is only re-rendered
+ * when the view matrix or tile changes or a static caster inside the view moves. Dynamic casters are rendered on
+ * top of the copied depth each frame.
+ *
+ * Plan() is pure CPU work and decides what has to be drawn, Record() turns the plan into commands and calls back
+ * into the renderer for the actual caster draws.
+ */
+class ShadowAtlas
+{
+public:
+    using DrawCallback = std::function<void(VkCommandBuffer commandBuffer,
+                                            const glm::mat4 &viewProjection,
+                                            const std::vector<ShadowCasterHandle> &casters)>;
+
+    explicit ShadowAtlas(const ShadowAtlasProperties &properties = {});
+
+    VkResult Initialize(VulkanDevice *device);
+    void Destroy();
+
+    ShadowLightHandle AddLight(const ShadowLight &light);
+    void UpdateLight(ShadowLightHandle handle, const ShadowLight &light);
+    void RemoveLight(ShadowLightHandle handle);
+
+    ShadowCasterHandle AddCaster(const glm::vec3 &center, float radius, bool isStatic);
+    void MoveCaster(ShadowCasterHandle handle, const glm::vec3 &center, float radius);
+    void RemoveCaster(ShadowCasterHandle handle);
+
+    void SetCaching(bool enabled);
+
+    void Plan(const ShadowCamera &camera);
+    void Record(VkCommandBuffer commandBuffer, const DrawCallback &draw);
+
+    [[nodiscard]] const std::vector<ShadowView> &GetViews() const
+    {
+        return views;
+    }
+
+    [[nodiscard]] const std::vector<ShadowPass> &GetPasses() const
+    {
+        return passes;
+    }
+
+    [[nodiscard]] const ShadowStats &GetStats() const
+    {
+        return stats;
+    }
+
+    [[nodiscard]] const Image &GetAtlas() const
+    {
+        return atlas;
+    }
+
+private:
+    struct Caster
+    {
+        glm::vec3 center{0.0f};
+        float radius = 0.0f;
+        bool isStatic = false;
+        bool alive = false;
+    };
+
+    struct LightView
+    {
+        glm::mat4 viewProjection{1.0f};
+        // cascades only: snapped light space center and radius, and the direction they were computed for
+        glm::vec4 cascadeBounds{0.0f};
+        glm::vec3 lightDirection{0.0f};
+        ShadowTile tile;
+        bool staticValid = false;
+    };
+
+    struct LightState
+    {
+        ShadowLight light;
+        bool alive = false;
+        uint32_t tileSize = 0;
+        uint32_t downsizeFrames = 0;
+        std::vector<LightView> lightViews;
+    };
+
+    uint32_t ViewCount(const ShadowLight &light) const;
+    uint32_t DesiredTileSize(const ShadowLight &light, const ShadowCamera &camera) const;
+    void ComputeViewMatrices(LightState &state, const ShadowCamera &camera) const;
+    void AssignTiles(LightState &state, uint32_t tileSize);
+    void ReleaseTiles(LightState &state);
+    void InvalidateStatic(const glm::vec3 &center, float radius);
+
+    ShadowAtlasProperties settings;
+    VulkanDevice *vulkanDevice = nullptr;
+    ShadowAtlasAllocator allocator;
+
+    std::vector<LightState> lights;
+    std::vector<ShadowLightHandle> freeLights;
+    std::vector<Caster> casters;
+    std::vector<ShadowCasterHandle> freeCasters;
+
+    std::vector<ShadowView> views;
+    std::vector<ShadowPass> passes;
+    ShadowStats stats;
+
+    Image atlas;
+    Image staticCache;
+    bool staticCacheInitialized = false;
+};
@@ -0,0 +1,233 @@
+#include "texture.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "core/log.h"
+#include "mip_generator.h"
+#include "upload_queue.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_host_memory.h"
+#include "vulkan/vk_initializers.h"
+
+namespace
+{
+    // storage images cannot be sRGB, mip generation writes sRGB textures through UNORM views
+    VkFormat StorageFormat(VkFormat format)
+    {
+        return format == VK_FORMAT_R8G8B8A8_SRGB ? VK_FORMAT_R8G8B8A8_UNORM : format;
+    }
+}
+
+/**
+ * Create the image, its memory and views, a previously initialized texture is destroyed first
+ *
+ * @param device Device to allocate the texture on
+ * @param extent Width and height of the base level
+ * @param properties (Optional) Format, number of levels and the upload queue family
+ *
+ * @return VK_ERROR_FORMAT_NOT_SUPPORTED for formats the MipGenerator does not handle, otherwise the VkResult of the
+ *         first call that failed
+ */
+VkResult Texture::Initialize(VulkanDevice *device, VkExtent2D extent, const TextureProperties &properties)
+{
+    Destroy();
+    if (!MipGenerator::Supports(properties.Format) || extent.width == 0 || extent.height == 0)
+    {
+        Log::Error("Cannot create a {0}x{1} texture of format {2}",
+                   extent.width,
+                   extent.height,
+                   static_cast<int32_t>(properties.Format));
+        return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+
+    vulkanDevice = device;
+    const VkDevice logicalDevice = device->logicalDevice;
+    const uint32_t fullChain = std::bit_width(std::max(extent.width, extent.height));
+    const uint32_t mipLevels = properties.MipLevels == 0 ? fullChain : std::min(properties.MipLevels, fullChain);
+
+    image.device = logicalDevice;
+    image.format = properties.Format;
+    image.extent = extent;
+    image.mipLevels = std::min(mipLevels, MipGenerator::MaxMipLevels);
+    image.arrayLayers = 1;
+    image.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image.usageFlags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if (image.mipLevels > 1)
+    {
+        // the levels are written through storage views of StorageFormat()
+        VkImageFormatProperties storageProperties;
+        const VkResult supported = vkGetPhysicalDeviceImageFormatProperties(device->physicalDevice,
+                                                                            StorageFormat(image.format),
+                                                                            VK_IMAGE_TYPE_2D,
+                                                                            VK_IMAGE_TILING_OPTIMAL,
+                                                                            VK_IMAGE_USAGE_STORAGE_BIT,
+                                                                            0,
+                                                                            &storageProperties);
+        if (supported != VK_SUCCESS || storageProperties.maxMipLevels < image.mipLevels ||
+            storageProperties.maxExtent.width < extent.width || storageProperties.maxExtent.height < extent.height)
+        {
+            Log::Error("Format {0} cannot be used as storage image for mip generation of a {1}x{2} texture",
+                       static_cast<int32_t>(StorageFormat(image.format)),
+                       extent.width,
+                       extent.height);
+            Destroy();
+            return VK_ERROR_FORMAT_NOT_SUPPORTED;
+        }
+        image.usageFlags |= VK_IMAGE_USAGE_STORAGE_BIT;
+    }
+
+    VkImageCreateInfo imageInfo = vkinit::imageCreateInfo();
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = image.format;
+    imageInfo.extent = {extent.width, extent.height, 1};
+    imageInfo.mipLevels = image.mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = image.usageFlags;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    // sRGB formats have no storage support, extended usage allows the storage usage for the UNORM views only. Listing
+    // the two view formats lets drivers keep compression that a bare mutable format would disable
+    const VkFormat viewFormats[] = {image.format, StorageFormat(image.format)};
+    VkImageFormatListCreateInfo formatList{};
+    formatList.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_LIST_CREATE_INFO;
+    formatList.viewFormatCount = 2;
+    formatList.pViewFormats = viewFormats;
+    if (image.mipLevels > 1 && viewFormats[0] != viewFormats[1])
+    {
+        imageInfo.flags = VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+        imageInfo.pNext = &formatList;
+    }
+
+    // the upload queue does no ownership transfers
+    const uint32_t queueFamilies[] = {device->queueFamilyIndices.graphics, properties.UploadQueueFamily};
+    if (properties.UploadQueueFamily != VK_QUEUE_FAMILY_IGNORED && queueFamilies[0] != queueFamilies[1])
+    {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = 2;
+        imageInfo.pQueueFamilyIndices = queueFamilies;
+    }
+
+    VkResult result = vkCreateImage(logicalDevice,
+                                    &imageInfo,
+                                    vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE),
+                                    &image.image);
+    if (result != VK_SUCCESS)
+    {
+        Destroy();
+        return result;
+    }
+
+    VkMemoryRequirements memReqs;
+    vkGetImageMemoryRequirements(logicalDevice, image.image, &memReqs);
+    VkMemoryAllocateInfo memAlloc = vkinit::memoryAllocateInfo();
+    memAlloc.allocationSize = memReqs.size;
+    memAlloc.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    result = vkAllocateMemory(logicalDevice,
+                              &memAlloc,
+                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY),
+                              &image.memory);
+    if (result != VK_SUCCESS)
+    {
+        Log::Error("Could not allocate {0} KiB for a {1}x{2} texture",
+                   memReqs.size / 1024,
+                   extent.width,
+                   extent.height);
+        Destroy();
+        return result;
+    }
+    Debug::CheckVulkan(vkBindImageMemory(logicalDevice, image.image, image.memory, 0));
+
+    VkImageViewCreateInfo viewInfo = vkinit::imageViewCreateInfo();
+    viewInfo.image = image.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = image.format;
+    viewInfo.subresourceRange = image.subresourceRange();
+    Debug::CheckVulkan(vkCreateImageView(logicalDevice,
+                                         &viewInfo,
+                                         vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW),
+                                         &image.view));
+
+    if (image.mipLevels > 1)
+    {
+        mipViews.resize(image.mipLevels, VK_NULL_HANDLE);
+        viewInfo.format = StorageFormat(image.format);
+        viewInfo.subresourceRange.levelCount = 1;
+        for (uint32_t level = 0; level < image.mipLevels; level++)
+        {
+            viewInfo.subresourceRange.baseMipLevel = level;
+            Debug::CheckVulkan(vkCreateImageView(logicalDevice,
+                                                 &viewInfo,
+                                                 vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW),
+                                                 &mipViews[level]));
+        }
+    }
+
+    layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    return VK_SUCCESS;
+}
+
+/**
+ * Release the image, its views and its mip generation descriptor set
+ *
+ * @note The MipGenerator that recorded the texture has to still exist, and no pending command buffer may use it
+ */
+void Texture::Destroy()
+{
+    if (!vulkanDevice)
+    {
+        return;
+    }
+
+    const VkDevice device = vulkanDevice->logicalDevice;
+    if (mipDescriptorSet)
+    {
+        vkFreeDescriptorSets(device, mipDescriptorPool, 1, &mipDescriptorSet);
+        mipDescriptorSet = VK_NULL_HANDLE;
+        mipDescriptorPool = VK_NULL_HANDLE;
+    }
+    for (VkImageView view : mipViews)
+    {
+        vkDestroyImageView(device, view, vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW));
+    }
+    mipViews.clear();
+    image.destroy();
+    layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    vulkanDevice = nullptr;
+}
+
+/**
+ * Stream the base level through the upload queue's staging ring, the copies are submitted with its next batch
+ *
+ * @param uploads Queue recording the copies, consumers wait for the value of its next Submit() before recording
+ *                mip generation
+ * @param texels Tightly packed base level of GetBaseLevelSize() bytes, only read during the call
+ */
+void Texture::Upload(UploadQueue &uploads, const void *texels)
+{
+    uploads.CopyToImage(texels, static_cast<VkDeviceSize>(image.extent.width) * GetTexelSize(image.format), image);
+    layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+}
+
+/**
+ * Size of one texel of the formats textures support
+ *
+ * @return 0 for any other format
+ */
+uint32_t Texture::GetTexelSize(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan/vk_image.h"
+
+class MipGenerator;
+class UploadQueue;
+struct VulkanDevice;
+
+struct TextureProperties
+{
+    // R8G8B8A8_UNORM, R8G8B8A8_SRGB or R16G16B16A16_SFLOAT, see MipGenerator
+    VkFormat Format = VK_FORMAT_R8G8B8A8_SRGB;
+    // 0 for the full chain down to 1x1, at most MipGenerator::MaxMipLevels
+    uint32_t MipLevels = 0;
+    // family of the upload queue filling the base level, the image is shared concurrently with the graphics family
+    // when it differs
+    uint32_t UploadQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+};
+
+/**
+ * @brief Sampled 2D texture in device local memory whose mip chain is built on the GPU
+ *
+ * Upload() streams the base level through an UploadQueue, MipGenerator::Record() builds the remaining levels once the
+ * upload's timeline value was waited on and leaves the texture in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, textures
+ * with a single level included. The texture remembers the layout its last recorded operation left it in, so it is
+ * meant to be recorded in submission order by one thread.
+ */
+class Texture
+{
+public:
+    VkResult Initialize(VulkanDevice *device, VkExtent2D extent, const TextureProperties &properties = {});
+    void Destroy();
+
+    void Upload(UploadQueue &uploads, const void *texels);
+
+    [[nodiscard]] const Image &GetImage() const
+    {
+        return image;
+    }
+
+    // size of the tightly packed base level Upload() expects
+    [[nodiscard]] VkDeviceSize GetBaseLevelSize() const
+    {
+        return static_cast<VkDeviceSize>(image.extent.width) * image.extent.height * GetTexelSize(image.format);
+    }
+
+    [[nodiscard]] static uint32_t GetTexelSize(VkFormat format);
+
+private:
+    friend class MipGenerator;
+
+    VulkanDevice *vulkanDevice = nullptr;
+    Image image;
+    // storage view of every level for mip generation, UNORM for sRGB textures
+    std::vector<VkImageView> mipViews;
+    // allocated by the MipGenerator on first use
+    VkDescriptorSet mipDescriptorSet{VK_NULL_HANDLE};
+    VkDescriptorPool mipDescriptorPool{VK_NULL_HANDLE};
+    // layout of every level after the last recorded operation
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
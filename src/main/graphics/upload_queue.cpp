@@ -0,0 +1,523 @@
+#include "upload_queue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "core/log.h"
+#include "core/profiler.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_host_memory.h"
+#include "vulkan/vk_initializers.h"
+#include "vulkan/vk_tools.h"
+
+namespace
+{
+    // ring positions stay aligned so memcpy writes start on a cache friendly boundary
+    constexpr uint64_t RingAlignment = 16;
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+/**
+ * Create the staging ring, command pool and timeline semaphore
+ *
+ * @param queue Queue the copies are submitted to, usually the dedicated transfer queue
+ * @param queueFamilyIndex Family of queue
+ * @param properties (Optional) Ring and batch sizes
+ *
+ * @return VkResult of the first call that failed
+ */
+VkResult UploadQueue::Initialize(VulkanDevice *device,
+                                 VkQueue queue,
+                                 uint32_t queueFamilyIndex,
+                                 const UploadQueueProperties &properties)
+{
+    vulkanDevice = device;
+    transferQueue = queue;
+    queueFamily = queueFamilyIndex;
+    settings = properties;
+    settings.StagingBytes = AlignUp(std::max<VkDeviceSize>(settings.StagingBytes, RingAlignment), RingAlignment);
+    settings.BatchBytes = std::clamp<VkDeviceSize>(settings.BatchBytes, RingAlignment, settings.StagingBytes);
+
+    VkResult result = device->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                           &staging,
+                                           settings.StagingBytes);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+    result = staging.map();
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    commandPool = device->createCommandPool(queueFamilyIndex);
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+    VkSemaphoreCreateInfo semaphoreInfo = vkinit::semaphoreCreateInfo();
+    semaphoreInfo.pNext = &typeInfo;
+    result = vkCreateSemaphore(device->logicalDevice,
+                               &semaphoreInfo,
+                               vkhost::allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE),
+                               &timeline);
+    Debug::CheckVulkan(result);
+
+    Log::System("Upload Queue Init ({0} MiB staging ring, queue family {1})",
+                settings.StagingBytes / (1024 * 1024),
+                queueFamilyIndex);
+    return result;
+}
+
+void UploadQueue::Destroy()
+{
+    if (!vulkanDevice)
+    {
+        return;
+    }
+
+    if (recording)
+    {
+        Submit();
+    }
+    Wait(submittedValue);
+
+    if (timeline)
+    {
+        vkDestroySemaphore(vulkanDevice->logicalDevice,
+                           timeline,
+                           vkhost::allocationCallbacks(VK_OBJECT_TYPE_SEMAPHORE));
+        timeline = VK_NULL_HANDLE;
+    }
+    if (commandPool)
+    {
+        // frees every command buffer allocated from it
+        vkDestroyCommandPool(vulkanDevice->logicalDevice,
+                             commandPool,
+                             vkhost::allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL));
+        commandPool = VK_NULL_HANDLE;
+    }
+    freeCommandBuffers.clear();
+    inFlight.clear();
+    reservations.clear();
+    recordedReservations.clear();
+    ringHead = ringTail = retiredEnd = 0;
+    staging.unmap();
+    staging.destroy();
+    vulkanDevice = nullptr;
+}
+
+/**
+ * Copy data into the staging ring and record its transfer into destination, blocks only while the ring is full
+ *
+ * @param data Source in host memory, only read during the call
+ * @param size Number of bytes to copy
+ * @param destination Buffer created with VK_BUFFER_USAGE_TRANSFER_DST_BIT
+ * @param destinationOffset Byte offset into destination
+ */
+void UploadQueue::CopyToBuffer(const void *data,
+                               VkDeviceSize size,
+                               VkBuffer destination,
+                               VkDeviceSize destinationOffset)
+{
+    VANADIUM_ZONE("UploadQueue::CopyToBuffer");
+    const uint8_t *source = static_cast<const uint8_t *>(data);
+
+    while (size > 0)
+    {
+        uint64_t available = settings.StagingBytes - (ringHead - ringTail);
+        if (available == 0)
+        {
+            // the current batch holds ring space too, it has to be in flight before anything can be waited on
+            const uint64_t tail = ringTail;
+            if (recording)
+            {
+                Submit();
+            }
+            if (inFlight.empty())
+            {
+                // Submit() may already have retired everything
+                if (ringTail != tail || ReclaimIdle())
+                {
+                    continue;
+                }
+                Log::Error("Upload queue staging ring is held by open reservations, dropping {0} bytes", size);
+                return;
+            }
+            Retire(true);
+            continue;
+        }
+
+        const uint64_t slot = ringHead % settings.StagingBytes;
+        const uint64_t chunk = std::min({size, available, settings.StagingBytes - slot});
+
+        std::memcpy(static_cast<uint8_t *>(staging.mapped) + slot, source, chunk);
+
+        BeginRecording();
+        VkBufferCopy region{};
+        region.srcOffset = slot;
+        region.dstOffset = destinationOffset;
+        region.size = chunk;
+        vkCmdCopyBuffer(recording, staging.buffer, destination, 1, &region);
+
+        ringHead += AlignUp(chunk, RingAlignment);
+        recordedBytes += chunk;
+        bytesUploaded += chunk;
+        source += chunk;
+        destinationOffset += chunk;
+        size -= chunk;
+
+        if (recordedBytes >= settings.BatchBytes)
+        {
+            Submit();
+        }
+    }
+}
+
+/**
+ * Copy the base level of an image into the staging ring and record its transfer, in bands of whole rows
+ *
+ * @param data Tightly packed texels of level 0 and layer 0, only read during the call
+ * @param rowBytes Size of one row of texels
+ * @param destination Image created with VK_IMAGE_USAGE_TRANSFER_DST_BIT, its previous contents are discarded and
+ *                    every level is left in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+ */
+void UploadQueue::CopyToImage(const void *data, VkDeviceSize rowBytes, const Image &destination)
+{
+    VANADIUM_ZONE("UploadQueue::CopyToImage");
+    const uint8_t *source = static_cast<const uint8_t *>(data);
+    const uint32_t height = destination.extent.height;
+
+    // transfer only families may need band offsets in multiples of their granularity, 0 allows whole images only
+    const uint32_t granularity = vulkanDevice->queueFamilyProperties[queueFamily].minImageTransferGranularity.height;
+    const uint32_t bandAlignment = granularity == 0 ? height : granularity;
+    if (AlignUp(rowBytes * std::min(bandAlignment, height), RingAlignment) > settings.StagingBytes)
+    {
+        Log::Error("Upload queue staging ring is too small for bands of {0} rows of {1} bytes",
+                   bandAlignment,
+                   rowBytes);
+        return;
+    }
+
+    bool transitioned = false;
+    uint32_t row = 0;
+    while (row < height)
+    {
+        const uint64_t available = settings.StagingBytes - (ringHead - ringTail);
+        const uint64_t slot = ringHead % settings.StagingBytes;
+        const uint64_t contiguous = std::min(available, settings.StagingBytes - slot);
+        const uint32_t remaining = height - row;
+        uint32_t rows = static_cast<uint32_t>(std::min<uint64_t>(remaining, contiguous / rowBytes));
+        if (rows < remaining)
+        {
+            rows -= rows % bandAlignment;
+        }
+
+        if (rows == 0)
+        {
+            if (contiguous < available)
+            {
+                // a band never wraps, the end of the ring is skipped when it is too small
+                ringHead += settings.StagingBytes - slot;
+                continue;
+            }
+            const uint64_t tail = ringTail;
+            if (recording)
+            {
+                Submit();
+            }
+            if (inFlight.empty())
+            {
+                if (ringTail != tail || ReclaimIdle())
+                {
+                    continue;
+                }
+                Log::Error("Upload queue staging ring is held by open reservations, dropping {0} rows", remaining);
+                return;
+            }
+            Retire(true);
+            continue;
+        }
+
+        const uint64_t bytes = rows * rowBytes;
+        std::memcpy(static_cast<uint8_t *>(staging.mapped) + slot, source + row * rowBytes, bytes);
+
+        BeginRecording();
+        if (!transitioned)
+        {
+            // later batches are submitted to the same queue, so the transition orders their copies as well
+            vktools::insertImageMemoryBarrier(recording,
+                                              destination.image,
+                                              0,
+                                              VK_ACCESS_TRANSFER_WRITE_BIT,
+                                              VK_IMAGE_LAYOUT_UNDEFINED,
+                                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                              VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                              destination.subresourceRange());
+            transitioned = true;
+        }
+        VkBufferImageCopy region{};
+        region.bufferOffset = slot;
+        region.imageSubresource.aspectMask = destination.aspectMask;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, static_cast<int32_t>(row), 0};
+        region.imageExtent = {destination.extent.width, rows, 1};
+        vkCmdCopyBufferToImage(recording,
+                               staging.buffer,
+                               destination.image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1,
+                               &region);
+
+        ringHead += AlignUp(bytes, RingAlignment);
+        recordedBytes += bytes;
+        bytesUploaded += bytes;
+        row += rows;
+
+        if (recordedBytes >= settings.BatchBytes)
+        {
+            Submit();
+        }
+    }
+}
+
+/**
+ * Submit every copy recorded since the last submission
+ *
+ * @return Timeline value signaled once the copies finished, the last submitted value if nothing was recorded
+ */
+uint64_t UploadQueue::Submit()
+{
+    if (!recording)
+    {
+        return submittedValue;
+    }
+
+    Debug::CheckVulkan(vkEndCommandBuffer(recording));
+
+    const uint64_t signalValue = submittedValue + 1;
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo = vkinit::submitInfo();
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &recording;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &timeline;
+    Debug::CheckVulkan(vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+    inFlight.push_back(Batch{recording, signalValue, ringHead, std::move(recordedReservations)});
+    recordedReservations.clear();
+    submittedValue = signalValue;
+    recording = VK_NULL_HANDLE;
+    recordedBytes = 0;
+
+    // opportunistically recycle whatever already finished
+    Retire(false);
+    return signalValue;
+}
+
+/**
+ * Reserve contiguous ring space to be filled later, blocks while finished batches can make room
+ *
+ * @param size Number of bytes, at most the ring size
+ * @param position Receives the reservation's ring position, pass it to CopyReserved() or ReleaseReserved()
+ *
+ * @return Mapped staging memory to write the data to, nullptr if the rest of the ring is held by open reservations
+ */
+uint8_t *UploadQueue::Reserve(VkDeviceSize size, uint64_t &position)
+{
+    if (size == 0 || size > settings.StagingBytes)
+    {
+        return nullptr;
+    }
+
+    const uint64_t alignedSize = AlignUp(size, RingAlignment);
+    while (true)
+    {
+        const uint64_t slot = ringHead % settings.StagingBytes;
+        // a reservation never wraps, the end of the ring is skipped when it is too small
+        const uint64_t skip = slot + alignedSize > settings.StagingBytes ? settings.StagingBytes - slot : 0;
+        const uint64_t available = settings.StagingBytes - (ringHead - ringTail);
+        if (skip + alignedSize <= available)
+        {
+            position = ringHead + skip;
+            ringHead = position + alignedSize;
+            reservations.insert(position);
+            return static_cast<uint8_t *>(staging.mapped) + position % settings.StagingBytes;
+        }
+
+        const uint64_t tail = ringTail;
+        if (recording)
+        {
+            Submit();
+        }
+        if (!inFlight.empty())
+        {
+            Retire(true);
+            continue;
+        }
+
+        if (ringTail != tail || ReclaimIdle())
+        {
+            continue;
+        }
+        if (reservations.empty() && skip > 0)
+        {
+            // the ring is empty, restart at its beginning
+            ringHead += skip;
+            retiredEnd = ringHead;
+            UpdateTail();
+            continue;
+        }
+        return nullptr;
+    }
+}
+
+/**
+ * Record the transfer of a filled reservation, the reservation is closed once the batch recording it finished
+ *
+ * @param position Position returned by Reserve()
+ * @param size Number of bytes to copy, at most the reserved size
+ * @param destination Buffer created with VK_BUFFER_USAGE_TRANSFER_DST_BIT
+ * @param destinationOffset Byte offset into destination
+ */
+void UploadQueue::CopyReserved(uint64_t position,
+                               VkDeviceSize size,
+                               VkBuffer destination,
+                               VkDeviceSize destinationOffset)
+{
+    if (size == 0)
+    {
+        ReleaseReserved(position);
+        return;
+    }
+
+    BeginRecording();
+    VkBufferCopy region{};
+    region.srcOffset = position % settings.StagingBytes;
+    region.dstOffset = destinationOffset;
+    region.size = size;
+    vkCmdCopyBuffer(recording, staging.buffer, destination, 1, &region);
+    recordedBytes += size;
+    bytesUploaded += size;
+
+    // batches submitted since the Reserve() end past the reservation, it has to stay open until the copy finished
+    recordedReservations.push_back(position);
+    if (recordedBytes >= settings.BatchBytes)
+    {
+        Submit();
+    }
+}
+
+/**
+ * Close a reservation without copying it, e.g. because the read that was to fill it was cancelled
+ */
+void UploadQueue::ReleaseReserved(uint64_t position)
+{
+    reservations.erase(position);
+    UpdateTail();
+}
+
+/**
+ * Block until the timeline reached value
+ */
+void UploadQueue::Wait(uint64_t value) const
+{
+    if (value == 0 || IsComplete(value))
+    {
+        return;
+    }
+
+    VANADIUM_ZONE("UploadQueue::Wait");
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline;
+    waitInfo.pValues = &value;
+    Debug::CheckVulkan(vkWaitSemaphores(vulkanDevice->logicalDevice, &waitInfo, DEFAULT_FENCE_TIMEOUT));
+}
+
+bool UploadQueue::IsComplete(uint64_t value) const
+{
+    uint64_t current = 0;
+    Debug::CheckVulkan(vkGetSemaphoreCounterValue(vulkanDevice->logicalDevice, timeline, &current));
+    return current >= value;
+}
+
+void UploadQueue::BeginRecording()
+{
+    if (recording)
+    {
+        return;
+    }
+
+    if (!freeCommandBuffers.empty())
+    {
+        recording = freeCommandBuffers.back();
+        freeCommandBuffers.pop_back();
+        Debug::CheckVulkan(vkResetCommandBuffer(recording, 0));
+    }
+    else
+    {
+        recording = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, commandPool, false);
+    }
+
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    Debug::CheckVulkan(vkBeginCommandBuffer(recording, &beginInfo));
+}
+
+// hands the ring space and command buffers of finished batches back, optionally waiting for the oldest one first
+void UploadQueue::Retire(bool waitForOldest)
+{
+    if (waitForOldest && !inFlight.empty())
+    {
+        Wait(inFlight.front().value);
+    }
+
+    uint64_t completed = 0;
+    Debug::CheckVulkan(vkGetSemaphoreCounterValue(vulkanDevice->logicalDevice, timeline, &completed));
+    while (!inFlight.empty() && inFlight.front().value <= completed)
+    {
+        retiredEnd = std::max(retiredEnd, inFlight.front().ringEnd);
+        for (const uint64_t position : inFlight.front().reservations)
+        {
+            reservations.erase(position);
+        }
+        freeCommandBuffers.push_back(inFlight.front().commandBuffer);
+        inFlight.pop_front();
+    }
+    UpdateTail();
+}
+
+// with nothing recorded or in flight only open reservations hold ring space, returns false if that freed nothing
+bool UploadQueue::ReclaimIdle()
+{
+    if (recording || !inFlight.empty() || retiredEnd == ringHead)
+    {
+        return false;
+    }
+    retiredEnd = ringHead;
+    const uint64_t tail = ringTail;
+    UpdateTail();
+    return ringTail != tail;
+}
+
+void UploadQueue::UpdateTail()
+{
+    ringTail = reservations.empty() ? retiredEnd : std::min(retiredEnd, *reservations.begin());
+}
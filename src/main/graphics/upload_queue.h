@@ -0,0 +1,121 @@
+#pragma once
+
+#include <deque>
+#include <set>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan/vk_buffer.h"
+#include "vulkan/vk_image.h"
+
+struct VulkanDevice;
+
+struct UploadQueueProperties
+{
+    // persistently mapped staging ring, uploads larger than this are streamed through it in pieces
+    VkDeviceSize StagingBytes = 64ull * 1024 * 1024;
+    // a command buffer is submitted on its own once it copies this much, so the ring is recycled while recording
+    VkDeviceSize BatchBytes = 16ull * 1024 * 1024;
+};
+
+/**
+ * @brief Streams data from host memory into device local buffers through a staging ring
+ *
+ * CopyToBuffer() copies the source straight into the mapped ring and records a vkCmdCopyBuffer for it, nothing is
+ * buffered on the heap in between. When the ring runs full the recorded copies are submitted and the oldest batch is
+ * waited on. Every submission signals the next value of a timeline semaphore, consumers wait for the value returned
+ * by Submit() before reading the destination.
+ *
+ * CopyToImage() streams the base level of an image the same way, in bands of whole rows.
+ *
+ * Reserve() hands out ring space to be filled later, e.g. by an asynchronous read straight into the mapped ring, and
+ * CopyReserved() records its transfer once the data arrived. The ring is not recycled past an open reservation, so
+ * every reservation has to be copied or released eventually. A copied reservation stays open until its batch finished.
+ *
+ * Destinations shared with another queue family have to be created with VK_SHARING_MODE_CONCURRENT, the queue does
+ * not do ownership transfers. The queue is not thread safe and has to be the only one submitting to its VkQueue
+ * while uploads are in flight.
+ */
+class UploadQueue
+{
+public:
+    VkResult Initialize(VulkanDevice *device,
+                        VkQueue queue,
+                        uint32_t queueFamilyIndex,
+                        const UploadQueueProperties &properties = {});
+    void Destroy();
+
+    void CopyToBuffer(const void *data, VkDeviceSize size, VkBuffer destination, VkDeviceSize destinationOffset);
+    void CopyToImage(const void *data, VkDeviceSize rowBytes, const Image &destination);
+    uint64_t Submit();
+
+    uint8_t *Reserve(VkDeviceSize size, uint64_t &position);
+    void CopyReserved(uint64_t position, VkDeviceSize size, VkBuffer destination, VkDeviceSize destinationOffset);
+    void ReleaseReserved(uint64_t position);
+
+    void Wait(uint64_t value) const;
+    [[nodiscard]] bool IsComplete(uint64_t value) const;
+
+    [[nodiscard]] VkSemaphore GetTimeline() const
+    {
+        return timeline;
+    }
+
+    [[nodiscard]] uint32_t GetQueueFamilyIndex() const
+    {
+        return queueFamily;
+    }
+
+    [[nodiscard]] uint64_t GetBytesUploaded() const
+    {
+        return bytesUploaded;
+    }
+
+    // the persistently mapped ring, e.g. to register it for asynchronous reads
+    [[nodiscard]] std::span<uint8_t> GetStagingMemory() const
+    {
+        return {static_cast<uint8_t *>(staging.mapped), static_cast<size_t>(settings.StagingBytes)};
+    }
+
+private:
+    struct Batch
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        uint64_t value = 0;
+        // ring position up to which this batch's copies read, free again once value is reached
+        uint64_t ringEnd = 0;
+        // reservations whose copy this batch recorded, closed once value is reached
+        std::vector<uint64_t> reservations;
+    };
+
+    void BeginRecording();
+    void Retire(bool waitForOldest);
+    bool ReclaimIdle();
+    void UpdateTail();
+
+    UploadQueueProperties settings;
+    VulkanDevice *vulkanDevice = nullptr;
+    VkQueue transferQueue{VK_NULL_HANDLE};
+    uint32_t queueFamily = 0;
+
+    Buffer staging;
+    // positions grow forever, the slot is position % StagingBytes
+    uint64_t ringHead = 0;
+    uint64_t ringTail = 0;
+    // end of the newest retired batch, the tail stops short of it at the oldest open reservation
+    uint64_t retiredEnd = 0;
+    std::set<uint64_t> reservations;
+    // reservations copied by the batch being recorded
+    std::vector<uint64_t> recordedReservations;
+
+    VkCommandPool commandPool{VK_NULL_HANDLE};
+    std::vector<VkCommandBuffer> freeCommandBuffers;
+    VkCommandBuffer recording{VK_NULL_HANDLE};
+    VkDeviceSize recordedBytes = 0;
+    std::deque<Batch> inFlight;
+
+    VkSemaphore timeline{VK_NULL_HANDLE};
+    uint64_t submittedValue = 0;
+    uint64_t bytesUploaded = 0;
+};
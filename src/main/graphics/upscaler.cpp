@@ -0,0 +1,200 @@
+#include "upscaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/log.h"
+#include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device.h"
+#include "vulkan/vk_host_memory.h"
+#include "vulkan/vk_initializers.h"
+#include "vulkan/vk_tools.h"
+
+namespace
+{
+    // must match local_size_x/y of upscale.comp
+    constexpr uint32_t GroupSize = 8;
+}
+
+/**
+ * Create the sampler, descriptors and the upscale pipeline
+ *
+ * @param device Device to create all resources on
+ * @param properties Render scale and sharpening settings
+ * @param shaderDirectory Directory containing the compiled .spv files
+ *
+ * @return VK_SUCCESS if all resources were created
+ */
+VkResult Upscaler::Initialize(VulkanDevice *device,
+                              const UpscalerProperties &properties,
+                              const std::string &shaderDirectory)
+{
+    vulkanDevice = device;
+    settings = properties;
+    SetScale(properties.Scale);
+
+    const VkDevice logicalDevice = device->logicalDevice;
+
+    // texels are fetched directly, the sampler only exists to bind the input as combined image sampler
+    VkSamplerCreateInfo samplerInfo = vkinit::samplerCreateInfo();
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    Debug::CheckVulkan(vkCreateSampler(logicalDevice,
+                                       &samplerInfo,
+                                       vkhost::allocationCallbacks(VK_OBJECT_TYPE_SAMPLER),
+                                       &sampler));
+
+    const std::vector<VkDescriptorPoolSize> poolSizes = {
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1),
+        vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1),
+    };
+    VkDescriptorPoolCreateInfo poolInfo = vkinit::descriptorPoolCreateInfo(poolSizes, 1);
+    Debug::CheckVulkan(vkCreateDescriptorPool(logicalDevice,
+                                              &poolInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL),
+                                              &descriptorPool));
+
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo = vkinit::descriptorSetLayoutCreateInfo(bindings);
+    Debug::CheckVulkan(vkCreateDescriptorSetLayout(logicalDevice,
+                                                   &layoutInfo,
+                                                   vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
+                                                   &descriptorSetLayout));
+
+    VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocateInfo(descriptorPool,
+                                                                              &descriptorSetLayout,
+                                                                              1);
+    Debug::CheckVulkan(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet));
+
+    VkPushConstantRange pushRange = vkinit::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                              sizeof(PushConstants),
+                                                              0);
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = vkinit::pipelineLayoutCreateInfo(&descriptorSetLayout);
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    Debug::CheckVulkan(vkCreatePipelineLayout(logicalDevice,
+                                              &pipelineLayoutInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT),
+                                              &pipelineLayout));
+
+    const VkShaderModule shader = vktools::loadShader(shaderDirectory + "/upscale.comp.spv", logicalDevice);
+    if (!shader)
+    {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    pipeline = vktools::createComputePipeline(logicalDevice, pipelineLayout, shader, nullptr, device->pipelineCache);
+    vkDestroyShaderModule(logicalDevice, shader, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+
+    Log::System("Upscaler Init (scale {0:.2f}, sharpness {1:.2f} stops{2})",
+                settings.Scale,
+                settings.Sharpness,
+                settings.Sharpen ? "" : ", disabled");
+    return VK_SUCCESS;
+}
+
+void Upscaler::Destroy()
+{
+    if (!vulkanDevice)
+    {
+        return;
+    }
+
+    const VkDevice device = vulkanDevice->logicalDevice;
+    vkDestroyPipeline(device, pipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipelineLayout(device, pipelineLayout, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+    vkDestroyDescriptorPool(device, descriptorPool, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+    vkDestroyDescriptorSetLayout(device,
+                                 descriptorSetLayout,
+                                 vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+    vkDestroySampler(device, sampler, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SAMPLER));
+
+    vulkanDevice = nullptr;
+}
+
+/**
+ * Point the descriptors at new input and output images, only needed when the images are (re)created
+ *
+ * @note Must not be called while a command buffer using the previous images is pending
+ */
+void Upscaler::SetImages(const Image &input, const Image &output)
+{
+    if (output.format != VK_FORMAT_R8G8B8A8_UNORM || !(output.usageFlags & VK_IMAGE_USAGE_STORAGE_BIT))
+    {
+        Log::Error("Upscaler output has to be a R8G8B8A8_UNORM storage image");
+        return;
+    }
+
+    VkDescriptorImageInfo inputInfo = vkinit::descriptorImageInfo(sampler,
+                                                                  input.view,
+                                                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    VkDescriptorImageInfo outputInfo = vkinit::descriptorImageInfo(VK_NULL_HANDLE,
+                                                                   output.view,
+                                                                   VK_IMAGE_LAYOUT_GENERAL);
+    const std::vector<VkWriteDescriptorSet> writes = {
+        vkinit::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &inputInfo),
+        vkinit::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &outputInfo),
+    };
+    vkUpdateDescriptorSets(vulkanDevice->logicalDevice,
+                           static_cast<uint32_t>(writes.size()),
+                           writes.data(),
+                           0,
+                           nullptr);
+}
+
+void Upscaler::SetScale(float scale)
+{
+    settings.Scale = std::clamp(scale, 0.25f, 1.0f);
+}
+
+void Upscaler::SetSharpness(float stops)
+{
+    settings.Sharpness = std::max(stops, 0.0f);
+}
+
+/**
+ * Record the upscale from the input extent of the input image to the output extent of the output image
+ */
+void Upscaler::Dispatch(VkCommandBuffer commandBuffer, VkExtent2D inputExtent, VkExtent2D outputExtent)
+{
+    PushConstants push{};
+    push.inputExtent[0] = static_cast<int32_t>(inputExtent.width);
+    push.inputExtent[1] = static_cast<int32_t>(inputExtent.height);
+    push.outputExtent[0] = static_cast<int32_t>(outputExtent.width);
+    push.outputExtent[1] = static_cast<int32_t>(outputExtent.height);
+    push.sharpness = settings.Sharpen ? std::exp2(-settings.Sharpness) : 0.0f;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipelineLayout,
+                            0,
+                            1,
+                            &descriptorSet,
+                            0,
+                            nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(commandBuffer,
+                  vktools::divideRoundUp(outputExtent.width, GroupSize),
+                  vktools::divideRoundUp(outputExtent.height, GroupSize),
+                  1);
+}
+
+/**
+ * Internal render extent for the configured scale, rounded to even sizes
+ */
+VkExtent2D Upscaler::GetRenderExtent(VkExtent2D outputExtent) const
+{
+    const auto scaled = [this](uint32_t size)
+    {
+        const uint32_t value = static_cast<uint32_t>(std::lround(static_cast<float>(size) * settings.Scale));
+        return std::max(value & ~1u, 2u);
+    };
+    return {scaled(outputExtent.width), scaled(outputExtent.height)};
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan/vk_image.h"
+
+struct VulkanDevice;
+
+struct UpscalerProperties
+{
+    // internal resolution per axis relative to the output, used by GetRenderExtent
+    float Scale = 0.67f;
+    // sharpening strength in stops, 0 is the strongest, every stop halves it
+    float Sharpness = 0.2f;
+    bool Sharpen = true;
+};
+
+/**
+ * @brief Edge adaptive spatial upscaler with contrast adaptive sharpening (FSR1 EASU / RCAS style)
+ *
+ * Upscaling and sharpening are a single compute dispatch (resources/shaders/upscale.comp) from the internal render
+ * target into a storage image at output size. The input is only read inside the given input extent, so it can be
+ * an oversized target like the one of DynamicResolution.
+ *
+ * The input has to be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and the output in VK_IMAGE_LAYOUT_GENERAL when
+ * Dispatch() is recorded. The output has to be VK_FORMAT_R8G8B8A8_UNORM with storage usage; if the swapchain does
+ * not support storage it gets copied or blitted into the swapchain image before present.
+ */
+class Upscaler
+{
+public:
+    VkResult Initialize(VulkanDevice *device,
+                        const UpscalerProperties &properties,
+                        const std::string &shaderDirectory);
+    void Destroy();
+
+    void SetImages(const Image &input, const Image &output);
+    void SetScale(float scale);
+    void SetSharpness(float stops);
+
+    void Dispatch(VkCommandBuffer commandBuffer, VkExtent2D inputExtent, VkExtent2D outputExtent);
+
+    [[nodiscard]] VkExtent2D GetRenderExtent(VkExtent2D outputExtent) const;
+
+private:
+    // mirrors PushConstants in upscale.comp
+    struct PushConstants
+    {
+        int32_t inputExtent[2];
+        int32_t outputExtent[2];
+        float sharpness;
+    };
+
+    UpscalerProperties settings;
+    VulkanDevice *vulkanDevice = nullptr;
+
+    VkSampler sampler{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+    VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline pipeline{VK_NULL_HANDLE};
+};
@@ -1,5 +1,7 @@
 #include "vk_buffer.h"
 
+#include "vk_host_memory.h"
+
 /**
  * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
  *
@@ -113,10 +115,10 @@ void Buffer::destroy()
 {
     if (buffer)
     {
-        vkDestroyBuffer(device, buffer, nullptr);
+        vkDestroyBuffer(device, buffer, vkhost::allocationCallbacks(VK_OBJECT_TYPE_BUFFER));
     }
     if (memory)
     {
-        vkFreeMemory(device, memory, nullptr);
+        vkFreeMemory(device, memory, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY));
     }
 }
\ No newline at end of file
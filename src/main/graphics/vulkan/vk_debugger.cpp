@@ -1,6 +1,162 @@
 #include "vk_debugger.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <format>
+
 #include "core/log.h"
 
+namespace
+{
+    // distinct messages tracked at once, has to be a power of two
+    constexpr uint32_t FilterTableSize = 1024;
+    // slots probed before a message counts as untracked
+    constexpr uint32_t FilterMaxProbes = 32;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct FilterEntry
+    {
+        // 0 while the slot is free
+        std::atomic<uint64_t> key{0};
+        // set once messageId and name are written by the thread that claimed the slot
+        std::atomic<bool> ready{false};
+        std::atomic<uint32_t> total{0};
+        // repeats counted since the last summary
+        std::atomic<uint32_t> pending{0};
+        int32_t messageId = 0;
+        LogLevel level = LogLevel::Warning;
+        char name[96] = {};
+    };
+
+    Debug::ValidationFilterProperties filterProperties;
+    std::array<FilterEntry, FilterTableSize> filterEntries;
+    std::atomic<uint32_t> untrackedMessages{0};
+    std::atomic<Clock::rep> lastSummary{0};
+
+    uint64_t HashCombine(uint64_t hash, uint64_t value)
+    {
+        // splitmix64 finalizer over the running hash
+        hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+        return hash ^ (hash >> 31);
+    }
+
+    uint64_t MessageKey(const VkDebugUtilsMessengerCallbackDataEXT *data)
+    {
+        uint64_t key = HashCombine(0, static_cast<uint32_t>(data->messageIdNumber));
+        // some layers report every message as id 0, fall back to the id name
+        if (data->messageIdNumber == 0 && data->pMessageIdName)
+        {
+            for (const char *c = data->pMessageIdName; *c; c++)
+            {
+                key = HashCombine(key, static_cast<uint8_t>(*c));
+            }
+        }
+        for (uint32_t i = 0; i < data->objectCount; i++)
+        {
+            key = HashCombine(key, data->pObjects[i].objectHandle);
+        }
+        return key != 0 ? key : 1;
+    }
+
+    LogLevel SeverityLevel(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+    {
+        if (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+        {
+            return LogLevel::Error;
+        }
+        if (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+        {
+            return LogLevel::Warning;
+        }
+        return LogLevel::System;
+    }
+
+    FilterEntry *FindOrInsert(uint64_t key, LogLevel level, const VkDebugUtilsMessengerCallbackDataEXT *data)
+    {
+        for (uint32_t probe = 0; probe < FilterMaxProbes; probe++)
+        {
+            FilterEntry &entry = filterEntries[(key + probe) & (FilterTableSize - 1)];
+            uint64_t current = entry.key.load(std::memory_order_acquire);
+            if (current == 0 && entry.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+            {
+                entry.messageId = data->messageIdNumber;
+                entry.level = level;
+                const char *name = data->pMessageIdName ? data->pMessageIdName : "unnamed";
+                std::strncpy(entry.name, name, sizeof(entry.name) - 1);
+                entry.ready.store(true, std::memory_order_release);
+                return &entry;
+            }
+            // a failed exchange loaded the key another thread just claimed the slot for
+            if (current == key)
+            {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    void BreakIntoDebugger()
+    {
+#if defined(_MSC_VER)
+        __debugbreak();
+#elif defined(SIGTRAP)
+        std::raise(SIGTRAP);
+#endif
+    }
+
+    // logs and resets the repeats counted since the previous summary, seconds ago
+    void LogSummary(double seconds)
+    {
+        for (FilterEntry &entry : filterEntries)
+        {
+            if (!entry.ready.load(std::memory_order_acquire))
+            {
+                continue;
+            }
+            const uint32_t repeats = entry.pending.exchange(0, std::memory_order_relaxed);
+            if (repeats > 0)
+            {
+                Log::Write(entry.level,
+                           std::format("[VALIDATION] {0} (0x{1:08x}) x{2} in last {3:.1f}s, {4} total",
+                                       entry.name,
+                                       static_cast<uint32_t>(entry.messageId),
+                                       repeats,
+                                       seconds,
+                                       entry.total.load(std::memory_order_relaxed)));
+            }
+        }
+        const uint32_t untracked = untrackedMessages.exchange(0, std::memory_order_relaxed);
+        if (untracked > 0)
+        {
+            Log::Warning("[VALIDATION] x{0} messages in last {1:.1f}s not shown, too many distinct messages",
+                         untracked,
+                         seconds);
+        }
+    }
+
+    // the first thread past the interval takes the summary, the others keep going
+    void MaybeLogSummary()
+    {
+        const Clock::rep now = Clock::now().time_since_epoch().count();
+        const auto interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<float>(filterProperties.SummaryIntervalSeconds));
+        Clock::rep last = lastSummary.load(std::memory_order_relaxed);
+        if (now - last < interval.count() ||
+            !lastSummary.compare_exchange_strong(last, now, std::memory_order_relaxed))
+        {
+            return;
+        }
+        LogSummary(std::chrono::duration<double>(Clock::duration(now - last)).count());
+    }
+}
+
 namespace Debug
 {
     PFN_vkCreateDebugUtilsMessengerEXT vkCreateDebugUtilsMessengerEXT;
@@ -18,19 +174,56 @@ namespace Debug
         const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
         void *pUserData)
     {
-        // TODO: string prefix from messageSeverity
-        std::string prefix = "VALIDATION";
-
-        std::string message = std::format("[{0}] {1}",
-                                          prefix,
-                                          pCallbackData->pMessage);
+        const uint64_t key = MessageKey(pCallbackData);
+        if (std::ranges::find(filterProperties.BreakOnMessageIds, pCallbackData->messageIdNumber) !=
+            filterProperties.BreakOnMessageIds.end())
+        {
+            BreakIntoDebugger();
+        }
 
-        Log::System(message);
+        const LogLevel level = SeverityLevel(messageSeverity);
+        FilterEntry *entry = FindOrInsert(key, level, pCallbackData);
+        const uint32_t occurrence = entry ? entry->total.fetch_add(1, std::memory_order_relaxed) + 1 : 0;
+        if (!entry)
+        {
+            untrackedMessages.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (occurrence <= filterProperties.ImmediateCount)
+        {
+            const char *repeats = occurrence == filterProperties.ImmediateCount ? " (repeats are summarized)" : "";
+            Log::Write(level, std::format("[VALIDATION] {0}{1}", pCallbackData->pMessage, repeats));
+        }
+        else
+        {
+            entry->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        MaybeLogSummary();
 
         // whether or not validation should abort vulkan
         return VK_FALSE;
     }
 
+    void SetValidationFilter(const ValidationFilterProperties &properties)
+    {
+        filterProperties = properties;
+        for (FilterEntry &entry : filterEntries)
+        {
+            entry.key.store(0, std::memory_order_relaxed);
+            entry.ready.store(false, std::memory_order_relaxed);
+            entry.total.store(0, std::memory_order_relaxed);
+            entry.pending.store(0, std::memory_order_relaxed);
+        }
+        untrackedMessages.store(0, std::memory_order_relaxed);
+        lastSummary.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    void FlushValidationSummary()
+    {
+        const Clock::rep now = Clock::now().time_since_epoch().count();
+        const Clock::rep last = lastSummary.exchange(now, std::memory_order_relaxed);
+        LogSummary(std::chrono::duration<double>(Clock::duration(now - last)).count());
+    }
+
     void CheckResult(const VkResult &result)
     {
         if (result != VK_SUCCESS)
@@ -84,6 +277,7 @@ namespace Debug
     {
         if (debugUtilsMessenger != VK_NULL_HANDLE)
         {
+            FlushValidationSummary();
             Debug::vkDestroyDebugUtilsMessengerEXT(
                 instance,
                 debugUtilsMessenger,
@@ -1,12 +1,35 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.hpp>
 #include "core/log.h"
 
 namespace Debug
 {
+    struct ValidationFilterProperties
+    {
+        // occurrences of each distinct message logged in full, later ones are only counted
+        uint32_t ImmediateCount = 3;
+        // period of the summaries of counted repeats
+        float SummaryIntervalSeconds = 1.0f;
+        // messageIdNumber values that trigger a debug break, only set these when running under a debugger
+        std::vector<int32_t> BreakOnMessageIds;
+    };
+
+    /**
+     * Configure how DebugUtilsMessageCallback deduplicates messages, call before the messenger is created
+     *
+     * Messages are keyed by messageIdNumber and their object handles. Each key is logged ImmediateCount times, after
+     * that repeats are counted in a fixed lock-free table and logged as one "xN in last 1.0s" line per key and
+     * SummaryIntervalSeconds, so a message repeated by every draw cannot flood the log.
+     */
+    void SetValidationFilter(const ValidationFilterProperties &properties);
+    /** @brief Log the repeats counted since the last summary right away */
+    void FlushValidationSummary();
+
     VKAPI_ATTR VkBool32 VKAPI_CALL DebugUtilsMessageCallback(
         VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
         VkDebugUtilsMessageTypeFlagsEXT messageType,
@@ -1,8 +1,11 @@
 #include "vk_device.h"
 
+#include <algorithm>
+
 #include "core/log.h"
 #include "vk_initializers.h"
 #include "vk_debugger.h"
+#include "vk_host_memory.h"
 
 /**
  * Default constructor
@@ -65,11 +68,11 @@ VulkanDevice::~VulkanDevice()
 {
     if (commandPool)
     {
-        vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+        vkDestroyCommandPool(logicalDevice, commandPool, vkhost::allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL));
     }
     if (logicalDevice)
     {
-        vkDestroyDevice(logicalDevice, nullptr);
+        vkDestroyDevice(logicalDevice, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE));
     }
 }
 
@@ -298,9 +301,7 @@ VkResult VulkanDevice::createLogicalDevice(
         {
             if (!extensionSupported(enabledExtension))
             {
-                Log::Error(std::format(
-                    "Enabled device extension {0} is not present at device level!",
-                    enabledExtension));
+                Log::Error("Enabled device extension {0} is not present at device level!", enabledExtension);
             }
         }
 
@@ -313,7 +314,7 @@ VkResult VulkanDevice::createLogicalDevice(
 
     VkResult result = vkCreateDevice(physicalDevice,
                                      &deviceCreateInfo,
-                                     nullptr,
+                                     vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE),
                                      &logicalDevice);
     if (result != VK_SUCCESS)
     {
@@ -351,7 +352,7 @@ VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags,
     bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     Debug::CheckVulkan(vkCreateBuffer(logicalDevice,
                                       &bufferCreateInfo,
-                                      nullptr,
+                                      vkhost::allocationCallbacks(VK_OBJECT_TYPE_BUFFER),
                                       buffer));
 
     // Create the memory backing up the buffer handle
@@ -373,7 +374,7 @@ VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags,
         memAlloc.pNext = &allocFlagsInfo;
     }
     Debug::CheckVulkan(
-        vkAllocateMemory(logicalDevice, &memAlloc, nullptr, memory));
+        vkAllocateMemory(logicalDevice, &memAlloc, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY), memory));
 
     // If a pointer to the buffer data has been passed, map the buffer and copy over the data
     if (data != nullptr)
@@ -410,6 +411,8 @@ VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags,
  * @param buffer Pointer to a vk::Vulkan buffer object
  * @param size Size of the buffer in bytes
  * @param data Pointer to the data that should be copied to the buffer after creation (optional, if not set, no data is copied over)
+ * @param queueFamilies Queue families accessing the buffer without ownership transfers (optional, the buffer is only
+ *                      created with concurrent sharing if they are at least two different families)
  *
  * @return VK_SUCCESS if buffer handle and memory have been created and (optionally passed) data has been copied
  */
@@ -418,15 +421,25 @@ VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags,
                                         memoryPropertyFlags,
                                     Buffer *buffer,
                                     VkDeviceSize size,
-                                    void *data)
+                                    void *data,
+                                    const std::vector<uint32_t> &queueFamilies)
 {
     buffer->device = logicalDevice;
 
     // Create the buffer handle
     VkBufferCreateInfo bufferCreateInfo = vkinit::bufferCreateInfo(usageFlags, size);
+    std::vector<uint32_t> sharedFamilies = queueFamilies;
+    std::sort(sharedFamilies.begin(), sharedFamilies.end());
+    sharedFamilies.erase(std::unique(sharedFamilies.begin(), sharedFamilies.end()), sharedFamilies.end());
+    if (sharedFamilies.size() > 1)
+    {
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharedFamilies.size());
+        bufferCreateInfo.pQueueFamilyIndices = sharedFamilies.data();
+    }
     Debug::CheckVulkan(vkCreateBuffer(logicalDevice,
                                       &bufferCreateInfo,
-                                      nullptr,
+                                      vkhost::allocationCallbacks(VK_OBJECT_TYPE_BUFFER),
                                       &buffer->buffer));
 
     // Create the memory backing up the buffer handle
@@ -449,7 +462,7 @@ VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags,
     }
     Debug::CheckVulkan(vkAllocateMemory(logicalDevice,
                                         &memAlloc,
-                                        nullptr,
+                                        vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY),
                                         &buffer->memory));
 
     buffer->alignment = memReqs.alignment;
@@ -476,6 +489,99 @@ VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags,
     return buffer->bind();
 }
 
+/**
+ * Create a 2D image on the device together with a default view over all mip levels and layers
+ *
+ * @param format Format of the image, depth/stencil formats get the matching aspect flags
+ * @param extent Width and height of the base level
+ * @param usageFlags Usage flag bit mask for the image (i.e. color attachment, sampled, storage)
+ * @param memoryPropertyFlags Memory properties for this image (usually device local)
+ * @param image Pointer to a vk::Vulkan image object
+ * @param mipLevels (Optional) Number of mip levels (Defaults to 1)
+ * @param arrayLayers (Optional) Number of array layers, views of layered images are 2D arrays (Defaults to 1)
+ *
+ * @return VK_SUCCESS if image handle, memory and view have been created
+ */
+VkResult VulkanDevice::createImage(VkFormat format,
+                                   VkExtent2D extent,
+                                   VkImageUsageFlags usageFlags,
+                                   VkMemoryPropertyFlags memoryPropertyFlags,
+                                   Image *image,
+                                   uint32_t mipLevels,
+                                   uint32_t arrayLayers)
+{
+    image->device = logicalDevice;
+    image->format = format;
+    image->extent = extent;
+    image->mipLevels = mipLevels;
+    image->arrayLayers = arrayLayers;
+    image->usageFlags = usageFlags;
+
+    switch (format)
+    {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+        image->aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        break;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        image->aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        break;
+    default:
+        image->aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        break;
+    }
+
+    // Create the image handle
+    VkImageCreateInfo imageCreateInfo = vkinit::imageCreateInfo();
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.format = format;
+    imageCreateInfo.extent = {extent.width, extent.height, 1};
+    imageCreateInfo.mipLevels = mipLevels;
+    imageCreateInfo.arrayLayers = arrayLayers;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = usageFlags;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    Debug::CheckVulkan(vkCreateImage(logicalDevice,
+                                     &imageCreateInfo,
+                                     vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE),
+                                     &image->image));
+
+    // Create the memory backing up the image handle
+    VkMemoryRequirements memReqs;
+    VkMemoryAllocateInfo memAlloc = vkinit::memoryAllocateInfo();
+    vkGetImageMemoryRequirements(logicalDevice, image->image, &memReqs);
+    memAlloc.allocationSize = memReqs.size;
+    memAlloc.memoryTypeIndex = getMemoryType(
+        memReqs.memoryTypeBits,
+        memoryPropertyFlags);
+    Debug::CheckVulkan(vkAllocateMemory(logicalDevice,
+                                        &memAlloc,
+                                        vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY),
+                                        &image->memory));
+    Debug::CheckVulkan(
+        vkBindImageMemory(logicalDevice, image->image, image->memory, 0));
+
+    // Default view, sampling depth/stencil images reads the depth aspect only
+    VkImageViewCreateInfo viewCreateInfo = vkinit::imageViewCreateInfo();
+    viewCreateInfo.image = image->image;
+    viewCreateInfo.viewType = arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+    viewCreateInfo.format = format;
+    viewCreateInfo.subresourceRange = image->subresourceRange();
+    if (image->aspectMask & VK_IMAGE_ASPECT_DEPTH_BIT)
+    {
+        viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    }
+    return vkCreateImageView(logicalDevice,
+                             &viewCreateInfo,
+                             vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW),
+                             &image->view);
+}
+
 /**
  * Copy buffer data from src to dst using VkCmdCopyBuffer
  *
@@ -533,7 +639,7 @@ VkCommandPool VulkanDevice::createCommandPool(
     Debug::CheckVulkan(
         vkCreateCommandPool(logicalDevice,
                             &cmdPoolInfo,
-                            nullptr,
+                            vkhost::allocationCallbacks(VK_OBJECT_TYPE_COMMAND_POOL),
                             &cmdPool));
     return cmdPool;
 }
@@ -606,7 +712,7 @@ void VulkanDevice::flushCommandBuffer(VkCommandBuffer commandBuffer,
     VkFenceCreateInfo fenceInfo = vkinit::fenceCreateInfo(0);
     VkFence fence;
     Debug::CheckVulkan(
-        vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence));
+        vkCreateFence(logicalDevice, &fenceInfo, vkhost::allocationCallbacks(VK_OBJECT_TYPE_FENCE), &fence));
     // Submit to the queue
     Debug::CheckVulkan(vkQueueSubmit(queue, 1, &submitInfo, fence));
     // Wait for the fence to signal that command buffer has finished executing
@@ -615,7 +721,7 @@ void VulkanDevice::flushCommandBuffer(VkCommandBuffer commandBuffer,
                                        &fence,
                                        VK_TRUE,
                                        DEFAULT_FENCE_TIMEOUT));
-    vkDestroyFence(logicalDevice, fence, nullptr);
+    vkDestroyFence(logicalDevice, fence, vkhost::allocationCallbacks(VK_OBJECT_TYPE_FENCE));
     if (free)
     {
         vkFreeCommandBuffers(logicalDevice, pool, 1, &commandBuffer);
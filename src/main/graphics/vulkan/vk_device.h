@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan.hpp>
 #include "vk_buffer.h"
+#include "vk_image.h"
 
 #define DEFAULT_FENCE_TIMEOUT 100000000000
 
@@ -25,6 +26,8 @@ struct VulkanDevice
     std::vector<std::string> supportedExtensions;
     /** @brief Default command pool for the graphics queue family index */
     VkCommandPool commandPool = VK_NULL_HANDLE;
+    /** @brief Pipeline cache shared by every pipeline created on this device, owned by the renderer (optional) */
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 
     /** @brief Contains queue family indices */
     struct
@@ -61,7 +64,15 @@ struct VulkanDevice
                           VkMemoryPropertyFlags memoryPropertyFlags,
                           Buffer *buffer,
                           VkDeviceSize size,
-                          void *data = nullptr);
+                          void *data = nullptr,
+                          const std::vector<uint32_t> &queueFamilies = {});
+    VkResult createImage(VkFormat format,
+                         VkExtent2D extent,
+                         VkImageUsageFlags usageFlags,
+                         VkMemoryPropertyFlags memoryPropertyFlags,
+                         Image *image,
+                         uint32_t mipLevels = 1,
+                         uint32_t arrayLayers = 1);
     void copyBuffer(Buffer *src,
                     Buffer *dst,
                     VkQueue queue,
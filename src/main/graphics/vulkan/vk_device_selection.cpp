@@ -0,0 +1,254 @@
+#include "vk_device_selection.h"
+
+#include <algorithm>
+#include <cctype>
+#include <format>
+
+#include "core/log.h"
+
+namespace
+{
+    // the type decides between otherwise suitable devices, memory and queue layout rank devices of the same type
+    constexpr uint64_t OverrideScore = 1'000'000;
+    constexpr uint64_t PreferredTypeScore = 100'000;
+    constexpr uint64_t OtherGpuTypeScore = 50'000;
+    constexpr uint64_t VirtualGpuScore = 20'000;
+    constexpr uint64_t CpuScore = 1'000;
+    // one point per 16 MiB, capped at 64 GiB so memory never outweighs the device type
+    constexpr VkDeviceSize BytesPerMemoryPoint = 16ull * 1024 * 1024;
+    constexpr uint64_t MaxMemoryScore = 4'096;
+    constexpr uint64_t DedicatedQueueScore = 500;
+
+    std::string Normalize(const std::string &text)
+    {
+        std::string normalized;
+        for (const char c : text)
+        {
+            if (c != '-')
+            {
+                normalized.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+            }
+        }
+        return normalized;
+    }
+
+    const char *DeviceTypeName(VkPhysicalDeviceType type)
+    {
+        switch (type)
+        {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return "discrete";
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return "integrated";
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return "virtual";
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            return "cpu";
+        default:
+            return "other";
+        }
+    }
+
+    uint64_t TypeScore(VkPhysicalDeviceType type, bool preferIntegrated)
+    {
+        const VkPhysicalDeviceType preferred =
+            preferIntegrated ? VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU : VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+        if (type == preferred)
+        {
+            return PreferredTypeScore;
+        }
+        switch (type)
+        {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return OtherGpuTypeScore;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return VirtualGpuScore;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            return CpuScore;
+        default:
+            return 0;
+        }
+    }
+
+    DeviceCandidate Evaluate(VkPhysicalDevice physicalDevice, const DeviceSelectionProperties &properties)
+    {
+        DeviceCandidate candidate;
+        candidate.PhysicalDevice = physicalDevice;
+
+        VkPhysicalDeviceIDProperties idProperties{};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+        candidate.Properties = properties2.properties;
+        for (const uint8_t byte : idProperties.deviceUUID)
+        {
+            candidate.Uuid += std::format("{0:02x}", byte);
+        }
+
+        // the features VulkanRenderer enables when creating the logical device
+        VkPhysicalDeviceVulkan13Features features13{};
+        features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+        VkPhysicalDeviceVulkan12Features features12{};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        features12.pNext = &features13;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &features12;
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        bool hasGraphics = false;
+        for (const VkQueueFamilyProperties &family : queueFamilies)
+        {
+            const VkQueueFlags flags = family.queueFlags;
+            hasGraphics |= (flags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            candidate.DedicatedCompute |= (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT);
+            candidate.DedicatedTransfer |=
+                (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+        }
+
+        // the feature structs are only valid to query on 1.3 devices
+        if (candidate.Properties.apiVersion < VK_API_VERSION_1_3)
+        {
+            candidate.Missing = "Vulkan 1.3";
+        }
+        else
+        {
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+            if (!features13.dynamicRendering)
+            {
+                candidate.Missing = "dynamicRendering";
+            }
+            else if (!features13.synchronization2)
+            {
+                candidate.Missing = "synchronization2";
+            }
+            else if (!features12.timelineSemaphore)
+            {
+                candidate.Missing = "timelineSemaphore";
+            }
+            else if (!hasGraphics)
+            {
+                candidate.Missing = "a graphics queue";
+            }
+        }
+
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+        {
+            if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            {
+                candidate.DeviceLocalBytes += memoryProperties.memoryHeaps[i].size;
+            }
+        }
+
+        if (!properties.Override.empty())
+        {
+            const std::string name = Normalize(candidate.Properties.deviceName);
+            const std::string requested = Normalize(properties.Override);
+            candidate.MatchesOverride = requested == candidate.Uuid || name.find(requested) != std::string::npos;
+        }
+
+        if (candidate.Missing.empty())
+        {
+            candidate.Score = TypeScore(candidate.Properties.deviceType, properties.PreferIntegrated) +
+                              std::min(candidate.DeviceLocalBytes / BytesPerMemoryPoint, MaxMemoryScore) +
+                              (candidate.DedicatedCompute ? DedicatedQueueScore : 0) +
+                              (candidate.DedicatedTransfer ? DedicatedQueueScore : 0) +
+                              (candidate.MatchesOverride ? OverrideScore : 0);
+        }
+        return candidate;
+    }
+}
+
+namespace vktools
+{
+    /**
+     * Score every physical device, devices missing a required feature score 0
+     *
+     * @param instance Instance to enumerate the physical devices of
+     * @param properties Preferred device type and optional override
+     *
+     * @return Candidates sorted by descending score, devices with equal scores keep their enumeration order
+     */
+    std::vector<DeviceCandidate> rankPhysicalDevices(VkInstance instance,
+                                                     const DeviceSelectionProperties &properties)
+    {
+        uint32_t gpuCount = 0;
+        vkEnumeratePhysicalDevices(instance, &gpuCount, nullptr);
+        std::vector<VkPhysicalDevice> physicalDevices(gpuCount);
+        if (gpuCount == 0 || vkEnumeratePhysicalDevices(instance, &gpuCount, physicalDevices.data()) != VK_SUCCESS)
+        {
+            return {};
+        }
+
+        std::vector<DeviceCandidate> candidates;
+        candidates.reserve(gpuCount);
+        for (VkPhysicalDevice physicalDevice : physicalDevices)
+        {
+            candidates.push_back(Evaluate(physicalDevice, properties));
+        }
+        std::ranges::stable_sort(candidates,
+                                 [](const DeviceCandidate &a, const DeviceCandidate &b) { return a.Score > b.Score; });
+        return candidates;
+    }
+
+    /**
+     * Pick the highest scoring physical device and log every candidate's score
+     *
+     * @param instance Instance to enumerate the physical devices of
+     * @param properties Preferred device type and optional override
+     *
+     * @return VK_NULL_HANDLE if no device has the required features
+     */
+    VkPhysicalDevice selectPhysicalDevice(VkInstance instance, const DeviceSelectionProperties &properties)
+    {
+        const std::vector<DeviceCandidate> candidates = rankPhysicalDevices(instance, properties);
+
+        bool overrideFound = false;
+        for (const DeviceCandidate &candidate : candidates)
+        {
+            overrideFound |= candidate.MatchesOverride;
+            if (!candidate.Missing.empty())
+            {
+                Log::Info("GPU {0} [{1}] {2}: unsuitable, missing {3}",
+                          candidate.Properties.deviceName,
+                          DeviceTypeName(candidate.Properties.deviceType),
+                          candidate.Uuid,
+                          candidate.Missing);
+                continue;
+            }
+            Log::Info("GPU {0} [{1}] {2}: {3} MiB device local{4}{5}{6}, score {7}",
+                      candidate.Properties.deviceName,
+                      DeviceTypeName(candidate.Properties.deviceType),
+                      candidate.Uuid,
+                      candidate.DeviceLocalBytes / (1024 * 1024),
+                      candidate.DedicatedCompute ? ", dedicated compute" : "",
+                      candidate.DedicatedTransfer ? ", dedicated transfer" : "",
+                      candidate.MatchesOverride ? ", override" : "",
+                      candidate.Score);
+        }
+
+        if (!properties.Override.empty() && !overrideFound)
+        {
+            Log::Warning("No GPU matches the device override {0}, using the highest score", properties.Override);
+        }
+        if (candidates.empty() || candidates.front().Score == 0)
+        {
+            return VK_NULL_HANDLE;
+        }
+        if (!properties.Override.empty() && overrideFound && !candidates.front().MatchesOverride)
+        {
+            Log::Warning("The GPU matching the device override {0} is unsuitable, using the highest score",
+                         properties.Override);
+        }
+        return candidates.front().PhysicalDevice;
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+struct DeviceSelectionProperties
+{
+    bool PreferIntegrated = false;
+    // substring of the device name or its UUID as 32 hex digits (dashes optional), wins over the score when suitable
+    std::string Override;
+};
+
+struct DeviceCandidate
+{
+    VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties Properties{};
+    // hex digits of VkPhysicalDeviceIDProperties::deviceUUID
+    std::string Uuid;
+    VkDeviceSize DeviceLocalBytes = 0;
+    bool DedicatedCompute = false;
+    bool DedicatedTransfer = false;
+    bool MatchesOverride = false;
+    // empty if the device has every required feature, otherwise the first one it is missing
+    std::string Missing;
+    uint64_t Score = 0;
+};
+
+namespace vktools
+{
+    std::vector<DeviceCandidate> rankPhysicalDevices(VkInstance instance,
+                                                     const DeviceSelectionProperties &properties);
+    VkPhysicalDevice selectPhysicalDevice(VkInstance instance, const DeviceSelectionProperties &properties);
+}
@@ -0,0 +1,416 @@
+#include "vk_host_memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include "core/log.h"
+
+namespace
+{
+    // precedes every allocation, the pointer handed to the driver is 16 byte aligned so this is too
+    struct alignas(16) AllocationHeader
+    {
+        uint64_t size;
+        // distance from the start of the underlying block to the returned pointer
+        uint32_t offset;
+        uint8_t scope;
+        uint8_t objectType;
+        // index into PoolBlockSizes or NotPooled
+        uint8_t sizeClass;
+    };
+    constexpr size_t HeaderSize = sizeof(AllocationHeader);
+    static_assert(HeaderSize == 16);
+
+    constexpr uint8_t NotPooled = UINT8_MAX;
+    // block sizes including the header, larger or more strictly aligned requests go to the system allocator
+    constexpr size_t PoolBlockSizes[] = {32, 64, 128, 256, 512};
+    constexpr uint32_t SizeClassCount = std::size(PoolBlockSizes);
+    constexpr size_t PoolChunkSize = 64 * 1024;
+    // blocks moved between a thread cache and the central lists at a time
+    constexpr uint32_t TransferBatch = 32;
+    constexpr uint32_t MaxCachedBlocks = 2 * TransferBatch;
+
+    struct AtomicCounters
+    {
+        std::atomic<int64_t> bytes{0};
+        std::atomic<int64_t> peakBytes{0};
+        std::atomic<int64_t> allocations{0};
+        std::atomic<uint64_t> totalAllocations{0};
+
+        void Add(int64_t size)
+        {
+            const int64_t current = bytes.fetch_add(size, std::memory_order_relaxed) + size;
+            int64_t peak = peakBytes.load(std::memory_order_relaxed);
+            while (current > peak && !peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+            {
+            }
+            allocations.fetch_add(1, std::memory_order_relaxed);
+            totalAllocations.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void Remove(int64_t size)
+        {
+            bytes.fetch_sub(size, std::memory_order_relaxed);
+            allocations.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        vkhost::HostMemoryCounters Load() const
+        {
+            vkhost::HostMemoryCounters counters;
+            counters.Bytes = bytes.load(std::memory_order_relaxed);
+            counters.PeakBytes = peakBytes.load(std::memory_order_relaxed);
+            counters.Allocations = allocations.load(std::memory_order_relaxed);
+            counters.TotalAllocations = totalAllocations.load(std::memory_order_relaxed);
+            return counters;
+        }
+    };
+
+    AtomicCounters totalCounters;
+    AtomicCounters scopeCounters[vkhost::AllocationScopes];
+    AtomicCounters objectTypeCounters[vkhost::TrackedObjectTypes];
+    std::atomic<int64_t> internalBytes{0};
+    std::atomic<uint64_t> pooledAllocations{0};
+    std::atomic<bool> poolingEnabled{false};
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    // shared free lists, only touched in batches when a thread cache runs empty or overflows
+    std::mutex centralMutex;
+    FreeBlock *centralLists[SizeClassCount] = {};
+
+    struct ThreadCache
+    {
+        FreeBlock *lists[SizeClassCount] = {};
+        uint32_t counts[SizeClassCount] = {};
+
+        ~ThreadCache()
+        {
+            // blocks of exiting driver threads go back to the central lists
+            std::lock_guard lock(centralMutex);
+            for (uint32_t sizeClass = 0; sizeClass < SizeClassCount; sizeClass++)
+            {
+                while (FreeBlock *block = lists[sizeClass])
+                {
+                    lists[sizeClass] = block->next;
+                    block->next = centralLists[sizeClass];
+                    centralLists[sizeClass] = block;
+                }
+            }
+        }
+    };
+    thread_local ThreadCache threadCache;
+
+    uint8_t SizeClass(size_t size, size_t alignment)
+    {
+        if (alignment > HeaderSize)
+        {
+            return NotPooled;
+        }
+        for (uint8_t sizeClass = 0; sizeClass < SizeClassCount; sizeClass++)
+        {
+            if (size + HeaderSize <= PoolBlockSizes[sizeClass])
+            {
+                return sizeClass;
+            }
+        }
+        return NotPooled;
+    }
+
+    // called with centralMutex held, chunks are never returned to the system
+    void RefillCentral(uint8_t sizeClass)
+    {
+        const size_t blockSize = PoolBlockSizes[sizeClass];
+        auto *chunk = static_cast<uint8_t *>(::operator new(PoolChunkSize, std::align_val_t{HeaderSize}));
+        for (size_t offset = 0; offset + blockSize <= PoolChunkSize; offset += blockSize)
+        {
+            auto *block = reinterpret_cast<FreeBlock *>(chunk + offset);
+            block->next = centralLists[sizeClass];
+            centralLists[sizeClass] = block;
+        }
+    }
+
+    void *PoolAllocate(uint8_t sizeClass)
+    {
+        ThreadCache &cache = threadCache;
+        if (!cache.lists[sizeClass])
+        {
+            std::lock_guard lock(centralMutex);
+            for (uint32_t i = 0; i < TransferBatch; i++)
+            {
+                if (!centralLists[sizeClass])
+                {
+                    RefillCentral(sizeClass);
+                }
+                FreeBlock *block = centralLists[sizeClass];
+                centralLists[sizeClass] = block->next;
+                block->next = cache.lists[sizeClass];
+                cache.lists[sizeClass] = block;
+            }
+            cache.counts[sizeClass] += TransferBatch;
+        }
+
+        FreeBlock *block = cache.lists[sizeClass];
+        cache.lists[sizeClass] = block->next;
+        cache.counts[sizeClass]--;
+        return block;
+    }
+
+    void PoolFree(void *memory, uint8_t sizeClass)
+    {
+        ThreadCache &cache = threadCache;
+        auto *block = static_cast<FreeBlock *>(memory);
+        block->next = cache.lists[sizeClass];
+        cache.lists[sizeClass] = block;
+
+        if (++cache.counts[sizeClass] > MaxCachedBlocks)
+        {
+            std::lock_guard lock(centralMutex);
+            for (uint32_t i = 0; i < TransferBatch; i++)
+            {
+                FreeBlock *returned = cache.lists[sizeClass];
+                cache.lists[sizeClass] = returned->next;
+                returned->next = centralLists[sizeClass];
+                centralLists[sizeClass] = returned;
+            }
+            cache.counts[sizeClass] -= TransferBatch;
+        }
+    }
+
+    uint8_t ObjectTypeIndex(void *pUserData)
+    {
+        return static_cast<uint8_t>(static_cast<AtomicCounters *>(pUserData) - objectTypeCounters);
+    }
+
+    VKAPI_ATTR void *VKAPI_CALL Allocate(void *pUserData,
+                                         size_t size,
+                                         size_t alignment,
+                                         VkSystemAllocationScope allocationScope)
+    {
+        if (size == 0)
+        {
+            return nullptr;
+        }
+        alignment = std::max(alignment, HeaderSize);
+
+        uint8_t sizeClass = poolingEnabled.load(std::memory_order_relaxed) ? SizeClass(size, alignment) : NotPooled;
+        uint8_t *block = nullptr;
+        size_t offset = HeaderSize;
+        if (sizeClass != NotPooled)
+        {
+            block = static_cast<uint8_t *>(PoolAllocate(sizeClass));
+            pooledAllocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            block = static_cast<uint8_t *>(std::malloc(size + HeaderSize + alignment - 1));
+            if (!block)
+            {
+                return nullptr;
+            }
+            const uintptr_t address = reinterpret_cast<uintptr_t>(block) + HeaderSize;
+            offset = HeaderSize + ((alignment - address % alignment) % alignment);
+        }
+
+        uint8_t *memory = block + offset;
+        auto *header = reinterpret_cast<AllocationHeader *>(memory - HeaderSize);
+        header->size = size;
+        header->offset = static_cast<uint32_t>(offset);
+        header->scope = static_cast<uint8_t>(allocationScope);
+        header->objectType = ObjectTypeIndex(pUserData);
+        header->sizeClass = sizeClass;
+
+        const int64_t bytes = static_cast<int64_t>(size);
+        totalCounters.Add(bytes);
+        scopeCounters[header->scope].Add(bytes);
+        objectTypeCounters[header->objectType].Add(bytes);
+        return memory;
+    }
+
+    VKAPI_ATTR void VKAPI_CALL Free(void *, void *pMemory)
+    {
+        if (!pMemory)
+        {
+            return;
+        }
+
+        auto *memory = static_cast<uint8_t *>(pMemory);
+        const AllocationHeader header = *reinterpret_cast<AllocationHeader *>(memory - HeaderSize);
+        const int64_t bytes = static_cast<int64_t>(header.size);
+        totalCounters.Remove(bytes);
+        scopeCounters[header.scope].Remove(bytes);
+        objectTypeCounters[header.objectType].Remove(bytes);
+
+        uint8_t *block = memory - header.offset;
+        if (header.sizeClass != NotPooled)
+        {
+            PoolFree(block, header.sizeClass);
+        }
+        else
+        {
+            std::free(block);
+        }
+    }
+
+    VKAPI_ATTR void *VKAPI_CALL Reallocate(void *pUserData,
+                                           void *pOriginal,
+                                           size_t size,
+                                           size_t alignment,
+                                           VkSystemAllocationScope allocationScope)
+    {
+        if (!pOriginal)
+        {
+            return Allocate(pUserData, size, alignment, allocationScope);
+        }
+        if (size == 0)
+        {
+            Free(pUserData, pOriginal);
+            return nullptr;
+        }
+
+        // on failure the original allocation has to stay untouched
+        void *memory = Allocate(pUserData, size, alignment, allocationScope);
+        if (!memory)
+        {
+            return nullptr;
+        }
+        const auto *header = reinterpret_cast<AllocationHeader *>(static_cast<uint8_t *>(pOriginal) - HeaderSize);
+        std::memcpy(memory, pOriginal, std::min(static_cast<size_t>(header->size), size));
+        Free(pUserData, pOriginal);
+        return memory;
+    }
+
+    VKAPI_ATTR void VKAPI_CALL InternalAllocation(void *,
+                                                  size_t size,
+                                                  VkInternalAllocationType,
+                                                  VkSystemAllocationScope)
+    {
+        internalBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+    }
+
+    VKAPI_ATTR void VKAPI_CALL InternalFree(void *,
+                                            size_t size,
+                                            VkInternalAllocationType,
+                                            VkSystemAllocationScope)
+    {
+        internalBytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+    }
+
+    // one set per object type, pUserData points at the counters of that type
+    constexpr std::array<VkAllocationCallbacks, vkhost::TrackedObjectTypes> MakeCallbacks()
+    {
+        std::array<VkAllocationCallbacks, vkhost::TrackedObjectTypes> callbacks{};
+        for (uint32_t type = 0; type < vkhost::TrackedObjectTypes; type++)
+        {
+            callbacks[type].pUserData = &objectTypeCounters[type];
+            callbacks[type].pfnAllocation = Allocate;
+            callbacks[type].pfnReallocation = Reallocate;
+            callbacks[type].pfnFree = Free;
+            callbacks[type].pfnInternalAllocation = InternalAllocation;
+            callbacks[type].pfnInternalFree = InternalFree;
+        }
+        return callbacks;
+    }
+    constinit const std::array<VkAllocationCallbacks, vkhost::TrackedObjectTypes> Callbacks = MakeCallbacks();
+
+    const char *ObjectTypeName(uint32_t type)
+    {
+        constexpr const char *Names[vkhost::TrackedObjectTypes] = {
+            "Unknown", "Instance", "PhysicalDevice", "Device", "Queue", "Semaphore", "CommandBuffer",
+            "Fence", "DeviceMemory", "Buffer", "Image", "Event", "QueryPool", "BufferView", "ImageView",
+            "ShaderModule", "PipelineCache", "PipelineLayout", "RenderPass", "Pipeline",
+            "DescriptorSetLayout", "Sampler", "DescriptorPool", "DescriptorSet", "Framebuffer", "CommandPool"};
+        return Names[type];
+    }
+
+    const char *ScopeName(uint32_t scope)
+    {
+        constexpr const char *Names[vkhost::AllocationScopes] = {"Command", "Object", "Cache", "Device", "Instance"};
+        return Names[scope];
+    }
+}
+
+namespace vkhost
+{
+    /**
+     * Callbacks accounting host allocations of the driver to the given object type
+     *
+     * @param objectType Type of the object created, destroyed or allocated by the call, types past
+     * VK_OBJECT_TYPE_COMMAND_POOL are accounted as VK_OBJECT_TYPE_UNKNOWN
+     *
+     * @note An object created with these callbacks has to be destroyed with them too (any object type works)
+     */
+    const VkAllocationCallbacks *allocationCallbacks(VkObjectType objectType)
+    {
+        const uint32_t type = static_cast<uint32_t>(objectType);
+        return &Callbacks[type < TrackedObjectTypes ? type : 0u];
+    }
+
+    /**
+     * Serve small allocations from per thread caches of fixed size blocks, can be toggled at any time
+     */
+    void setPoolingEnabled(bool enabled)
+    {
+        poolingEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    HostMemoryStatistics getStatistics()
+    {
+        HostMemoryStatistics statistics;
+        statistics.Total = totalCounters.Load();
+        for (uint32_t scope = 0; scope < AllocationScopes; scope++)
+        {
+            statistics.Scopes[scope] = scopeCounters[scope].Load();
+        }
+        for (uint32_t type = 0; type < TrackedObjectTypes; type++)
+        {
+            statistics.ObjectTypes[type] = objectTypeCounters[type].Load();
+        }
+        statistics.InternalBytes = internalBytes.load(std::memory_order_relaxed);
+        statistics.PooledAllocations = pooledAllocations.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+    void logStatistics()
+    {
+        const HostMemoryStatistics statistics = getStatistics();
+        Log::Info("Driver host memory: {0} KiB in {1} allocations (peak {2} KiB, {3} total, {4} pooled), "
+                  "{5} KiB internal",
+                  statistics.Total.Bytes / 1024,
+                  statistics.Total.Allocations,
+                  statistics.Total.PeakBytes / 1024,
+                  statistics.Total.TotalAllocations,
+                  statistics.PooledAllocations,
+                  statistics.InternalBytes / 1024);
+        for (uint32_t scope = 0; scope < AllocationScopes; scope++)
+        {
+            const HostMemoryCounters &counters = statistics.Scopes[scope];
+            if (counters.TotalAllocations > 0)
+            {
+                Log::Info("    scope {0}: {1} KiB in {2} allocations (peak {3} KiB)",
+                          ScopeName(scope),
+                          counters.Bytes / 1024,
+                          counters.Allocations,
+                          counters.PeakBytes / 1024);
+            }
+        }
+        for (uint32_t type = 0; type < TrackedObjectTypes; type++)
+        {
+            const HostMemoryCounters &counters = statistics.ObjectTypes[type];
+            if (counters.TotalAllocations > 0)
+            {
+                Log::Info("    {0}: {1} KiB in {2} allocations (peak {3} KiB)",
+                          ObjectTypeName(type),
+                          counters.Bytes / 1024,
+                          counters.Allocations,
+                          counters.PeakBytes / 1024);
+            }
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+namespace vkhost
+{
+    // core object types up to VK_OBJECT_TYPE_COMMAND_POOL get their own counters, everything else counts as UNKNOWN
+    constexpr uint32_t TrackedObjectTypes = VK_OBJECT_TYPE_COMMAND_POOL + 1;
+    constexpr uint32_t AllocationScopes = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+    /** @brief Host memory handed to the driver, bytes and allocation counts are live values */
+    struct HostMemoryCounters
+    {
+        int64_t Bytes = 0;
+        int64_t PeakBytes = 0;
+        int64_t Allocations = 0;
+        uint64_t TotalAllocations = 0;
+    };
+
+    struct HostMemoryStatistics
+    {
+        HostMemoryCounters Total;
+        // indexed by VkSystemAllocationScope
+        std::array<HostMemoryCounters, AllocationScopes> Scopes;
+        // indexed by VkObjectType of the call the callbacks were passed to
+        std::array<HostMemoryCounters, TrackedObjectTypes> ObjectTypes;
+        // memory the driver allocated itself and only reported, e.g. executable code
+        int64_t InternalBytes = 0;
+        // allocations served by the thread caching pool instead of the system allocator
+        uint64_t PooledAllocations = 0;
+    };
+
+    const VkAllocationCallbacks *allocationCallbacks(VkObjectType objectType);
+
+    void setPoolingEnabled(bool enabled);
+    HostMemoryStatistics getStatistics();
+    void logStatistics();
+}
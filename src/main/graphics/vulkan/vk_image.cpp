@@ -0,0 +1,39 @@
+#include "vk_image.h"
+
+#include "vk_host_memory.h"
+
+/**
+ * Subresource range covering every mip level and layer of the image
+ */
+VkImageSubresourceRange Image::subresourceRange() const
+{
+    VkImageSubresourceRange range{};
+    range.aspectMask = aspectMask;
+    range.baseMipLevel = 0;
+    range.levelCount = mipLevels;
+    range.baseArrayLayer = 0;
+    range.layerCount = arrayLayers;
+    return range;
+}
+
+/**
+ * Release all Vulkan resources held by this image
+ */
+void Image::destroy()
+{
+    if (view)
+    {
+        vkDestroyImageView(device, view, vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW));
+        view = VK_NULL_HANDLE;
+    }
+    if (image)
+    {
+        vkDestroyImage(device, image, vkhost::allocationCallbacks(VK_OBJECT_TYPE_IMAGE));
+        image = VK_NULL_HANDLE;
+    }
+    if (memory)
+    {
+        vkFreeMemory(device, memory, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY));
+        memory = VK_NULL_HANDLE;
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+/**
+ * @brief Encapsulates access to a Vulkan image backed up by device memory, with a default view over all levels
+ * @note To be filled by an external source like the VulkanDevice
+ */
+struct Image
+{
+    VkDevice device;
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent{};
+    uint32_t mipLevels = 1;
+    uint32_t arrayLayers = 1;
+    /** @brief Aspects covered by the image (depth and stencil for combined formats), used for barriers */
+    VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    /** @brief Usage flags to be filled by external source at image creation (to query at some later point) */
+    VkImageUsageFlags usageFlags;
+    VkImageSubresourceRange subresourceRange() const;
+    void destroy();
+};
@@ -614,6 +614,21 @@ namespace vkinit
         return computePipelineCreateInfo;
     }
 
+    inline VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfo(
+        VkShaderStageFlagBits stage,
+        VkShaderModule module,
+        const VkSpecializationInfo *pSpecializationInfo = nullptr)
+    {
+        VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfo{};
+        pipelineShaderStageCreateInfo.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineShaderStageCreateInfo.stage = stage;
+        pipelineShaderStageCreateInfo.module = module;
+        pipelineShaderStageCreateInfo.pName = "main";
+        pipelineShaderStageCreateInfo.pSpecializationInfo = pSpecializationInfo;
+        return pipelineShaderStageCreateInfo;
+    }
+
     inline VkPushConstantRange pushConstantRange(
         VkShaderStageFlags stageFlags,
         uint32_t size,
@@ -0,0 +1,115 @@
+#include "vk_tools.h"
+
+#include <fstream>
+
+#include "core/log.h"
+#include "vk_debugger.h"
+#include "vk_host_memory.h"
+#include "vk_initializers.h"
+
+namespace vktools
+{
+    /**
+     * Load a SPIR-V binary from disk and create a shader module from it
+     *
+     * @param fileName Path to the .spv file
+     * @param device Logical device to create the module on
+     *
+     * @return Shader module handle, VK_NULL_HANDLE if the file could not be read
+     */
+    VkShaderModule loadShader(const std::string &fileName, VkDevice device)
+    {
+        std::ifstream file(fileName, std::ios::binary | std::ios::in | std::ios::ate);
+        if (!file.is_open())
+        {
+            Log::Error("Could not open shader file \"{0}\"", fileName);
+            return VK_NULL_HANDLE;
+        }
+
+        const size_t size = static_cast<size_t>(file.tellg());
+        assert(size > 0 && size % sizeof(uint32_t) == 0);
+
+        // SPIR-V words have to be 4 byte aligned
+        std::vector<uint32_t> code(size / sizeof(uint32_t));
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char *>(code.data()), static_cast<std::streamsize>(size));
+
+        VkShaderModuleCreateInfo moduleCreateInfo{};
+        moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleCreateInfo.codeSize = size;
+        moduleCreateInfo.pCode = code.data();
+
+        VkShaderModule shaderModule;
+        Debug::CheckVulkan(vkCreateShaderModule(device,
+                                                &moduleCreateInfo,
+                                                vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE),
+                                                &shaderModule));
+        return shaderModule;
+    }
+
+    /**
+     * Create a compute pipeline from a single shader module
+     *
+     * @param pSpecializationInfo (Optional) Specialization constants for the compute stage
+     * @param pipelineCache (Optional) Cache to look the pipeline up in and add it to
+     */
+    VkPipeline createComputePipeline(VkDevice device,
+                                     VkPipelineLayout layout,
+                                     VkShaderModule module,
+                                     const VkSpecializationInfo *pSpecializationInfo,
+                                     VkPipelineCache pipelineCache)
+    {
+        VkComputePipelineCreateInfo pipelineCreateInfo =
+            vkinit::computePipelineCreateInfo(layout);
+        pipelineCreateInfo.stage = vkinit::pipelineShaderStageCreateInfo(
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            module,
+            pSpecializationInfo);
+
+        VkPipeline pipeline;
+        Debug::CheckVulkan(vkCreateComputePipelines(device,
+                                                    pipelineCache,
+                                                    1,
+                                                    &pipelineCreateInfo,
+                                                    vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE),
+                                                    &pipeline));
+        return pipeline;
+    }
+
+    // Record a single image memory barrier (layout transition) without queue family ownership transfer
+    void insertImageMemoryBarrier(VkCommandBuffer commandBuffer,
+                                  VkImage image,
+                                  VkAccessFlags srcAccessMask,
+                                  VkAccessFlags dstAccessMask,
+                                  VkImageLayout oldLayout,
+                                  VkImageLayout newLayout,
+                                  VkPipelineStageFlags srcStageMask,
+                                  VkPipelineStageFlags dstStageMask,
+                                  VkImageSubresourceRange subresourceRange)
+    {
+        VkImageMemoryBarrier imageMemoryBarrier = vkinit::imageMemoryBarrier();
+        imageMemoryBarrier.srcAccessMask = srcAccessMask;
+        imageMemoryBarrier.dstAccessMask = dstAccessMask;
+        imageMemoryBarrier.oldLayout = oldLayout;
+        imageMemoryBarrier.newLayout = newLayout;
+        imageMemoryBarrier.image = image;
+        imageMemoryBarrier.subresourceRange = subresourceRange;
+
+        vkCmdPipelineBarrier(commandBuffer,
+                             srcStageMask,
+                             dstStageMask,
+                             0,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr,
+                             1,
+                             &imageMemoryBarrier);
+    }
+
+    // Number of workgroups needed to cover value invocations
+    uint32_t divideRoundUp(uint32_t value, uint32_t divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+}
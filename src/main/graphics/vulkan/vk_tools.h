@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vulkan/vulkan.hpp>
+
+namespace vktools
+{
+    VkShaderModule loadShader(const std::string &fileName, VkDevice device);
+    VkPipeline createComputePipeline(VkDevice device,
+                                     VkPipelineLayout layout,
+                                     VkShaderModule module,
+                                     const VkSpecializationInfo *pSpecializationInfo = nullptr,
+                                     VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+    void insertImageMemoryBarrier(VkCommandBuffer commandBuffer,
+                                  VkImage image,
+                                  VkAccessFlags srcAccessMask,
+                                  VkAccessFlags dstAccessMask,
+                                  VkImageLayout oldLayout,
+                                  VkImageLayout newLayout,
+                                  VkPipelineStageFlags srcStageMask,
+                                  VkPipelineStageFlags dstStageMask,
+                                  VkImageSubresourceRange subresourceRange);
+    uint32_t divideRoundUp(uint32_t value, uint32_t divisor);
+}
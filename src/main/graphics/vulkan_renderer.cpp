@@ -1,8 +1,16 @@
 #include "vulkan_renderer.h"
 
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
 #include "core/log.h"
+#include "core/mapped_file.h"
+#include "core/profiler.h"
 #include "vulkan/vk_initializers.h"
 #include "vulkan/vk_debugger.h"
+#include "vulkan/vk_device_selection.h"
+#include "vulkan/vk_host_memory.h"
 
 VulkanRenderer::VulkanRenderer(const RendererProperties &properties)
     : settings(properties)
@@ -13,52 +21,91 @@ VulkanRenderer::VulkanRenderer(const RendererProperties &properties)
 
     extraFeatures.dynamicRendering = VK_TRUE;
     extraFeatures.synchronization2 = VK_TRUE;
+    extraFeatures.pNext = &features12;
+    features12.timelineSemaphore = VK_TRUE;
 }
 
 bool VulkanRenderer::Initialize()
 {
-    const VkResult result = InitVulkan();
-    if (result != VK_SUCCESS)
+    VANADIUM_ZONE("VulkanRenderer::Initialize");
+    StartupGraph startup;
+    AddStartupPhases(startup);
+    const bool succeeded = startup.Run();
+    startup.LogTimings();
+    if (succeeded)
     {
-        // Log::Error(std::format("Failed initializing Vulkan! [{0}]",
-        //                        string_VkResult(result)));
-        return false;
+        Log::System("Vulkan Init Done");
     }
-    Log::System("Vulkan Init Done");
-    return true;
+    return succeeded;
 }
 
-// Initialize vulkan backend. Create Instance, grabs physical device, creates logical device (VulkanDevice),
-// get graphics queue, verify supported depth stencil format
-VkResult VulkanRenderer::InitVulkan()
+/**
+ * Add the Vulkan initialization phases to a startup graph. Instance extension and layer enumeration and reading the
+ * pipeline cache do not depend on each other, instance, physical device and logical device creation are serial.
+ *
+ * @param startup Graph the phases are added to, run by the caller
+ *
+ * @return Last phase, the renderer is usable once it succeeded
+ */
+StartupGraph::PhaseId VulkanRenderer::AddStartupPhases(StartupGraph &startup)
 {
-    VkResult result = CreateInstance();
-    if (result != VK_SUCCESS)
-    {
-        return result;
-    }
-
-    if (settings.Debug)
-    {
-        result = Debug::SetupDebugging(instance);
-
-        if (result != VK_SUCCESS)
-            return result;
-    }
-
-    // grab physical device & info
-    result = PickPhysicalDevice(settings.PreferIntegratedGraphics);
-
-    if (result != VK_SUCCESS)
-    {
-        return result;
-    }
-
-    Log::System(std::format("Physical Device: {0}",
-                            deviceProperties.deviceName));
+    const StartupGraph::PhaseId support = startup.Add("Instance support",
+                                                      [this]
+                                                      {
+                                                          QueryInstanceSupport();
+                                                          return true;
+                                                      });
+    const StartupGraph::PhaseId cacheRead = startup.Add("Pipeline cache read",
+                                                        [this]
+                                                        {
+                                                            ReadPipelineCache();
+                                                            return true;
+                                                        });
+    const StartupGraph::PhaseId instancePhase = startup.Add(
+        "Instance",
+        [this]
+        {
+            VkResult result = CreateInstance();
+            if (result == VK_SUCCESS && settings.Debug)
+            {
+                result = Debug::SetupDebugging(instance);
+            }
+            return result == VK_SUCCESS;
+        },
+        {support});
+    const StartupGraph::PhaseId physicalDevicePhase = startup.Add(
+        "Physical device",
+        [this]
+        {
+            if (PickPhysicalDevice(settings.PreferIntegratedGraphics) != VK_SUCCESS)
+            {
+                return false;
+            }
+            Log::System("Physical Device: {0}", deviceProperties.deviceName);
+            return true;
+        },
+        {instancePhase});
+    const StartupGraph::PhaseId devicePhase = startup.Add("Logical device",
+                                                          [this] { return CreateLogicalDevice() == VK_SUCCESS; },
+                                                          {physicalDevicePhase});
+    // a missing or stale cache only costs pipeline compile time, it never fails startup
+    return startup.Add("Pipeline cache",
+                       [this]
+                       {
+                           CreatePipelineCache();
+                           return true;
+                       },
+                       {devicePhase, cacheRead});
+}
 
+// Creates logical device (VulkanDevice), get graphics queue, verify supported depth stencil format
+VkResult VulkanRenderer::CreateLogicalDevice()
+{
     vulkanDevice = new VulkanDevice(physicalDevice);
-    result = vulkanDevice->createLogicalDevice(
+    // optional, GpuStatistics disables itself without them
+    enabledFeatures.pipelineStatisticsQuery = vulkanDevice->features.pipelineStatisticsQuery;
+    enabledFeatures.occlusionQueryPrecise = vulkanDevice->features.occlusionQueryPrecise;
+    const VkResult result = vulkanDevice->createLogicalDevice(
         enabledFeatures,
         enabledDeviceExtensions,
         &extraFeatures);
@@ -75,6 +122,10 @@ VkResult VulkanRenderer::InitVulkan()
                      vulkanDevice->queueFamilyIndices.graphics,
                      0,
                      &queue);
+    vkGetDeviceQueue(device,
+                     vulkanDevice->queueFamilyIndices.compute,
+                     0,
+                     &computeQueue);
 
     // verify supported depth stencil format for attachment
     const VkBool32 validDepthStencilFormat = GetSupportedDepthStencilFormat(
@@ -88,13 +139,9 @@ VkResult VulkanRenderer::InitVulkan()
     return VK_SUCCESS;
 }
 
-// Creates vulkan instance, gathers supportedInstanceExtensions, verifies requested extensions,
-// hook up debug utils/debug messenger and validation if requested
-VkResult VulkanRenderer::CreateInstance()
+// Gathers supportedInstanceExtensions and whether the validation layer is present, needs no instance
+void VulkanRenderer::QueryInstanceSupport()
 {
-    std::vector<const char *> enabledInstanceExtensions = {};
-
-    // gather supported instance extensions
     uint32_t supportedExtensionCount = 0;
     vkEnumerateInstanceExtensionProperties(nullptr,
                                            &supportedExtensionCount,
@@ -116,6 +163,42 @@ VkResult VulkanRenderer::CreateInstance()
         }
     }
 
+    if (settings.Debug)
+    {
+        uint32_t instanceLayerCount;
+        vkEnumerateInstanceLayerProperties(&instanceLayerCount, nullptr);
+        std::vector<VkLayerProperties> instanceLayerProperties(
+            instanceLayerCount);
+        vkEnumerateInstanceLayerProperties(&instanceLayerCount,
+                                           instanceLayerProperties.data());
+
+        for (const VkLayerProperties &layer : instanceLayerProperties)
+        {
+            if (strcmp(layer.layerName, "VK_LAYER_KHRONOS_validation") == 0)
+            {
+                validationLayerPresent = true;
+                break;
+            }
+        }
+    }
+}
+
+// Creates vulkan instance, verifies requested extensions against QueryInstanceSupport(),
+// hook up debug utils/debug messenger and validation if requested
+VkResult VulkanRenderer::CreateInstance()
+{
+    // has to be decided before the first allocation goes through the callbacks
+    vkhost::setPoolingEnabled(settings.PoolDriverAllocations);
+
+    if (settings.Debug)
+    {
+        Debug::ValidationFilterProperties filterProperties = {};
+        filterProperties.BreakOnMessageIds = settings.ValidationBreakIds;
+        Debug::SetValidationFilter(filterProperties);
+    }
+
+    std::vector<const char *> enabledInstanceExtensions = {};
+
     // verify requested instance extensions
     if (requestedInstanceExtensions.size() > 0)
     {
@@ -126,9 +209,7 @@ VkResult VulkanRenderer::CreateInstance()
                                   requestedExtension) ==
                 supportedInstanceExtensions.end())
             {
-                Log::Warning(std::format(
-                    "Requested Instance extension {0} is not supported.",
-                    requestedExtension));
+                Log::Warning("Requested Instance extension {0} is not supported.", requestedExtension);
             }
             enabledInstanceExtensions.push_back(requestedExtension);
         }
@@ -172,23 +253,6 @@ VkResult VulkanRenderer::CreateInstance()
     if (settings.Debug)
     {
         const auto validationLayerName = "VK_LAYER_KHRONOS_validation";
-        uint32_t instanceLayerCount;
-        vkEnumerateInstanceLayerProperties(&instanceLayerCount, nullptr);
-        std::vector<VkLayerProperties> instanceLayerProperties(
-            instanceLayerCount);
-        vkEnumerateInstanceLayerProperties(&instanceLayerCount,
-                                           instanceLayerProperties.data());
-
-        // verify validation layer is supported
-        bool validationLayerPresent = false;
-        for (const VkLayerProperties &layer : instanceLayerProperties)
-        {
-            if (strcmp(layer.layerName, validationLayerName) == 0)
-            {
-                validationLayerPresent = true;
-                break;
-            }
-        }
 
         // add instance layer to instance create info
         if (validationLayerPresent)
@@ -206,7 +270,7 @@ VkResult VulkanRenderer::CreateInstance()
 
     const VkResult result = vkCreateInstance(
         &instanceCreateInfo,
-        nullptr,
+        vkhost::allocationCallbacks(VK_OBJECT_TYPE_INSTANCE),
         &instance);
 
     // enable debug labels if available
@@ -221,51 +285,19 @@ VkResult VulkanRenderer::CreateInstance()
     return result;
 }
 
-// Select vulkan capable physical device, prefer discrete unless specified otherwise
+// Select the highest scoring physical device, see vktools::selectPhysicalDevice
 VkResult VulkanRenderer::PickPhysicalDevice(const bool preferIntegrated)
 {
-    uint32_t gpuCount = 0;
-    vkEnumeratePhysicalDevices(instance, &gpuCount, nullptr);
-    if (gpuCount == 0)
-    {
-        Log::Error("No Physical Device with Vulkan support found!");
-        return VK_ERROR_DEVICE_LOST;
-    }
-
-    std::vector<VkPhysicalDevice> physicalDevices(gpuCount);
-    if (const VkResult result = vkEnumeratePhysicalDevices(instance,
-                                                           &gpuCount,
-                                                           physicalDevices.data());
-        result != VK_SUCCESS)
+    DeviceSelectionProperties selection = {};
+    selection.PreferIntegrated = preferIntegrated;
+    selection.Override = settings.DeviceOverride;
+    physicalDevice = vktools::selectPhysicalDevice(instance, selection);
+    if (physicalDevice == VK_NULL_HANDLE)
     {
-        // Log::Error(std::format("Coult not enumerate Physical Devices: {0}",
-        //                        string_VkResult(result)));
-        return result;
+        Log::Error("No Physical Device with the required Vulkan features found!");
+        return VK_ERROR_INITIALIZATION_FAILED;
     }
 
-    // select discrete or integrated gpu based on setting (PreferIntegratedGpu)
-    uint32_t selectedDevice = 0;
-    if (gpuCount > 1)
-    {
-        for (int i = 0; i < physicalDevices.size(); i++)
-        {
-            VkPhysicalDeviceProperties props;
-            vkGetPhysicalDeviceProperties(physicalDevices[i], &props);
-            if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU && preferIntegrated)
-            {
-                selectedDevice = i;
-                break;
-            }
-            if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
-                !preferIntegrated)
-            {
-                selectedDevice = i;
-            }
-        }
-    }
-
-    physicalDevice = physicalDevices[selectedDevice];
-
     vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
 
     return VK_SUCCESS;
@@ -303,10 +335,110 @@ VkBool32 VulkanRenderer::GetSupportedDepthStencilFormat(
     return false;
 }
 
-void VulkanRenderer::OnUpdate() {}
+// Read the cache written by the previous run, a missing file leaves the cache empty
+void VulkanRenderer::ReadPipelineCache()
+{
+    if (settings.PipelineCachePath.empty())
+    {
+        return;
+    }
+
+    // not finding the cache is expected on first launch, MappedFile would log it as an error
+    std::error_code error;
+    if (!std::filesystem::exists(settings.PipelineCachePath, error))
+    {
+        return;
+    }
+
+    MappedFile file;
+    if (file.Open(settings.PipelineCachePath, MappedFileAccess::Sequential) && file.Size() > 0)
+    {
+        pipelineCacheData.assign(file.Data(), file.Data() + file.Size());
+    }
+}
+
+// Create the pipeline cache, seeded with the data read at startup if it was written by this device and driver, and
+// hand it to the device so every pipeline created through vktools goes through it
+VkResult VulkanRenderer::CreatePipelineCache()
+{
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    VkPipelineCacheHeaderVersionOne header{};
+    if (pipelineCacheData.size() >= sizeof(header))
+    {
+        std::memcpy(&header, pipelineCacheData.data(), sizeof(header));
+        // drivers reject foreign data themselves, checking here keeps a stale cache from being logged as loaded
+        if (header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+            header.vendorID == deviceProperties.vendorID &&
+            header.deviceID == deviceProperties.deviceID &&
+            std::memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0)
+        {
+            createInfo.initialDataSize = pipelineCacheData.size();
+            createInfo.pInitialData = pipelineCacheData.data();
+            Log::System("Loaded {0} bytes of pipeline cache", pipelineCacheData.size());
+        }
+        else
+        {
+            Log::Info("Pipeline cache {0} is from another device or driver, starting empty",
+                      settings.PipelineCachePath);
+        }
+    }
+
+    const VkResult result = vkCreatePipelineCache(device,
+                                                  &createInfo,
+                                                  vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_CACHE),
+                                                  &pipelineCache);
+    pipelineCacheData.clear();
+    pipelineCacheData.shrink_to_fit();
+    if (result == VK_SUCCESS)
+    {
+        vulkanDevice->pipelineCache = pipelineCache;
+    }
+    return result;
+}
+
+// Write the pipeline cache back for the next launch
+void VulkanRenderer::WritePipelineCache()
+{
+    if (pipelineCache == VK_NULL_HANDLE || settings.PipelineCachePath.empty())
+    {
+        return;
+    }
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+    {
+        return;
+    }
+    std::vector<uint8_t> data(dataSize);
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+    {
+        return;
+    }
+
+    FILE *file = std::fopen(settings.PipelineCachePath.c_str(), "wb");
+    if (!file || std::fwrite(data.data(), 1, dataSize, file) != dataSize)
+    {
+        Log::Warning("Could not write pipeline cache {0}", settings.PipelineCachePath);
+    }
+    if (file)
+    {
+        std::fclose(file);
+    }
+}
+
+void VulkanRenderer::OnUpdate(const FrameSnapshot &frame) {}
 
 VulkanRenderer::~VulkanRenderer()
 {
+    if (pipelineCache != VK_NULL_HANDLE)
+    {
+        WritePipelineCache();
+        vulkanDevice->pipelineCache = VK_NULL_HANDLE;
+        vkDestroyPipelineCache(device, pipelineCache, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_CACHE));
+    }
+
     delete vulkanDevice;
 
     if (settings.Debug)
@@ -314,5 +446,11 @@ VulkanRenderer::~VulkanRenderer()
         Debug::FreeDebugCallback(instance);
     }
 
-    vkDestroyInstance(instance, nullptr);
+    vkDestroyInstance(instance, vkhost::allocationCallbacks(VK_OBJECT_TYPE_INSTANCE));
+
+    // anything still live at this point was leaked by the driver or by us
+    if (settings.Debug)
+    {
+        vkhost::logStatistics();
+    }
 }
\ No newline at end of file
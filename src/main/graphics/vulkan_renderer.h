@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/startup_graph.h"
 #include "graphics/renderer.h"
 #include "vulkan/vulkan.hpp"
 #include "vulkan/vk_device.h"
@@ -9,17 +14,23 @@ class VulkanRenderer : public IRenderer
 public:
     VulkanRenderer(const RendererProperties &properties);
     bool Initialize() override;
-    void OnUpdate() override;
+    StartupGraph::PhaseId AddStartupPhases(StartupGraph &startup);
+    void OnUpdate(const FrameSnapshot &frame) override;
     ~VulkanRenderer() override;
 
 private:
     RendererProperties settings;
-    VkResult InitVulkan();
+    void QueryInstanceSupport();
     VkResult CreateInstance();
     VkResult PickPhysicalDevice(const bool preferIntegrated = false);
+    VkResult CreateLogicalDevice();
+    void ReadPipelineCache();
+    VkResult CreatePipelineCache();
+    void WritePipelineCache();
     VkBool32 GetSupportedDepthStencilFormat(VkPhysicalDevice physicalDevice,
                                             VkFormat *depthStencilFormat);
     std::vector<std::string> supportedInstanceExtensions;
+    bool validationLayerPresent = false;
     std::vector<const char *> requestedInstanceExtensions;
     VkInstance instance{VK_NULL_HANDLE};
     // selected physical device
@@ -30,9 +41,16 @@ private:
     std::vector<const char *> enabledDeviceExtensions;
     VkPhysicalDeviceVulkan13Features extraFeatures{
         VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
-    VulkanDevice *vulkanDevice;
+    VkPhysicalDeviceVulkan12Features features12{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    VulkanDevice *vulkanDevice{nullptr};
     // Handle to the device graphics queue that command buffers are submitted to
     VkQueue queue{VK_NULL_HANDLE};
+    // Handle to the compute queue, same as queue if the device has no separate compute family
+    VkQueue computeQueue{VK_NULL_HANDLE};
     // Depth buffer format (selected during Vulkan initialization)
     VkFormat depthFormat;
+    // contents of settings.PipelineCachePath, read while the instance and device are created
+    std::vector<uint8_t> pipelineCacheData;
+    VkPipelineCache pipelineCache{VK_NULL_HANDLE};
 };
\ No newline at end of file
@@ -3,18 +3,32 @@
 #include <iostream>
 using std::cout;
 using std::endl;
+#include <chrono>
 #include <fstream>
+#include <memory>
 #include <string>
 
 #define SDL_MAIN_HANDLED true
 #include <SDL.h>
 
+#include "core/frame_loop.h"
 #include "core/log.h"
+#include "core/profiler.h"
+#include "core/startup_graph.h"
 #include "platform/sdl_window.h"
 #include "graphics/vulkan_renderer.h"
 
 int main(int argc, char *argv[])
 {
+    const auto launchStart = std::chrono::steady_clock::now();
+    VANADIUM_PROFILE_THREAD("Main");
+
+    LogProperties logProperties = {};
+    logProperties.FilePath = "vanadium.log";
+    Log::Initialize(logProperties);
+#ifdef VANADIUM_PROFILING
+    Profiler::BeginCapture();
+#endif
 
     RendererProperties rProperties = {};
     rProperties.Title = "Vanadium Test Renderer";
@@ -22,20 +36,45 @@ int main(int argc, char *argv[])
     rProperties.PreferIntegratedGraphics = false;
     VulkanRenderer renderer(rProperties);
 
-    if (!renderer.Initialize())
-    {
-        Log::Error("Failed initializing renderer!");
-        return EXIT_FAILURE;
-    }
-
     WindowProperties wProperties = {};
     wProperties.Title = "Vanadium Test Window";
-    SDLWindow window(wProperties);
+    std::unique_ptr<SDLWindow> window;
 
-    while (!window.Close)
+    // SDL init and window creation overlap with Vulkan init, SDL wants its window on the main thread
+    StartupGraph startup;
+    startup.Add("Window",
+                [&]
+                {
+                    window = std::make_unique<SDLWindow>(wProperties);
+                    return window->GetNativeWindow() != nullptr;
+                },
+                {},
+                StartupThread::Caller);
+    renderer.AddStartupPhases(startup);
+
+    const bool started = startup.Run();
+    startup.LogTimings();
+    if (!started)
     {
-        window.OnUpdate();
+        // phases skipped because of a failed dependency are not the cause
+        for (const StartupPhaseTiming &timing : startup.GetTimings())
+        {
+            if (!timing.Succeeded && !timing.Skipped)
+            {
+                Log::Error("Failed initializing {0}!", timing.Name);
+            }
+        }
+        return EXIT_FAILURE;
     }
 
+    FrameLoopProperties loopProperties = {};
+    loopProperties.LaunchTime = launchStart;
+    FrameLoop loop(loopProperties);
+    loop.Run(*window, renderer);
+
+#ifdef VANADIUM_PROFILING
+    Profiler::EndCapture("vanadium_trace.json");
+#endif
+
     return EXIT_SUCCESS;
 }
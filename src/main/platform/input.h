@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/spsc_queue.h"
+
+enum class InputEventType : uint8_t
+{
+    KeyDown,
+    KeyUp,
+    MouseMove,
+    MouseButtonDown,
+    MouseButtonUp,
+    MouseWheel,
+    Resize,
+};
+
+struct InputEvent
+{
+    // steady_clock nanoseconds when the event was taken from the OS
+    int64_t TimestampNs = 0;
+    InputEventType Type = InputEventType::KeyDown;
+    // key code or mouse button
+    int32_t Code = 0;
+    // cursor position, wheel delta or new window size
+    float X = 0.0f;
+    float Y = 0.0f;
+};
+
+// filled by the thread pumping OS events, drained by the simulation thread
+using InputQueue = SpscQueue<InputEvent, 1024>;
@@ -1,5 +1,7 @@
 #include "sdl_window.h"
 
+#include <chrono>
+
 #include "core/log.h"
 
 SDLWindow::SDLWindow(const WindowProperties &properties) : settings(properties)
@@ -40,4 +42,85 @@ void SDLWindow::OnUpdate()
             Close = true;
         }
     }
-}
\ No newline at end of file
+}
+
+/**
+ * Wait for OS events and forward them as timestamped input, without spinning while nothing happens
+ *
+ * @param timeoutMs Longest time to block when no event arrives
+ * @param input Queue the simulation thread drains, events that do not fit are dropped and counted
+ *
+ * @return False once the window was asked to close
+ */
+bool SDLWindow::PumpEvents(uint32_t timeoutMs, InputQueue &input)
+{
+    SDL_Event e;
+    if (!SDL_WaitEventTimeout(&e, static_cast<int>(timeoutMs)))
+    {
+        return !Close;
+    }
+
+    do
+    {
+        if (e.type == SDL_QUIT)
+        {
+            Log::System("Window Quit");
+            Close = true;
+        }
+        Translate(e, input);
+    } while (SDL_PollEvent(&e));
+
+    return !Close;
+}
+
+void SDLWindow::Translate(const SDL_Event &event, InputQueue &input)
+{
+    InputEvent translated;
+    translated.TimestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now().time_since_epoch())
+                                 .count();
+    switch (event.type)
+    {
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+        translated.Type = event.type == SDL_KEYDOWN ? InputEventType::KeyDown : InputEventType::KeyUp;
+        translated.Code = event.key.keysym.sym;
+        break;
+    case SDL_MOUSEMOTION:
+        translated.Type = InputEventType::MouseMove;
+        translated.X = static_cast<float>(event.motion.x);
+        translated.Y = static_cast<float>(event.motion.y);
+        break;
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+        translated.Type =
+            event.type == SDL_MOUSEBUTTONDOWN ? InputEventType::MouseButtonDown : InputEventType::MouseButtonUp;
+        translated.Code = event.button.button;
+        translated.X = static_cast<float>(event.button.x);
+        translated.Y = static_cast<float>(event.button.y);
+        break;
+    case SDL_MOUSEWHEEL:
+        translated.Type = InputEventType::MouseWheel;
+        translated.X = event.wheel.preciseX;
+        translated.Y = event.wheel.preciseY;
+        break;
+    case SDL_WINDOWEVENT:
+        if (event.window.event != SDL_WINDOWEVENT_SIZE_CHANGED)
+        {
+            return;
+        }
+        translated.Type = InputEventType::Resize;
+        translated.X = static_cast<float>(event.window.data1);
+        translated.Y = static_cast<float>(event.window.data2);
+        settings.Width = static_cast<uint32_t>(event.window.data1);
+        settings.Height = static_cast<uint32_t>(event.window.data2);
+        break;
+    default:
+        return;
+    }
+
+    if (!input.TryPush(translated) && droppedInput++ == 0)
+    {
+        Log::Warning("Input queue full, dropping input events");
+    }
+}
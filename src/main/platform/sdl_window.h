@@ -11,6 +11,7 @@ public:
     ~SDLWindow() override;
 
     void OnUpdate() override;
+    bool PumpEvents(uint32_t timeoutMs, InputQueue &input) override;
 
     [[nodiscard]] uint32_t GetWidth() const override
     {
@@ -30,6 +31,10 @@ public:
     bool Close = false;
 
 private:
+    void Translate(const SDL_Event &event, InputQueue &input);
+
     WindowProperties settings;
     SDL_Window *native;
+    // events lost to a full input queue
+    uint64_t droppedInput = 0;
 };
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include <cstdint> // cross platform integer types
 #include <string>
 
+#include "input.h"
+
 struct WindowProperties
 {
     std::string Title = "Vanadium";
@@ -16,6 +18,8 @@ class IWindow
 {
 public:
     virtual void OnUpdate() = 0;
+    // blocks up to timeoutMs for OS events, returns false once the window was asked to close
+    virtual bool PumpEvents(uint32_t timeoutMs, InputQueue &input) = 0;
     virtual ~IWindow() = default;
     [[nodiscard]] virtual uint32_t GetWidth() const = 0;
     [[nodiscard]] virtual uint32_t GetHeight() const = 0;
@@ -0,0 +1,310 @@
+#include "transform_hierarchy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+#include "core/profiler.h"
+#include "core/job_system.h"
+
+namespace
+{
+    constexpr uint32_t NoParent = UINT32_MAX;
+    // nodes handed to a worker at a time, large enough that the matrix math dominates scheduling
+    constexpr uint32_t UpdateGrainSize = 4096;
+
+    glm::mat4 ComposeTRS(const glm::vec3 &position,
+                         const glm::quat &rotation,
+                         const glm::vec3 &scale)
+    {
+        glm::mat4 matrix = glm::mat4_cast(rotation);
+        matrix[0] *= scale.x;
+        matrix[1] *= scale.y;
+        matrix[2] *= scale.z;
+        matrix[3] = glm::vec4(position, 1.0f);
+        return matrix;
+    }
+}
+
+/**
+ * Add a node to the hierarchy
+ *
+ * @param parent (Optional) Parent node, InvalidTransform creates a root
+ *
+ * @return Stable handle of the new node
+ *
+ * @note The node is appended unsorted, the depth order is restored on the next Update
+ */
+TransformHandle TransformHierarchy::Create(TransformHandle parent)
+{
+    TransformHandle handle;
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<TransformHandle>(sparse.size());
+        sparse.push_back(NoParent);
+    }
+
+    uint32_t parentIndex = NoParent;
+    uint32_t depth = 0;
+    if (parent != InvalidTransform)
+    {
+        parentIndex = sparse[parent];
+        assert(parentIndex != NoParent);
+        depth = depths[parentIndex] + 1;
+    }
+
+    // parents are always created first, so appending keeps every parent in front of its children
+    sparse[handle] = static_cast<uint32_t>(handles.size());
+    handles.push_back(handle);
+    positions.emplace_back(0.0f);
+    rotations.emplace_back(1.0f, 0.0f, 0.0f, 0.0f);
+    scales.emplace_back(1.0f);
+    localMatrices.emplace_back(1.0f);
+    worldMatrices.emplace_back(1.0f);
+    parents.push_back(parentIndex);
+    depths.push_back(depth);
+    flags.push_back(LocalDirty);
+
+    structureDirty = true;
+    return handle;
+}
+
+/**
+ * Remove a node together with its whole subtree
+ *
+ * @note Removal is deferred until the next Update, the handles of the subtree are recycled afterwards
+ */
+void TransformHierarchy::Destroy(TransformHandle handle)
+{
+    const uint32_t index = sparse[handle];
+    assert(index != NoParent);
+    flags[index] |= PendingDestroy;
+    structureDirty = true;
+}
+
+void TransformHierarchy::Reserve(uint32_t count)
+{
+    positions.reserve(count);
+    rotations.reserve(count);
+    scales.reserve(count);
+    localMatrices.reserve(count);
+    worldMatrices.reserve(count);
+    parents.reserve(count);
+    depths.reserve(count);
+    flags.reserve(count);
+    handles.reserve(count);
+    sparse.reserve(count);
+}
+
+void TransformHierarchy::SetLocal(TransformHandle handle,
+                                  const glm::vec3 &position,
+                                  const glm::quat &rotation,
+                                  const glm::vec3 &scale)
+{
+    const uint32_t index = sparse[handle];
+    positions[index] = position;
+    rotations[index] = rotation;
+    scales[index] = scale;
+    flags[index] |= LocalDirty;
+}
+
+void TransformHierarchy::SetPosition(TransformHandle handle, const glm::vec3 &position)
+{
+    const uint32_t index = sparse[handle];
+    positions[index] = position;
+    flags[index] |= LocalDirty;
+}
+
+void TransformHierarchy::SetRotation(TransformHandle handle, const glm::quat &rotation)
+{
+    const uint32_t index = sparse[handle];
+    rotations[index] = rotation;
+    flags[index] |= LocalDirty;
+}
+
+void TransformHierarchy::SetScale(TransformHandle handle, const glm::vec3 &scale)
+{
+    const uint32_t index = sparse[handle];
+    scales[index] = scale;
+    flags[index] |= LocalDirty;
+}
+
+const glm::mat4 &TransformHierarchy::GetWorld(TransformHandle handle) const
+{
+    return worldMatrices[sparse[handle]];
+}
+
+const glm::mat4 &TransformHierarchy::GetLocal(TransformHandle handle) const
+{
+    return localMatrices[sparse[handle]];
+}
+
+TransformHandle TransformHierarchy::GetParent(TransformHandle handle) const
+{
+    const uint32_t parent = parents[sparse[handle]];
+    return parent == NoParent ? InvalidTransform : handles[parent];
+}
+
+bool TransformHierarchy::WorldChanged(TransformHandle handle) const
+{
+    return (flags[sparse[handle]] & WorldUpdated) != 0;
+}
+
+uint32_t TransformHierarchy::Update(JobSystem *jobs)
+{
+    VANADIUM_ZONE("TransformHierarchy::Update");
+    if (structureDirty)
+    {
+        Rebuild();
+    }
+
+    uint32_t updated = 0;
+
+    // levels have to run in order, nodes within a level only read their parent's already final state
+    for (uint32_t level = 0; level + 1 < levelOffsets.size(); level++)
+    {
+        const uint32_t begin = levelOffsets[level];
+        const uint32_t count = levelOffsets[level + 1] - begin;
+
+        if (jobs && count > UpdateGrainSize)
+        {
+            std::atomic<uint32_t> levelUpdated{0};
+            jobs->ParallelFor(count, UpdateGrainSize, [&](uint32_t first, uint32_t last)
+                              { levelUpdated.fetch_add(UpdateRange(begin + first, begin + last),
+                                                       std::memory_order_relaxed); });
+            updated += levelUpdated.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            updated += UpdateRange(begin, begin + count);
+        }
+    }
+
+    return updated;
+}
+
+uint32_t TransformHierarchy::UpdateRange(uint32_t begin, uint32_t end)
+{
+    uint32_t updated = 0;
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        const uint8_t nodeFlags = flags[i];
+        const uint32_t parent = parents[i];
+        // a parent which got a new world matrix this frame dirties its whole subtree
+        const bool parentUpdated = parent != NoParent && (flags[parent] & WorldUpdated);
+
+        if (nodeFlags & LocalDirty)
+        {
+            localMatrices[i] = ComposeTRS(positions[i], rotations[i], scales[i]);
+        }
+
+        if ((nodeFlags & LocalDirty) || parentUpdated)
+        {
+            worldMatrices[i] = parent == NoParent
+                                   ? localMatrices[i]
+                                   : worldMatrices[parent] * localMatrices[i];
+            flags[i] = WorldUpdated;
+            updated++;
+        }
+        else
+        {
+            flags[i] = 0;
+        }
+    }
+
+    return updated;
+}
+
+// Drop destroyed subtrees and counting sort the remaining nodes by depth, keeping the relative order within a level
+void TransformHierarchy::Rebuild()
+{
+    const uint32_t count = static_cast<uint32_t>(handles.size());
+
+    // destruction propagates down, parents are always visited before their children
+    uint32_t maxDepth = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (parents[i] != NoParent && (flags[parents[i]] & PendingDestroy))
+        {
+            flags[i] |= PendingDestroy;
+        }
+        if (!(flags[i] & PendingDestroy))
+        {
+            maxDepth = std::max(maxDepth, depths[i]);
+        }
+    }
+
+    levelOffsets.assign(maxDepth + 2, 0);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!(flags[i] & PendingDestroy))
+        {
+            levelOffsets[depths[i] + 1]++;
+        }
+    }
+    for (uint32_t level = 1; level < levelOffsets.size(); level++)
+    {
+        levelOffsets[level] += levelOffsets[level - 1];
+    }
+
+    const uint32_t alive = levelOffsets.back();
+    std::vector<uint32_t> remap(count, NoParent);
+    std::vector<uint32_t> cursor(levelOffsets.begin(), levelOffsets.end() - 1);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (flags[i] & PendingDestroy)
+        {
+            sparse[handles[i]] = NoParent;
+            freeHandles.push_back(handles[i]);
+            continue;
+        }
+        remap[i] = cursor[depths[i]]++;
+    }
+
+    std::vector<glm::vec3> sortedPositions(alive);
+    std::vector<glm::quat> sortedRotations(alive);
+    std::vector<glm::vec3> sortedScales(alive);
+    std::vector<glm::mat4> sortedLocal(alive);
+    std::vector<glm::mat4> sortedWorld(alive);
+    std::vector<uint32_t> sortedParents(alive);
+    std::vector<uint32_t> sortedDepths(alive);
+    std::vector<uint8_t> sortedFlags(alive);
+    std::vector<TransformHandle> sortedHandles(alive);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t target = remap[i];
+        if (target == NoParent)
+        {
+            continue;
+        }
+        sortedPositions[target] = positions[i];
+        sortedRotations[target] = rotations[i];
+        sortedScales[target] = scales[i];
+        sortedLocal[target] = localMatrices[i];
+        sortedWorld[target] = worldMatrices[i];
+        sortedParents[target] = parents[i] == NoParent ? NoParent : remap[parents[i]];
+        sortedDepths[target] = depths[i];
+        sortedFlags[target] = flags[i];
+        sortedHandles[target] = handles[i];
+        sparse[handles[i]] = target;
+    }
+
+    positions = std::move(sortedPositions);
+    rotations = std::move(sortedRotations);
+    scales = std::move(sortedScales);
+    localMatrices = std::move(sortedLocal);
+    worldMatrices = std::move(sortedWorld);
+    parents = std::move(sortedParents);
+    depths = std::move(sortedDepths);
+    flags = std::move(sortedFlags);
+    handles = std::move(sortedHandles);
+
+    structureDirty = false;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+class JobSystem;
+
+using TransformHandle = uint32_t;
+constexpr TransformHandle InvalidTransform = UINT32_MAX;
+
+/**
+ * @brief Scene transform hierarchy stored as depth sorted structure of arrays
+ *
+ * Nodes are kept ordered by depth so every parent precedes its children. Updating world matrices is a linear
+ * sweep per depth level, and all nodes of one level are independent so each level is split across threads.
+ * Handles stay stable while the dense arrays are reordered underneath.
+ */
+class TransformHierarchy
+{
+public:
+    TransformHandle Create(TransformHandle parent = InvalidTransform);
+    void Destroy(TransformHandle handle);
+    void Reserve(uint32_t count);
+
+    void SetLocal(TransformHandle handle,
+                  const glm::vec3 &position,
+                  const glm::quat &rotation,
+                  const glm::vec3 &scale);
+    void SetPosition(TransformHandle handle, const glm::vec3 &position);
+    void SetRotation(TransformHandle handle, const glm::quat &rotation);
+    void SetScale(TransformHandle handle, const glm::vec3 &scale);
+
+    [[nodiscard]] const glm::mat4 &GetWorld(TransformHandle handle) const;
+    [[nodiscard]] const glm::mat4 &GetLocal(TransformHandle handle) const;
+    [[nodiscard]] TransformHandle GetParent(TransformHandle handle) const;
+    /** @brief Whether the world matrix was recomputed by the last Update (e.g. to upload only changed instances) */
+    [[nodiscard]] bool WorldChanged(TransformHandle handle) const;
+
+    /**
+     * Recompute local and world matrices of all dirty nodes and their descendants
+     *
+     * @param jobs (Optional) Job system used to split each depth level, runs on the calling thread if null
+     *
+     * @return Number of world matrices recomputed
+     */
+    uint32_t Update(JobSystem *jobs = nullptr);
+
+    [[nodiscard]] uint32_t Size() const
+    {
+        return static_cast<uint32_t>(handles.size());
+    }
+
+    [[nodiscard]] uint32_t GetDepthCount() const
+    {
+        return levelOffsets.empty() ? 0 : static_cast<uint32_t>(levelOffsets.size()) - 1;
+    }
+
+private:
+    enum Flags : uint8_t
+    {
+        LocalDirty = 1 << 0,
+        WorldUpdated = 1 << 1,
+        PendingDestroy = 1 << 2,
+    };
+
+    void Rebuild();
+    uint32_t UpdateRange(uint32_t begin, uint32_t end);
+
+    // dense arrays, indexed by sorted position
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> localMatrices;
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> depths;
+    std::vector<uint8_t> flags;
+    // dense index -> handle
+    std::vector<TransformHandle> handles;
+
+    // handle -> dense index
+    std::vector<uint32_t> sparse;
+    std::vector<TransformHandle> freeHandles;
+
+    // first dense index of each depth level, with a trailing end offset
+    std::vector<uint32_t> levelOffsets;
+    // set when nodes were added or removed and the arrays need re-sorting by depth
+    bool structureDirty = false;
+};
@@ -0,0 +1,241 @@
+#include "archive_packer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "core/log.h"
+#include "core/mapped_file.h"
+
+namespace
+{
+    struct PendingEntry
+    {
+        const Pack::PackInput *Input = nullptr;
+        std::string Name;
+        bool BakeMesh = false;
+        AssetArchiveEntry Entry;
+    };
+
+    bool HasExtension(const std::string &name, std::string_view extension)
+    {
+        return name.size() >= extension.size() &&
+               std::equal(extension.rbegin(),
+                          extension.rend(),
+                          name.rbegin(),
+                          [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); });
+    }
+
+    void Classify(PendingEntry &pending, const Pack::PackProperties &properties)
+    {
+        const std::string &name = pending.Input->Name;
+        pending.Name = name;
+        if (HasExtension(name, ".glb"))
+        {
+            pending.Entry.Type = AssetType::Mesh;
+            if (properties.BakeMeshes)
+            {
+                pending.BakeMesh = true;
+                pending.Name = name.substr(0, name.size() - 4) + ".vmesh";
+                pending.Entry.Flags |= AssetGpuReady;
+            }
+        }
+        else if (HasExtension(name, ".vmesh"))
+        {
+            pending.Entry.Type = AssetType::Mesh;
+            pending.Entry.Flags |= AssetGpuReady;
+        }
+        else if (HasExtension(name, ".spv"))
+        {
+            pending.Entry.Type = AssetType::Shader;
+            pending.Entry.Flags |= AssetGpuReady;
+        }
+    }
+
+    uint64_t Align(uint64_t offset, uint32_t alignment)
+    {
+        return (offset + alignment - 1) & ~static_cast<uint64_t>(alignment - 1);
+    }
+
+    void WriteZeros(std::ostream &stream, uint64_t count)
+    {
+        static constexpr char zeros[4096] = {};
+        while (count > 0)
+        {
+            const uint64_t chunk = std::min<uint64_t>(count, sizeof(zeros));
+            stream.write(zeros, static_cast<std::streamsize>(chunk));
+            count -= chunk;
+        }
+    }
+
+    bool WritePayload(std::ostream &stream, PendingEntry &pending, const Pack::PackProperties &properties)
+    {
+        if (pending.BakeMesh)
+        {
+            Bake::SourceModel source;
+            if (!Bake::ImportGlb(pending.Input->Path, source))
+            {
+                return false;
+            }
+            Bake::BakedModel baked;
+            Bake::BakeStatistics statistics;
+            Bake::Bake(source, properties.Bake, baked, statistics);
+
+            std::ostringstream buffer(std::ios::binary);
+            if (!Bake::WriteBaked(buffer, baked))
+            {
+                return false;
+            }
+            const std::string bytes = buffer.str();
+            stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            pending.Entry.Size = bytes.size();
+            return true;
+        }
+
+        MappedFile file;
+        if (!file.Open(pending.Input->Path, MappedFileAccess::Sequential))
+        {
+            return false;
+        }
+        stream.write(reinterpret_cast<const char *>(file.Data()), static_cast<std::streamsize>(file.Size()));
+        pending.Entry.Size = file.Size();
+        return true;
+    }
+}
+
+namespace Pack
+{
+    /**
+     * Collect every regular file below a directory, named by its path relative to the directory
+     *
+     * @param inputs Receives the files sorted by name, so related files end up next to each other in the archive
+     *
+     * @return False if the directory could not be read
+     */
+    bool CollectDirectory(const std::string &directory, std::vector<PackInput> &inputs)
+    {
+        namespace fs = std::filesystem;
+        std::error_code error;
+        const fs::path root(directory);
+        for (fs::recursive_directory_iterator it(root, error), end; !error && it != end; it.increment(error))
+        {
+            if (it->is_regular_file())
+            {
+                inputs.push_back({fs::relative(it->path(), root).generic_string(), it->path().string()});
+            }
+        }
+        if (error)
+        {
+            Log::Error("Could not read {0}: {1}", directory, error.message());
+            return false;
+        }
+
+        std::sort(inputs.begin(),
+                  inputs.end(),
+                  [](const PackInput &a, const PackInput &b) { return a.Name < b.Name; });
+        return true;
+    }
+
+    /**
+     * Write a .vpak archive, see core/asset_archive.h for the layout
+     *
+     * The index and names are known before any payload is read, so payloads are streamed into the archive one at a
+     * time and only the index is written again at the end.
+     *
+     * @param inputs Files to pack, stored in this order
+     * @param statistics Receives the entry count and sizes of the written archive
+     *
+     * @return False if an input could not be read or baked, the names collide or the archive could not be written
+     */
+    bool WriteArchive(const std::string &path,
+                      const std::vector<PackInput> &inputs,
+                      const PackProperties &properties,
+                      PackStatistics &statistics)
+    {
+        statistics = {};
+        const uint32_t alignment = properties.Alignment;
+        if (alignment < MinAlignment || (alignment & (alignment - 1)) != 0)
+        {
+            Log::Error("Archive alignment {0} is not a power of two of at least {1}", alignment, MinAlignment);
+            return false;
+        }
+
+        std::vector<PendingEntry> pending(inputs.size());
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            pending[i].Input = &inputs[i];
+            Classify(pending[i], properties);
+            pending[i].Entry.Hash = AssetArchive::HashName(pending[i].Name);
+        }
+
+        // the index is sorted by hash, the payloads stay in input order
+        std::vector<PendingEntry *> index(pending.size());
+        for (size_t i = 0; i < pending.size(); i++)
+        {
+            index[i] = &pending[i];
+        }
+        std::sort(index.begin(),
+                  index.end(),
+                  [](const PendingEntry *a, const PendingEntry *b) { return a->Entry.Hash < b->Entry.Hash; });
+        for (size_t i = 1; i < index.size(); i++)
+        {
+            if (index[i - 1]->Entry.Hash == index[i]->Entry.Hash)
+            {
+                Log::Error("{0} and {1} have the same name hash", index[i - 1]->Name, index[i]->Name);
+                return false;
+            }
+        }
+
+        AssetArchiveHeader header;
+        header.EntryCount = static_cast<uint32_t>(index.size());
+        header.Alignment = alignment;
+        std::string names;
+        for (PendingEntry *entry : index)
+        {
+            entry->Entry.NameOffset = static_cast<uint32_t>(names.size());
+            entry->Entry.NameLength = static_cast<uint32_t>(entry->Name.size());
+            names += entry->Name;
+        }
+        header.NamesOffset = sizeof(header) + index.size() * sizeof(AssetArchiveEntry);
+        header.NamesSize = names.size();
+
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        // the index is filled in once the payload offsets and sizes are known
+        WriteZeros(stream, header.NamesOffset);
+        stream.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+        uint64_t offset = header.NamesOffset + header.NamesSize;
+        for (PendingEntry &entry : pending)
+        {
+            const uint64_t aligned = Align(offset, alignment);
+            WriteZeros(stream, aligned - offset);
+            entry.Entry.Offset = aligned;
+            if (!WritePayload(stream, entry, properties))
+            {
+                Log::Error("Could not pack {0}", entry.Input->Path);
+                return false;
+            }
+            offset = aligned + entry.Entry.Size;
+            statistics.PayloadBytes += entry.Entry.Size;
+            statistics.BakedMeshes += entry.BakeMesh ? 1 : 0;
+        }
+
+        stream.seekp(0);
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const PendingEntry *entry : index)
+        {
+            stream.write(reinterpret_cast<const char *>(&entry->Entry), sizeof(entry->Entry));
+        }
+        if (!stream.good())
+        {
+            Log::Error("Could not write {0}", path);
+            return false;
+        }
+
+        statistics.Entries = header.EntryCount;
+        statistics.ArchiveBytes = offset;
+        return true;
+    }
+}
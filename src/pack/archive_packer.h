@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/asset_archive.h"
+#include "mesh_baker.h"
+
+/** @brief Offline packing of loose asset files into the .vpak archives AssetArchive reads */
+namespace Pack
+{
+    struct PackInput
+    {
+        // name the runtime looks the entry up by, forward slashes
+        std::string Name;
+        std::string Path;
+    };
+
+    struct PackProperties
+    {
+        // power of two, at least MinAlignment
+        uint32_t Alignment = AssetArchiveDefaultAlignment;
+        // bake .glb files into .vmesh while packing, the entry is then named .vmesh as well
+        bool BakeMeshes = true;
+        Bake::BakeProperties Bake;
+    };
+
+    struct PackStatistics
+    {
+        uint32_t Entries = 0;
+        uint32_t BakedMeshes = 0;
+        uint64_t PayloadBytes = 0;
+        uint64_t ArchiveBytes = 0;
+    };
+
+    // nonCoherentAtomSize is at most 256 bytes, so payloads never share an atom
+    constexpr uint32_t MinAlignment = 256;
+
+    bool CollectDirectory(const std::string &directory, std::vector<PackInput> &inputs);
+
+    bool WriteArchive(const std::string &path,
+                      const std::vector<PackInput> &inputs,
+                      const PackProperties &properties,
+                      PackStatistics &statistics);
+}
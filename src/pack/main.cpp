@@ -0,0 +1,74 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "archive_packer.h"
+#include "core/log.h"
+
+namespace
+{
+    void PrintUsage()
+    {
+        Log::Info("usage: vanadium_pack [options] <input directory> <output.vpak>\n"
+                  "  --alignment <n>       payload alignment in bytes, a power of two of at least 256 (4096)\n"
+                  "  --no-bake             store .glb files as they are instead of baking them into .vmesh\n"
+                  "  --quantize-positions  store baked positions as 16 bit unorm");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Pack::PackProperties properties;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--alignment" && i + 1 < argc)
+        {
+            properties.Alignment = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (argument == "--no-bake")
+        {
+            properties.BakeMeshes = false;
+        }
+        else if (argument == "--quantize-positions")
+        {
+            properties.Bake.QuantizePositions = true;
+        }
+        else if (!argument.starts_with("--"))
+        {
+            files.push_back(argument);
+        }
+        else
+        {
+            Log::Error("Invalid or incomplete argument {0}", argument);
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (files.size() != 2)
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Pack::PackInput> inputs;
+    if (!Pack::CollectDirectory(files[0], inputs))
+    {
+        return EXIT_FAILURE;
+    }
+
+    Pack::PackStatistics statistics;
+    if (!Pack::WriteArchive(files[1], inputs, properties, statistics))
+    {
+        return EXIT_FAILURE;
+    }
+
+    Log::System("Packed {0} files into {1}", statistics.Entries, files[1]);
+    Log::Info("    {0} meshes baked", statistics.BakedMeshes);
+    Log::Info("    payloads {0:.2f} MiB, archive {1:.2f} MiB with {2} byte alignment",
+              static_cast<double>(statistics.PayloadBytes) / (1024.0 * 1024.0),
+              static_cast<double>(statistics.ArchiveBytes) / (1024.0 * 1024.0),
+              properties.Alignment);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,329 @@
+#include "bench_report.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+#include "core/log.h"
+
+namespace
+{
+    constexpr uint32_t ReportVersion = 1;
+    // differences below these are noise on any device and never count as regressions
+    constexpr double TimeNoiseFloorMs = 0.05;
+    constexpr double MemoryNoiseFloorBytes = 1024.0 * 1024.0;
+
+    std::string Escape(const std::string &text)
+    {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+            }
+            if (static_cast<unsigned char>(c) >= 0x20)
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    std::string StatsJson(const Bench::Stats &stats)
+    {
+        return std::format("{{\"samples\": {0}, \"mean\": {1:.4f}, \"min\": {2:.4f}, \"p50\": {3:.4f}, "
+                           "\"p95\": {4:.4f}, \"p99\": {5:.4f}, \"max\": {6:.4f}}}",
+                           stats.samples,
+                           stats.mean,
+                           stats.min,
+                           stats.p50,
+                           stats.p95,
+                           stats.p99,
+                           stats.max);
+    }
+
+    /**
+     * @brief Reads just enough JSON for our own reports: objects, strings and numbers are flattened into paths,
+     * arrays, booleans and null are skipped
+     */
+    class FlatJsonReader
+    {
+    public:
+        explicit FlatJsonReader(const std::string &text) : text(text) {}
+
+        bool Read(BenchBaseline &baseline)
+        {
+            output = &baseline;
+            if (!ReadValue(""))
+            {
+                return false;
+            }
+            SkipWhitespace();
+            return position == text.size();
+        }
+
+    private:
+        void SkipWhitespace()
+        {
+            while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position])))
+            {
+                position++;
+            }
+        }
+
+        bool Consume(char expected)
+        {
+            SkipWhitespace();
+            if (position < text.size() && text[position] == expected)
+            {
+                position++;
+                return true;
+            }
+            return false;
+        }
+
+        bool ReadString(std::string &value)
+        {
+            if (!Consume('"'))
+            {
+                return false;
+            }
+            value.clear();
+            while (position < text.size() && text[position] != '"')
+            {
+                if (text[position] == '\\' && position + 1 < text.size())
+                {
+                    position++;
+                }
+                value += text[position++];
+            }
+            return Consume('"');
+        }
+
+        bool ReadValue(const std::string &path)
+        {
+            SkipWhitespace();
+            if (position >= text.size())
+            {
+                return false;
+            }
+
+            const char c = text[position];
+            if (c == '{')
+            {
+                position++;
+                if (Consume('}'))
+                {
+                    return true;
+                }
+                do
+                {
+                    std::string key;
+                    if (!ReadString(key) || !Consume(':') || !ReadValue(path.empty() ? key : path + "/" + key))
+                    {
+                        return false;
+                    }
+                } while (Consume(','));
+                return Consume('}');
+            }
+            if (c == '[')
+            {
+                position++;
+                if (Consume(']'))
+                {
+                    return true;
+                }
+                do
+                {
+                    if (!ReadValue(path + "/[]"))
+                    {
+                        return false;
+                    }
+                } while (Consume(','));
+                return Consume(']');
+            }
+            if (c == '"')
+            {
+                std::string value;
+                if (!ReadString(value))
+                {
+                    return false;
+                }
+                if (path == "device")
+                {
+                    output->Device = value;
+                }
+                return true;
+            }
+
+            const char *begin = text.c_str() + position;
+            char *end = nullptr;
+            const double number = std::strtod(begin, &end);
+            if (end != begin)
+            {
+                output->Values[path] = number;
+                position += static_cast<size_t>(end - begin);
+                return true;
+            }
+            for (const char *literal : {"true", "false", "null"})
+            {
+                if (text.compare(position, std::strlen(literal), literal) == 0)
+                {
+                    position += std::strlen(literal);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        const std::string &text;
+        size_t position = 0;
+        BenchBaseline *output = nullptr;
+    };
+}
+
+bool WriteReport(const std::string &path, const std::string &deviceName, const std::vector<SceneResult> &results)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        Log::Error("Could not open {0} for writing", path);
+        return false;
+    }
+
+    file << "{\n";
+    file << std::format("    \"version\": {0},\n", ReportVersion);
+    file << std::format("    \"device\": \"{0}\",\n", Escape(deviceName));
+    file << "    \"scenes\": {";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const SceneResult &result = results[i];
+        file << (i == 0 ? "\n" : ",\n");
+        file << std::format("        \"{0}\": {{\n", Escape(result.Scene));
+        file << std::format("            \"warmupFrames\": {0},\n", result.WarmupFrames);
+        file << std::format("            \"cpuMs\": {0},\n", StatsJson(result.CpuMs));
+        file << std::format("            \"gpuMs\": {0},\n", StatsJson(result.GpuMs));
+        file << std::format("            \"frameMs\": {0},\n", StatsJson(result.FrameMs));
+        file << std::format("            \"uploadBytesPerFrame\": {0},\n", result.UploadBytesPerFrame);
+        file << std::format("            \"memory\": {{\"peakResidentBytes\": {0}, \"peakDriverHostBytes\": {1}, "
+                            "\"sceneBufferBytes\": {2}}}\n",
+                            result.Memory.PeakResident,
+                            result.Memory.PeakDriverHost,
+                            result.Memory.SceneBuffers);
+        file << "        }";
+    }
+    file << "\n    }\n}\n";
+
+    return file.good();
+}
+
+std::optional<BenchBaseline> LoadBaseline(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        Log::Error("Could not open baseline {0}", path);
+        return std::nullopt;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    const std::string text = contents.str();
+
+    BenchBaseline baseline;
+    if (!FlatJsonReader(text).Read(baseline))
+    {
+        Log::Error("Baseline {0} is not valid JSON", path);
+        return std::nullopt;
+    }
+    const auto version = baseline.Values.find("version");
+    if (version == baseline.Values.end() || version->second != ReportVersion)
+    {
+        Log::Error("Baseline {0} was written by a different report version", path);
+        return std::nullopt;
+    }
+    return baseline;
+}
+
+uint32_t CompareToBaseline(const std::vector<SceneResult> &results,
+                           const BenchBaseline &baseline,
+                           double thresholdPercent)
+{
+    const double limit = 1.0 + thresholdPercent / 100.0;
+    uint32_t regressions = 0;
+    uint32_t compared = 0;
+
+    const auto check = [&](const std::string &path, double current, double noiseFloor, const char *unit)
+    {
+        const auto it = baseline.Values.find(path);
+        // metrics the baseline did not measure, e.g. GPU time without timestamp support
+        if (it == baseline.Values.end() || it->second <= 0.0)
+        {
+            return;
+        }
+        compared++;
+
+        const double previous = it->second;
+        if (current > previous * limit && current - previous > noiseFloor)
+        {
+            Log::Error("Regression {0}: {1:.3f}{3} -> {2:.3f}{3} ({4:+.1f}%)",
+                       path,
+                       previous,
+                       current,
+                       unit,
+                       (current / previous - 1.0) * 100.0);
+            regressions++;
+        }
+        else if (current * limit < previous && previous - current > noiseFloor)
+        {
+            Log::Info("Improvement {0}: {1:.3f}{3} -> {2:.3f}{3} ({4:+.1f}%)",
+                      path,
+                      previous,
+                      current,
+                      unit,
+                      (current / previous - 1.0) * 100.0);
+        }
+    };
+
+    for (const SceneResult &result : results)
+    {
+        const std::string scene = "scenes/" + result.Scene;
+        if (!baseline.Values.contains(scene + "/warmupFrames"))
+        {
+            Log::Warning("Scene {0} is not in the baseline", result.Scene);
+            continue;
+        }
+
+        const std::pair<const char *, const Bench::Stats *> timings[] = {
+            {"cpuMs", &result.CpuMs},
+            {"gpuMs", &result.GpuMs},
+            {"frameMs", &result.FrameMs},
+        };
+        for (const auto &[name, stats] : timings)
+        {
+            const std::string prefix = std::format("{0}/{1}/", scene, name);
+            check(prefix + "p50", stats->p50, TimeNoiseFloorMs, "ms");
+            check(prefix + "p95", stats->p95, TimeNoiseFloorMs, "ms");
+            check(prefix + "p99", stats->p99, TimeNoiseFloorMs, "ms");
+        }
+
+        check(scene + "/memory/peakResidentBytes",
+              static_cast<double>(result.Memory.PeakResident),
+              MemoryNoiseFloorBytes,
+              "B");
+        check(scene + "/memory/peakDriverHostBytes",
+              static_cast<double>(result.Memory.PeakDriverHost),
+              MemoryNoiseFloorBytes,
+              "B");
+    }
+
+    Log::System("Compared {0} values against the baseline with a {1:.1f}% threshold, {2} regressions",
+                compared,
+                thresholdPercent,
+                regressions);
+    return regressions;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "scene_runner.h"
+
+/**
+ * @brief Numbers of a previous report keyed by their path, e.g. "scenes/lights/gpuMs/p95"
+ */
+struct BenchBaseline
+{
+    std::string Device;
+    std::map<std::string, double> Values;
+};
+
+/**
+ * Write all scene results as JSON, one object per scene under "scenes" keyed by the scene name
+ *
+ * @return False if the file could not be written
+ */
+bool WriteReport(const std::string &path, const std::string &deviceName, const std::vector<SceneResult> &results);
+
+/** @brief Read a report written by WriteReport, nothing if it is missing or malformed */
+std::optional<BenchBaseline> LoadBaseline(const std::string &path);
+
+/**
+ * Compare the frame time percentiles and memory peaks of every scene that is also in the baseline
+ *
+ * @param thresholdPercent Allowed increase over the baseline before a value counts as a regression
+ *
+ * @return Number of regressions, each one is logged as an error
+ */
+uint32_t CompareToBaseline(const std::vector<SceneResult> &results,
+                           const BenchBaseline &baseline,
+                           double thresholdPercent);
@@ -0,0 +1,260 @@
+#include <charconv>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "bench_report.h"
+#include "core/log.h"
+#include "graphics/frame_capture.h"
+#include "headless_context.h"
+#include "scene_runner.h"
+#include "scene_script.h"
+
+namespace
+{
+    struct Options
+    {
+        std::vector<std::string> scenes;
+        uint32_t warmupFrames = 60;
+        uint32_t frames = 300;
+        std::string output = "vanadium_bench.json";
+        std::string baseline;
+        std::string capture;
+        std::string replay;
+        double thresholdPercent = 10.0;
+        bool list = false;
+    };
+
+    void PrintUsage()
+    {
+        Log::Info("usage: vanadium_bench [options] [scene or script file ...]\n"
+                  "  --frames <n>         measured frames per scene (300)\n"
+                  "  --warmup <n>         unmeasured frames before them (60)\n"
+                  "  --output <file>      JSON report (vanadium_bench.json)\n"
+                  "  --baseline <file>    report to compare against, exits with 1 on regressions\n"
+                  "  --threshold <pct>    allowed increase over the baseline (10)\n"
+                  "  --capture <file>     record every frame of the single scene given\n"
+                  "  --replay <file>      run a capture instead of scenes, reported as replay/<scene>\n"
+                  "  --list               print the built-in scenes\n"
+                  "Without scenes every built-in scene is run.");
+    }
+
+    template <typename T>
+    bool ParseValue(int argc, char *argv[], int &i, T &value)
+    {
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        const std::string text = argv[++i];
+        const auto [ptr, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return error == std::errc() && ptr == text.data() + text.size();
+    }
+
+    bool ParseOptions(int argc, char *argv[], Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string argument = argv[i];
+            bool valid = true;
+            if (argument == "--frames")
+            {
+                valid = ParseValue(argc, argv, i, options.frames) && options.frames > 0;
+            }
+            else if (argument == "--warmup")
+            {
+                valid = ParseValue(argc, argv, i, options.warmupFrames);
+            }
+            else if (argument == "--threshold")
+            {
+                valid = ParseValue(argc, argv, i, options.thresholdPercent);
+            }
+            else if (argument == "--output" || argument == "--baseline" || argument == "--capture" ||
+                     argument == "--replay")
+            {
+                valid = i + 1 < argc;
+                if (valid)
+                {
+                    std::string &value = argument == "--output"     ? options.output
+                                         : argument == "--baseline" ? options.baseline
+                                         : argument == "--capture"  ? options.capture
+                                                                    : options.replay;
+                    value = argv[++i];
+                }
+            }
+            else if (argument == "--list")
+            {
+                options.list = true;
+            }
+            else if (argument.starts_with("--"))
+            {
+                valid = false;
+            }
+            else
+            {
+                options.scenes.push_back(argument);
+            }
+
+            if (!valid)
+            {
+                Log::Error("Invalid or incomplete argument {0}", argument);
+                return false;
+            }
+        }
+
+        if (!options.capture.empty() && options.scenes.size() != 1)
+        {
+            Log::Error("--capture needs exactly one scene");
+            return false;
+        }
+        if (!options.replay.empty() && (!options.scenes.empty() || !options.capture.empty()))
+        {
+            Log::Error("--replay runs the captured scene only and cannot be combined with scenes or --capture");
+            return false;
+        }
+        return true;
+    }
+
+    void ReportResult(const SceneResult &result)
+    {
+        Bench::Report(result.Scene + "/cpu", result.CpuMs);
+        Bench::Report(result.Scene + "/gpu", result.GpuMs);
+        Bench::Report(result.Scene + "/frame", result.FrameMs);
+        Log::Info("    {0:.2f} MiB uploaded per frame, {1} MiB resident, {2} KiB driver host memory",
+                  static_cast<double>(result.UploadBytesPerFrame) / (1024.0 * 1024.0),
+                  result.Memory.PeakResident >> 20,
+                  result.Memory.PeakDriverHost / 1024);
+    }
+
+    // a built-in scene name, otherwise a script file
+    std::optional<SceneScript> ResolveScene(const std::string &name)
+    {
+        if (std::optional<SceneScript> scene = FindBuiltinScene(name))
+        {
+            return scene;
+        }
+        if (std::filesystem::exists(name))
+        {
+            return LoadSceneScript(name);
+        }
+        Log::Error("{0} is neither a built-in scene nor a script file", name);
+        return std::nullopt;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    if (options.list)
+    {
+        for (const SceneScript &scene : BuiltinScenes())
+        {
+            Log::Info("{0:<12} {1} instances, {2} lights, {3} materials ({4} updated per frame), "
+                      "{5} KiB streamed per frame",
+                      scene.Name,
+                      scene.Instances,
+                      scene.Lights,
+                      scene.Materials,
+                      scene.MaterialUpdates,
+                      scene.StreamBytes / 1024);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<SceneScript> scenes;
+    if (options.scenes.empty() && options.replay.empty())
+    {
+        scenes = BuiltinScenes();
+    }
+    for (const std::string &name : options.scenes)
+    {
+        std::optional<SceneScript> scene = ResolveScene(name);
+        if (!scene)
+        {
+            return EXIT_FAILURE;
+        }
+        scenes.push_back(std::move(*scene));
+    }
+
+    // read before running so a broken baseline fails fast
+    std::optional<BenchBaseline> baseline;
+    if (!options.baseline.empty())
+    {
+        baseline = LoadBaseline(options.baseline);
+        if (!baseline)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    HeadlessContext context;
+    if (!context.Initialize())
+    {
+        return EXIT_FAILURE;
+    }
+    const std::string deviceName = context.device->properties.deviceName;
+
+    std::vector<SceneResult> results;
+    if (!options.replay.empty())
+    {
+        FrameCaptureReader capture;
+        SceneRunner runner;
+        if (!capture.Open(options.replay) || !runner.InitializeReplay(context, capture))
+        {
+            Log::Error("Could not replay {0}", options.replay);
+            return EXIT_FAILURE;
+        }
+        Log::System("[{0}, {1} captured frames]", options.replay, capture.GetFrameCount());
+        results.push_back(runner.Run(options.warmupFrames, options.frames));
+        ReportResult(results.back());
+    }
+
+    FrameCaptureWriter capture;
+    if (!options.capture.empty() && !capture.Open(options.capture))
+    {
+        return EXIT_FAILURE;
+    }
+    for (const SceneScript &scene : scenes)
+    {
+        Log::System("[{0}]", scene.Name);
+        SceneRunner runner;
+        if (!runner.Initialize(context, scene, capture.IsOpen() ? &capture : nullptr))
+        {
+            Log::Error("Could not set up scene {0}", scene.Name);
+            return EXIT_FAILURE;
+        }
+
+        results.push_back(runner.Run(options.warmupFrames, options.frames));
+        ReportResult(results.back());
+    }
+    capture.Close();
+
+    if (!WriteReport(options.output, deviceName, results))
+    {
+        return EXIT_FAILURE;
+    }
+    Log::System("Wrote {0}", options.output);
+
+    if (baseline)
+    {
+        if (baseline->Device != deviceName)
+        {
+            Log::Warning("Baseline was recorded on {0}, comparing anyway", baseline->Device);
+        }
+        if (CompareToBaseline(results, *baseline, options.thresholdPercent) > 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
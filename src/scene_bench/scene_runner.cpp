@@ -0,0 +1,739 @@
+#include "scene_runner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#include "core/log.h"
+#include "core/job_system.h"
+#include "graphics/vulkan/vk_debugger.h"
+#include "graphics/vulkan/vk_host_memory.h"
+#include "graphics/vulkan/vk_initializers.h"
+#include "graphics/vulkan/vk_tools.h"
+#include "headless_context.h"
+
+namespace
+{
+    constexpr uint32_t CullGroupSize = 64;
+    constexpr float SceneExtent = 150.0f;
+    constexpr float ZNear = 0.1f;
+    constexpr float ZFar = 400.0f;
+    const glm::vec3 CameraPosition(0.0f, 60.0f, -160.0f);
+
+    using Clock = std::chrono::steady_clock;
+
+    double ElapsedMs(Clock::time_point start, Clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    // resident set size of the process, 0 where it cannot be queried
+    uint64_t ReadResidentBytes()
+    {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return counters.WorkingSetSize;
+        }
+        return 0;
+#elif defined(__linux__)
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.rfind("VmRSS:", 0) == 0)
+            {
+                return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+            }
+        }
+        return 0;
+#else
+        return 0;
+#endif
+    }
+
+    // Gribb / Hartmann plane extraction for a zero to one depth range, normalized so distances are in world units
+    void ExtractFrustumPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6])
+    {
+        const glm::mat4 m = glm::transpose(viewProjection);
+        planes[0] = m[3] + m[0];
+        planes[1] = m[3] - m[0];
+        planes[2] = m[3] + m[1];
+        planes[3] = m[3] - m[1];
+        planes[4] = m[2];
+        planes[5] = m[3] - m[2];
+        for (uint32_t i = 0; i < 6; i++)
+        {
+            planes[i] /= glm::length(glm::vec3(planes[i]));
+        }
+    }
+
+    // appends a copy or grows the previous one when both source and destination continue it
+    void AppendCopy(std::vector<VkBufferCopy> &copies,
+                    VkDeviceSize srcOffset,
+                    VkDeviceSize dstOffset,
+                    VkDeviceSize size)
+    {
+        if (!copies.empty())
+        {
+            VkBufferCopy &last = copies.back();
+            if (last.srcOffset + last.size == srcOffset && last.dstOffset + last.size == dstOffset)
+            {
+                last.size += size;
+                return;
+            }
+        }
+        copies.push_back({srcOffset, dstOffset, size});
+    }
+}
+
+SceneRunner::SceneRunner() = default;
+
+SceneRunner::~SceneRunner()
+{
+    Destroy();
+}
+
+/**
+ * Build the scene and create all buffers and pipelines it needs
+ *
+ * @param headlessContext Initialized headless context, has to outlive the runner
+ * @param sceneScript Scene to run, the light count is capped by ClusterProperties::MaxLights
+ * @param captureWriter (Optional) Open capture every frame of Run() is recorded to, has to outlive the runner
+ */
+bool SceneRunner::Initialize(HeadlessContext &headlessContext,
+                             const SceneScript &sceneScript,
+                             FrameCaptureWriter *captureWriter)
+{
+    script = sceneScript;
+    capture = captureWriter && captureWriter->IsOpen() ? captureWriter : nullptr;
+    replay = nullptr;
+
+    BuildScene();
+    if (!CreateResources(headlessContext))
+    {
+        return false;
+    }
+    shading.SetLights(script.Lights);
+
+    const glm::mat4 view = glm::lookAt(CameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f),
+                                                       static_cast<float>(script.Width) /
+                                                           static_cast<float>(script.Height),
+                                                       ZNear,
+                                                       ZFar);
+    SetCamera({view, projection, ZNear, ZFar, script.Width, script.Height});
+
+    if (capture)
+    {
+        // the script is all a replay needs to recreate the buffers and pipelines
+        capture->WriteMetadata(FormatSceneScript(script));
+        for (uint32_t id = 0; id < SceneBufferCount; id++)
+        {
+            capture->CreateBuffer(id, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sceneBuffers[id].size);
+        }
+        capture->SetLights(shading.GetLights());
+        capture->SetCamera(camera);
+    }
+    return true;
+}
+
+/**
+ * Create the resources of a captured scene, Run() then replays the capture instead of simulating the scene
+ *
+ * @param headlessContext Initialized headless context, has to outlive the runner
+ * @param captureReader Open capture written by Initialize() with a FrameCaptureWriter, has to outlive the runner
+ *
+ * @return False if the capture has no scene metadata or frames
+ */
+bool SceneRunner::InitializeReplay(HeadlessContext &headlessContext, FrameCaptureReader &captureReader)
+{
+    if (captureReader.GetMetadata().empty() || captureReader.GetFrameCount() == 0)
+    {
+        Log::Error("The capture contains no scene or no complete frame");
+        return false;
+    }
+    const std::optional<SceneScript> capturedScript = ParseSceneScript(captureReader.GetMetadata(), "capture");
+    if (!capturedScript)
+    {
+        return false;
+    }
+
+    script = *capturedScript;
+    capture = nullptr;
+    replay = &captureReader;
+    replay->Rewind();
+    replayedLights = nullptr;
+    return CreateResources(headlessContext);
+}
+
+bool SceneRunner::CreateResources(HeadlessContext &headlessContext)
+{
+    context = &headlessContext;
+    device = context->device->logicalDevice;
+
+    // the calling thread takes part in the work, uses all hardware threads
+    jobSystem = std::make_unique<JobSystem>();
+
+    if (!shading.Initialize(*context, script.Width, script.Height))
+    {
+        return false;
+    }
+
+    Debug::CheckVulkan(profiler.Initialize(context->device,
+                                           GpuProfilerProperties{},
+                                           FramesInFlight,
+                                           context->device->queueFamilyIndices.graphics));
+
+    const VkDeviceSize instanceBytes = sizeof(GpuInstance) * static_cast<VkDeviceSize>(script.Instances);
+    const VkDeviceSize materialBytes = sizeof(GpuMaterial) * static_cast<VkDeviceSize>(script.Materials);
+    // draw count padded to 16 bytes, followed by one record per instance
+    const VkDeviceSize drawBytes = 16 + 16 * static_cast<VkDeviceSize>(script.Instances);
+    const VkDeviceSize streamBytes = std::max<VkDeviceSize>(script.StreamBytes, 4);
+    stagingBytes = instanceBytes + materialBytes + script.StreamBytes;
+
+    const VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VulkanDevice *vulkanDevice = context->device;
+    Debug::CheckVulkan(vulkanDevice->createBuffer(storageUsage,
+                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                  &sceneBuffers[InstanceData],
+                                                  instanceBytes));
+    Debug::CheckVulkan(vulkanDevice->createBuffer(storageUsage,
+                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                  &sceneBuffers[MaterialData],
+                                                  materialBytes));
+    Debug::CheckVulkan(vulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                  &sceneBuffers[StreamData],
+                                                  streamBytes));
+    Debug::CheckVulkan(vulkanDevice->createBuffer(storageUsage,
+                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                  &drawBuffer,
+                                                  drawBytes));
+    sceneBufferBytes = instanceBytes + materialBytes + drawBytes + streamBytes;
+
+    for (FrameResources &frame : frames)
+    {
+        Debug::CheckVulkan(vulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                      &frame.staging,
+                                                      stagingBytes));
+        Debug::CheckVulkan(frame.staging.map());
+        sceneBufferBytes += stagingBytes;
+
+        frame.commandBuffer = vulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, false);
+        const VkFenceCreateInfo fenceInfo = vkinit::fenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
+        Debug::CheckVulkan(vkCreateFence(device,
+                                         &fenceInfo,
+                                         vkhost::allocationCallbacks(VK_OBJECT_TYPE_FENCE),
+                                         &frame.fence));
+    }
+
+    if (CreateCullPipeline(context->shaderDirectory) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    cullPush.instanceCount = script.Instances;
+    cullPush.materialCount = script.Materials;
+    return true;
+}
+
+void SceneRunner::Destroy()
+{
+    if (!device)
+    {
+        return;
+    }
+
+    vkDeviceWaitIdle(device);
+    vkDestroyPipeline(device, cullPipeline, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    vkDestroyPipelineLayout(device, cullPipelineLayout, vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+    vkDestroyDescriptorPool(device, descriptorPool, vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+    vkDestroyDescriptorSetLayout(device,
+                                 cullLayout,
+                                 vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+    for (FrameResources &frame : frames)
+    {
+        vkDestroyFence(device, frame.fence, vkhost::allocationCallbacks(VK_OBJECT_TYPE_FENCE));
+        if (frame.commandBuffer)
+        {
+            vkFreeCommandBuffers(device, context->device->commandPool, 1, &frame.commandBuffer);
+        }
+        frame.staging.destroy();
+        frame = FrameResources{};
+    }
+    for (Buffer &buffer : sceneBuffers)
+    {
+        buffer.destroy();
+    }
+    drawBuffer.destroy();
+
+    profiler.Destroy();
+    shading.Destroy();
+    jobSystem.reset();
+    capture = nullptr;
+    replay = nullptr;
+
+    device = VK_NULL_HANDLE;
+}
+
+/**
+ * Run the scene, the first warmupFrames are not measured
+ *
+ * @return Frame time percentiles and memory high water marks of the measured frames
+ */
+SceneResult SceneRunner::Run(uint32_t warmupFrames, uint32_t measuredFrames)
+{
+    SceneResult result;
+    // replays get their own name so a baseline never compares them against live runs
+    result.Scene = replay ? "replay/" + script.Name : script.Name;
+    result.WarmupFrames = warmupFrames;
+
+    std::vector<double> cpuSamples;
+    std::vector<double> gpuSamples;
+    std::vector<double> frameSamples;
+    cpuSamples.reserve(measuredFrames);
+    gpuSamples.reserve(measuredFrames);
+    frameSamples.reserve(measuredFrames);
+    uint64_t uploadBytes = 0;
+    const auto measured = [&](uint32_t frame)
+    {
+        return frame >= warmupFrames && frame < warmupFrames + measuredFrames;
+    };
+
+    // GPU timings lag FramesInFlight frames behind, the extra frames resolve the last measured ones
+    const uint32_t totalFrames = warmupFrames + measuredFrames + FramesInFlight;
+    Clock::time_point previousFrameStart{};
+    for (uint32_t frame = 0; frame < totalFrames; frame++)
+    {
+        const Clock::time_point frameStart = Clock::now();
+        if (frame > 0 && measured(frame - 1))
+        {
+            frameSamples.push_back(ElapsedMs(previousFrameStart, frameStart));
+        }
+        previousFrameStart = frameStart;
+
+        const uint32_t slot = frame % FramesInFlight;
+        FrameResources &frameResources = frames[slot];
+        Debug::CheckVulkan(vkWaitForFences(device, 1, &frameResources.fence, VK_TRUE, UINT64_MAX));
+        Debug::CheckVulkan(vkResetFences(device, 1, &frameResources.fence));
+
+        const Clock::time_point cpuStart = Clock::now();
+        const VkDeviceSize stagedBytes = replay ? ReplayFrame(frameResources) : SimulateFrame(frameResources, frame);
+        RecordFrame(frameResources, slot);
+        if (capture)
+        {
+            capture->EndFrame();
+        }
+        if (profiler.HasNewResults() && frame >= FramesInFlight && measured(frame - FramesInFlight))
+        {
+            gpuSamples.push_back(profiler.GetFrameMs());
+        }
+
+        // waits for the light culling if it was submitted to the compute queue
+        context->SubmitToQueue(frameResources.commandBuffer, frameResources.fence);
+        const Clock::time_point cpuEnd = Clock::now();
+
+        if (measured(frame))
+        {
+            cpuSamples.push_back(ElapsedMs(cpuStart, cpuEnd));
+            uploadBytes += stagedBytes;
+            result.Memory.PeakResident = std::max(result.Memory.PeakResident, ReadResidentBytes());
+            result.Memory.PeakDriverHost = std::max(result.Memory.PeakDriverHost,
+                                                    vkhost::getStatistics().Total.Bytes);
+        }
+    }
+    vkDeviceWaitIdle(device);
+
+    if (gpuSamples.size() < measuredFrames)
+    {
+        Log::Warning("{0}: only {1} of {2} frames have GPU timings", script.Name, gpuSamples.size(), measuredFrames);
+    }
+
+    result.CpuMs = Bench::Summarize(std::move(cpuSamples));
+    result.GpuMs = Bench::Summarize(std::move(gpuSamples));
+    result.FrameMs = Bench::Summarize(std::move(frameSamples));
+    result.UploadBytesPerFrame = measuredFrames > 0 ? uploadBytes / measuredFrames : 0;
+    result.Memory.SceneBuffers = sceneBufferBytes;
+    return result;
+}
+
+void SceneRunner::BuildScene()
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> groupPosition(-SceneExtent, SceneExtent);
+    std::uniform_real_distribution<float> offset(-8.0f, 8.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    const uint32_t groupCount = (script.Instances + script.GroupSize - 1) / script.GroupSize;
+    hierarchy.Reserve(groupCount + script.Instances);
+
+    groups.resize(groupCount);
+    for (TransformHandle &group : groups)
+    {
+        group = hierarchy.Create();
+        hierarchy.SetPosition(group, glm::vec3(groupPosition(rng), 0.0f, groupPosition(rng)));
+    }
+
+    instances.resize(script.Instances);
+    instanceMaterials.resize(script.Instances);
+    std::uniform_int_distribution<uint32_t> materialIndex(0, script.Materials - 1);
+    for (uint32_t i = 0; i < script.Instances; i++)
+    {
+        instances[i] = hierarchy.Create(groups[i / script.GroupSize]);
+        const glm::quat rotation = glm::angleAxis(unit(rng) * glm::two_pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f));
+        hierarchy.SetLocal(instances[i],
+                           glm::vec3(offset(rng), unit(rng) * 4.0f, offset(rng)),
+                           rotation,
+                           glm::vec3(scale(rng)));
+        instanceMaterials[i] = materialIndex(rng);
+    }
+
+    materials.resize(script.Materials);
+    for (uint32_t i = 0; i < script.Materials; i++)
+    {
+        // every tenth material is translucent, every seventh alpha tested
+        const float alpha = i % 10 == 0 ? 0.5f : 1.0f;
+        const float cutoff = i % 7 == 0 ? 0.5f : 0.0f;
+        materials[i].baseColor = glm::vec4(unit(rng), unit(rng), unit(rng), alpha);
+        materials[i].parameters = glm::vec4(0.0f, unit(rng), unit(rng), cutoff);
+    }
+}
+
+void SceneRunner::Animate(uint32_t frame)
+{
+    const uint32_t groupCount = static_cast<uint32_t>(groups.size());
+    const uint32_t animated = std::min(static_cast<uint32_t>(std::lround(script.AnimatedGroups * groupCount)),
+                                       groupCount);
+    // a sliding window so different groups move every frame unless all of them do
+    const uint32_t first = groupCount > 0 ? frame * animated % groupCount : 0;
+    const float angle = static_cast<float>(frame) * 0.01f;
+    for (uint32_t i = 0; i < animated; i++)
+    {
+        const uint32_t group = (first + i) % groupCount;
+        hierarchy.SetRotation(groups[group], glm::angleAxis(angle + static_cast<float>(group), glm::vec3(0, 1, 0)));
+    }
+    hierarchy.Update(jobSystem.get());
+
+    for (uint32_t i = 0; i < script.MaterialUpdates; i++)
+    {
+        GpuMaterial &material = materials[(nextMaterialUpdate + i) % materials.size()];
+        material.parameters.x = 0.5f + 0.5f * std::sin(angle);
+    }
+}
+
+/**
+ * Write everything that changed since the last frame into the slot's staging buffer and collect the copies
+ *
+ * @return Number of bytes staged
+ */
+VkDeviceSize SceneRunner::StageUploads(FrameResources &frameResources, uint32_t frame)
+{
+    uint8_t *staging = static_cast<uint8_t *>(frameResources.staging.mapped);
+    VkDeviceSize offset = 0;
+
+    for (std::vector<VkBufferCopy> &bufferCopies : copies)
+    {
+        bufferCopies.clear();
+    }
+
+    for (uint32_t i = 0; i < instances.size(); i++)
+    {
+        if (!uploadEverything && !hierarchy.WorldChanged(instances[i]))
+        {
+            continue;
+        }
+
+        GpuInstance instance;
+        instance.world = hierarchy.GetWorld(instances[i]);
+        instance.boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        instance.material = glm::uvec4(instanceMaterials[i], 0, 0, 0);
+        std::memcpy(staging + offset, &instance, sizeof(GpuInstance));
+        AppendCopy(copies[InstanceData], offset, sizeof(GpuInstance) * i, sizeof(GpuInstance));
+        offset += sizeof(GpuInstance);
+    }
+
+    const uint32_t materialCount = static_cast<uint32_t>(materials.size());
+    const uint32_t materialUploads = uploadEverything ? materialCount : script.MaterialUpdates;
+    const uint32_t firstMaterial = uploadEverything ? 0 : nextMaterialUpdate;
+    for (uint32_t i = 0; i < materialUploads; i++)
+    {
+        const uint32_t index = (firstMaterial + i) % materialCount;
+        std::memcpy(staging + offset, &materials[index], sizeof(GpuMaterial));
+        AppendCopy(copies[MaterialData], offset, sizeof(GpuMaterial) * index, sizeof(GpuMaterial));
+        offset += sizeof(GpuMaterial);
+    }
+    nextMaterialUpdate = (nextMaterialUpdate + script.MaterialUpdates) % materialCount;
+
+    if (script.StreamBytes > 0)
+    {
+        std::memset(staging + offset, static_cast<int>(frame & 0xff), script.StreamBytes);
+        copies[StreamData].push_back({offset, 0, script.StreamBytes});
+        offset += script.StreamBytes;
+    }
+
+    uploadEverything = false;
+    return offset;
+}
+
+/**
+ * Advance the simulation by one frame, stage its uploads and build its packets
+ *
+ * @return Number of bytes staged
+ */
+VkDeviceSize SceneRunner::SimulateFrame(FrameResources &frameResources, uint32_t frame)
+{
+    Animate(frame);
+    const VkDeviceSize stagedBytes = StageUploads(frameResources, frame);
+
+    packets.clear();
+    const uint32_t cullGroups = vktools::divideRoundUp(script.Instances, CullGroupSize);
+    packets.push_back({InstancePass, 0, 0, 0, script.Instances, cullGroups, 1, 1});
+    packets.push_back({LightingPass, 0, 0, 0, 0, 0, 0, 0});
+
+    if (capture)
+    {
+        // read back from the staging memory, capturing runs are not meant to be measured
+        const uint8_t *staging = static_cast<const uint8_t *>(frameResources.staging.mapped);
+        for (uint32_t id = 0; id < SceneBufferCount; id++)
+        {
+            for (const VkBufferCopy &copy : copies[id])
+            {
+                capture->Upload(id, copy.dstOffset, staging + copy.srcOffset, copy.size);
+            }
+        }
+        for (const CapturePacket &packet : packets)
+        {
+            capture->Submit(packet);
+        }
+    }
+    return stagedBytes;
+}
+
+/**
+ * Stage the uploads of the next captured frame and take over its camera, lights and packets
+ *
+ * @return Number of bytes staged
+ */
+VkDeviceSize SceneRunner::ReplayFrame(FrameResources &frameResources)
+{
+    CaptureFrame frame;
+    if (!replay->NextFrame(frame))
+    {
+        // InitializeReplay() made sure there is at least one complete frame
+        replay->Rewind();
+        replay->NextFrame(frame);
+    }
+
+    for (std::vector<VkBufferCopy> &bufferCopies : copies)
+    {
+        bufferCopies.clear();
+    }
+
+    uint8_t *staging = static_cast<uint8_t *>(frameResources.staging.mapped);
+    VkDeviceSize offset = 0;
+    for (const CaptureUploadView &upload : frame.Uploads)
+    {
+        const CaptureUpload &info = *upload.Upload;
+        if (info.BufferId >= SceneBufferCount || info.Offset + info.Size > sceneBuffers[info.BufferId].size ||
+            offset + info.Size > stagingBytes)
+        {
+            Log::Warning("Skipped an upload of {0} bytes outside of buffer {1} in captured frame {2}",
+                         info.Size,
+                         info.BufferId,
+                         frame.Index);
+            continue;
+        }
+        std::memcpy(staging + offset, upload.Data, info.Size);
+        AppendCopy(copies[info.BufferId], offset, info.Offset, info.Size);
+        offset += info.Size;
+    }
+
+    if (frame.Camera)
+    {
+        SetCamera(*frame.Camera);
+    }
+    // lights are only recorded when they change, looping back to the first frame must not upload them again
+    if (frame.Lights && frame.Lights != replayedLights)
+    {
+        std::vector<Light> lights(frame.LightCount);
+        std::memcpy(lights.data(), frame.Lights, sizeof(Light) * lights.size());
+        shading.SetLights(lights);
+        replayedLights = frame.Lights;
+    }
+
+    packets.clear();
+    for (const CapturePacket *packet : frame.Packets)
+    {
+        packets.push_back(*packet);
+    }
+    return offset;
+}
+
+void SceneRunner::SetCamera(const CaptureCamera &newCamera)
+{
+    camera = newCamera;
+    ExtractFrustumPlanes(camera.Projection * camera.View, cullPush.frustumPlanes);
+    cullPush.zFar = camera.ZFar;
+}
+
+void SceneRunner::RecordFrame(FrameResources &frameResources, uint32_t slot)
+{
+    const VkCommandBuffer commandBuffer = frameResources.commandBuffer;
+    const VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo();
+    Debug::CheckVulkan(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    profiler.BeginFrame(commandBuffer, slot);
+
+    // the previous frame still reads the buffers this one overwrites
+    VkMemoryBarrier reuseBarrier = vkinit::memoryBarrier();
+    reuseBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    reuseBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         1,
+                         &reuseBarrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+
+    profiler.BeginScope(commandBuffer, "Upload");
+    for (uint32_t id = 0; id < SceneBufferCount; id++)
+    {
+        if (!copies[id].empty())
+        {
+            vkCmdCopyBuffer(commandBuffer,
+                            frameResources.staging.buffer,
+                            sceneBuffers[id].buffer,
+                            static_cast<uint32_t>(copies[id].size()),
+                            copies[id].data());
+        }
+    }
+    vkCmdFillBuffer(commandBuffer, drawBuffer.buffer, 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier uploadBarrier = vkinit::memoryBarrier();
+    uploadBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    uploadBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         1,
+                         &uploadBarrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+    profiler.EndScope(commandBuffer);
+
+    for (const CapturePacket &packet : packets)
+    {
+        switch (packet.Pass)
+        {
+        case InstancePass:
+        {
+            CullPushConstants push = cullPush;
+            push.instanceCount = std::min(packet.InstanceCount, script.Instances);
+            profiler.BeginScope(commandBuffer, "Instances");
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+            vkCmdBindDescriptorSets(commandBuffer,
+                                    VK_PIPELINE_BIND_POINT_COMPUTE,
+                                    cullPipelineLayout,
+                                    0,
+                                    1,
+                                    &cullSet,
+                                    0,
+                                    nullptr);
+            vkCmdPushConstants(commandBuffer,
+                               cullPipelineLayout,
+                               VK_SHADER_STAGE_COMPUTE_BIT,
+                               0,
+                               sizeof(CullPushConstants),
+                               &push);
+            vkCmdDispatch(commandBuffer, vktools::divideRoundUp(push.instanceCount, CullGroupSize), 1, 1);
+            profiler.EndScope(commandBuffer);
+            break;
+        }
+        case LightingPass:
+            profiler.BeginScope(commandBuffer, "Lighting");
+            shading.RecordClustered(commandBuffer);
+            profiler.EndScope(commandBuffer);
+            break;
+        default:
+            break;
+        }
+    }
+
+    profiler.EndFrame(commandBuffer);
+    Debug::CheckVulkan(vkEndCommandBuffer(commandBuffer));
+}
+
+VkResult SceneRunner::CreateCullPipeline(const std::string &shaderDirectory)
+{
+    const VkDescriptorSetLayoutBinding bindings[] = {
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+        vkinit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo = vkinit::descriptorSetLayoutCreateInfo(bindings, 3);
+    Debug::CheckVulkan(vkCreateDescriptorSetLayout(device,
+                                                   &layoutInfo,
+                                                   vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
+                                                   &cullLayout));
+
+    VkDescriptorPoolSize poolSize = vkinit::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3);
+    VkDescriptorPoolCreateInfo poolInfo = vkinit::descriptorPoolCreateInfo(1, &poolSize, 1);
+    Debug::CheckVulkan(vkCreateDescriptorPool(device,
+                                              &poolInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL),
+                                              &descriptorPool));
+
+    VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocateInfo(descriptorPool, &cullLayout, 1);
+    Debug::CheckVulkan(vkAllocateDescriptorSets(device, &allocInfo, &cullSet));
+    VkDescriptorBufferInfo *instanceInfo = &sceneBuffers[InstanceData].descriptor;
+    VkDescriptorBufferInfo *materialInfo = &sceneBuffers[MaterialData].descriptor;
+    const VkWriteDescriptorSet writes[] = {
+        vkinit::writeDescriptorSet(cullSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, instanceInfo),
+        vkinit::writeDescriptorSet(cullSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, materialInfo),
+        vkinit::writeDescriptorSet(cullSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &drawBuffer.descriptor),
+    };
+    vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
+
+    VkPushConstantRange pushRange = vkinit::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                              sizeof(CullPushConstants),
+                                                              0);
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = vkinit::pipelineLayoutCreateInfo(&cullLayout, 1);
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+    Debug::CheckVulkan(vkCreatePipelineLayout(device,
+                                              &pipelineLayoutInfo,
+                                              vkhost::allocationCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT),
+                                              &cullPipelineLayout));
+
+    const VkShaderModule shader = vktools::loadShader(shaderDirectory + "/scene_instances_bench.comp.spv", device);
+    if (!shader)
+    {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    cullPipeline = vktools::createComputePipeline(device, cullPipelineLayout, shader);
+    vkDestroyShaderModule(device, shader, vkhost::allocationCallbacks(VK_OBJECT_TYPE_SHADER_MODULE));
+    return VK_SUCCESS;
+}
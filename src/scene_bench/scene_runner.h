@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "bench.h"
+#include "graphics/frame_capture.h"
+#include "graphics/gpu_profiler.h"
+#include "graphics/vulkan/vk_buffer.h"
+#include "scene/transform_hierarchy.h"
+#include "scene_script.h"
+#include "shading_workload.h"
+
+class HeadlessContext;
+class JobSystem;
+
+/** @brief Memory high water marks of a scene run in bytes */
+struct SceneMemory
+{
+    uint64_t PeakResident = 0;
+    // host memory the driver allocated through the vkhost callbacks
+    int64_t PeakDriverHost = 0;
+    // buffers created by the scene itself, including the staging rings
+    uint64_t SceneBuffers = 0;
+};
+
+struct SceneResult
+{
+    std::string Scene;
+    uint32_t WarmupFrames = 0;
+    // recording, uploads and submission on the CPU, without waiting for the GPU
+    Bench::Stats CpuMs;
+    // GPU time between the first and last command of the frame
+    Bench::Stats GpuMs;
+    // wall time from one frame start to the next
+    Bench::Stats FrameMs;
+    uint64_t UploadBytesPerFrame = 0;
+    SceneMemory Memory;
+};
+
+/**
+ * @brief Runs a SceneScript headlessly with a fixed number of frames in flight
+ *
+ * Every frame animates the transform hierarchy, copies changed transforms, material blocks and streaming data
+ * through a per frame staging buffer, frustum culls all instances on the GPU (scene_instances_bench.comp) and
+ * shades the lights through ClusteredLighting like the lighting microbenchmark.
+ *
+ * The uploads, camera, lights and packets of every frame can be written to a FrameCaptureWriter. A runner set up
+ * with InitializeReplay() skips the simulation and feeds the captured frames to the GPU unchanged instead, looping
+ * the capture if more frames are run than it holds.
+ */
+class SceneRunner
+{
+public:
+    SceneRunner();
+    ~SceneRunner();
+
+    bool Initialize(HeadlessContext &headlessContext,
+                    const SceneScript &sceneScript,
+                    FrameCaptureWriter *captureWriter = nullptr);
+    bool InitializeReplay(HeadlessContext &headlessContext, FrameCaptureReader &captureReader);
+    void Destroy();
+
+    SceneResult Run(uint32_t warmupFrames, uint32_t measuredFrames);
+
+private:
+    static constexpr uint32_t FramesInFlight = 2;
+
+    // capture buffer ids
+    enum SceneBuffer : uint32_t
+    {
+        InstanceData,
+        MaterialData,
+        StreamData,
+        SceneBufferCount,
+    };
+
+    // capture packet passes
+    enum ScenePass : uint32_t
+    {
+        InstancePass,
+        LightingPass,
+    };
+
+    struct GpuInstance
+    {
+        glm::mat4 world;
+        glm::vec4 boundingSphere;
+        glm::uvec4 material;
+    };
+
+    struct GpuMaterial
+    {
+        glm::vec4 baseColor;
+        glm::vec4 parameters;
+    };
+
+    struct CullPushConstants
+    {
+        glm::vec4 frustumPlanes[6];
+        uint32_t instanceCount;
+        uint32_t materialCount;
+        float zFar;
+    };
+
+    struct FrameResources
+    {
+        VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+        VkFence fence{VK_NULL_HANDLE};
+        Buffer staging;
+    };
+
+    bool CreateResources(HeadlessContext &headlessContext);
+    void BuildScene();
+    void SetCamera(const CaptureCamera &newCamera);
+    void Animate(uint32_t frame);
+    VkDeviceSize StageUploads(FrameResources &frameResources, uint32_t frame);
+    VkDeviceSize SimulateFrame(FrameResources &frameResources, uint32_t frame);
+    VkDeviceSize ReplayFrame(FrameResources &frameResources);
+    void RecordFrame(FrameResources &frameResources, uint32_t slot);
+    VkResult CreateCullPipeline(const std::string &shaderDirectory);
+
+    SceneScript script;
+    HeadlessContext *context = nullptr;
+    VkDevice device{VK_NULL_HANDLE};
+    std::unique_ptr<JobSystem> jobSystem;
+    FrameCaptureWriter *capture = nullptr;
+    FrameCaptureReader *replay = nullptr;
+    // light record of the capture that was applied last
+    const Light *replayedLights = nullptr;
+
+    // simulation state, unused when replaying
+    TransformHierarchy hierarchy;
+    std::vector<TransformHandle> groups;
+    std::vector<TransformHandle> instances;
+    std::vector<uint32_t> instanceMaterials;
+    std::vector<GpuMaterial> materials;
+    uint32_t nextMaterialUpdate = 0;
+    bool uploadEverything = true;
+
+    ShadingWorkload shading;
+    GpuProfiler profiler;
+    FrameResources frames[FramesInFlight];
+
+    std::array<Buffer, SceneBufferCount> sceneBuffers{};
+    Buffer drawBuffer{};
+    uint64_t sceneBufferBytes = 0;
+    VkDeviceSize stagingBytes = 0;
+
+    // work of the current frame, filled by SimulateFrame or ReplayFrame
+    std::array<std::vector<VkBufferCopy>, SceneBufferCount> copies;
+    std::vector<CapturePacket> packets;
+
+    CaptureCamera camera{};
+    CullPushConstants cullPush{};
+    VkDescriptorSetLayout cullLayout{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSet cullSet{VK_NULL_HANDLE};
+    VkPipelineLayout cullPipelineLayout{VK_NULL_HANDLE};
+    VkPipeline cullPipeline{VK_NULL_HANDLE};
+};
@@ -0,0 +1,202 @@
+#include "scene_script.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+#include "core/log.h"
+
+namespace
+{
+    std::vector<SceneScript> MakeBuiltinScenes()
+    {
+        std::vector<SceneScript> scenes;
+
+        // transform propagation and instance culling dominate
+        SceneScript instances;
+        instances.Name = "instances";
+        instances.Instances = 200'000;
+        instances.AnimatedGroups = 0.25f;
+        instances.Lights = 128;
+        instances.Materials = 16;
+        scenes.push_back(instances);
+
+        // light culling and shading dominate
+        SceneScript lights;
+        lights.Name = "lights";
+        lights.Instances = 5'000;
+        lights.AnimatedGroups = 0.05f;
+        lights.Lights = 4096;
+        lights.Materials = 16;
+        scenes.push_back(lights);
+
+        // large material table with scattered parameter updates
+        SceneScript materials;
+        materials.Name = "materials";
+        materials.Instances = 20'000;
+        materials.AnimatedGroups = 0.05f;
+        materials.Lights = 256;
+        materials.Materials = 16'384;
+        materials.MaterialUpdates = 1024;
+        scenes.push_back(materials);
+
+        // every transform plus 32 MiB of streaming data crosses the bus each frame
+        SceneScript uploads;
+        uploads.Name = "uploads";
+        uploads.Instances = 50'000;
+        uploads.AnimatedGroups = 1.0f;
+        uploads.Lights = 128;
+        uploads.Materials = 256;
+        uploads.MaterialUpdates = 256;
+        uploads.StreamBytes = 32u << 20;
+        scenes.push_back(uploads);
+
+        SceneScript mixed;
+        mixed.Name = "mixed";
+        mixed.Instances = 100'000;
+        mixed.AnimatedGroups = 0.2f;
+        mixed.Lights = 1024;
+        mixed.Materials = 4096;
+        mixed.MaterialUpdates = 256;
+        mixed.StreamBytes = 8u << 20;
+        scenes.push_back(mixed);
+
+        return scenes;
+    }
+
+    std::string Trim(const std::string &text)
+    {
+        const size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+        {
+            return {};
+        }
+        const size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    template <typename T>
+    bool ParseNumber(const std::string &text, T &value)
+    {
+        const char *end = text.data() + text.size();
+        const auto [ptr, error] = std::from_chars(text.data(), end, value);
+        return error == std::errc() && ptr == end;
+    }
+
+    bool SetField(SceneScript &scene, const std::string &key, const std::string &value)
+    {
+        if (key == "Name")
+        {
+            scene.Name = value;
+            return true;
+        }
+        if (key == "AnimatedGroups")
+        {
+            return ParseNumber(value, scene.AnimatedGroups);
+        }
+
+        const std::pair<const char *, uint32_t *> fields[] = {
+            {"Instances", &scene.Instances},
+            {"GroupSize", &scene.GroupSize},
+            {"Lights", &scene.Lights},
+            {"Materials", &scene.Materials},
+            {"MaterialUpdates", &scene.MaterialUpdates},
+            {"StreamBytes", &scene.StreamBytes},
+            {"Width", &scene.Width},
+            {"Height", &scene.Height},
+        };
+        for (const auto &[name, field] : fields)
+        {
+            if (key == name)
+            {
+                return ParseNumber(value, *field);
+            }
+        }
+        return false;
+    }
+}
+
+const std::vector<SceneScript> &BuiltinScenes()
+{
+    static const std::vector<SceneScript> scenes = MakeBuiltinScenes();
+    return scenes;
+}
+
+std::optional<SceneScript> FindBuiltinScene(const std::string &name)
+{
+    const std::vector<SceneScript> &scenes = BuiltinScenes();
+    const auto it = std::ranges::find(scenes, name, &SceneScript::Name);
+    if (it == scenes.end())
+    {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+std::optional<SceneScript> ParseSceneScript(const std::string &text, const std::string &source)
+{
+    SceneScript scene;
+    scene.Name = std::filesystem::path(source).stem().string();
+
+    std::istringstream lines(text);
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        lineNumber++;
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+
+        const size_t separator = line.find('=');
+        if (separator == std::string::npos ||
+            !SetField(scene, Trim(line.substr(0, separator)), Trim(line.substr(separator + 1))))
+        {
+            Log::Error("{0}:{1}: expected \"<field> = <value>\" with a SceneScript field, got \"{2}\"",
+                       source,
+                       lineNumber,
+                       line);
+            return std::nullopt;
+        }
+    }
+
+    scene.Instances = std::max(scene.Instances, 1u);
+    scene.GroupSize = std::max(scene.GroupSize, 1u);
+    scene.MaterialUpdates = std::min(scene.MaterialUpdates, scene.Materials);
+    scene.Materials = std::max(scene.Materials, 1u);
+    return scene;
+}
+
+std::optional<SceneScript> LoadSceneScript(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        Log::Error("Could not open scene script {0}", path);
+        return std::nullopt;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return ParseSceneScript(contents.str(), path);
+}
+
+std::string FormatSceneScript(const SceneScript &scene)
+{
+    return std::format("Name = {0}\nInstances = {1}\nGroupSize = {2}\nAnimatedGroups = {3}\nLights = {4}\n"
+                       "Materials = {5}\nMaterialUpdates = {6}\nStreamBytes = {7}\nWidth = {8}\nHeight = {9}\n",
+                       scene.Name,
+                       scene.Instances,
+                       scene.GroupSize,
+                       scene.AnimatedGroups,
+                       scene.Lights,
+                       scene.Materials,
+                       scene.MaterialUpdates,
+                       scene.StreamBytes,
+                       scene.Width,
+                       scene.Height);
+}
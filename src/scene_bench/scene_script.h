@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Parameters of one synthetic benchmark scene
+ *
+ * Instances are parented to groups of GroupSize, animating a group rotates it and moves all of its instances, so
+ * AnimatedGroups also drives how many instance transforms are uploaded each frame.
+ */
+struct SceneScript
+{
+    std::string Name = "scene";
+    uint32_t Instances = 10'000;
+    uint32_t GroupSize = 64;
+    // fraction of the groups rotated every frame
+    float AnimatedGroups = 0.1f;
+    uint32_t Lights = 256;
+    uint32_t Materials = 64;
+    // material parameter blocks rewritten and uploaded every frame
+    uint32_t MaterialUpdates = 0;
+    // extra bytes streamed into device local memory every frame, stands in for texture and mesh streaming
+    uint32_t StreamBytes = 0;
+    uint32_t Width = 1280;
+    uint32_t Height = 720;
+};
+
+/** @brief The scenes run when no script is given: instances, lights, materials, uploads and mixed */
+const std::vector<SceneScript> &BuiltinScenes();
+
+/** @brief Look up a built-in scene by name */
+std::optional<SceneScript> FindBuiltinScene(const std::string &name);
+
+/**
+ * Read a scene script, one "key = value" pair per line using the SceneScript field names, '#' starts a comment
+ *
+ * @param path Script file, the scene is named after the file unless it sets Name
+ *
+ * @return The scene or nothing if the file could not be read or contains an unknown key
+ */
+std::optional<SceneScript> LoadSceneScript(const std::string &path);
+
+/**
+ * Parse the text of a scene script, see LoadSceneScript
+ *
+ * @param source File name used for the default name and in error messages
+ */
+std::optional<SceneScript> ParseSceneScript(const std::string &text, const std::string &source);
+
+/** @brief Write a scene as a script that ParseSceneScript reads back unchanged */
+std::string FormatSceneScript(const SceneScript &scene);